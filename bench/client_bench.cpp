@@ -0,0 +1,365 @@
+// client_bench.cpp
+//
+// Times the hot paths of the client against the in-process stand-in for
+// the C library (fake_mqtt_async.cpp), so it needs no server, and the
+// numbers are for this library alone:
+//
+//   - publish() at each QoS, with the actions completed on the caller's
+//     thread, and QoS 1 with them completed from another thread
+//   - publish_nowait() at QoS 0, and publishing through a topic handle
+//   - waiting on a token that's completed from another thread
+//   - dispatching incoming messages to a callback, the consumer queue,
+//     and the message routes
+//   - making, copying and moving messages
+//   - publishing QoS 1 with the messages put in, and removed from, a
+//     user persistence store through its callbacks
+//
+// The results are printed as a table, and can also be written as JSON,
+// to be kept and compared from one build to the next.
+//
+// USAGE:
+//     client_bench [--json file] [num_msgs [payload_size]]
+//
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include "mqtt/async_client.h"
+#include "mqtt/memory_persistence.h"
+#include "fake_mqtt_async.h"
+
+using namespace std;
+using namespace std::chrono;
+
+const string SERVER_URI { "tcp://localhost:1883" };
+const string CLIENT_ID { "client_bench" };
+const string TOPIC { "bench/sensors/temperature" };
+
+const long TIMEOUT = 30000L;
+
+// The number of messages in flight, when they're acked from another thread
+const size_t WINDOW = 256;
+
+// How long the stand-in takes to ack a message, when it's not right away
+const auto ACK_DELAY = microseconds(20);
+
+/////////////////////////////////////////////////////////////////////////////
+
+// The result of one benchmark
+
+struct result
+{
+	string name;
+	size_t n;
+	double secs;
+
+	double ns_per_op() const { return 1.0e9 * secs / n; }
+	double ops_per_sec() const { return n / secs; }
+};
+
+vector<result> results;
+
+// Times 'n' operations run by 'f', and keeps the result.
+
+void run(const string& name, size_t n, function<void()> f)
+{
+	auto start = steady_clock::now();
+	f();
+	double secs = duration<double>(steady_clock::now() - start).count();
+
+	result res { name, n, secs };
+	results.push_back(res);
+
+	cout << setw(28) << left << name << right
+		<< setw(14) << fixed << setprecision(0) << res.ops_per_sec() << " op/s"
+		<< setw(12) << setprecision(1) << res.ns_per_op() << " ns/op" << endl;
+}
+
+// Writes the results as JSON.
+
+bool write_json(const string& fname, size_t nmsg, size_t sz)
+{
+	ofstream os(fname);
+	if (!os)
+		return false;
+
+	os << fixed << "{\n  \"benchmark\": \"client_bench\",\n"
+		<< "  \"num_msgs\": " << nmsg << ",\n"
+		<< "  \"payload_size\": " << sz << ",\n"
+		<< "  \"results\": [";
+
+	for (size_t i=0; i<results.size(); ++i) {
+		const auto& res = results[i];
+		os << (i ? "," : "") << "\n    { \"name\": \"" << res.name << "\""
+			<< ", \"iterations\": " << res.n
+			<< setprecision(9) << ", \"seconds\": " << res.secs
+			<< setprecision(3) << ", \"ns_per_op\": " << res.ns_per_op()
+			<< setprecision(1) << ", \"ops_per_sec\": " << res.ops_per_sec() << " }";
+	}
+	os << "\n  ]\n}\n";
+	return bool(os);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+// A callback that just counts the messages.
+
+class counting_callback : public virtual mqtt::callback
+{
+public:
+	atomic<size_t> n;
+
+	counting_callback() : n(0) {}
+
+	void connection_lost(const string&) override {}
+	void message_arrived(const string&, mqtt::const_message_ptr) override { ++n; }
+	void delivery_complete(mqtt::idelivery_token_ptr) override {}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+// Publishes at a QoS, with the actions completed on the caller's thread.
+
+void bench_publish(size_t nmsg, const string& payload, int qos)
+{
+	mqtt::async_client cli(SERVER_URI, CLIENT_ID, nullptr);
+	cli.connect()->wait_for_completion(TIMEOUT);
+
+	run("publish_qos" + to_string(qos), nmsg, [&] {
+		for (size_t i=0; i<nmsg; ++i)
+			cli.publish(TOPIC, payload.data(), payload.size(), qos, false);
+	});
+
+	cli.disconnect()->wait_for_completion(TIMEOUT);
+}
+
+// Publishes QoS 0 through a topic handle, which was resolved up front.
+
+void bench_publish_topic(size_t nmsg, const string& payload)
+{
+	mqtt::async_client cli(SERVER_URI, CLIENT_ID, nullptr);
+	cli.connect()->wait_for_completion(TIMEOUT);
+	mqtt::topic top(TOPIC, cli);
+
+	run("publish_topic_qos0", nmsg, [&] {
+		for (size_t i=0; i<nmsg; ++i)
+			top.publish(payload.data(), payload.size(), 0, false);
+	});
+
+	cli.disconnect()->wait_for_completion(TIMEOUT);
+}
+
+// Publishes QoS 1, with the acks coming from another thread, keeping a
+// window of messages in flight.
+
+void bench_publish_acked(size_t nmsg, const string& payload)
+{
+	mqtt::async_client cli(SERVER_URI, CLIENT_ID, nullptr);
+	cli.connect()->wait_for_completion(TIMEOUT);
+	cli.set_max_inflight(WINDOW);
+
+	run("publish_qos1_acked", nmsg, [&] {
+		mqtt::idelivery_token_ptr tok;
+		for (size_t i=0; i<nmsg; ++i)
+			tok = cli.publish(TOPIC, payload.data(), payload.size(), 1, false);
+		tok->wait_for_completion(TIMEOUT);
+	});
+
+	cli.disconnect()->wait_for_completion(TIMEOUT);
+}
+
+void bench_publish_nowait(size_t nmsg, const string& payload)
+{
+	mqtt::async_client cli(SERVER_URI, CLIENT_ID, nullptr);
+	cli.connect()->wait_for_completion(TIMEOUT);
+
+	run("publish_nowait_qos0", nmsg, [&] {
+		for (size_t i=0; i<nmsg; ++i)
+			cli.publish_nowait(TOPIC, payload.data(), payload.size());
+	});
+
+	cli.disconnect()->wait_for_completion(TIMEOUT);
+}
+
+// Publishes QoS 1 and waits for each one, for the round trip through the
+// token and the completion thread.
+
+void bench_token_wait(size_t nmsg, const string& payload)
+{
+	mqtt::async_client cli(SERVER_URI, CLIENT_ID, nullptr);
+	cli.connect()->wait_for_completion(TIMEOUT);
+
+	run("token_wait_qos1", nmsg, [&] {
+		for (size_t i=0; i<nmsg; ++i)
+			cli.publish(TOPIC, payload.data(), payload.size(), 1, false)
+				->wait_for_completion(TIMEOUT);
+	});
+
+	cli.disconnect()->wait_for_completion(TIMEOUT);
+}
+
+// Dispatches incoming messages to a callback, the consumer queue, and the
+// message routes.
+
+void bench_dispatch(size_t nmsg, const string& payload)
+{
+	{
+		mqtt::async_client cli(SERVER_URI, CLIENT_ID, nullptr);
+		counting_callback cb;
+		cli.set_callback(cb);
+		cli.connect()->wait_for_completion(TIMEOUT);
+
+		run("dispatch_callback", nmsg, [&] {
+			fake_mqtt::inject(CLIENT_ID, TOPIC, payload.data(), payload.size(), nmsg);
+		});
+		cli.disconnect()->wait_for_completion(TIMEOUT);
+	}
+
+	{
+		mqtt::async_client cli(SERVER_URI, CLIENT_ID, nullptr);
+		cli.start_consuming(nmsg);
+		cli.connect()->wait_for_completion(TIMEOUT);
+
+		run("dispatch_consumer", nmsg, [&] {
+			fake_mqtt::inject(CLIENT_ID, TOPIC, payload.data(), payload.size(), nmsg);
+			mqtt::const_message_ptr msg;
+			while (cli.try_consume_message(&msg))
+				;
+		});
+		cli.disconnect()->wait_for_completion(TIMEOUT);
+	}
+
+	{
+		mqtt::async_client cli(SERVER_URI, CLIENT_ID, nullptr);
+		size_t n = 0;
+		cli.add_route("bench/sensors/#", [&n](mqtt::const_message_ptr) { ++n; });
+		cli.add_route("bench/+/humidity", [&n](mqtt::const_message_ptr) { ++n; });
+		cli.connect()->wait_for_completion(TIMEOUT);
+
+		run("dispatch_route", nmsg, [&] {
+			fake_mqtt::inject(CLIENT_ID, TOPIC, payload.data(), payload.size(), nmsg);
+		});
+		cli.disconnect()->wait_for_completion(TIMEOUT);
+	}
+}
+
+// Makes, copies and moves messages.
+
+void bench_message(size_t nmsg, const string& payload)
+{
+	run("message_make", nmsg, [&] {
+		for (size_t i=0; i<nmsg; ++i)
+			mqtt::make_message(payload.data(), payload.size());
+	});
+
+	mqtt::message msg(payload.data(), payload.size());
+
+	run("message_copy", nmsg, [&] {
+		for (size_t i=0; i<nmsg; ++i)
+			mqtt::message m(msg);
+	});
+
+	run("message_move", nmsg, [&] {
+		mqtt::message m(msg);
+		for (size_t i=0; i<nmsg; ++i) {
+			mqtt::message m2(std::move(m));
+			m = std::move(m2);
+		}
+	});
+}
+
+// Publishes QoS 1 with the messages going through the callbacks of a user
+// persistence store.
+
+void bench_persistence(size_t nmsg, const string& payload)
+{
+	mqtt::memory_persistence store(64, 64 + payload.size());
+	mqtt::async_client cli(SERVER_URI, CLIENT_ID, &store);
+	cli.connect()->wait_for_completion(TIMEOUT);
+
+	run("publish_qos1_persist", nmsg, [&] {
+		for (size_t i=0; i<nmsg; ++i)
+			cli.publish(TOPIC, payload.data(), payload.size(), 1, false);
+	});
+
+	cli.disconnect()->wait_for_completion(TIMEOUT);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+	string jsonFile;
+	int iarg = 1;
+
+	if (argc > 2 && strcmp(argv[1], "--json") == 0) {
+		jsonFile = argv[2];
+		iarg = 3;
+	}
+
+	size_t nmsg = (argc > iarg) ? size_t(atol(argv[iarg])) : 100000;
+	size_t sz = (argc > iarg+1) ? size_t(atol(argv[iarg+1])) : 64;
+
+	if (nmsg == 0) {
+		cerr << "The number of messages must be more than zero" << endl;
+		return 2;
+	}
+
+	string payload(sz, 'x');
+
+	cout << "Running " << nmsg << " operations with " << sz
+		<< " byte payloads\n" << endl;
+
+	try {
+		fake_mqtt::set_completion(fake_mqtt::completion::SYNC);
+
+		for (int qos=0; qos<=2; ++qos)
+			bench_publish(nmsg, payload, qos);
+		bench_publish_nowait(nmsg, payload);
+		bench_publish_topic(nmsg, payload);
+		bench_dispatch(nmsg, payload);
+		bench_message(nmsg, payload);
+		bench_persistence(nmsg, payload);
+
+		fake_mqtt::set_completion(fake_mqtt::completion::THREAD, ACK_DELAY);
+		bench_publish_acked(nmsg, payload);
+
+		fake_mqtt::set_completion(fake_mqtt::completion::THREAD);
+		bench_token_wait(nmsg, payload);
+	}
+	catch (const mqtt::exception& exc) {
+		cerr << "Error: " << exc.what() << endl;
+		return 1;
+	}
+
+	if (!jsonFile.empty() && !write_json(jsonFile, nmsg, sz)) {
+		cerr << "Error writing " << jsonFile << endl;
+		return 1;
+	}
+
+	return 0;
+}
+
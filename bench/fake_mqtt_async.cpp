@@ -0,0 +1,503 @@
+// fake_mqtt_async.cpp
+//
+// An in-process stand-in for the parts of the Paho C MQTTAsync library
+// that the C++ library uses. The self-contained benchmarks link against
+// this instead of paho-mqtt3a, so they need no server, and measure the
+// C++ library rather than the network.
+//
+// See fake_mqtt_async.h for how it's controlled.
+//
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#include "fake_mqtt_async.h"
+#include "MQTTAsync.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <map>
+#include <atomic>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std::chrono;
+
+namespace fake_mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+using guard = std::unique_lock<std::mutex>;
+
+/** The state of a fake client */
+struct client
+{
+	std::string uri;
+	std::string clientId;
+	completion mode;
+	nanoseconds ackDelay;
+	std::atomic<bool> connected;
+	int nextId;
+
+	void* context;
+	MQTTAsync_connectionLost* connLost;
+	MQTTAsync_messageArrived* msgArrived;
+
+	MQTTClient_persistence* persist;
+	void* persistHandle;
+
+	client() : mode(completion::SYNC), ackDelay(0), connected(false), nextId(0),
+				context(nullptr), connLost(nullptr), msgArrived(nullptr),
+				persist(nullptr), persistHandle(nullptr) {}
+};
+
+/**
+ * The thread that completes the actions, in order, for the clients in
+ * completion::THREAD mode.
+ */
+class completion_thread
+{
+	struct task {
+		steady_clock::time_point due;
+		client* cli;
+		std::function<void()> fn;
+	};
+
+	std::mutex lock_;
+	std::condition_variable cond_;
+	std::deque<task> que_;
+	client* running_;
+	std::thread thr_;
+
+	void run() {
+		guard g(lock_);
+		while (true) {
+			if (que_.empty()) {
+				cond_.wait(g);
+				continue;
+			}
+			if (que_.front().due > steady_clock::now()) {
+				cond_.wait_until(g, que_.front().due);
+				continue;
+			}
+			task t = std::move(que_.front());
+			que_.pop_front();
+			running_ = t.cli;
+			g.unlock();
+			t.fn();
+			g.lock();
+			running_ = nullptr;
+			cond_.notify_all();
+		}
+	}
+
+public:
+	completion_thread() : running_(nullptr) {
+		thr_ = std::thread(&completion_thread::run, this);
+		thr_.detach();
+	}
+
+	void post(client* cli, std::function<void()> fn, nanoseconds delay) {
+		guard g(lock_);
+		// Keep them in order, even if the delay changed.
+		auto due = steady_clock::now() + delay;
+		if (!que_.empty() && que_.back().due > due)
+			due = que_.back().due;
+		que_.push_back(task{ due, cli, std::move(fn) });
+		cond_.notify_all();
+	}
+
+	void purge(client* cli) {
+		guard g(lock_);
+		for (auto p = que_.begin(); p != que_.end(); ) {
+			if (p->cli == cli)
+				p = que_.erase(p);
+			else
+				++p;
+		}
+		cond_.wait(g, [this,cli] { return running_ != cli; });
+	}
+
+	void drain() {
+		guard g(lock_);
+		cond_.wait(g, [this] { return que_.empty() && !running_; });
+	}
+};
+
+// The settings for new clients, and the clients by ID.
+std::mutex g_lock;
+completion g_mode = completion::SYNC;
+nanoseconds g_ackDelay(0);
+std::multimap<std::string, client*> g_clients;
+
+completion_thread& completer()
+{
+	// Never destroyed, as it may be running when the program exits.
+	static completion_thread* thr = new completion_thread;
+	return *thr;
+}
+
+// Runs the function now, or on the completion thread.
+void complete(client* cli, std::function<void()> fn, bool ack=false)
+{
+	if (cli->mode == completion::SYNC)
+		fn();
+	else
+		completer().post(cli, std::move(fn), ack ? cli->ackDelay : nanoseconds(0));
+}
+
+void succeed(client* cli, MQTTAsync_onSuccess* onSuccess, void* context,
+			 MQTTAsync_token tok, bool ack=false)
+{
+	if (!onSuccess)
+		return;
+
+	complete(cli, [onSuccess, context, tok] {
+		MQTTAsync_successData rsp;
+		std::memset(&rsp, 0, sizeof(rsp));
+		rsp.token = tok;
+		onSuccess(context, &rsp);
+	}, ack);
+}
+
+int check_qos(int qos)
+{
+	return (qos < 0 || qos > 2) ? MQTTASYNC_BAD_QOS : MQTTASYNC_SUCCESS;
+}
+
+}	// namespace
+
+/////////////////////////////////////////////////////////////////////////////
+
+void set_completion(completion mode, nanoseconds ackDelay /*=0*/)
+{
+	guard g(g_lock);
+	g_mode = mode;
+	g_ackDelay = ackDelay;
+}
+
+void drain()
+{
+	completer().drain();
+}
+
+size_t inject(const std::string& clientId, const std::string& topic,
+			  const void* payload, size_t n, size_t count, double rate /*=0.0*/)
+{
+	guard g(g_lock);
+	auto p = g_clients.find(clientId);
+	client* cli = (p == g_clients.end()) ? nullptr : p->second;
+	g.unlock();
+
+	if (!cli || !cli->connected || !cli->msgArrived)
+		return 0;
+
+	auto start = steady_clock::now();
+
+	for (size_t i=0; i<count; ++i) {
+		if (rate > 0.0)
+			std::this_thread::sleep_until(start + duration_cast<nanoseconds>(
+									duration<double>(double(i) / rate)));
+
+		// The C library hands over buffers that the callback frees
+		auto msg = static_cast<MQTTAsync_message*>(std::malloc(sizeof(MQTTAsync_message)));
+		*msg = MQTTAsync_message(MQTTAsync_message_initializer);
+		msg->payload = std::malloc(n ? n : 1);
+		if (n > 0)
+			std::memcpy(msg->payload, payload, n);
+		msg->payloadlen = int(n);
+
+		char* topicName = static_cast<char*>(std::malloc(topic.size()+1));
+		std::strcpy(topicName, topic.c_str());
+
+		if (!cli->msgArrived(cli->context, topicName, int(topic.size()), msg)) {
+			MQTTAsync_freeMessage(&msg);
+			MQTTAsync_free(topicName);
+		}
+	}
+	return count;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace fake_mqtt
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// The C API
+
+using fake_mqtt::client;
+
+extern "C" {
+
+int MQTTAsync_create(MQTTAsync* handle, const char* serverURI, const char* clientId,
+					 int persistence_type, void* persistence_context)
+{
+	auto cli = new client;
+	cli->uri = serverURI ? serverURI : "";
+	cli->clientId = clientId ? clientId : "";
+
+	{
+		fake_mqtt::guard g(fake_mqtt::g_lock);
+		cli->mode = fake_mqtt::g_mode;
+		cli->ackDelay = fake_mqtt::g_ackDelay;
+		fake_mqtt::g_clients.emplace(cli->clientId, cli);
+	}
+
+	if (persistence_type == MQTTCLIENT_PERSISTENCE_USER && persistence_context) {
+		cli->persist = static_cast<MQTTClient_persistence*>(persistence_context);
+		int rc = cli->persist->popen(&cli->persistHandle, cli->clientId.c_str(),
+									 cli->uri.c_str(), cli->persist->context);
+		if (rc != 0)
+			cli->persist = nullptr;
+	}
+
+	*handle = cli;
+	return MQTTASYNC_SUCCESS;
+}
+
+void MQTTAsync_destroy(MQTTAsync* handle)
+{
+	if (!handle || !*handle)
+		return;
+
+	auto cli = static_cast<client*>(*handle);
+	if (cli->mode == fake_mqtt::completion::THREAD)
+		fake_mqtt::completer().purge(cli);
+
+	{
+		fake_mqtt::guard g(fake_mqtt::g_lock);
+		auto rng = fake_mqtt::g_clients.equal_range(cli->clientId);
+		for (auto p = rng.first; p != rng.second; ++p) {
+			if (p->second == cli) {
+				fake_mqtt::g_clients.erase(p);
+				break;
+			}
+		}
+	}
+
+	if (cli->persist)
+		cli->persist->pclose(cli->persistHandle);
+
+	delete cli;
+	*handle = nullptr;
+}
+
+int MQTTAsync_setCallbacks(MQTTAsync handle, void* context,
+						   MQTTAsync_connectionLost* cl,
+						   MQTTAsync_messageArrived* ma,
+						   MQTTAsync_deliveryComplete* /*dc*/)
+{
+	auto cli = static_cast<client*>(handle);
+	cli->context = context;
+	cli->connLost = cl;
+	cli->msgArrived = ma;
+	return MQTTASYNC_SUCCESS;
+}
+
+int MQTTAsync_connect(MQTTAsync handle, const MQTTAsync_connectOptions* options)
+{
+	auto cli = static_cast<client*>(handle);
+	if (options->will && fake_mqtt::check_qos(options->will->qos) != MQTTASYNC_SUCCESS)
+		return MQTTASYNC_BAD_QOS;
+
+	auto onSuccess = options->onSuccess;
+	void* context = options->context;
+
+	fake_mqtt::complete(cli, [cli, onSuccess, context] {
+		cli->connected = true;
+		if (onSuccess) {
+			MQTTAsync_successData rsp;
+			std::memset(&rsp, 0, sizeof(rsp));
+			onSuccess(context, &rsp);
+		}
+	});
+	return MQTTASYNC_SUCCESS;
+}
+
+int MQTTAsync_disconnect(MQTTAsync handle, const MQTTAsync_disconnectOptions* options)
+{
+	auto cli = static_cast<client*>(handle);
+	if (!cli->connected)
+		return MQTTASYNC_DISCONNECTED;
+
+	auto onSuccess = options->onSuccess;
+	void* context = options->context;
+
+	fake_mqtt::complete(cli, [cli, onSuccess, context] {
+		cli->connected = false;
+		if (onSuccess) {
+			MQTTAsync_successData rsp;
+			std::memset(&rsp, 0, sizeof(rsp));
+			onSuccess(context, &rsp);
+		}
+	});
+	return MQTTASYNC_SUCCESS;
+}
+
+int MQTTAsync_isConnected(MQTTAsync handle)
+{
+	return static_cast<client*>(handle)->connected ? 1 : 0;
+}
+
+int MQTTAsync_subscribe(MQTTAsync handle, const char* /*topic*/, int qos,
+						MQTTAsync_responseOptions* response)
+{
+	auto cli = static_cast<client*>(handle);
+	if (!cli->connected)
+		return MQTTASYNC_DISCONNECTED;
+	if (fake_mqtt::check_qos(qos) != MQTTASYNC_SUCCESS)
+		return MQTTASYNC_BAD_QOS;
+
+	if (response) {
+		response->token = ++cli->nextId;
+		fake_mqtt::succeed(cli, response->onSuccess, response->context, response->token);
+	}
+	return MQTTASYNC_SUCCESS;
+}
+
+int MQTTAsync_subscribeMany(MQTTAsync handle, int count, char* const* /*topic*/,
+							int* qos, MQTTAsync_responseOptions* response)
+{
+	auto cli = static_cast<client*>(handle);
+	if (!cli->connected)
+		return MQTTASYNC_DISCONNECTED;
+	for (int i=0; i<count; ++i) {
+		if (fake_mqtt::check_qos(qos[i]) != MQTTASYNC_SUCCESS)
+			return MQTTASYNC_BAD_QOS;
+	}
+
+	if (response) {
+		response->token = ++cli->nextId;
+		fake_mqtt::succeed(cli, response->onSuccess, response->context, response->token);
+	}
+	return MQTTASYNC_SUCCESS;
+}
+
+int MQTTAsync_unsubscribe(MQTTAsync handle, const char* /*topic*/,
+						  MQTTAsync_responseOptions* response)
+{
+	auto cli = static_cast<client*>(handle);
+	if (!cli->connected)
+		return MQTTASYNC_DISCONNECTED;
+
+	if (response) {
+		response->token = ++cli->nextId;
+		fake_mqtt::succeed(cli, response->onSuccess, response->context, response->token);
+	}
+	return MQTTASYNC_SUCCESS;
+}
+
+int MQTTAsync_unsubscribeMany(MQTTAsync handle, int /*count*/, char* const* /*topic*/,
+							  MQTTAsync_responseOptions* response)
+{
+	auto cli = static_cast<client*>(handle);
+	if (!cli->connected)
+		return MQTTASYNC_DISCONNECTED;
+
+	if (response) {
+		response->token = ++cli->nextId;
+		fake_mqtt::succeed(cli, response->onSuccess, response->context, response->token);
+	}
+	return MQTTASYNC_SUCCESS;
+}
+
+int MQTTAsync_sendMessage(MQTTAsync handle, const char* /*destinationName*/,
+						  const MQTTAsync_message* msg,
+						  MQTTAsync_responseOptions* response)
+{
+	auto cli = static_cast<client*>(handle);
+	if (!cli->connected)
+		return MQTTASYNC_DISCONNECTED;
+	if (fake_mqtt::check_qos(msg->qos) != MQTTASYNC_SUCCESS)
+		return MQTTASYNC_BAD_QOS;
+
+	MQTTAsync_token tok = 0;
+	std::string key;
+
+	if (msg->qos > 0) {
+		tok = ++cli->nextId;
+		if (cli->nextId == 65535)
+			cli->nextId = 0;
+
+		// The C library keeps each message in the store until it's acked,
+		// as a header and the payload.
+		if (cli->persist) {
+			key = "s-" + std::to_string(tok);
+			char hdr[4] = { char(0x30 | (msg->qos << 1)), 0, char(tok >> 8), char(tok) };
+			char* bufs[] = { hdr, static_cast<char*>(msg->payload) };
+			int lens[] = { int(sizeof(hdr)), msg->payloadlen };
+			if (cli->persist->pput(cli->persistHandle, const_cast<char*>(key.c_str()),
+								   2, bufs, lens) != 0)
+				return MQTTASYNC_PERSISTENCE_ERROR;
+		}
+	}
+
+	if (response)
+		response->token = tok;
+
+	MQTTAsync_onSuccess* onSuccess = response ? response->onSuccess : nullptr;
+	void* context = response ? response->context : nullptr;
+
+	if (!key.empty()) {
+		fake_mqtt::complete(cli, [cli, key, onSuccess, context, tok] {
+			cli->persist->premove(cli->persistHandle, const_cast<char*>(key.c_str()));
+			if (onSuccess) {
+				MQTTAsync_successData rsp;
+				std::memset(&rsp, 0, sizeof(rsp));
+				rsp.token = tok;
+				onSuccess(context, &rsp);
+			}
+		}, true);
+	}
+	else
+		fake_mqtt::succeed(cli, onSuccess, context, tok, msg->qos > 0);
+
+	return MQTTASYNC_SUCCESS;
+}
+
+int MQTTAsync_send(MQTTAsync handle, const char* destinationName, int payloadlen,
+				   void* payload, int qos, int retained,
+				   MQTTAsync_responseOptions* response)
+{
+	MQTTAsync_message msg = MQTTAsync_message_initializer;
+	msg.payload = payload;
+	msg.payloadlen = payloadlen;
+	msg.qos = qos;
+	msg.retained = retained;
+	return MQTTAsync_sendMessage(handle, destinationName, &msg, response);
+}
+
+void MQTTAsync_freeMessage(MQTTAsync_message** msg)
+{
+	if (msg && *msg) {
+		std::free((*msg)->payload);
+		std::free(*msg);
+		*msg = nullptr;
+	}
+}
+
+void MQTTAsync_free(void* ptr)
+{
+	std::free(ptr);
+}
+
+}	// extern "C"
+
@@ -0,0 +1,89 @@
+// fake_mqtt_async.h
+//
+// Controls for the in-process stand-in for the Paho C MQTTAsync library
+// that the self-contained benchmarks link against instead of the real one.
+//
+// The stand-in has no network. Connects, subscribes and publishes succeed
+// as long as the client is "connected", and are completed either right
+// away, on the caller's thread, or from a completion thread after an
+// optional delay, like the acknowledgment from a server. Incoming
+// messages are injected by the benchmark at a chosen rate.
+//
+// If the client was created with user persistence, the stand-in opens the
+// store and puts and removes each QoS 1 and 2 message through its
+// callbacks, as the C library does.
+//
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __fake_mqtt_async_h
+#define __fake_mqtt_async_h
+
+#include <string>
+#include <chrono>
+#include <cstddef>
+
+namespace fake_mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * How the stand-in completes the actions that it accepts.
+ */
+enum class completion {
+	/** Completed on the caller's thread, before the C call returns */
+	SYNC,
+	/** Completed in order from a separate thread, after the ack delay */
+	THREAD
+};
+
+/**
+ * Sets how actions are completed, for the clients created after this.
+ * @param mode Completion on the caller's thread, or a completion thread.
+ * @param ackDelay For the completion thread, how long after the call
+ *  			   each QoS 1 or 2 publish is acknowledged.
+ */
+void set_completion(completion mode,
+					std::chrono::nanoseconds ackDelay=std::chrono::nanoseconds(0));
+
+/**
+ * Waits for the completion thread to finish all the work it was given.
+ */
+void drain();
+
+/**
+ * Delivers messages to a client, as if they came from the server.
+ * They're delivered on the calling thread.
+ * @param clientId The ID of the client.
+ * @param topic The topic of the messages.
+ * @param payload The payload of each message.
+ * @param n The size of the payload.
+ * @param count The number of messages to deliver.
+ * @param rate The number of messages per second, or zero for as fast as
+ *  		   the client takes them.
+ * @return The number of messages that were delivered; zero if there's no
+ *  	   client with the ID, or it's not connected.
+ */
+size_t inject(const std::string& clientId, const std::string& topic,
+			  const void* payload, size_t n, size_t count, double rate=0.0);
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace fake_mqtt
+}
+
+#endif		// __fake_mqtt_async_h
+
@@ -0,0 +1,408 @@
+// load_gen.cpp
+//
+// Measures the throughput and latency of the whole stack, this library and
+// the Paho C library under it, with a number of publishers all sending to
+// one topic (fan in), and a number of subscribers that each receive all of
+// the messages (fan out).
+//
+// It reports the rate at which the messages were published and received,
+// and the 50th, 99th and 99.9th percentile of the publish-ack latency: the
+// time from the call to publish() until the token for the message is
+// complete. When the payload is big enough to hold a timestamp, it also
+// reports the latency from publish() to the arrival at the subscribers.
+//
+// By default, it starts the loopback server from loopback_broker.h in the
+// same process, so it needs no outside services and the runs can be
+// repeated. Use --uri to test with another server.
+//
+// The --scenario option sets up runs like the sample applications:
+//
+//   async_publish  One publisher, QoS 1, with the messages pipelined, as
+//                  by the async_client in the async_publish sample.
+//   sync_publish   One publisher, QoS 1, that waits for each message to
+//                  be acknowledged before sending the next, as the
+//                  synchronous client in the sync_publish sample does.
+//
+// The other options can then change any part of the scenario.
+//
+// USAGE:
+//     load_gen [options]
+//
+//     --uri URI         The server; otherwise the loopback server is used
+//     --scenario NAME   async_publish or sync_publish
+//     --qos N           The QoS of the messages [1]
+//     --size N          The payload size in bytes [64]
+//     --count N         The number of messages for each publisher [100000]
+//     --pubs N          The number of publishers [1]
+//     --subs N          The number of subscribers [0]
+//     --window N        The most messages each publisher keeps in flight,
+//                       or zero for no limit [1000]
+//     --json FILE       Write the results to the file as JSON
+//
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "mqtt/async_client.h"
+#include "mqtt/client_metrics.h"
+#include "loopback_broker.h"
+
+using namespace std;
+using namespace std::chrono;
+
+const string TOPIC { "load_gen/data" };
+
+const long TIMEOUT = 30000L;
+
+// How long to wait for the subscribers to get all the messages
+const auto RECV_TIMEOUT = seconds(60);
+
+/////////////////////////////////////////////////////////////////////////////
+
+// The settings for a run
+
+struct settings
+{
+	string uri;
+	int qos;
+	size_t size;
+	size_t count;
+	int npub;
+	int nsub;
+	size_t window;
+
+	settings() : qos(1), size(64), count(100000), npub(1), nsub(0), window(1000) {}
+};
+
+// The latencies, in nanoseconds
+
+mqtt::latency_histogram ackLatency, deliveryLatency;
+
+// The time now, as nanoseconds, for the timestamps in the payloads
+
+static inline uint64_t now_ns()
+{
+	return uint64_t(duration_cast<nanoseconds>(
+				steady_clock::now().time_since_epoch()).count());
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+// A publisher. It's the listener for its own messages, and gets the index
+// of each one as the user context, to find the time it was sent.
+
+class publisher : public virtual mqtt::iaction_listener
+{
+	mqtt::async_client cli_;
+	vector<steady_clock::time_point> sendTimes_;
+	atomic<size_t> ndone_, nfail_;
+
+	void on_success(const mqtt::itoken& tok) override {
+		auto i = reinterpret_cast<uintptr_t>(tok.get_user_context());
+		ackLatency.record(steady_clock::now() - sendTimes_[i]);
+		++ndone_;
+	}
+
+	void on_failure(const mqtt::itoken&) override {
+		++nfail_;
+		++ndone_;
+	}
+
+public:
+	publisher(const string& uri, const string& clientId, size_t count)
+		: cli_(uri, clientId, nullptr), sendTimes_(count), ndone_(0), nfail_(0) {}
+
+	void connect(size_t window) {
+		mqtt::connect_options connOpts;
+		connOpts.set_clean_session(true);
+		cli_.connect(connOpts)->wait_for_completion(TIMEOUT);
+		if (window > 0)
+			cli_.set_max_inflight(window);
+	}
+
+	void run(const settings& s) {
+		string payload(s.size, 'x');
+
+		for (size_t i=0; i<s.count; ++i) {
+			sendTimes_[i] = steady_clock::now();
+			if (s.size >= sizeof(uint64_t)) {
+				uint64_t ns = now_ns();
+				memcpy(&payload[0], &ns, sizeof(ns));
+			}
+			cli_.publish(TOPIC, payload.data(), payload.size(), s.qos, false,
+						 reinterpret_cast<void*>(uintptr_t(i)), *this);
+		}
+
+		auto deadline = steady_clock::now() + RECV_TIMEOUT;
+		while (ndone_ < s.count && steady_clock::now() < deadline)
+			this_thread::sleep_for(microseconds(100));
+	}
+
+	size_t num_failed() const { return nfail_; }
+
+	void disconnect() {
+		cli_.disconnect()->wait_for_completion(TIMEOUT);
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+// A subscriber, which counts the messages and records their latency.
+
+class subscriber : public virtual mqtt::callback
+{
+	mqtt::async_client cli_;
+	atomic<size_t> n_;
+	bool timestamps_;
+
+	void connection_lost(const string&) override {}
+	void delivery_complete(mqtt::idelivery_token_ptr) override {}
+
+	void message_arrived(const string&, mqtt::const_message_ptr msg) override {
+		if (timestamps_ && msg->get_payload_length() >= sizeof(uint64_t)) {
+			uint64_t ns;
+			memcpy(&ns, msg->get_payload_bytes(), sizeof(ns));
+			uint64_t t = now_ns();
+			deliveryLatency.record(t > ns ? t - ns : 0);
+		}
+		++n_;
+	}
+
+public:
+	subscriber(const string& uri, const string& clientId, bool timestamps)
+		: cli_(uri, clientId, nullptr), n_(0), timestamps_(timestamps) {}
+
+	void connect(int qos) {
+		mqtt::connect_options connOpts;
+		connOpts.set_clean_session(true);
+		cli_.set_callback(*this);
+		cli_.connect(connOpts)->wait_for_completion(TIMEOUT);
+		cli_.subscribe(TOPIC, qos)->wait_for_completion(TIMEOUT);
+	}
+
+	size_t num_received() const { return n_; }
+
+	void disconnect() {
+		cli_.disconnect()->wait_for_completion(TIMEOUT);
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+// Prints the percentiles of a histogram, in microseconds.
+
+void print_latency(const string& name, const mqtt::latency_histogram& h)
+{
+	cout << setw(18) << left << name << right << fixed << setprecision(1)
+		<< "p50: " << setw(9) << (h.percentile(50.0) / 1.0e3) << " us"
+		<< "   p99: " << setw(9) << (h.percentile(99.0) / 1.0e3) << " us"
+		<< "   p99.9: " << setw(9) << (h.percentile(99.9) / 1.0e3) << " us"
+		<< "   max: " << setw(9) << (h.max() / 1.0e3) << " us" << endl;
+}
+
+// Writes the percentiles of a histogram as a JSON object, in microseconds.
+
+void write_latency(ostream& os, const mqtt::latency_histogram& h)
+{
+	os << "{ \"count\": " << h.count()
+		<< ", \"p50_us\": " << (h.percentile(50.0) / 1.0e3)
+		<< ", \"p99_us\": " << (h.percentile(99.0) / 1.0e3)
+		<< ", \"p999_us\": " << (h.percentile(99.9) / 1.0e3)
+		<< ", \"max_us\": " << (h.max() / 1.0e3) << " }";
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+void usage()
+{
+	cerr << "USAGE: load_gen [--uri URI] [--scenario async_publish|sync_publish]\n"
+		 << "                [--qos N] [--size N] [--count N] [--pubs N] [--subs N]\n"
+		 << "                [--window N] [--json FILE]" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	settings s;
+	string scenario, jsonFile;
+
+	for (int i=1; i<argc; ++i) {
+		string opt = argv[i];
+		if (i+1 == argc) {
+			usage();
+			return 2;
+		}
+		const char* val = argv[++i];
+
+		if (opt == "--scenario") {
+			scenario = val;
+			if (scenario == "async_publish") {
+				s.qos = 1; s.npub = 1; s.window = 1000;
+			}
+			else if (scenario == "sync_publish") {
+				s.qos = 1; s.npub = 1; s.window = 1;
+			}
+			else {
+				cerr << "Unknown scenario: " << scenario << endl;
+				return 2;
+			}
+		}
+		else if (opt == "--uri")	s.uri = val;
+		else if (opt == "--qos")	s.qos = atoi(val);
+		else if (opt == "--size")	s.size = size_t(atol(val));
+		else if (opt == "--count")	s.count = size_t(atol(val));
+		else if (opt == "--pubs")	s.npub = atoi(val);
+		else if (opt == "--subs")	s.nsub = atoi(val);
+		else if (opt == "--window")	s.window = size_t(atol(val));
+		else if (opt == "--json")	jsonFile = val;
+		else {
+			usage();
+			return 2;
+		}
+	}
+
+	if (s.qos < 0 || s.qos > 2 || s.count == 0 || s.npub < 1 || s.nsub < 0) {
+		usage();
+		return 2;
+	}
+
+	unique_ptr<loopback::broker> brkr;
+	if (s.uri.empty()) {
+		brkr.reset(new loopback::broker());
+		s.uri = brkr->uri();
+	}
+
+	cout << "Server:      " << s.uri << (brkr ? " (loopback)" : "") << "\n"
+		<< "Publishers:  " << s.npub << " x " << s.count << " messages, QoS " << s.qos
+		<< ", " << s.size << " bytes, window " << s.window << "\n"
+		<< "Subscribers: " << s.nsub << "\n" << endl;
+
+	vector<unique_ptr<publisher>> pubs;
+	vector<unique_ptr<subscriber>> subs;
+
+	size_t nexpected = s.count * size_t(s.npub);
+	double pubSecs = 0.0, recvSecs = 0.0;
+	size_t nrecv = 0, nfail = 0;
+
+	try {
+		bool timestamps = (s.size >= sizeof(uint64_t));
+		for (int i=0; i<s.nsub; ++i) {
+			subs.emplace_back(new subscriber(s.uri, "load_gen_sub_" + to_string(i), timestamps));
+			subs.back()->connect(s.qos);
+		}
+
+		for (int i=0; i<s.npub; ++i) {
+			pubs.emplace_back(new publisher(s.uri, "load_gen_pub_" + to_string(i), s.count));
+			pubs.back()->connect(s.window);
+		}
+
+		auto start = steady_clock::now();
+
+		vector<thread> thrs;
+		for (auto& pub : pubs)
+			thrs.emplace_back([&pub, &s] { pub->run(s); });
+
+		for (auto& thr : thrs)
+			thr.join();
+
+		pubSecs = duration<double>(steady_clock::now() - start).count();
+
+		// Wait for the subscribers to catch up
+		auto deadline = steady_clock::now() + RECV_TIMEOUT;
+		while (true) {
+			nrecv = 0;
+			for (const auto& sub : subs)
+				nrecv += sub->num_received();
+			if (nrecv >= nexpected * subs.size() || steady_clock::now() >= deadline)
+				break;
+			this_thread::sleep_for(milliseconds(1));
+		}
+		recvSecs = duration<double>(steady_clock::now() - start).count();
+
+		for (auto& pub : pubs) {
+			nfail += pub->num_failed();
+			pub->disconnect();
+		}
+		for (auto& sub : subs)
+			sub->disconnect();
+	}
+	catch (const mqtt::exception& exc) {
+		cerr << "Error: " << exc.what() << endl;
+		return 1;
+	}
+
+	double pubRate = nexpected / pubSecs,
+		   recvRate = (nrecv > 0) ? (nrecv / recvSecs) : 0.0;
+
+	cout << "Published:  " << setw(10) << nexpected << " msgs in " << fixed
+		<< setprecision(3) << pubSecs << " s, " << setprecision(0)
+		<< setw(10) << pubRate << " msgs/s";
+	if (nfail > 0)
+		cout << " (" << nfail << " failed)";
+	cout << endl;
+
+	if (!subs.empty()) {
+		cout << "Received:   " << setw(10) << nrecv << " msgs in " << setprecision(3)
+			<< recvSecs << " s, " << setprecision(0) << setw(10) << recvRate
+			<< " msgs/s" << endl;
+	}
+	cout << endl;
+
+	print_latency("Publish-ack", ackLatency);
+	if (deliveryLatency.count() > 0)
+		print_latency("Delivery", deliveryLatency);
+
+	if (!jsonFile.empty()) {
+		ofstream os(jsonFile);
+		os << fixed << setprecision(1)
+			<< "{\n  \"benchmark\": \"load_gen\",\n"
+			<< "  \"scenario\": \"" << scenario << "\",\n"
+			<< "  \"loopback\": " << (brkr ? "true" : "false") << ",\n"
+			<< "  \"qos\": " << s.qos << ",\n"
+			<< "  \"payload_size\": " << s.size << ",\n"
+			<< "  \"publishers\": " << s.npub << ",\n"
+			<< "  \"subscribers\": " << s.nsub << ",\n"
+			<< "  \"window\": " << s.window << ",\n"
+			<< "  \"published\": " << nexpected << ",\n"
+			<< "  \"failed\": " << nfail << ",\n"
+			<< "  \"publish_msgs_per_sec\": " << pubRate << ",\n"
+			<< "  \"received\": " << nrecv << ",\n"
+			<< "  \"receive_msgs_per_sec\": " << recvRate << ",\n"
+			<< "  \"publish_ack_latency\": ";
+		write_latency(os, ackLatency);
+		os << ",\n  \"delivery_latency\": ";
+		write_latency(os, deliveryLatency);
+		os << "\n}\n";
+
+		if (!os) {
+			cerr << "Error writing " << jsonFile << endl;
+			return 1;
+		}
+	}
+
+	return (nfail > 0 || nrecv < nexpected * subs.size()) ? 1 : 0;
+}
+
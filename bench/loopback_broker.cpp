@@ -0,0 +1,543 @@
+// loopback_broker.cpp
+//
+// A minimal MQTT v3.1.1 server on the loopback interface, for tests and
+// benchmarks. See loopback_broker.h
+//
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#include "loopback_broker.h"
+#include <system_error>
+#include <algorithm>
+#include <utility>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+namespace loopback {
+
+using guard = std::unique_lock<std::mutex>;
+
+// The MQTT control packet types
+enum packet_type : uint8_t {
+	CONNECT = 1, CONNACK, PUBLISH, PUBACK, PUBREC, PUBREL, PUBCOMP,
+	SUBSCRIBE, SUBACK, UNSUBSCRIBE, UNSUBACK, PINGREQ, PINGRESP, DISCONNECT
+};
+
+// The largest packet that we'll accept, as a sanity check on the length.
+static const size_t MAX_PACKET_SIZE = 256*1024*1024;
+
+/////////////////////////////////////////////////////////////////////////////
+// Packet encoding and decoding
+
+// Appends the "remaining length" of a packet.
+static void put_length(std::string& s, size_t n)
+{
+	do {
+		uint8_t b = uint8_t(n % 128);
+		n /= 128;
+		if (n > 0)
+			b |= 0x80;
+		s.push_back(char(b));
+	}
+	while (n > 0);
+}
+
+static void put16(std::string& s, uint16_t v)
+{
+	s.push_back(char(v >> 8));
+	s.push_back(char(v & 0xFF));
+}
+
+// Makes a packet with just a packet ID, like the acks.
+static std::string id_packet(uint8_t hdr, uint16_t id)
+{
+	std::string s;
+	s.push_back(char(hdr));
+	s.push_back(char(2));
+	put16(s, id);
+	return s;
+}
+
+// Reads a 16-bit value from a packet body.
+static bool get16(const std::string& body, size_t& pos, uint16_t& v)
+{
+	if (pos + 2 > body.size())
+		return false;
+	v = uint16_t((uint8_t(body[pos]) << 8) | uint8_t(body[pos+1]));
+	pos += 2;
+	return true;
+}
+
+// Reads a length-prefixed string from a packet body.
+static bool get_string(const std::string& body, size_t& pos, std::string& s)
+{
+	uint16_t n;
+	if (!get16(body, pos, n) || pos + n > body.size())
+		return false;
+	s.assign(body, pos, n);
+	pos += n;
+	return true;
+}
+
+// Reads exactly 'n' bytes from a socket.
+static bool read_full(int sock, void* buf, size_t n)
+{
+	char* p = static_cast<char*>(buf);
+	while (n > 0) {
+		ssize_t ret = ::recv(sock, p, n, 0);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return false;
+		p += ret;
+		n -= size_t(ret);
+	}
+	return true;
+}
+
+// Reads a whole packet from a socket: the first byte of the header, and
+// the body.
+static bool read_packet(int sock, uint8_t& hdr, std::string& body)
+{
+	if (!read_full(sock, &hdr, 1))
+		return false;
+
+	size_t n = 0, mult = 1;
+	for (int i=0; ; ++i) {
+		uint8_t b;
+		if (i == 4 || !read_full(sock, &b, 1))
+			return false;
+		n += (b & 0x7F) * mult;
+		if ((b & 0x80) == 0)
+			break;
+		mult *= 128;
+	}
+
+	if (n > MAX_PACKET_SIZE)
+		return false;
+
+	body.resize(n);
+	return n == 0 || read_full(sock, &body[0], n);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// session
+
+struct broker::session
+{
+	/** The socket, or -1 after it's closed */
+	int sock;
+	/** Whether the client is connected */
+	std::atomic<bool> connected;
+	/** The thread serving the session */
+	std::thread thr;
+	/** Lock for writing to the socket, and for the packet IDs */
+	std::mutex wlock;
+	/** The last packet ID used for a message to the client */
+	uint16_t lastId;
+	/** Lock for the subscriptions */
+	std::mutex sublock;
+	/** The subscriptions, as topic filter and granted QoS */
+	std::vector<std::pair<std::string,int>> subs;
+
+	explicit session(int s) : sock(s), connected(false), lastId(0) {}
+
+	// Writes a packet. The caller must hold the write lock.
+	bool write(const std::string& pkt) {
+		const char* p = pkt.data();
+		size_t n = pkt.size();
+		while (n > 0) {
+			if (sock < 0)
+				return false;
+			ssize_t ret = ::send(sock, p, n, MSG_NOSIGNAL);
+			if (ret < 0 && errno == EINTR)
+				continue;
+			if (ret <= 0)
+				return false;
+			p += ret;
+			n -= size_t(ret);
+		}
+		return true;
+	}
+
+	bool send(const std::string& pkt) {
+		guard g(wlock);
+		return write(pkt);
+	}
+
+	// Sends a message to the client.
+	bool send_publish(const std::string& topic, const char* payload,
+					  size_t n, int qos) {
+		std::string pkt;
+		size_t len = 2 + topic.size() + (qos > 0 ? 2 : 0) + n;
+		pkt.reserve(len + 5);
+		pkt.push_back(char((PUBLISH << 4) | (qos << 1)));
+		put_length(pkt, len);
+		put16(pkt, uint16_t(topic.size()));
+		pkt.append(topic);
+
+		guard g(wlock);
+		if (qos > 0) {
+			if (++lastId == 0)
+				lastId = 1;
+			put16(pkt, lastId);
+		}
+		pkt.append(payload, n);
+		return write(pkt);
+	}
+
+	// Finds the highest QoS of the subscriptions that match a topic.
+	// Returns -1 if there are none.
+	int match(const std::string& topic) {
+		int qos = -1;
+		guard g(sublock);
+		for (const auto& sub : subs) {
+			if (sub.second > qos && broker::topic_matches(sub.first, topic))
+				qos = sub.second;
+		}
+		return qos;
+	}
+
+	// Closes the connection. Any thread blocked reading the socket returns.
+	void close() {
+		connected = false;
+		guard g(wlock);
+		if (sock >= 0) {
+			::shutdown(sock, SHUT_RDWR);
+			::close(sock);
+			sock = -1;
+		}
+	}
+
+	// Shuts down the connection, to wake the session thread, leaving it
+	// to close the socket.
+	void shutdown() {
+		guard g(wlock);
+		if (sock >= 0)
+			::shutdown(sock, SHUT_RDWR);
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// broker
+
+broker::broker(uint16_t port /*=0*/)
+			: sock_(-1), port_(0), stopping_(false), nrecv_(0), nsent_(0)
+{
+	sock_ = ::socket(AF_INET, SOCK_STREAM, 0);
+	if (sock_ < 0)
+		throw std::system_error(errno, std::generic_category(), "socket");
+
+	int on = 1;
+	::setsockopt(sock_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+	sockaddr_in addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+
+	socklen_t len = sizeof(addr);
+
+	if (::bind(sock_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0
+			|| ::listen(sock_, SOMAXCONN) < 0
+			|| ::getsockname(sock_, reinterpret_cast<sockaddr*>(&addr), &len) < 0) {
+		int err = errno;
+		::close(sock_);
+		throw std::system_error(err, std::generic_category(), "bind");
+	}
+
+	port_ = ntohs(addr.sin_port);
+	acceptThr_ = std::thread(&broker::accept_loop, this);
+}
+
+broker::~broker()
+{
+	stop();
+}
+
+void broker::stop()
+{
+	if (stopping_.exchange(true))
+		return;
+
+	// This wakes the thread blocked in accept()
+	::shutdown(sock_, SHUT_RDWR);
+	acceptThr_.join();
+	::close(sock_);
+
+	std::vector<session_ptr> sessions;
+	{
+		guard g(lock_);
+		sessions.swap(sessions_);
+	}
+
+	for (auto& ses : sessions)
+		ses->shutdown();
+
+	for (auto& ses : sessions)
+		ses->thr.join();
+}
+
+std::string broker::uri() const
+{
+	return "tcp://127.0.0.1:" + std::to_string(port_);
+}
+
+size_t broker::num_clients() const
+{
+	return live_sessions().size();
+}
+
+std::vector<broker::session_ptr> broker::live_sessions() const
+{
+	std::vector<session_ptr> sessions;
+	guard g(lock_);
+	for (const auto& ses : sessions_) {
+		if (ses->connected)
+			sessions.push_back(ses);
+	}
+	return sessions;
+}
+
+void broker::accept_loop()
+{
+	while (!stopping_) {
+		int sock = ::accept(sock_, nullptr, nullptr);
+		if (sock < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			break;
+		}
+
+		int on = 1;
+		::setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+		auto ses = std::make_shared<session>(sock);
+
+		guard g(lock_);
+		if (stopping_) {
+			g.unlock();
+			ses->close();
+			break;
+		}
+		ses->thr = std::thread(&broker::session_loop, this, ses);
+		sessions_.push_back(ses);
+	}
+}
+
+void broker::session_loop(session_ptr ses)
+{
+	uint8_t hdr;
+	std::string body;
+
+	// The first packet must be a CONNECT for v3.1.1, or v3.1, which the C
+	// library falls back to.
+	if (read_packet(ses->sock, hdr, body) && (hdr >> 4) == CONNECT) {
+		size_t pos = 0;
+		std::string proto;
+		bool ok = get_string(body, pos, proto) && pos < body.size();
+		int ver = ok ? int(uint8_t(body[pos])) : 0;
+
+		if ((proto == "MQTT" && ver == 4) || (proto == "MQIsdp" && ver == 3)) {
+			ses->connected = true;
+			ses->send(std::string("\x20\x02\x00\x00", 4));
+		}
+		else if (ok) {
+			// Unacceptable protocol version
+			ses->send(std::string("\x20\x02\x00\x01", 4));
+		}
+	}
+
+	while (ses->connected && read_packet(ses->sock, hdr, body)) {
+		size_t pos = 0;
+		uint16_t id;
+		bool ok = true;
+
+		switch (hdr >> 4) {
+			case PUBLISH:
+				ok = on_publish(*ses, hdr & 0x0F, body);
+				break;
+
+			case PUBREC:
+				ok = get16(body, pos, id) && ses->send(id_packet((PUBREL << 4) | 0x02, id));
+				break;
+
+			case PUBREL:
+				ok = get16(body, pos, id) && ses->send(id_packet(PUBCOMP << 4, id));
+				break;
+
+			case PUBACK:
+			case PUBCOMP:
+				break;
+
+			case SUBSCRIBE: {
+				std::string suback;
+				ok = get16(body, pos, id);
+				put16(suback, id);
+
+				std::string filter;
+				while (ok && pos < body.size()) {
+					ok = get_string(body, pos, filter) && pos < body.size();
+					if (!ok)
+						break;
+					int qos = std::min(int(uint8_t(body[pos++]) & 0x03), 2);
+
+					guard g(ses->sublock);
+					auto& subs = ses->subs;
+					auto p = std::find_if(subs.begin(), subs.end(),
+						[&filter](const std::pair<std::string,int>& sub) {
+							return sub.first == filter;
+						});
+					if (p != subs.end())
+						p->second = qos;
+					else
+						subs.emplace_back(filter, qos);
+					suback.push_back(char(qos));
+				}
+
+				if (ok) {
+					std::string pkt(1, char(SUBACK << 4));
+					put_length(pkt, suback.size());
+					ok = ses->send(pkt + suback);
+				}
+				break;
+			}
+
+			case UNSUBSCRIBE: {
+				ok = get16(body, pos, id);
+
+				std::string filter;
+				while (ok && pos < body.size()) {
+					ok = get_string(body, pos, filter);
+					if (!ok)
+						break;
+
+					guard g(ses->sublock);
+					auto& subs = ses->subs;
+					subs.erase(std::remove_if(subs.begin(), subs.end(),
+						[&filter](const std::pair<std::string,int>& sub) {
+							return sub.first == filter;
+						}), subs.end());
+				}
+				ok = ok && ses->send(id_packet(UNSUBACK << 4, id));
+				break;
+			}
+
+			case PINGREQ:
+				ok = ses->send(std::string(1, char(PINGRESP << 4)) + '\0');
+				break;
+
+			default:
+				// DISCONNECT, or something a client shouldn't send
+				ok = false;
+				break;
+		}
+
+		if (!ok)
+			break;
+	}
+
+	ses->close();
+}
+
+bool broker::on_publish(session& ses, uint8_t flags, const std::string& body)
+{
+	int qos = (flags >> 1) & 0x03;
+	size_t pos = 0;
+	std::string topic;
+	uint16_t id = 0;
+
+	if (qos > 2 || !get_string(body, pos, topic) || (qos > 0 && !get16(body, pos, id)))
+		return false;
+
+	++nrecv_;
+	route(topic, body.data() + pos, body.size() - pos, qos);
+
+	// The ack goes out after the message was passed on, as with a real
+	// server, so the publisher's latency includes the fan out.
+	if (qos == 1)
+		return ses.send(id_packet(PUBACK << 4, id));
+	if (qos == 2)
+		return ses.send(id_packet(PUBREC << 4, id));
+	return true;
+}
+
+void broker::route(const std::string& topic, const char* payload, size_t n,
+				   int qos)
+{
+	for (const auto& ses : live_sessions()) {
+		int subQos = ses->match(topic);
+		if (subQos < 0)
+			continue;
+		if (ses->send_publish(topic, payload, n, std::min(qos, subQos)))
+			++nsent_;
+	}
+}
+
+bool broker::topic_matches(const std::string& filter, const std::string& topic)
+{
+	// A filter starting with a wildcard doesn't match the '$' topics
+	if (!topic.empty() && topic[0] == '$' && !filter.empty()
+			&& (filter[0] == '+' || filter[0] == '#'))
+		return false;
+
+	// Compare one level at a time. Once the topic runs out, 'ti' is past
+	// the end of it.
+	size_t fi = 0, ti = 0,
+		   fn = filter.size(), tn = topic.size();
+
+	while (true) {
+		size_t fe = filter.find('/', fi);
+		if (fe == std::string::npos)
+			fe = fn;
+
+		// '#' matches the rest of the levels, even none.
+		if (fe - fi == 1 && filter[fi] == '#')
+			return true;
+
+		if (ti > tn)
+			return false;
+
+		size_t te = topic.find('/', ti);
+		if (te == std::string::npos)
+			te = tn;
+
+		bool plus = (fe - fi == 1 && filter[fi] == '+');
+		if (!plus && (fe - fi != te - ti
+					  || filter.compare(fi, fe - fi, topic, ti, te - ti) != 0))
+			return false;
+
+		fi = fe + 1;
+		ti = te + 1;
+
+		if (fi > fn)
+			return ti > tn;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace loopback
+}
+
@@ -0,0 +1,153 @@
+// loopback_broker.h
+//
+// A minimal MQTT v3.1.1 server that runs inside a test or benchmark
+// program and listens on the loopback interface, so that the whole stack,
+// this library and the Paho C library under it, can be measured on one
+// machine without any outside services.
+//
+// It handles CONNECT, PUBLISH at QoS 0, 1 and 2 in both directions,
+// SUBSCRIBE, UNSUBSCRIBE, PINGREQ and DISCONNECT, and routes each message
+// to the sessions with a matching subscription. It's just enough of a
+// server for that: there are no retained messages, wills, persistent
+// sessions, authentication, or keep-alive timeouts, and a QoS 1 or 2
+// message that a client doesn't acknowledge is never sent again.
+//
+// Each connection is served by its own thread, which suits the small
+// number of clients in a load test.
+//
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __loopback_broker_h
+#define __loopback_broker_h
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+namespace loopback {
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * An MQTT server on the loopback interface, for tests and benchmarks.
+ *
+ * The server starts listening when it's constructed, and stops when it's
+ * destroyed, closing the connections to any clients that remain.
+ */
+class broker
+{
+	/** A connection from a client */
+	struct session;
+	/** Pointer to a session */
+	using session_ptr = std::shared_ptr<session>;
+
+	/** The listening socket */
+	int sock_;
+	/** The port it's bound to */
+	uint16_t port_;
+	/** Whether the server is being stopped */
+	std::atomic<bool> stopping_;
+	/** The thread that accepts the connections */
+	std::thread acceptThr_;
+	/** Lock for the sessions */
+	mutable std::mutex lock_;
+	/** The sessions, including those that already ended */
+	std::vector<session_ptr> sessions_;
+
+	/** The number of messages received from the clients */
+	std::atomic<uint64_t> nrecv_;
+	/** The number of messages sent to subscribers */
+	std::atomic<uint64_t> nsent_;
+
+	/** Accepts connections until the server is stopped */
+	void accept_loop();
+	/** Reads and handles the packets from a client, until it's done */
+	void session_loop(session_ptr ses);
+	/** Handles a PUBLISH packet from a client */
+	bool on_publish(session& ses, uint8_t flags, const std::string& body);
+	/** Sends a message to the sessions subscribed to its topic */
+	void route(const std::string& topic, const char* payload, size_t n,
+			   int qos);
+	/** Gets the sessions that are still connected */
+	std::vector<session_ptr> live_sessions() const;
+
+	/** Non-copyable */
+	broker(const broker&) =delete;
+	broker& operator=(const broker&) =delete;
+
+public:
+	/**
+	 * Creates a server and starts it listening on the loopback interface.
+	 * @param port The TCP port, or zero to have the system pick a free one.
+	 * @throw std::system_error if the socket can't be opened.
+	 */
+	explicit broker(uint16_t port=0);
+	/**
+	 * Stops the server, if it's still running.
+	 */
+	~broker();
+	/**
+	 * Stops the server.
+	 * This closes the listening socket and all the client connections, and
+	 * waits for the threads to end.
+	 */
+	void stop();
+	/**
+	 * Gets the port that the server is listening on.
+	 * @return The TCP port.
+	 */
+	uint16_t port() const { return port_; }
+	/**
+	 * Gets the URI for clients to connect to this server.
+	 * @return The URI, like "tcp://127.0.0.1:<port>"
+	 */
+	std::string uri() const;
+	/**
+	 * Gets the number of clients that are connected.
+	 * @return The number of clients that are connected.
+	 */
+	size_t num_clients() const;
+	/**
+	 * Gets the number of messages that were published by the clients.
+	 * @return The number of messages received.
+	 */
+	uint64_t num_received() const { return nrecv_.load(); }
+	/**
+	 * Gets the number of messages that were sent to subscribers.
+	 * @return The number of messages sent.
+	 */
+	uint64_t num_sent() const { return nsent_.load(); }
+	/**
+	 * Determines if a topic filter matches a topic, by the rules of MQTT.
+	 * @param filter The topic filter, which may contain wildcards.
+	 * @param topic The topic name.
+	 * @return @em true if the filter matches the topic.
+	 */
+	static bool topic_matches(const std::string& filter, const std::string& topic);
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace loopback
+}
+
+#endif		// __loopback_broker_h
+
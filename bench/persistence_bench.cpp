@@ -0,0 +1,260 @@
+// persistence_bench.cpp
+//
+// Compares the cost of persisting QoS 1 messages with a store that keeps
+// a file for each message, as the C library's default persistence does,
+// with the mmap_persistence store, syncing it directly and from behind a
+// write_behind_persistence store, and with the memory_persistence store,
+// which doesn't write to disk at all.
+//
+// Each message is put, then removed a few messages later, as it would be
+// when the server acknowledges it. The calls go through the same C
+// callbacks that the library uses.
+//
+// Then it times restoring a session from an mmap_persistence store that
+// was left full of messages, reading the store one key at a time, and
+// through the callbacks, which read it all in one go.
+//
+// USAGE:
+//     persistence_bench [dir [num_msgs [payload_size]]]
+//
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <sys/stat.h>
+#include "mqtt/mmap_persistence.h"
+#include "mqtt/memory_persistence.h"
+#include "mqtt/write_behind_persistence.h"
+#include "mqtt/exception.h"
+
+using namespace std;
+using namespace std::chrono;
+
+const char* CLIENT_ID = "persistence_bench";
+const char* SERVER_URI = "tcp://localhost:1883";
+
+// The number of messages in flight
+const int WINDOW = 16;
+
+/////////////////////////////////////////////////////////////////////////////
+
+// A store with a file per key, written the way the C library does it.
+
+class file_persistence : public mqtt::iclient_persistence
+{
+	string dir_;
+
+	string path(const string& key) const { return dir_ + "/" + key + ".msg"; }
+
+public:
+	file_persistence(const string& dir) : dir_(dir) {}
+
+	void open(const string&, const string&) override {
+		::mkdir(dir_.c_str(), 0755);
+	}
+	void close() override {}
+	void clear() override {}
+	bool contains_key(const string& key) override {
+		struct stat st;
+		return ::stat(path(key).c_str(), &st) == 0;
+	}
+	mqtt::ipersistable_ptr get(const string&) const override {
+		throw mqtt::persistence_exception();
+	}
+	vector<string> keys() const override { return vector<string>(); }
+
+	void put(const string& key, mqtt::ipersistable_ptr p) override {
+		FILE* f = fopen(path(key).c_str(), "wb");
+		if (!f)
+			throw mqtt::persistence_exception();
+		fwrite(p->get_header_bytes(), 1, p->get_header_length(), f);
+		fwrite(p->get_payload_bytes(), 1, p->get_payload_length(), f);
+		fclose(f);
+	}
+	void remove(const string& key) override {
+		::remove(path(key).c_str());
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+double run(const string& name, mqtt::iclient_persistence& per, size_t nmsg,
+		   const string& payload)
+{
+	using ip = mqtt::iclient_persistence;
+
+	void* handle = nullptr;
+	ip::persistence_open(&handle, CLIENT_ID, SERVER_URI, &per);
+
+	char hdr[] = { char(0x32), char(0x7F), 0, 5, 't', 'o', 'p', 'i', 'c', 0, 1 };
+	char* buffers[] = { hdr, const_cast<char*>(payload.data()) };
+	int buflens[] = { int(sizeof(hdr)), int(payload.size()) };
+
+	vector<string> keys;
+	for (int i=0; i<WINDOW; ++i)
+		keys.push_back("s-" + to_string(i+1));
+
+	auto start = steady_clock::now();
+
+	for (size_t i=0; i<nmsg; ++i) {
+		string& key = keys[i % WINDOW];
+		if (i >= WINDOW)
+			ip::persistence_remove(handle, &key[0]);
+		ip::persistence_put(handle, &key[0], 2, buffers, buflens);
+	}
+
+	double secs = duration<double>(steady_clock::now() - start).count();
+	double rate = nmsg / secs;
+
+	for (auto& key : keys)
+		ip::persistence_remove(handle, &key[0]);
+	ip::persistence_close(handle);
+
+	cout << setw(20) << left << name << right
+		<< setw(14) << fixed << setprecision(0) << rate << " msg/s"
+		<< setw(10) << setprecision(1) << (1.0e9 * secs / nmsg) << " ns/msg" << endl;
+	return rate;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+// Restores all the messages in the store, the way the C library does when
+// a client starts: it gets the keys, then the data for each one. With
+// 'bulk' this goes through the callbacks; otherwise it gets each key from
+// the store, which is what the callbacks used to do.
+
+double restore(const string& name, mqtt::iclient_persistence& per, bool bulk)
+{
+	using ip = mqtt::iclient_persistence;
+
+	void* handle = nullptr;
+	ip::persistence_open(&handle, CLIENT_ID, SERVER_URI, &per);
+
+	auto start = steady_clock::now();
+	size_t n = 0;
+
+	if (bulk) {
+		char** keys = nullptr;
+		int nkeys = 0;
+		ip::persistence_keys(handle, &keys, &nkeys);
+		for (int i=0; i<nkeys; ++i) {
+			char* buf = nullptr;
+			int buflen = 0;
+			if (ip::persistence_get(handle, keys[i], &buf, &buflen) == MQTTASYNC_SUCCESS)
+				free(buf);
+			free(keys[i]);
+		}
+		free(keys);
+		n = size_t(nkeys);
+	}
+	else {
+		for (const auto& key : per.keys()) {
+			auto p = per.get(key);
+			char* buf = static_cast<char*>(malloc(p->get_header_length()));
+			memcpy(buf, p->get_header_bytes(), p->get_header_length());
+			free(buf);
+			++n;
+		}
+	}
+
+	double secs = duration<double>(steady_clock::now() - start).count();
+	double rate = n / secs;
+	ip::persistence_close(handle);
+
+	cout << setw(20) << left << name << right
+		<< setw(14) << fixed << setprecision(0) << rate << " msg/s"
+		<< setw(10) << setprecision(1) << (1.0e3 * secs) << " ms" << endl;
+	return rate;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+	string dir = (argc > 1) ? string(argv[1]) : string("persistence_bench.d");
+	size_t nmsg = (argc > 2) ? size_t(atol(argv[2])) : 100000;
+	size_t sz = (argc > 3) ? size_t(atol(argv[3])) : 256;
+
+	string payload(sz, 'x');
+	::mkdir(dir.c_str(), 0755);
+
+	cout << "Persisting " << nmsg << " messages of " << sz << " bytes" << endl;
+
+	try {
+		file_persistence fp(dir + "/file");
+		double r1 = run("file per message", fp, nmsg, payload);
+
+		mqtt::mmap_persistence mp(dir + "/mmap");
+		double r2 = run("mmap_persistence", mp, nmsg, payload);
+
+		mqtt::mmap_persistence mps(dir + "/mmap");
+		mps.set_sync_interval(milliseconds(5));
+		double r3 = run("mmap, sync 5ms", mps, nmsg, payload);
+
+		mqtt::mmap_persistence mpw(dir + "/mmap");
+		mqtt::write_behind_persistence wb(mpw);
+		wb.set_sync_interval(milliseconds(5));
+		double r4 = run("write-behind, 5ms", wb, nmsg, payload);
+
+		mqtt::memory_persistence mem(WINDOW, sz + 64);
+		double r5 = run("memory_persistence", mem, nmsg, payload);
+
+		cout << "\nSpeedup: " << setprecision(1) << (r2 / r1) << "x, "
+			<< (r3 / r1) << "x with syncing, " << (r4 / r1) << "x write-behind, "
+			<< (r5 / r1) << "x in memory" << endl;
+
+		cout << "\nRestoring " << nmsg << " messages" << endl;
+		{
+			using ip = mqtt::iclient_persistence;
+			mqtt::mmap_persistence per(dir + "/restore");
+			void* handle = nullptr;
+			ip::persistence_open(&handle, CLIENT_ID, SERVER_URI, &per);
+			per.clear();
+
+			char* buffers[] = { const_cast<char*>(payload.data()) };
+			int buflens[] = { int(payload.size()) };
+			for (size_t i=0; i<nmsg; ++i) {
+				string key = "s-" + to_string(i+1);
+				ip::persistence_put(handle, &key[0], 1, buffers, buflens);
+			}
+			ip::persistence_close(handle);
+		}
+
+		mqtt::mmap_persistence mr1(dir + "/restore");
+		double r6 = restore("one key at a time", mr1, false);
+
+		mqtt::mmap_persistence mr2(dir + "/restore");
+		double r7 = restore("load_all", mr2, true);
+
+		cout << "\nSpeedup: " << setprecision(1) << (r7 / r6) << "x" << endl;
+	}
+	catch (const mqtt::exception& exc) {
+		cerr << "Error: " << exc.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
+
@@ -0,0 +1,133 @@
+// publish_alloc_bench.cpp
+//
+// Counts the heap allocations made by the C++ library for each publish of
+// a small message once the client has reached a steady state.
+//
+// The global operator new is replaced to count calls. Allocations made by
+// the C library (with malloc) are not counted.
+//
+// It compares publishing a raw payload, which lets the client build the
+// message from its pool, with publishing a message that the application
+// created on the heap with make_message().
+//
+// This needs an MQTT server to publish to.
+//
+// USAGE:
+//     publish_alloc_bench [server_uri [num_msgs [payload_size]]]
+//
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <string>
+#include <atomic>
+#include <new>
+#include <chrono>
+#include <functional>
+#include "mqtt/async_client.h"
+
+using namespace std;
+using namespace std::chrono;
+
+const string DFLT_SERVER_URI { "tcp://localhost:1883" };
+const string CLIENT_ID { "publish_alloc_bench" };
+const string TOPIC { "bench/sensors/temperature" };
+
+const long TIMEOUT = 10000L;
+
+/////////////////////////////////////////////////////////////////////////////
+// Counting allocator
+
+static atomic<size_t> nalloc { 0 };
+
+void* operator new(size_t n)
+{
+	++nalloc;
+	if (void* p = malloc(n ? n : 1))
+		return p;
+	throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+/////////////////////////////////////////////////////////////////////////////
+
+// Runs 'nmsg' publishes, waiting for each one to complete, after an
+// untimed warm-up, and reports the allocations per publish.
+
+void run(const string& name, size_t nmsg, function<mqtt::idelivery_token_ptr()> pub)
+{
+	for (size_t i=0; i<1000; ++i)
+		pub()->wait_for_completion(TIMEOUT);
+
+	size_t n0 = nalloc;
+	auto start = steady_clock::now();
+
+	for (size_t i=0; i<nmsg; ++i)
+		pub()->wait_for_completion(TIMEOUT);
+
+	auto t = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+	size_t n = nalloc - n0;
+
+	cout << setw(24) << left << name << right
+		<< setw(12) << fixed << setprecision(3) << double(n)/nmsg << " allocs/msg"
+		<< setw(12) << (t/nmsg) << " ns/msg" << endl;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+	string uri = (argc > 1) ? string(argv[1]) : DFLT_SERVER_URI;
+	size_t nmsg = (argc > 2) ? size_t(atol(argv[2])) : 10000;
+	size_t sz = (argc > 3) ? size_t(atol(argv[3])) : 128;
+
+	string payload(sz, 'x');
+
+	mqtt::async_client cli(uri, CLIENT_ID, nullptr);
+
+	try {
+		cli.connect()->wait_for_completion(TIMEOUT);
+
+		cout << "Publishing " << nmsg << " messages of " << sz << " bytes" << endl;
+
+		for (int qos=0; qos<2; ++qos) {
+			cout << "\nQoS " << qos << endl;
+
+			run("publish(payload)", nmsg, [&] {
+				return cli.publish(TOPIC, payload.data(), payload.size(), qos, false);
+			});
+
+			run("publish(make_message)", nmsg, [&] {
+				auto msg = mqtt::make_message(payload.data(), payload.size(), qos, false);
+				return cli.publish(TOPIC, msg);
+			});
+		}
+
+		cli.disconnect()->wait_for_completion(TIMEOUT);
+	}
+	catch (const mqtt::exception& exc) {
+		cerr << "Error: " << exc.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
+
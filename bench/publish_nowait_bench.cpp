@@ -0,0 +1,111 @@
+// publish_nowait_bench.cpp
+//
+// Compares the rate at which QoS 0 messages can be handed to the client
+// with the regular publish(), which creates and tracks a delivery token for
+// each message, and with publish_nowait(), which doesn't.
+//
+// Each run ends with one tracked publish that is waited on, so that the
+// time includes getting all of the messages out of the client.
+//
+// This needs an MQTT server to publish to.
+//
+// USAGE:
+//     publish_nowait_bench [server_uri [num_msgs [payload_size]]]
+//
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <string>
+#include <chrono>
+#include <functional>
+#include "mqtt/async_client.h"
+
+using namespace std;
+using namespace std::chrono;
+
+const string DFLT_SERVER_URI { "tcp://localhost:1883" };
+const string CLIENT_ID { "publish_nowait_bench" };
+const string TOPIC { "bench/sensors/temperature" };
+
+const long TIMEOUT = 30000L;
+
+/////////////////////////////////////////////////////////////////////////////
+
+// Runs 'nmsg' publishes and reports the rate.
+
+double run(mqtt::async_client& cli, const string& name, size_t nmsg,
+		   const string& payload, function<void()> pub)
+{
+	auto start = steady_clock::now();
+
+	for (size_t i=0; i<nmsg; ++i)
+		pub();
+
+	// QoS 0 messages go out in order, so when this one is done, they all are
+	cli.publish(TOPIC, payload.data(), payload.size(), 0, false)
+		->wait_for_completion(TIMEOUT);
+
+	double secs = duration<double>(steady_clock::now() - start).count();
+	double rate = nmsg / secs;
+
+	cout << setw(20) << left << name << right
+		<< setw(14) << fixed << setprecision(0) << rate << " msg/s"
+		<< setw(10) << setprecision(1) << (1.0e9 * secs / nmsg) << " ns/msg" << endl;
+	return rate;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+	string uri = (argc > 1) ? string(argv[1]) : DFLT_SERVER_URI;
+	size_t nmsg = (argc > 2) ? size_t(atol(argv[2])) : 100000;
+	size_t sz = (argc > 3) ? size_t(atol(argv[3])) : 64;
+
+	string payload(sz, 'x');
+
+	mqtt::async_client cli(uri, CLIENT_ID, nullptr);
+
+	try {
+		cli.connect()->wait_for_completion(TIMEOUT);
+
+		cout << "Publishing " << nmsg << " QoS 0 messages of " << sz
+			<< " bytes" << endl;
+
+		double r1 = run(cli, "publish()", nmsg, payload, [&] {
+			cli.publish(TOPIC, payload.data(), payload.size(), 0, false);
+		});
+
+		double r2 = run(cli, "publish_nowait()", nmsg, payload, [&] {
+			cli.publish_nowait(TOPIC, payload.data(), payload.size());
+		});
+
+		cout << "\nSpeedup: " << setprecision(2) << (r2 / r1) << "x" << endl;
+
+		cli.disconnect()->wait_for_completion(TIMEOUT);
+	}
+	catch (const mqtt::exception& exc) {
+		cerr << "Error: " << exc.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
+
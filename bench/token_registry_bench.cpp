@@ -0,0 +1,174 @@
+// token_registry_bench.cpp
+//
+// Measures the cost of completing a publish (looking up its delivery
+// token by message ID and removing it from the client's registry) as the
+// number of messages in flight grows.
+//
+// For comparison, it runs the same workload against a plain std::list,
+// which is how the async_client used to track its tokens.
+//
+// USAGE:
+//     token_registry_bench [num_ops]
+//
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <list>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include "mqtt/async_client.h"
+#include "mqtt/token_registry.h"
+
+using namespace std;
+using namespace std::chrono;
+
+const string SERVER_URI { "tcp://localhost:1883" };
+const string CLIENT_ID { "token_registry_bench" };
+const string TOPIC { "bench" };
+
+// Message ID's are 16-bit and never zero.
+const int MAX_MSG_ID = 65535;
+
+inline int next_msg_id(int id) { return (id >= MAX_MSG_ID) ? 1 : id+1; }
+
+/////////////////////////////////////////////////////////////////////////////
+
+// The old way: a linear list of delivery tokens, searched by message ID
+// and then by address.
+
+class list_registry
+{
+	list<pair<mqtt::idelivery_token_ptr,int>> toks_;
+
+public:
+	void add(mqtt::idelivery_token_ptr tok, int msgId) {
+		toks_.emplace_back(tok, msgId);
+	}
+
+	mqtt::idelivery_token_ptr get_delivery_token(int msgId) const {
+		for (const auto& t : toks_) {
+			if (t.second == msgId)
+				return t.first;
+		}
+		return mqtt::idelivery_token_ptr();
+	}
+
+	void remove(const mqtt::itoken* tok) {
+		for (auto p=toks_.begin(); p!=toks_.end(); ++p) {
+			if (static_cast<const mqtt::itoken*>(p->first.get()) == tok) {
+				toks_.erase(p);
+				return;
+			}
+		}
+	}
+};
+
+// Keeps 'nInFlight' tokens in the registry, then times 'nOps' completions,
+// each followed by a new publish to refill the window. The acks come back
+// in random order, as they do with a mix of QoS levels and retries.
+
+template <typename Reg>
+double run(mqtt::iasync_client& cli, Reg& reg, size_t nInFlight, size_t nOps,
+		   void (*add)(Reg&, mqtt::idelivery_token_ptr, int),
+		   void (*complete)(Reg&, int))
+{
+	vector<int> window;
+	window.reserve(nInFlight);
+	int id = 0;
+
+	vector<mqtt::idelivery_token_ptr> toks;
+	toks.reserve(nInFlight+nOps);
+
+	for (size_t i=0; i<nInFlight; ++i) {
+		id = next_msg_id(id);
+		toks.push_back(std::make_shared<mqtt::delivery_token>(cli, TOPIC));
+		add(reg, toks.back(), id);
+		window.push_back(id);
+	}
+
+	// Pre-build the replacement tokens so we only time the registry
+	for (size_t i=0; i<nOps; ++i)
+		toks.push_back(std::make_shared<mqtt::delivery_token>(cli, TOPIC));
+
+	minstd_rand rng(42);
+	auto start = steady_clock::now();
+
+	for (size_t i=0; i<nOps; ++i) {
+		size_t k = rng() % window.size();
+		complete(reg, window[k]);
+
+		id = next_msg_id(id);
+		add(reg, toks[nInFlight+i], id);
+		window[k] = id;
+	}
+
+	auto dur = steady_clock::now() - start;
+	return double(duration_cast<nanoseconds>(dur).count()) / nOps;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+	size_t nOps = (argc > 1) ? size_t(atol(argv[1])) : 100000;
+
+	// The client is only used as the owner of the tokens; it never connects.
+	mqtt::async_client cli(SERVER_URI, CLIENT_ID, nullptr);
+
+	// The window has to stay below the 16-bit message ID space
+	const vector<size_t> IN_FLIGHT { 10, 100, 1000, 10000, 50000 };
+
+	cout << "Completion cost (ns/op), " << nOps << " ops per run" << endl;
+	cout << setw(10) << "in-flight" << setw(16) << "token_registry"
+		<< setw(16) << "std::list" << endl;
+
+	for (auto n : IN_FLIGHT) {
+		mqtt::token_registry reg;
+		double t = run<mqtt::token_registry>(cli, reg, n, nOps,
+			[](mqtt::token_registry& r, mqtt::idelivery_token_ptr tok, int id) {
+				r.add(tok);
+				r.set_message_id(tok.get(), id);
+			},
+			[](mqtt::token_registry& r, int id) {
+				auto tok = r.get_delivery_token(id);
+				r.remove(tok.get());
+			});
+
+		// The list is quadratic, so limit the number of ops
+		list_registry lreg;
+		size_t nListOps = std::min(nOps, size_t(10000000) / n);
+		double tl = run<list_registry>(cli, lreg, n, nListOps,
+			[](list_registry& r, mqtt::idelivery_token_ptr tok, int id) {
+				r.add(tok, id);
+			},
+			[](list_registry& r, int id) {
+				auto tok = r.get_delivery_token(id);
+				r.remove(tok.get());
+			});
+
+		cout << setw(10) << n << setw(16) << fixed << setprecision(1) << t
+			<< setw(16) << tl << endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,187 @@
+// topic_router_bench.cpp
+//
+// Measures the cost of finding the handlers for an incoming topic with the
+// topic_router, against a linear scan that matches the topic against each
+// subscription filter in turn.
+//
+// The filters look like those of a telemetry system: a site, a device
+// class, a device ID and a measurement, with some of them using the '+'
+// and '#' wildcards.
+//
+// USAGE:
+//     topic_router_bench [num_filters [num_lookups]]
+//
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include "mqtt/topic_router.h"
+
+using namespace std;
+using namespace std::chrono;
+
+const int N_SITES = 20, N_CLASSES = 10, N_MEASURES = 8;
+
+/////////////////////////////////////////////////////////////////////////////
+
+// The simple way: split both strings into levels on each call and compare.
+
+vector<string> split(const string& s)
+{
+	vector<string> v;
+	size_t i = 0, j;
+	while ((j = s.find('/', i)) != string::npos) {
+		v.push_back(s.substr(i, j-i));
+		i = j + 1;
+	}
+	v.push_back(s.substr(i));
+	return v;
+}
+
+bool filter_matches(const string& filt, const string& topic)
+{
+	if ((filt[0] == '+' || filt[0] == '#') && !topic.empty() && topic[0] == '$')
+		return false;
+
+	vector<string> f = split(filt), t = split(topic);
+	size_t i = 0;
+
+	for (; i<f.size(); ++i) {
+		if (f[i] == "#")
+			return true;
+		if (i >= t.size() || (f[i] != "+" && f[i] != t[i]))
+			return false;
+	}
+	return i == t.size();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+string make_topic(minstd_rand& rng)
+{
+	return "site" + to_string(rng() % N_SITES) + "/class" + to_string(rng() % N_CLASSES)
+		+ "/dev" + to_string(rng() % 1000) + "/m" + to_string(rng() % N_MEASURES);
+}
+
+string make_filter(minstd_rand& rng)
+{
+	string filt = make_topic(rng);
+
+	// About one in five filters has a wildcard
+	switch (rng() % 10) {
+		case 0:
+			filt = filt.substr(0, filt.rfind('/')) + "/+";
+			break;
+		case 1:
+			filt = filt.substr(0, filt.rfind('/')) + "/#";
+			break;
+		default:
+			break;
+	}
+	return filt;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+	size_t nFilters = (argc > 1) ? size_t(atol(argv[1])) : 10000;
+	size_t nLookups = (argc > 2) ? size_t(atol(argv[2])) : 1000000;
+
+	minstd_rand rng(42);
+
+	vector<string> filters;
+	mqtt::topic_router router;
+
+	while (router.size() < nFilters) {
+		string filt = make_filter(rng);
+		if (!router.contains(filt)) {
+			router.add(filt, [](mqtt::const_message_ptr) {});
+			filters.push_back(filt);
+		}
+	}
+
+	// Half the topics are taken from the filters, so they have a hit.
+	vector<string> topics;
+	const size_t N_TOPICS = 4096;
+	for (size_t i=0; i<N_TOPICS; ++i) {
+		if (i % 2 == 0)
+			topics.push_back(make_topic(rng));
+		else {
+			string t = filters[rng() % filters.size()];
+			if (t.back() == '+' || t.back() == '#')
+				t.back() = 'x';
+			topics.push_back(t);
+		}
+	}
+
+	// ----- The router -----
+
+	size_t nMatch = 0;
+	auto start = steady_clock::now();
+
+	for (size_t i=0; i<nLookups; ++i)
+		nMatch += router.match(topics[i % N_TOPICS], [](const mqtt::topic_router::handler&) {});
+
+	auto dur = steady_clock::now() - start;
+	double tr = double(duration_cast<nanoseconds>(dur).count()) / nLookups;
+
+	// ----- The linear scan -----
+	// This is O(filters) per lookup, so it gets fewer lookups.
+
+	size_t nScan = std::max<size_t>(1, std::min(nLookups, size_t(100000000) / (nFilters*20)));
+	size_t nScanMatch = 0;
+	start = steady_clock::now();
+
+	for (size_t i=0; i<nScan; ++i) {
+		const string& topic = topics[i % N_TOPICS];
+		for (const auto& filt : filters) {
+			if (filter_matches(filt, topic))
+				++nScanMatch;
+		}
+	}
+
+	dur = steady_clock::now() - start;
+	double tl = double(duration_cast<nanoseconds>(dur).count()) / nScan;
+
+	// Both should find the same matches for the topics that were scanned
+	size_t nRouterMatch = 0;
+	for (size_t i=0; i<nScan; ++i)
+		nRouterMatch += router.match(topics[i % N_TOPICS], [](const mqtt::topic_router::handler&) {});
+
+	cout << "Filters: " << nFilters << ", lookups: " << nLookups << endl;
+	cout << fixed << setprecision(1);
+	cout << setw(14) << "topic_router" << setw(14) << tr << " ns/lookup  ("
+		<< nMatch << " matches)" << endl;
+	cout << setw(14) << "linear scan" << setw(14) << tl << " ns/lookup  ("
+		<< nScan << " lookups)" << endl;
+
+	if (nRouterMatch != nScanMatch) {
+		cerr << "Mismatch: router found " << nRouterMatch
+			<< ", scan found " << nScanMatch << endl;
+		return 1;
+	}
+	return 0;
+}
+
@@ -21,20 +21,30 @@
 #include "mqtt/message.h"
 #include "mqtt/response_options.h"
 #include "mqtt/disconnect_options.h"
+#include "mqtt/topic.h"
+#include "mqtt/trace.h"
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
 #include <cstring>
 #include <cstdio>
+#include <iterator>
+#include <algorithm>
 
 namespace mqtt {
 
+const size_t async_client::MAX_PUB_TOPICS;
+
 /////////////////////////////////////////////////////////////////////////////
 
 async_client::async_client(const std::string& serverURI, const std::string& clientId)
 				: serverURI_(serverURI), clientId_(clientId),
-					persist_(nullptr), userCallback_(nullptr)
+					persist_(nullptr), userCallback_(nullptr),
+					zeroCopyRecv_(false), consuming_(false),
+					queOverflow_(consumer_overflow::BLOCK),
+					pool_(std::make_shared<block_pool>()),
+					pendingTokens_(pool_), metrics_(nullptr)
 {
 	MQTTAsync_create(&cli_, serverURI.c_str(), clientId.c_str(),
 					 MQTTCLIENT_PERSISTENCE_DEFAULT, nullptr);
@@ -44,7 +54,11 @@ async_client::async_client(const std::string& serverURI, const std::string& clie
 async_client::async_client(const std::string& serverURI, const std::string& clientId,
 						   const std::string& persistDir)
 				: serverURI_(serverURI), clientId_(clientId),
-					persist_(nullptr), userCallback_(nullptr)
+					persist_(nullptr), userCallback_(nullptr),
+					zeroCopyRecv_(false), consuming_(false),
+					queOverflow_(consumer_overflow::BLOCK),
+					pool_(std::make_shared<block_pool>()),
+					pendingTokens_(pool_), metrics_(nullptr)
 {
 	MQTTAsync_create(&cli_, serverURI.c_str(), clientId.c_str(),
 					 MQTTCLIENT_PERSISTENCE_DEFAULT, const_cast<char*>(persistDir.c_str()));
@@ -53,7 +67,11 @@ async_client::async_client(const std::string& serverURI, const std::string& clie
 async_client::async_client(const std::string& serverURI, const std::string& clientId,
 						   iclient_persistence* persistence)
 				: serverURI_(serverURI), clientId_(clientId),
-					persist_(nullptr), userCallback_(nullptr)
+					persist_(nullptr), userCallback_(nullptr),
+					zeroCopyRecv_(false), consuming_(false),
+					queOverflow_(consumer_overflow::BLOCK),
+					pool_(std::make_shared<block_pool>()),
+					pendingTokens_(pool_), metrics_(nullptr)
 {
 	if (!persistence) {
 		MQTTAsync_create(&cli_, serverURI.c_str(), clientId.c_str(),
@@ -81,6 +99,7 @@ async_client::~async_client()
 {
 	MQTTAsync_destroy(&cli_);
 	delete persist_;
+	delete metrics_.load();
 }
 
 // --------------------------------------------------------------------------
@@ -93,27 +112,114 @@ void async_client::on_connection_lost(void *context, char *cause)
 {
 	if (context) {
 		async_client* cli = static_cast<async_client*>(context);
-		callback* cb = cli->get_callback();
-		if (cb)
-			cb->connection_lost(cause ? std::string(cause) : std::string());
+
+		#if defined(PAHO_MQTTPP_METRICS)
+			client_metrics* m = cli->metrics_.load(std::memory_order_acquire);
+			if (m)
+				m->on_connection_lost();
+		#endif
+
+		executor_ptr exec;
+		callback* cb = cli->get_callback(&exec);
+		if (cb) {
+			std::string why = cause ? std::string(cause) : std::string();
+			if (exec)
+				exec->execute_always([cb, why] { cb->connection_lost(why); });
+			else
+				cb->connection_lost(why);
+		}
+
+		// A null message tells the consumers that the connection is gone.
+		if (cli->is_consuming())
+			cli->que_.try_put(const_message_ptr());
 	}
 }
 
 int async_client::on_message_arrived(void* context, char* topicName, int topicLen,
 									 MQTTAsync_message* msg)
 {
+	// The C message is the ID for the trace, even after it's handed off.
+	const void* rcvId = msg;
+	PAHO_MQTTPP_TRACE_POINT(RECEIVE_BEGIN, rcvId);
+
 	if (context) {
 		async_client* cli = static_cast<async_client*>(context);
-		callback* cb = cli->get_callback();
-		if (cb) {
-			std::string topic(topicName, topicName+topicLen);
-			const_message_ptr m = std::make_shared<message>(*msg);
-			cb->message_arrived(topic, m);
+
+		#if defined(PAHO_MQTTPP_METRICS)
+			// The time to hand off the message, however it goes.
+			client_metrics* metrics = cli->metrics_.load(std::memory_order_acquire);
+			std::chrono::steady_clock::time_point start;
+			if (metrics) {
+				metrics->on_receive(size_t(msg->payloadlen));
+				start = std::chrono::steady_clock::now();
+			}
+		#endif
+
+		executor_ptr exec;
+		callback* cb = cli->get_callback(&exec);
+		bool consuming = cli->is_consuming();
+		const_topic_router_ptr router = cli->get_router();
+
+		if (router && router->empty())
+			router.reset();
+
+		if (cb || consuming || router) {
+			message_ptr m;
+
+			if (cli->is_zero_copy_receive()) {
+				// The message takes over the C buffer, which is freed
+				// along with the last reference to it.
+				std::shared_ptr<const void> owner(msg,
+					[](MQTTAsync_message* p) { MQTTAsync_freeMessage(&p); });
+				m = std::make_shared<message>(*msg, std::move(owner));
+				msg = nullptr;
+			}
+			else
+				m = std::make_shared<message>(*msg);
+
+			m->set_topic(std::string(topicName, topicName+topicLen));
+			MQTTAsync_free(topicName);
+			topicName = nullptr;
+			PAHO_MQTTPP_TRACE_POINT(RECEIVE_MESSAGE, rcvId);
+
+			// Messages on a topic must be delivered in order, so the topic
+			// is the key for the executor.
+			size_t nrouted = 0;
+			if (router) {
+				if (exec) {
+					// The task holds the router, which owns the handler.
+					nrouted = router->match(m->get_topic(),
+						[&exec, &router, &m](const topic_router::handler& h) {
+							const topic_router::handler* ph = &h;
+							exec->execute(m->get_topic(), [router, ph, m] { (*ph)(m); });
+						});
+				}
+				else
+					nrouted = router->route(m);
+			}
+
+			if (nrouted == 0) {
+				if (consuming)
+					cli->queue_message(std::move(m));
+				else if (cb && exec)
+					exec->execute(m->get_topic(), [cb, m] { cb->message_arrived(m->get_topic(), m); });
+				else if (cb)
+					cb->message_arrived(m->get_topic(), m);
+			}
 		}
+
+		#if defined(PAHO_MQTTPP_METRICS)
+			if (metrics)
+				metrics->callbackTime_.record(std::chrono::steady_clock::now() - start);
+		#endif
 	}
 
-	MQTTAsync_freeMessage(&msg);
-	MQTTAsync_free(topicName);
+	if (msg)
+		MQTTAsync_freeMessage(&msg);
+	if (topicName)
+		MQTTAsync_free(topicName);
+
+	PAHO_MQTTPP_TRACE_POINT(RECEIVE_COMPLETE, rcvId);
 
 	// TODO: Should the user code determine the return value?
 	// The Java version does doesn't seem to...
@@ -150,18 +256,24 @@ void async_client::on_delivery_complete(void* context, MQTTAsync_token msgID)
 
 void async_client::add_token(itoken_ptr tok)
 {
-	if (tok) {
-		guard g(lock_);
-		pendingTokens_.push_back(tok);
-	}
+	pendingTokens_.add(tok);
+
+	#if defined(PAHO_MQTTPP_METRICS)
+		client_metrics* m = metrics_.load(std::memory_order_acquire);
+		if (m)
+			m->on_token_added();
+	#endif
 }
 
 void async_client::add_token(idelivery_token_ptr tok)
 {
-	if (tok) {
-	   guard g(lock_);
-	   pendingDeliveryTokens_.push_back(tok);
-	}
+	pendingTokens_.add(tok);
+
+	#if defined(PAHO_MQTTPP_METRICS)
+		client_metrics* m = metrics_.load(std::memory_order_acquire);
+		if (m)
+			m->on_token_added();
+	#endif
 }
 
 // Note that we uniquely identify a token by the address of its raw pointer,
@@ -169,38 +281,79 @@ void async_client::add_token(idelivery_token_ptr tok)
 
 void async_client::remove_token(itoken* tok)
 {
-	if (!tok)
+	// Not from the C library's callbacks, so there's no result to count.
+	remove_token(tok, MQTTASYNC_OPERATION_INCOMPLETE);
+}
+
+void async_client::remove_token(itoken* tok, int rc)
+{
+	idelivery_token_ptr dtok;
+	if (!pendingTokens_.remove(tok, &dtok))
 		return;
 
-	guard g(lock_);
-	for (auto p=pendingDeliveryTokens_.begin();
-					p!=pendingDeliveryTokens_.end(); ++p) {
-		if (p->get() == tok) {
-			idelivery_token_ptr dtok = *p;
-			pendingDeliveryTokens_.erase(p);
-
-			// If there's a user callback registered, we can now call
-			// delivery_complete()
-
-			if (userCallback_) {
-				const_message_ptr msg = dtok->get_message();
-				if (msg && msg->get_qos() > 0) {
-					callback* cb = userCallback_;
-					g.unlock();
-					cb->delivery_complete(dtok);
-				}
+	#if defined(PAHO_MQTTPP_METRICS)
+		client_metrics* m = metrics_.load(std::memory_order_acquire);
+		if (m) {
+			m->on_token_removed();
+
+			// A token that failed in the C library. The ones it refused
+			// outright are counted where they're refused. This uses the
+			// code from the callback, since the token itself isn't
+			// complete yet when an executor runs its listener.
+			if (rc != MQTTASYNC_SUCCESS && rc != MQTTASYNC_OPERATION_INCOMPLETE)
+				m->on_failure(rc);
+			else if (rc == MQTTASYNC_SUCCESS && dtok) {
+				auto d = dynamic_cast<delivery_token*>(dtok.get());
+				if (d && d->sendTime_ != std::chrono::steady_clock::time_point())
+					m->publishLatency_.record(std::chrono::steady_clock::now() - d->sendTime_);
 			}
-			return;
 		}
-	}
-	for (auto p=pendingTokens_.begin(); p!=pendingTokens_.end(); ++p) {
-		if (p->get() == tok) {
-			pendingTokens_.erase(p);
-			return;
+	#else
+		(void) rc;
+	#endif
+
+	if (!dtok)
+		return;
+
+	const_message_ptr msg = dtok->get_message();
+	return_credit(msg);
+
+	// If there's a user callback registered, we can now call
+	// delivery_complete()
+
+	executor_ptr exec;
+	callback* cb = get_callback(&exec);
+	if (cb) {
+		if (msg && msg->get_qos() > 0) {
+			if (exec)
+				exec->execute([cb, dtok] { cb->delivery_complete(dtok); });
+			else
+				cb->delivery_complete(dtok);
 		}
 	}
 }
 
+void async_client::return_credit(const const_message_ptr& msg)
+{
+	if (credit_.release(msg ? msg->get_payload_length() : 0))
+		notify_credit();
+}
+
+void async_client::notify_credit()
+{
+	guard g(lock_);
+	credit_handler handler = creditHandler_;
+	executor_ptr exec = exec_;
+	g.unlock();
+
+	if (handler) {
+		if (exec)
+			exec->execute_always(std::move(handler));
+		else
+			handler();
+	}
+}
+
 std::vector<char*> async_client::alloc_topic_filters(
 							const topic_filter_collection& topicFilters)
 {
@@ -238,9 +391,16 @@ itoken_ptr async_client::connect(connect_options opts)
 
 	if (rc != MQTTASYNC_SUCCESS) {
 		remove_token(tok);
+		count_failure(rc);
 		throw exception(rc);
 	}
 
+	#if defined(PAHO_MQTTPP_METRICS)
+		client_metrics* m = metrics_.load(std::memory_order_acquire);
+		if (m)
+			m->on_connect();
+	#endif
+
 	return tok;
 }
 
@@ -258,9 +418,16 @@ itoken_ptr async_client::connect(connect_options opts, void* userContext,
 
 	if (rc != MQTTASYNC_SUCCESS) {
 		remove_token(tok);
+		count_failure(rc);
 		throw exception(rc);
 	}
 
+	#if defined(PAHO_MQTTPP_METRICS)
+		client_metrics* m = metrics_.load(std::memory_order_acquire);
+		if (m)
+			m->on_connect();
+	#endif
+
 	return tok;
 }
 
@@ -287,6 +454,7 @@ itoken_ptr async_client::disconnect(long timeout)
 
 	if (rc != MQTTASYNC_SUCCESS) {
 		remove_token(tok);
+		count_failure(rc);
 		throw exception(rc);
 	}
 
@@ -307,6 +475,7 @@ itoken_ptr async_client::disconnect(long timeout, void* userContext, iaction_lis
 
 	if (rc != MQTTASYNC_SUCCESS) {
 		remove_token(tok);
+		count_failure(rc);
 		throw exception(rc);
 	}
 
@@ -324,35 +493,87 @@ idelivery_token_ptr async_client::get_pending_delivery_token(int msgID) const
 	// back from the broker, the C++ library can look up the token from the
 	// msgID and signal it, indicating completion.
 
-	if (msgID > 0) {
-		guard g(lock_);
-		for (const auto& t : pendingDeliveryTokens_) {
-			if (t->get_message_id() == msgID)
-				return t;
-		}
-	}
-	return idelivery_token_ptr();
+	return pendingTokens_.get_delivery_token(msgID);
 }
 
 std::vector<idelivery_token_ptr> async_client::get_pending_delivery_tokens() const
 {
-	std::vector<idelivery_token_ptr> toks;
-	guard g(lock_);
-	for (const auto& t : pendingDeliveryTokens_) {
-		if (t->get_message_id() > 0) {
-			toks.push_back(t);
-		}
-	}
-	return toks;
+	return pendingTokens_.get_delivery_tokens();
 }
 
 // --------------------------------------------------------------------------
 // Publish
 
+message_ptr async_client::make_pooled_message(const void* payload, size_t n,
+											   int qos, bool retained)
+{
+	pool_allocator<message> alloc(pool_);
+
+	if (n > block_pool::MAX_BLOCK_SIZE)
+		return std::allocate_shared<message>(alloc, payload, n, qos, retained);
+
+	message::validate_qos(qos);
+
+	// The buffer and the message hold the pool until they're released,
+	// which may well be after the client is gone.
+	block_pool_ptr pool = pool_;
+	void* buf = pool->allocate(n);
+	if (n > 0)
+		std::memcpy(buf, payload, n);
+
+	std::shared_ptr<const void> owner(buf,
+		[pool, n](void* p) { pool->deallocate(p, n); }, alloc);
+
+	MQTTAsync_message cmsg = MQTTAsync_message_initializer;
+	cmsg.payload = buf;
+	cmsg.payloadlen = int(n);
+	cmsg.qos = qos;
+	cmsg.retained = retained ? (!0) : 0;
+
+	return std::allocate_shared<message>(alloc, cmsg, std::move(owner));
+}
+
+delivery_token_ptr async_client::make_delivery_token(const std::string& topic,
+													 const_message_ptr msg)
+{
+	return make_delivery_token(shared_topics(topic), std::move(msg));
+}
+
+delivery_token_ptr async_client::make_delivery_token(
+		std::shared_ptr<const std::vector<std::string>> topics,
+		const_message_ptr msg)
+{
+	auto tok = std::allocate_shared<delivery_token>(
+					pool_allocator<delivery_token>(pool_), *this);
+	tok->set_topics(std::move(topics));
+	tok->set_message(std::move(msg));
+	return tok;
+}
+
+std::shared_ptr<const std::vector<std::string>>
+	async_client::shared_topics(const std::string& topic)
+{
+	guard g(topicLock_);
+	return find_shared_topics(topic);
+}
+
+std::shared_ptr<const std::vector<std::string>>
+	async_client::find_shared_topics(const std::string& topic)
+{
+	auto p = pubTopics_.find(topic);
+	if (p != pubTopics_.end())
+		return p->second;
+
+	auto topics = std::make_shared<const std::vector<std::string>>(1, topic);
+	if (pubTopics_.size() < MAX_PUB_TOPICS)
+		pubTopics_.emplace(topic, topics);
+	return topics;
+}
+
 idelivery_token_ptr async_client::publish(const std::string& topic, const void* payload,
 										  size_t n, int qos, bool retained)
 {
-	auto msg = make_message(payload, n, qos, retained);
+	auto msg = make_pooled_message(payload, n, qos, retained);
 	return publish(topic, msg);
 }
 
@@ -361,68 +582,392 @@ idelivery_token_ptr async_client::publish(const std::string& topic,
 										  int qos, bool retained, void* userContext,
 										  iaction_listener& cb)
 {
-	auto msg = make_message(payload, n, qos, retained);
+	auto msg = make_pooled_message(payload, n, qos, retained);
 	return publish(topic, msg, userContext, cb);
 }
 
-idelivery_token_ptr async_client::publish(const std::string& topic, const_message_ptr msg)
+idelivery_token_ptr async_client::publish(const std::string& topic,
+										  std::string&& payload,
+										  int qos, bool retained)
 {
-	idelivery_token_ptr tok = std::make_shared<delivery_token>(*this, topic, msg);
-	add_token(tok);
+	pool_allocator<message> alloc(pool_);
+	return publish(topic, std::allocate_shared<message>(alloc, std::move(payload),
+														qos, retained));
+}
+
+idelivery_token_ptr async_client::publish(const std::string& topic,
+										  std::vector<byte>&& payload,
+										  int qos, bool retained)
+{
+	pool_allocator<message> alloc(pool_);
+	return publish(topic, std::allocate_shared<message>(alloc, std::move(payload),
+														qos, retained));
+}
 
-	auto dtok = std::dynamic_pointer_cast<delivery_token>(tok);
-	dtok->set_message(msg);
+int async_client::send_message(const std::string& topic, const_message_ptr msg,
+								delivery_token_ptr dtok)
+{
+	idelivery_token_ptr tok = dtok;
+	add_token(tok);
 
 	delivery_response_options opts(dtok);
 
+	#if defined(PAHO_MQTTPP_METRICS)
+		client_metrics* m = metrics_.load(std::memory_order_acquire);
+		if (m)
+			dtok->sendTime_ = std::chrono::steady_clock::now();
+	#endif
+
 	int rc = MQTTAsync_sendMessage(cli_, topic.c_str(), &(msg->msg_),
 								   &opts.opts_);
+	PAHO_MQTTPP_TRACE_POINT(PUBLISH_SENT, static_cast<token*>(dtok.get()));
 
 	if (rc == MQTTASYNC_SUCCESS) {
 		dtok->set_message_id(opts.opts_.token);
+		pendingTokens_.set_message_id(tok.get(), opts.opts_.token);
+
+		#if defined(PAHO_MQTTPP_METRICS)
+			if (m)
+				m->on_publish(msg->get_payload_length());
+		#endif
 	}
 	else {
 		remove_token(tok);
-		throw exception(rc);
+		count_failure(rc);
+		PAHO_MQTTPP_TRACE_POINT(TOKEN_COMPLETE, static_cast<token*>(dtok.get()));
 	}
 
-	return tok;
+	return rc;
+}
+
+idelivery_token_ptr async_client::publish(const std::string& topic, const_message_ptr msg)
+{
+	auto dtok = make_delivery_token(topic, msg);
+	PAHO_MQTTPP_TRACE_POINT(PUBLISH_BEGIN, static_cast<token*>(dtok.get()));
+
+	credit_.acquire(msg->get_payload_length());
+	int rc = send_message(topic, std::move(msg), dtok);
+
+	if (rc != MQTTASYNC_SUCCESS)
+		throw exception(rc);
+
+	return dtok;
+}
+
+idelivery_token_ptr async_client::publish(const topic& top, const_message_ptr msg)
+{
+	auto dtok = make_delivery_token(top.names_, msg);
+	PAHO_MQTTPP_TRACE_POINT(PUBLISH_BEGIN, static_cast<token*>(dtok.get()));
+
+	credit_.acquire(msg->get_payload_length());
+	int rc = send_message(top.get_name(), std::move(msg), dtok);
+
+	if (rc != MQTTASYNC_SUCCESS)
+		throw exception(rc);
+
+	return dtok;
 }
 
 idelivery_token_ptr async_client::publish(const std::string& topic, const_message_ptr msg,
 										  void* userContext, iaction_listener& cb)
 {
-	idelivery_token_ptr tok = std::make_shared<delivery_token>(*this, topic, msg);
+	auto dtok = make_delivery_token(topic, msg);
+	PAHO_MQTTPP_TRACE_POINT(PUBLISH_BEGIN, static_cast<token*>(dtok.get()));
+	dtok->set_user_context(userContext);
+	dtok->set_action_callback(cb);
+
+	credit_.acquire(msg->get_payload_length());
+	int rc = send_message(topic, std::move(msg), dtok);
+
+	if (rc != MQTTASYNC_SUCCESS)
+		throw exception(rc);
+
+	return dtok;
+}
+
+result<idelivery_token_ptr> async_client::publish(std::nothrow_t,
+												  const std::string& topic,
+												  const_message_ptr msg) noexcept
+{
+	using res_t = result<idelivery_token_ptr>;
+	try {
+		if (!credit_.try_acquire(msg->get_payload_length()))
+			return res_t::failure(MQTTASYNC_MAX_MESSAGES_INFLIGHT);
+
+		idelivery_token_ptr dtok;
+		int rc = publish_with_credit(topic, std::move(msg), &dtok);
+
+		if (rc != MQTTASYNC_SUCCESS)
+			return res_t::failure(rc);
+		return res_t(std::move(dtok));
+	}
+	catch (const exception& exc) {
+		return res_t::failure(exc.get_reason_code());
+	}
+	catch (...) {
+		return res_t::failure(MQTTASYNC_FAILURE);
+	}
+}
+
+result<idelivery_token_ptr> async_client::publish(std::nothrow_t,
+												  const std::string& topic,
+												  const void* payload, size_t n,
+												  int qos, bool retained) noexcept
+{
+	// Check the QoS here, rather than have the message throw it.
+	if (qos < 0 || qos > 2)
+		return result<idelivery_token_ptr>::failure(MQTTASYNC_BAD_QOS);
+
+	message_ptr msg;
+	try {
+		msg = make_pooled_message(payload, n, qos, retained);
+	}
+	catch (...) {
+		return result<idelivery_token_ptr>::failure(MQTTASYNC_FAILURE);
+	}
+	return publish(std::nothrow, topic, std::move(msg));
+}
+
+int async_client::try_publish(const std::string& topic, const_message_ptr msg,
+							  idelivery_token_ptr* tok /*=nullptr*/)
+{
+	if (!credit_.try_acquire(msg->get_payload_length()))
+		return MQTTASYNC_MAX_MESSAGES_INFLIGHT;
+
+	return publish_with_credit(topic, std::move(msg), tok);
+}
+
+int async_client::publish_with_credit(const std::string& topic, const_message_ptr msg,
+									  idelivery_token_ptr* tok)
+{
+	delivery_token_ptr dtok;
+	try {
+		dtok = make_delivery_token(topic, msg);
+	}
+	catch (...) {
+		return_credit(msg);
+		throw;
+	}
+	PAHO_MQTTPP_TRACE_POINT(PUBLISH_BEGIN, static_cast<token*>(dtok.get()));
+	int rc = send_message(topic, std::move(msg), dtok);
+
+	if (rc == MQTTASYNC_SUCCESS && tok)
+		*tok = std::move(dtok);
+	return rc;
+}
+
+itoken_ptr async_client::send_batch(const publish_collection& msgs,
+									token_ptr batchTok)
+{
+	const size_t n = msgs.size();
+	if (n == 0) {
+		batchTok->on_success(nullptr);
+		return batchTok;
+	}
+	batchTok->set_num_pending(n);
+
+	std::vector<delivery_token_ptr> toks;
+	toks.reserve(n);
+
+	guard g(topicLock_);
+	pool_allocator<delivery_token> alloc(pool_);
+	for (const auto& m : msgs) {
+		auto dtok = std::allocate_shared<delivery_token>(alloc, *this);
+		dtok->set_topics(find_shared_topics(m.first));
+		dtok->set_message(m.second);
+		dtok->add_parent(batchTok);
+		PAHO_MQTTPP_TRACE_POINT(PUBLISH_BEGIN, static_cast<token*>(dtok.get()));
+		toks.push_back(std::move(dtok));
+	}
+	g.unlock();
+
+	pendingTokens_.add(toks);
+
+	#if defined(PAHO_MQTTPP_METRICS)
+		client_metrics* m = metrics_.load(std::memory_order_acquire);
+		if (m)
+			m->on_token_added(n);
+	#endif
+
+	std::vector<std::pair<const itoken*,int>> ids;
+	ids.reserve(n);
+
+	size_t i = 0;
+	int rc = MQTTASYNC_SUCCESS;
+
+	for (; i < n; ++i) {
+		const auto& dtok = toks[i];
+		delivery_response_options opts(dtok);
+
+		credit_.acquire(msgs[i].second->get_payload_length());
+
+		#if defined(PAHO_MQTTPP_METRICS)
+			if (m)
+				dtok->sendTime_ = std::chrono::steady_clock::now();
+		#endif
+
+		rc = MQTTAsync_sendMessage(cli_, msgs[i].first.c_str(),
+								   &(msgs[i].second->msg_), &opts.opts_);
+		PAHO_MQTTPP_TRACE_POINT(PUBLISH_SENT, static_cast<token*>(dtok.get()));
+		if (rc != MQTTASYNC_SUCCESS) {
+			return_credit(msgs[i].second);
+			break;
+		}
+
+		dtok->set_message_id(opts.opts_.token);
+		ids.emplace_back(dtok.get(), opts.opts_.token);
+
+		#if defined(PAHO_MQTTPP_METRICS)
+			if (m)
+				m->on_publish(msgs[i].second->get_payload_length());
+		#endif
+	}
+
+	pendingTokens_.set_message_ids(ids);
+
+	if (i < n) {
+		// The rest of the batch won't be sent. Their tokens never complete,
+		// so they're counted as failures here.
+		for (size_t j = i; j < n; ++j) {
+			pendingTokens_.remove(toks[j].get());
+			PAHO_MQTTPP_TRACE_POINT(TOKEN_COMPLETE, static_cast<token*>(toks[j].get()));
+		}
+
+		#if defined(PAHO_MQTTPP_METRICS)
+			if (m)
+				m->on_token_removed(n - i);
+		#endif
+		count_failure(rc);
+
+		if (i == 0)
+			throw exception(rc);
+
+		for (size_t j = i; j < n; ++j)
+			batchTok->on_child_complete(rc);
+	}
+
+	return batchTok;
+}
+
+itoken_ptr async_client::publish_batch(const publish_collection& msgs)
+{
+	return send_batch(msgs, std::make_shared<token>(*this));
+}
+
+itoken_ptr async_client::publish_batch(const publish_collection& msgs,
+									   void* userContext, iaction_listener& cb)
+{
+	auto tok = std::make_shared<token>(*this);
 	tok->set_user_context(userContext);
 	tok->set_action_callback(cb);
-	add_token(tok);
+	return send_batch(msgs, tok);
+}
 
-	auto dtok = std::dynamic_pointer_cast<delivery_token>(tok);
-	dtok->set_message(msg);
+// The topic goes along with each message in the batch, so the one message
+// can be sent to all of them.
 
-	delivery_response_options opts(dtok);
+itoken_ptr async_client::publish_fanout(const std::vector<std::string>& topics,
+										const payload_buffer& payload, int qos,
+										bool retained /*=false*/)
+{
+	pool_allocator<message> alloc(pool_);
+	const_message_ptr msg = std::allocate_shared<message>(alloc, payload, qos, retained);
 
-	int rc = MQTTAsync_sendMessage(cli_, topic.c_str(), &(msg->msg_),
-								   &opts.opts_);
+	publish_collection msgs;
+	msgs.reserve(topics.size());
+	for (const auto& topic : topics)
+		msgs.emplace_back(topic, msg);
 
-	if (rc == MQTTASYNC_SUCCESS) {
-		dtok->set_message_id(opts.opts_.token);
+	return publish_batch(msgs);
+}
+
+void async_client::set_max_inflight(size_t maxMsgs, size_t maxBytes /*=0*/)
+{
+	if (credit_.set_limits(maxMsgs, maxBytes))
+		notify_credit();
+}
+
+void async_client::set_credit_handler(credit_handler handler)
+{
+	guard g(lock_);
+	creditHandler_ = std::move(handler);
+}
+
+#if defined(PAHO_MQTTPP_METRICS)
+const client_metrics& async_client::enable_metrics()
+{
+	guard g(lock_);
+	client_metrics* m = metrics_.load(std::memory_order_relaxed);
+	if (!m) {
+		m = new client_metrics;
+		// Start the gauge with what's already out, so it balances when
+		// those complete.
+		m->on_token_added(pendingTokens_.size());
+		metrics_.store(m, std::memory_order_release);
 	}
-	else {
-		remove_token(tok);
+	return *m;
+}
+#endif
+
+void async_client::publish_nowait(const std::string& topic, const void* payload,
+								  size_t n, bool retained /*=false*/)
+{
+	MQTTAsync_responseOptions opts = MQTTAsync_responseOptions_initializer;
+
+	int rc = MQTTAsync_send(cli_, topic.c_str(), static_cast<int>(n),
+							const_cast<void*>(payload), 0,
+							retained ? (!0) : 0, &opts);
+
+	if (rc != MQTTASYNC_SUCCESS) {
+		count_failure(rc);
 		throw exception(rc);
 	}
 
-	return tok;
+	#if defined(PAHO_MQTTPP_METRICS)
+		client_metrics* m = metrics_.load(std::memory_order_acquire);
+		if (m)
+			m->on_publish(n);
+	#endif
+}
+
+void async_client::publish_nowait(const std::string& topic, const_message_ptr msg)
+{
+	MQTTAsync_responseOptions opts = MQTTAsync_responseOptions_initializer;
+
+	int rc = MQTTAsync_sendMessage(cli_, topic.c_str(), &(msg->msg_), &opts);
+
+	if (rc != MQTTASYNC_SUCCESS) {
+		count_failure(rc);
+		throw exception(rc);
+	}
+
+	#if defined(PAHO_MQTTPP_METRICS)
+		client_metrics* m = metrics_.load(std::memory_order_acquire);
+		if (m)
+			m->on_publish(msg->get_payload_length());
+	#endif
 }
 
 // --------------------------------------------------------------------------
 
 void async_client::set_callback(callback& cb)
+{
+	set_callback(cb, executor_ptr());
+}
+
+void async_client::set_callback(callback& cb, executor_ptr exec)
 {
 	guard g(lock_);
 	userCallback_ = &cb;
+	std::swap(exec_, exec);
+	set_c_callbacks();
 
+	// Any previous executor is released on the way out, after the lock,
+	// since it may have to wait for its tasks to finish.
+}
+
+void async_client::set_c_callbacks()
+{
 	int rc = MQTTAsync_setCallbacks(cli_, this,
 									&async_client::on_connection_lost,
 									&async_client::on_message_arrived,
@@ -432,6 +977,125 @@ void async_client::set_callback(callback& cb)
 		throw exception(rc);
 }
 
+// --------------------------------------------------------------------------
+// Message routes
+
+void async_client::add_route(const std::string& topicFilter,
+							 topic_router::handler handler)
+{
+	add_routes(route_collection{ { topicFilter, std::move(handler) } });
+}
+
+void async_client::add_routes(const route_collection& routes)
+{
+	for (const auto& r : routes) {
+		if (!r.second)
+			throw std::invalid_argument("Empty handler");
+	}
+	exchange_routes(routes);
+}
+
+async_client::route_collection
+	async_client::exchange_routes(const route_collection& routes)
+{
+	route_collection prev;
+	prev.reserve(routes.size());
+
+	guard g(lock_);
+	// The callback may be reading the current router, so change a copy.
+	topic_router_ptr router = router_ ? std::make_shared<topic_router>(*router_)
+									  : std::make_shared<topic_router>();
+	for (const auto& r : routes) {
+		prev.emplace_back(r.first, router->get_handler(r.first));
+		if (r.second)
+			router->add(r.first, r.second);
+		else
+			router->remove(r.first);
+	}
+	router_ = std::move(router);
+	set_c_callbacks();
+	return prev;
+}
+
+async_client::route_collection
+	async_client::take_routes(const topic_filter_collection& topicFilters)
+{
+	route_collection routes;
+
+	guard g(lock_);
+	if (!router_)
+		return routes;
+
+	for (const auto& filt : topicFilters) {
+		if (router_->contains(filt))
+			routes.emplace_back(filt, topic_router::handler());
+	}
+	g.unlock();
+
+	return routes.empty() ? routes : exchange_routes(routes);
+}
+
+bool async_client::remove_route(const std::string& topicFilter)
+{
+	guard g(lock_);
+	if (!router_ || !router_->contains(topicFilter))
+		return false;
+
+	topic_router_ptr router = std::make_shared<topic_router>(*router_);
+	router->remove(topicFilter);
+	router_ = std::move(router);
+	return true;
+}
+
+// --------------------------------------------------------------------------
+// Consumer queue
+
+void async_client::start_consuming(size_t capacity /*=max*/,
+								   consumer_overflow overflow /*=BLOCK*/)
+{
+	guard g(lock_);
+	que_.capacity(capacity);
+	queOverflow_ = overflow;
+	consuming_ = true;
+	set_c_callbacks();
+}
+
+void async_client::stop_consuming()
+{
+	consuming_ = false;
+	que_.try_put(const_message_ptr());
+}
+
+void async_client::queue_message(const_message_ptr msg)
+{
+	switch (queOverflow_) {
+		case consumer_overflow::BLOCK:
+			que_.put(std::move(msg));
+			break;
+
+		case consumer_overflow::DROP_OLDEST:
+			// A consumer may make room between the two calls, in which
+			// case nothing gets dropped.
+			while (!que_.try_put(msg)) {
+				const_message_ptr old;
+				que_.try_get(&old);
+			}
+			break;
+
+		case consumer_overflow::DROP_NEWEST:
+			que_.try_put(std::move(msg));
+			break;
+	}
+}
+
+std::vector<const_message_ptr> async_client::consume_messages(size_t n)
+{
+	std::vector<const_message_ptr> msgs;
+	msgs.reserve(std::min<size_t>(n, que_.size()+1));
+	que_.get_batch(std::back_inserter(msgs), n);
+	return msgs;
+}
+
 // --------------------------------------------------------------------------
 // Subscribe
 
@@ -456,6 +1120,7 @@ itoken_ptr async_client::subscribe(const topic_filter_collection& topicFilters,
 	free_topic_filters(filts);
 	if (rc != MQTTASYNC_SUCCESS) {
 		remove_token(tok);
+		count_failure(rc);
 		throw exception(rc);
 	}
 
@@ -487,6 +1152,7 @@ itoken_ptr async_client::subscribe(const topic_filter_collection& topicFilters,
 	free_topic_filters(filts);
 	if (rc != MQTTASYNC_SUCCESS) {
 		remove_token(tok);
+		count_failure(rc);
 		throw exception(rc);
 	}
 
@@ -504,6 +1170,7 @@ itoken_ptr async_client::subscribe(const std::string& topicFilter, int qos)
 
 	if (rc != MQTTASYNC_SUCCESS) {
 		remove_token(tok);
+		count_failure(rc);
 		throw exception(rc);
 	}
 
@@ -524,95 +1191,172 @@ itoken_ptr async_client::subscribe(const std::string& topicFilter, int qos,
 
 	if (rc != MQTTASYNC_SUCCESS) {
 		remove_token(tok);
+		count_failure(rc);
 		throw exception(rc);
 	}
 
 	return tok;
 }
 
+itoken_ptr async_client::subscribe(const std::string& topicFilter, int qos,
+								   topic_router::handler handler)
+{
+	if (!handler)
+		throw std::invalid_argument("Empty handler");
+
+	auto prev = exchange_routes(route_collection{ { topicFilter, std::move(handler) } });
+	try {
+		return subscribe(topicFilter, qos);
+	}
+	catch (...) {
+		exchange_routes(prev);
+		throw;
+	}
+}
+
+itoken_ptr async_client::subscribe(const route_collection& routes,
+								   const qos_collection& qos)
+{
+	if (routes.size() != qos.size())
+		throw std::invalid_argument("Collection sizes don't match");
+
+	topic_filter_collection topicFilters;
+	topicFilters.reserve(routes.size());
+	for (const auto& r : routes) {
+		if (!r.second)
+			throw std::invalid_argument("Empty handler");
+		topicFilters.push_back(r.first);
+	}
+
+	auto prev = exchange_routes(routes);
+	try {
+		return subscribe(topicFilters, qos);
+	}
+	catch (...) {
+		exchange_routes(prev);
+		throw;
+	}
+}
+
 // --------------------------------------------------------------------------
 // Unsubscribe
 
 itoken_ptr async_client::unsubscribe(const std::string& topicFilter)
 {
-	itoken_ptr tok = std::make_shared<token>(*this, topicFilter);
-	add_token(tok);
+	auto prev = take_routes(topic_filter_collection{ topicFilter });
+	try {
+		itoken_ptr tok = std::make_shared<token>(*this, topicFilter);
+		add_token(tok);
 
-	response_options opts(std::dynamic_pointer_cast<token>(tok));
+		response_options opts(std::dynamic_pointer_cast<token>(tok));
 
-	int rc = MQTTAsync_unsubscribe(cli_, topicFilter.c_str(), &opts.opts_);
+		int rc = MQTTAsync_unsubscribe(cli_, topicFilter.c_str(), &opts.opts_);
 
-	if (rc != MQTTASYNC_SUCCESS) {
-		remove_token(tok);
-		throw exception(rc);
-	}
+		if (rc != MQTTASYNC_SUCCESS) {
+			remove_token(tok);
+			count_failure(rc);
+			throw exception(rc);
+		}
 
-	return tok;
+		return tok;
+	}
+	catch (...) {
+		if (!prev.empty())
+			exchange_routes(prev);
+		throw;
+	}
 }
 
 itoken_ptr async_client::unsubscribe(const topic_filter_collection& topicFilters)
 {
-	size_t n = topicFilters.size();
-	std::vector<char*> filts = alloc_topic_filters(topicFilters);
+	auto prev = take_routes(topicFilters);
+	try {
+		size_t n = topicFilters.size();
+		std::vector<char*> filts = alloc_topic_filters(topicFilters);
 
-	itoken_ptr tok = std::make_shared<token>(*this, topicFilters);
-	add_token(tok);
+		itoken_ptr tok = std::make_shared<token>(*this, topicFilters);
+		add_token(tok);
 
-	response_options opts(std::dynamic_pointer_cast<token>(tok));
+		response_options opts(std::dynamic_pointer_cast<token>(tok));
 
-	int rc = MQTTAsync_unsubscribeMany(cli_, static_cast<int>(n), static_cast<char**>(&filts[0]), &opts.opts_);
+		int rc = MQTTAsync_unsubscribeMany(cli_, static_cast<int>(n), static_cast<char**>(&filts[0]), &opts.opts_);
 
-	free_topic_filters(filts);
-	if (rc != MQTTASYNC_SUCCESS) {
-		remove_token(tok);
-		throw exception(rc);
-	}
+		free_topic_filters(filts);
+		if (rc != MQTTASYNC_SUCCESS) {
+			remove_token(tok);
+			count_failure(rc);
+			throw exception(rc);
+		}
 
-	return tok;
+		return tok;
+	}
+	catch (...) {
+		if (!prev.empty())
+			exchange_routes(prev);
+		throw;
+	}
 }
 
 itoken_ptr async_client::unsubscribe(const topic_filter_collection& topicFilters,
 									 void* userContext, iaction_listener& cb)
 {
-	size_t n = topicFilters.size();
-	std::vector<char*> filts = alloc_topic_filters(topicFilters);
+	auto prev = take_routes(topicFilters);
+	try {
+		size_t n = topicFilters.size();
+		std::vector<char*> filts = alloc_topic_filters(topicFilters);
 
-	itoken_ptr tok = std::make_shared<token>(*this, topicFilters);
-	tok->set_user_context(userContext);
-	tok->set_action_callback(cb);
-	add_token(tok);
+		itoken_ptr tok = std::make_shared<token>(*this, topicFilters);
+		tok->set_user_context(userContext);
+		tok->set_action_callback(cb);
+		add_token(tok);
 
-	response_options opts(std::dynamic_pointer_cast<token>(tok));
+		response_options opts(std::dynamic_pointer_cast<token>(tok));
 
-	int rc = MQTTAsync_unsubscribeMany(cli_, static_cast<int>(n), static_cast<char**>(&filts[0]), &opts.opts_);
+		int rc = MQTTAsync_unsubscribeMany(cli_, static_cast<int>(n), static_cast<char**>(&filts[0]), &opts.opts_);
 
-	free_topic_filters(filts);
-	if (rc != MQTTASYNC_SUCCESS) {
-		remove_token(tok);
-		throw exception(rc);
-	}
+		free_topic_filters(filts);
+		if (rc != MQTTASYNC_SUCCESS) {
+			remove_token(tok);
+			count_failure(rc);
+			throw exception(rc);
+		}
 
-	return tok;
+		return tok;
+	}
+	catch (...) {
+		if (!prev.empty())
+			exchange_routes(prev);
+		throw;
+	}
 }
 
 itoken_ptr async_client::unsubscribe(const std::string& topicFilter,
 									 void* userContext, iaction_listener& cb)
 {
-	itoken_ptr tok = std::make_shared<token>(*this, topicFilter);
-	tok->set_user_context(userContext);
-	tok->set_action_callback(cb);
-	add_token(tok);
+	auto prev = take_routes(topic_filter_collection{ topicFilter });
+	try {
+		itoken_ptr tok = std::make_shared<token>(*this, topicFilter);
+		tok->set_user_context(userContext);
+		tok->set_action_callback(cb);
+		add_token(tok);
 
-	response_options opts(std::dynamic_pointer_cast<token>(tok));
+		response_options opts(std::dynamic_pointer_cast<token>(tok));
 
-	int rc = MQTTAsync_unsubscribe(cli_, topicFilter.c_str(), &opts.opts_);
+		int rc = MQTTAsync_unsubscribe(cli_, topicFilter.c_str(), &opts.opts_);
 
-	if (rc != MQTTASYNC_SUCCESS) {
-		remove_token(tok);
-		throw exception(rc);
-	}
+		if (rc != MQTTASYNC_SUCCESS) {
+			remove_token(tok);
+			count_failure(rc);
+			throw exception(rc);
+		}
 
-	return tok;
+		return tok;
+	}
+	catch (...) {
+		if (!prev.empty())
+			exchange_routes(prev);
+		throw;
+	}
 }
 
 /////////////////////////////////////////////////////////////////////////////
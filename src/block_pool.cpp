@@ -0,0 +1,120 @@
+// block_pool.cpp
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#include "mqtt/block_pool.h"
+#include <new>
+
+namespace mqtt {
+
+const size_t block_pool::MIN_BLOCK_SIZE;
+const size_t block_pool::MAX_BLOCK_SIZE;
+const size_t block_pool::N_SIZES;
+
+/////////////////////////////////////////////////////////////////////////////
+
+block_pool::block_pool()
+{
+	for (size_t i=0; i<N_SIZES; ++i) {
+		free_[i] = nullptr;
+		nfree_[i] = 0;
+	}
+}
+
+block_pool::~block_pool()
+{
+	clear();
+}
+
+size_t block_pool::size_index(size_t n)
+{
+	size_t i = 0;
+	for (size_t sz = MIN_BLOCK_SIZE; sz < n && i < N_SIZES; sz <<= 1)
+		++i;
+	return i;
+}
+
+void* block_pool::allocate(size_t n)
+{
+	size_t i = size_index(n);
+	if (i == N_SIZES)
+		return ::operator new(n);
+
+	guard g(lock_);
+	free_block* blk = free_[i];
+	if (blk) {
+		free_[i] = blk->next;
+		--nfree_[i];
+		return blk;
+	}
+	g.unlock();
+
+	return ::operator new(MIN_BLOCK_SIZE << i);
+}
+
+void block_pool::deallocate(void* p, size_t n)
+{
+	if (!p)
+		return;
+
+	size_t i = size_index(n);
+	if (i == N_SIZES) {
+		::operator delete(p);
+		return;
+	}
+
+	free_block* blk = static_cast<free_block*>(p);
+	guard g(lock_);
+	blk->next = free_[i];
+	free_[i] = blk;
+	++nfree_[i];
+}
+
+void block_pool::clear()
+{
+	free_block* lists[N_SIZES];
+
+	guard g(lock_);
+	for (size_t i=0; i<N_SIZES; ++i) {
+		lists[i] = free_[i];
+		free_[i] = nullptr;
+		nfree_[i] = 0;
+	}
+	g.unlock();
+
+	for (size_t i=0; i<N_SIZES; ++i) {
+		while (lists[i]) {
+			free_block* blk = lists[i];
+			lists[i] = blk->next;
+			::operator delete(blk);
+		}
+	}
+}
+
+size_t block_pool::num_free() const
+{
+	size_t n = 0;
+	guard g(lock_);
+	for (size_t i=0; i<N_SIZES; ++i)
+		n += nfree_[i];
+	return n;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
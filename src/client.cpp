@@ -29,22 +29,57 @@ const int client::DFLT_QOS = 1;
 /////////////////////////////////////////////////////////////////////////////
 
 client::client(const std::string& serverURI, const std::string& clientId)
-			: cli_(serverURI, clientId), timeout_(-1)
+			: cli_(serverURI, clientId), timeout_(-1), window_(1)
 {
 }
 
 client::client(const std::string& serverURI, const std::string& clientId,
 			   const std::string& persistDir)
-			: cli_(serverURI, clientId, persistDir), timeout_(-1)
+			: cli_(serverURI, clientId, persistDir), timeout_(-1), window_(1)
 {
 }
 
 client::client(const std::string& serverURI, const std::string& clientId,
 			   iclient_persistence* persistence)
-			: cli_(serverURI, clientId, persistence), timeout_(-1)
+			: cli_(serverURI, clientId, persistence), timeout_(-1), window_(1)
 {
 }
 
+// Takes the token for a message that was just sent, and waits until fewer
+// than a window's worth of messages are unacknowledged. Older messages
+// that are already done are taken off too, so that if one of them failed,
+// the error is thrown now rather than later.
+// Each token is taken off under the lock, but waited on without it, so
+// that other publishers aren't held up by it.
+
+void client::complete(idelivery_token_ptr tok, bool wait /*=false*/)
+{
+	guard g(lock_);
+
+	if (wait || window_ <= 1) {
+		while (!inflight_.empty()) {
+			auto t = std::move(inflight_.front());
+			inflight_.pop_front();
+			g.unlock();
+			t->wait_for_completion(timeout_);
+			g.lock();
+		}
+		g.unlock();
+		tok->wait_for_completion(timeout_);
+		return;
+	}
+
+	inflight_.push_back(std::move(tok));
+	while (!inflight_.empty() &&
+		   (inflight_.size() >= window_ || inflight_.front()->is_complete())) {
+		auto t = std::move(inflight_.front());
+		inflight_.pop_front();
+		g.unlock();
+		t->wait_for_completion(timeout_);
+		g.lock();
+	}
+}
+
 void client::close()
 {
 	// TODO: What?
@@ -62,14 +97,28 @@ void client::connect(connect_options opts)
 
 void client::disconnect()
 {
+	flush();
 	cli_.disconnect()->wait_for_completion(timeout_);
 }
 
 void client::disconnect(long timeout)
 {
+	flush();
 	cli_.disconnect(timeout)->wait_for_completion(timeout_);
 }
 
+void client::flush()
+{
+	guard g(lock_);
+	while (!inflight_.empty()) {
+		auto tok = std::move(inflight_.front());
+		inflight_.pop_front();
+		g.unlock();
+		tok->wait_for_completion(timeout_);
+		g.lock();
+	}
+}
+
 //std::string client::generate_client_id()
 //{
 //}
@@ -92,6 +141,12 @@ std::vector<idelivery_token_ptr> client::get_pending_delivery_tokens() const
 	return cli_.get_pending_delivery_tokens();
 }
 
+size_t client::get_publish_window() const
+{
+	guard g(lock_);
+	return window_;
+}
+
 int client::get_time_to_wait() const
 {
 	return timeout_;
@@ -110,19 +165,26 @@ bool client::is_connected() const
 void client::publish(const std::string& top, const void* payload, size_t n,
 					 int qos, bool retained)
 {
-	cli_.publish(top, payload, n, qos, retained)->wait_for_completion(timeout_);
+	complete(cli_.publish(top, payload, n, qos, retained));
 }
 
 void client::publish(const std::string& top, const_message_ptr msg)
 {
-	cli_.publish(top, msg)->wait_for_completion(timeout_);
+	complete(cli_.publish(top, msg));
 }
 
 void client::publish(const std::string& top, const message& msg)
 {
-	// Don't destroy non-heap message.
+	// The message has to outlive the call if it's left in the window.
+	// Otherwise, don't destroy non-heap message, and wait for it here,
+	// after any older ones still in the window.
+	if (get_publish_window() > 1) {
+		complete(cli_.publish(top, std::make_shared<message>(msg)));
+		return;
+	}
+
 	std::shared_ptr<message> msgp(const_cast<message*>(&msg), [](message*){});
-	cli_.publish(top, msgp)->wait_for_completion(timeout_);
+	complete(cli_.publish(top, msgp), true);
 }
 
 void client::set_callback(callback& cb)
@@ -130,6 +192,17 @@ void client::set_callback(callback& cb)
 	cli_.set_callback(cb);
 }
 
+void client::set_callback(callback& cb, executor_ptr exec)
+{
+	cli_.set_callback(cb, std::move(exec));
+}
+
+void client::set_publish_window(size_t n)
+{
+	guard g(lock_);
+	window_ = n;
+}
+
 void client::set_time_to_wait(int timeout)
 {
 	timeout_ = timeout;
@@ -0,0 +1,184 @@
+// client_metrics.cpp
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#include "mqtt/client_metrics.h"
+#include <limits>
+#include <cmath>
+
+namespace mqtt {
+
+const unsigned latency_histogram::SUB_BUCKET_BITS;
+const size_t latency_histogram::SUB_BUCKETS;
+const size_t latency_histogram::NUM_BUCKETS;
+
+const int client_metrics::MIN_REASON_CODE;
+const int client_metrics::MAX_REASON_CODE;
+const size_t client_metrics::NUM_REASON_CODES;
+
+// The position of the highest bit that's set in a non-zero value.
+static inline unsigned high_bit(uint64_t v)
+{
+	#if defined(__GNUC__)
+		return 63u - unsigned(__builtin_clzll(v));
+	#else
+		unsigned n = 0;
+		while (v >>= 1)
+			++n;
+		return n;
+	#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// latency_histogram
+
+latency_histogram::latency_histogram()
+		: count_(0), sum_(0), min_(std::numeric_limits<uint64_t>::max()), max_(0)
+{
+	for (auto& c : counts_)
+		c.store(0, std::memory_order_relaxed);
+}
+
+// Values below SUB_BUCKETS each have a bucket. Above that, each power of
+// two is split into SUB_BUCKETS buckets, using the bits just below the
+// highest one.
+
+size_t latency_histogram::bucket_index(uint64_t v)
+{
+	if (v < SUB_BUCKETS)
+		return size_t(v);
+
+	unsigned shift = high_bit(v) - SUB_BUCKET_BITS;
+	return size_t(shift + 1) * SUB_BUCKETS + size_t((v >> shift) - SUB_BUCKETS);
+}
+
+uint64_t latency_histogram::bucket_lower(size_t i)
+{
+	if (i < SUB_BUCKETS)
+		return uint64_t(i);
+
+	unsigned shift = unsigned(i / SUB_BUCKETS) - 1;
+	return uint64_t(SUB_BUCKETS + i % SUB_BUCKETS) << shift;
+}
+
+uint64_t latency_histogram::bucket_upper(size_t i)
+{
+	if (i < SUB_BUCKETS)
+		return uint64_t(i);
+
+	unsigned shift = unsigned(i / SUB_BUCKETS) - 1;
+	return bucket_lower(i) + ((uint64_t(1) << shift) - 1);
+}
+
+void latency_histogram::record(uint64_t ns)
+{
+	counts_[bucket_index(ns)].fetch_add(1, std::memory_order_relaxed);
+	count_.fetch_add(1, std::memory_order_relaxed);
+	sum_.fetch_add(ns, std::memory_order_relaxed);
+
+	uint64_t x = min_.load(std::memory_order_relaxed);
+	while (ns < x && !min_.compare_exchange_weak(x, ns, std::memory_order_relaxed))
+		;
+
+	x = max_.load(std::memory_order_relaxed);
+	while (ns > x && !max_.compare_exchange_weak(x, ns, std::memory_order_relaxed))
+		;
+}
+
+void latency_histogram::reset()
+{
+	for (auto& c : counts_)
+		c.store(0, std::memory_order_relaxed);
+	count_.store(0, std::memory_order_relaxed);
+	sum_.store(0, std::memory_order_relaxed);
+	min_.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+	max_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t latency_histogram::min() const
+{
+	uint64_t x = min_.load(std::memory_order_relaxed);
+	return (x == std::numeric_limits<uint64_t>::max()) ? 0 : x;
+}
+
+double latency_histogram::mean() const
+{
+	uint64_t n = count();
+	return (n == 0) ? 0.0 : double(sum_.load(std::memory_order_relaxed)) / double(n);
+}
+
+uint64_t latency_histogram::percentile(double pct) const
+{
+	// Count the buckets themselves, so the total agrees with them even if
+	// values are being recorded.
+	uint64_t total = 0;
+	for (const auto& c : counts_)
+		total += c.load(std::memory_order_relaxed);
+
+	if (total == 0)
+		return 0;
+
+	if (pct < 0.0)
+		pct = 0.0;
+	else if (pct > 100.0)
+		pct = 100.0;
+
+	uint64_t target = uint64_t(std::ceil(pct / 100.0 * double(total)));
+	if (target == 0)
+		target = 1;
+
+	uint64_t n = 0;
+	for (size_t i=0; i<NUM_BUCKETS; ++i) {
+		n += counts_[i].load(std::memory_order_relaxed);
+		if (n >= target) {
+			uint64_t v = bucket_upper(i), mx = max();
+			return (v > mx && mx >= bucket_lower(i)) ? mx : v;
+		}
+	}
+	return max();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// client_metrics
+
+client_metrics::client_metrics()
+		: msgsPublished_(0), bytesPublished_(0), msgsReceived_(0),
+			bytesReceived_(0), tokensInFlight_(0), failures_(0),
+			connectionsLost_(0), reconnects_(0), lost_(false)
+{
+	for (auto& c : failuresByCode_)
+		c.store(0, std::memory_order_relaxed);
+}
+
+void client_metrics::on_failure(int rc)
+{
+	failures_.fetch_add(1, std::memory_order_relaxed);
+	if (rc >= MIN_REASON_CODE && rc <= MAX_REASON_CODE)
+		failuresByCode_[rc - MIN_REASON_CODE].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t client_metrics::failures(int rc) const
+{
+	if (rc < MIN_REASON_CODE || rc > MAX_REASON_CODE)
+		return 0;
+	return failuresByCode_[rc - MIN_REASON_CODE].load(std::memory_order_relaxed);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
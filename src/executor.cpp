@@ -0,0 +1,138 @@
+// executor.cpp
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#include "mqtt/executor.h"
+#include <algorithm>
+
+namespace mqtt {
+
+const size_t thread_executor::DFLT_CAPACITY = 1024;
+
+/////////////////////////////////////////////////////////////////////////////
+// thread_executor
+
+thread_executor::thread_executor(size_t cap /*=DFLT_CAPACITY*/,
+								 executor_overflow overflow /*=DROP*/)
+					: que_(std::make_shared<queue_type>(cap)),
+						overflow_(overflow), dropped_(0)
+{
+	thr_ = std::thread(&thread_executor::run, que_);
+}
+
+thread_executor::~thread_executor()
+{
+	// An empty task tells the thread to quit. It's queued behind any
+	// tasks that are still waiting, so they get to run first.
+	if (thr_.get_id() != std::this_thread::get_id()) {
+		que_->put(task());
+		thr_.join();
+		return;
+	}
+
+	// A task is destroying us, so the thread can't join itself, nor wait
+	// for room in the queue, since it's the one that empties it. The queue
+	// is grown if need be. The thread keeps its own reference to it, and
+	// exits once the task returns and the rest of the queue is drained.
+	while (!que_->try_put(task()))
+		que_->capacity(que_->capacity() + 1);
+	thr_.detach();
+}
+
+void thread_executor::run(std::shared_ptr<queue_type> que)
+{
+	task t;
+	while ((t = que->get())) {
+		try {
+			t();
+		}
+		catch (...) {}
+	}
+}
+
+void thread_executor::execute(task t)
+{
+	if (!t)
+		return;
+
+	if (overflow_ == executor_overflow::BLOCK)
+		que_->put(std::move(t));
+	else if (!que_->try_put(std::move(t)))
+		++dropped_;
+}
+
+// Running the task here, rather than dropping it, can put it ahead of
+// tasks that are still queued, but a full queue is already late.
+
+void thread_executor::execute_always(task t)
+{
+	if (!t)
+		return;
+
+	if (overflow_ == executor_overflow::BLOCK)
+		que_->put(std::move(t));
+	else if (!que_->try_put(t)) {
+		try {
+			t();
+		}
+		catch (...) {}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// thread_pool_executor
+
+thread_pool_executor::thread_pool_executor(size_t nthreads,
+										   size_t cap /*=DFLT_CAPACITY*/,
+										   executor_overflow overflow /*=DROP*/)
+						: next_(0)
+{
+	nthreads = std::max<size_t>(nthreads, 1);
+	for (size_t i=0; i<nthreads; ++i)
+		threads_.emplace_back(new thread_executor(cap, overflow));
+}
+
+void thread_pool_executor::execute(task t)
+{
+	size_t i = next_++ % threads_.size();
+	threads_[i]->execute(std::move(t));
+}
+
+void thread_pool_executor::execute(const std::string& key, task t)
+{
+	size_t i = std::hash<std::string>()(key) % threads_.size();
+	threads_[i]->execute(std::move(t));
+}
+
+void thread_pool_executor::execute_always(task t)
+{
+	size_t i = next_++ % threads_.size();
+	threads_[i]->execute_always(std::move(t));
+}
+
+size_t thread_pool_executor::dropped() const
+{
+	size_t n = 0;
+	for (const auto& thr : threads_)
+		n += thr->dropped();
+	return n;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
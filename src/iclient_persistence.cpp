@@ -18,18 +18,20 @@
 
 #include "mqtt/types.h"
 #include "mqtt/iclient_persistence.h"
+#include <vector>
+#include <stdexcept>
 #include <cstring>
 #include <cstdlib>
+#include <limits>
+#include <new>
 
 namespace mqtt {
 
 /////////////////////////////////////////////////////////////////////////////
 
 // This is an internal class for wrapping a buffer into a persistable type.
-// Note that it does not copy the buffer or take possession of it, and thus
-// is only useful for a subset of circumstances where the buffer is
-// guaranteed to live longer than the wrapper object, and performance is
-// important.
+// It keeps a copy of the data, so that the persistence object can hold on
+// to it after the put() call returns.
 
 class persistence_wrapper : virtual public ipersistable
 {
@@ -37,6 +39,8 @@ class persistence_wrapper : virtual public ipersistable
 	const byte_buffer payload_;
 
 public:
+	persistence_wrapper(byte_buffer&& payload)
+			: payload_(std::move(payload)) {}
 	persistence_wrapper(const void* payload, size_t payloadlen) 
 			: payload_(static_cast<const byte*>(payload), 
 					   static_cast<const byte*>(payload) + payloadlen) {}
@@ -67,20 +71,285 @@ public:
 	}
 };
 
+/////////////////////////////////////////////////////////////////////////////
+// persistable_view
+
+size_t persistable_view::get_length() const
+{
+	size_t len = 0;
+	for (size_t i=0; i<n_; ++i)
+		len += iov_[i].len;
+	return len;
+}
+
+const byte_buffer& persistable_view::assembled_payload() const
+{
+	if (payload_.empty()) {
+		payload_.reserve(get_length());
+		for (size_t i=0; i<n_; ++i)
+			payload_.append(iov_[i].data, iov_[i].len);
+	}
+	return payload_;
+}
+
+std::vector<byte> persistable_view::get_header_byte_arr() const
+{
+	const byte* p = get_header_bytes();
+	return p ? std::vector<byte>(p, p+get_header_length()) : std::vector<byte>();
+}
+
+const byte* persistable_view::get_payload_bytes() const
+{
+	switch (n_) {
+		case 0: return nullptr;
+		case 1: return iov_[0].data;
+		case 2: return iov_[1].data;
+		default: return assembled_payload().data();
+	}
+}
+
+std::vector<byte> persistable_view::get_payload_byte_arr() const
+{
+	const byte* p = get_payload_bytes();
+	return p ? std::vector<byte>(p, p+get_payload_length()) : std::vector<byte>();
+}
+
+size_t persistable_view::get_payload_length() const
+{
+	switch (n_) {
+		case 0: return 0;
+		case 1: return iov_[0].len;
+		case 2: return iov_[1].len;
+		default: return get_length();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// persistence_snapshot
+
+const size_t persistence_snapshot::npos;
+
+void persistence_snapshot::reserve(size_t nkeys, size_t keyLen)
+{
+	index_.reserve(nkeys);
+	keys_.reserve(keyLen + nkeys);
+}
+
+size_t persistence_snapshot::add(const std::string& key, size_t len)
+{
+	if (data_)
+		throw std::logic_error("Snapshot is already allocated");
+
+	if (len > UINT32_MAX || keys_.size() + key.size() >= UINT32_MAX)
+		throw std::invalid_argument("Snapshot entry is too large");
+
+	index_.push_back(entry{ uint64_t(dataLen_), uint32_t(len), uint32_t(keys_.size()) });
+	keys_.append(key);
+	keys_.push_back('\0');
+	dataLen_ += len;
+	return index_.size() - 1;
+}
+
+namespace {
+
+// FNV-1a hash of a NUL-terminated key
+size_t hash_key(const char* k)
+{
+	uint32_t h = 2166136261U;
+	while (*k)
+		h = (h ^ uint8_t(*k++)) * 16777619U;
+	return size_t(h);
+}
+
+}
+
+// The hash table is at most half full, with linear probing.
+
+void persistence_snapshot::allocate()
+{
+	data_.reset(new byte[dataLen_ ? dataLen_ : 1]);
+
+	size_t n = 2;
+	while (n < 2*index_.size())
+		n <<= 1;
+
+	table_.assign(n, 0);
+	for (size_t i=0; i<index_.size(); ++i) {
+		size_t j = hash_key(key(i)) & (n-1);
+		while (table_[j] != 0)
+			j = (j+1) & (n-1);
+		table_[j] = uint32_t(i+1);
+	}
+}
+
+size_t persistence_snapshot::find(const char* k) const
+{
+	if (table_.empty())
+		return npos;
+
+	size_t mask = table_.size() - 1;
+	for (size_t j=hash_key(k) & mask; table_[j] != 0; j=(j+1) & mask) {
+		size_t i = table_[j] - 1;
+		if (std::strcmp(key(i), k) == 0)
+			return i;
+	}
+	return npos;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// iclient_persistence
+
+// The default copies the data in one go, so that the store can keep it.
+
+void iclient_persistence::put_iov(const std::string& key,
+								  const persistence_iov* iov, size_t n)
+{
+	ipersistable_ptr p;
+
+	if (n == 1)
+		p = std::make_shared<persistence_wrapper>(iov[0].data, iov[0].len);
+	else if (n == 2)
+		p = std::make_shared<persistence_wrapper>(iov[0].data, iov[0].len,
+												  iov[1].data, iov[1].len);
+	else {
+		byte_buffer buf;
+		buf.reserve(persistable_view(iov, n).get_length());
+		for (size_t i=0; i<n; ++i)
+			buf.append(iov[i].data, iov[i].len);
+		p = std::make_shared<persistence_wrapper>(std::move(buf));
+	}
+
+	put(key, p);
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // Functions to transition C persistence calls to the C++ persistence object.
 
 // Upon the call to persistence_open(), the 'context' has the address of the
-// C++ persistence object, which is reassigned to the 'handle'. Subsequent
-// calls have the object address as the handle.
+// C++ persistence object. The 'handle' given back to the C library is a
+// small object that points to it, and keeps the state for restoring a
+// session. Subsequent calls have that as the handle, and it's deleted by
+// persistence_close().
+//
+// To restore a session, the C library gets the keys, then the data for
+// each key, and it does this once for each kind of data, picking out the
+// keys of that kind by their prefix. If the store can be read in bulk, the
+// first call to persistence_keys() takes a snapshot of the whole store, the
+// later ones list the keys from it, and persistence_get() reads from it
+// until every key has been read. Anything that changes the store drops the
+// snapshot.
+
+namespace {
+
+// The handle for a store that was opened by the C library.
+class persistence_handle
+{
+	iclient_persistence* per_;
+	persistence_snapshot_ptr snap_;
+	std::vector<bool> restored_;
+	size_t nrestored_;
+	size_t nextKey_;
+
+public:
+	explicit persistence_handle(iclient_persistence* per)
+		: per_(per), nrestored_(0), nextKey_(0) {}
+
+	iclient_persistence* store() { return per_; }
+
+	// The snapshot being used to restore a session, if any
+	const persistence_snapshot_ptr& snapshot() const { return snap_; }
+
+	void begin_restore(persistence_snapshot_ptr snap) {
+		restored_.assign(snap->size(), false);
+		snap_ = std::move(snap);
+		nrestored_ = nextKey_ = 0;
+	}
+
+	void end_restore() {
+		snap_.reset();
+		restored_.clear();
+		nrestored_ = nextKey_ = 0;
+	}
+
+	// Finds a key in the snapshot. They're often read in the order they
+	// were given.
+	size_t find(const char* key) const {
+		size_t i = nextKey_;
+		if (i >= snap_->size() || std::strcmp(snap_->key(i), key) != 0)
+			i = snap_->find(key);
+		return i;
+	}
+
+	// Marks a key as read, dropping the snapshot after the last one.
+	void restored(size_t i) {
+		nextKey_ = i + 1;
+		if (!restored_[i]) {
+			restored_[i] = true;
+			if (++nrestored_ == snap_->size())
+				end_restore();
+		}
+	}
+};
+
+inline persistence_handle* to_handle(void* handle)
+{
+	return static_cast<persistence_handle*>(handle);
+}
+
+// The C library frees each key, so each needs its own allocation.
+char* dup_key(const char* key, size_t len)
+{
+	char* s = static_cast<char*>(malloc(len+1));
+	if (!s)
+		throw std::bad_alloc();
+	std::memcpy(s, key, len);
+	s[len] = '\0';
+	return s;
+}
+
+// Gives the C library an array of copies of the keys, which it frees.
+template <typename KeyFunc>
+void copy_keys(size_t n, KeyFunc key, char*** keys, int* nkeys)
+{
+	if (n > size_t(std::numeric_limits<int>::max()))
+		throw std::length_error("too many keys");
+
+	if (n == 0) {
+		*keys = nullptr;
+		*nkeys = 0;
+		return;
+	}
+
+	char** k = static_cast<char**>(malloc(n*sizeof(char*)));
+	if (!k)
+		throw std::bad_alloc();
+
+	size_t i = 0;
+	try {
+		for (; i<n; ++i)
+			k[i] = key(i);
+	}
+	catch (...) {
+		while (i > 0)
+			free(k[--i]);
+		free(k);
+		throw;
+	}
+
+	*keys = k;
+	*nkeys = static_cast<int>(n);
+}
+
+}
 
 int iclient_persistence::persistence_open(void** handle, const char* clientID, 
 										  const char* serverURI, void* context)
 {
 	try {
 		if (context) {
-			static_cast<iclient_persistence*>(context)->open(clientID, serverURI);
-			*handle = context;
+			auto per = static_cast<iclient_persistence*>(context);
+			per->open(clientID, serverURI);
+			*handle = new persistence_handle(per);
 			return MQTTASYNC_SUCCESS;
 		}
 	}
@@ -93,7 +362,8 @@ int iclient_persistence::persistence_close(void* handle)
 {
 	try {
 		if (handle) {
-			static_cast<iclient_persistence*>(handle)->close();
+			std::unique_ptr<persistence_handle> h(to_handle(handle));
+			h->store()->close();
 			return MQTTASYNC_SUCCESS;
 		}
 	}
@@ -102,28 +372,39 @@ int iclient_persistence::persistence_close(void* handle)
 	return MQTTCLIENT_PERSISTENCE_ERROR;
 }
 
+// The C library passes the pieces of a message in a handful of buffers,
+// so the references to them normally fit on the stack.
+
 int iclient_persistence::persistence_put(void* handle, char* key, int bufcount, 
 										 char* buffers[], int buflens[])
 {
+	const size_t N_LOCAL_IOV = 8;
+
 	try {
 		if (handle && bufcount > 0) {
-			ipersistable_ptr p;
-			if (bufcount == 1)
-				p = std::make_shared<persistence_wrapper>(buffers[0], buflens[0]);
-			else if (bufcount == 2)
-				p = std::make_shared<persistence_wrapper>(buffers[0], buflens[0],
-														  buffers[1], buflens[1]);
-			else {
-				std::string buf;
-				for (int i=0; i<bufcount; ++i) {
-					if (buffers[i] && buflens[i] > 0)
-						buf.append(buffers[i], buflens[i]);
-				}
-				if (buf.empty())	// No data!
-					return MQTTCLIENT_PERSISTENCE_ERROR;
-				p = std::make_shared<persistence_wrapper>(&buf[0], buf.size());
+			persistence_iov localIov[N_LOCAL_IOV];
+			std::vector<persistence_iov> vecIov;
+
+			size_t n = size_t(bufcount);
+			persistence_iov* iov = localIov;
+			if (n > N_LOCAL_IOV) {
+				vecIov.resize(n);
+				iov = vecIov.data();
 			}
-			static_cast<iclient_persistence*>(handle)->put(key, p);
+
+			size_t len = 0;
+			for (size_t i=0; i<n; ++i) {
+				iov[i].data = reinterpret_cast<const byte*>(buffers[i]);
+				iov[i].len = (buffers[i] && buflens[i] > 0) ? size_t(buflens[i]) : 0;
+				len += iov[i].len;
+			}
+
+			if (n > 2 && len == 0)	// No data!
+				return MQTTCLIENT_PERSISTENCE_ERROR;
+
+			auto h = to_handle(handle);
+			h->end_restore();
+			h->store()->put_iov(key, iov, n);
 			return MQTTASYNC_SUCCESS;
 		}
 	}
@@ -137,7 +418,29 @@ int iclient_persistence::persistence_get(void* handle, char* key,
 {
 	try {
 		if (handle) {
-			ipersistable_ptr p = static_cast<iclient_persistence*>(handle)->get(key);
+			auto h = to_handle(handle);
+
+			if (h->snapshot()) {
+				const persistence_snapshot& snap = *h->snapshot();
+				size_t i = h->find(key);
+				if (i != persistence_snapshot::npos) {
+					size_t len = snap.data_length(i);
+					if (len > size_t(std::numeric_limits<int>::max()))
+						return MQTTCLIENT_PERSISTENCE_ERROR;
+
+					char* buf = static_cast<char*>(malloc(len ? len : 1));
+					if (!buf)
+						return MQTTCLIENT_PERSISTENCE_ERROR;
+
+					std::memcpy(buf, snap.data(i), len);
+					*buflen = static_cast<int>(len);
+					*buffer = buf;
+					h->restored(i);
+					return MQTTASYNC_SUCCESS;
+				}
+			}
+
+			ipersistable_ptr p = h->store()->get(key);
 
 			size_t	hdrlen = p->get_header_length(),
 					payloadlen = p->get_payload_length();
@@ -163,7 +466,9 @@ int iclient_persistence::persistence_remove(void* handle, char* key)
 {
 	try {
 		if (handle) {
-			static_cast<iclient_persistence*>(handle)->remove(key);
+			auto h = to_handle(handle);
+			h->end_restore();
+			h->store()->remove(key);
 			return MQTTASYNC_SUCCESS;
 		}
 	}
@@ -176,20 +481,34 @@ int iclient_persistence::persistence_keys(void* handle, char*** keys, int* nkeys
 {
 	try {
 		if (handle && keys && nkeys) {
-			std::vector<std::string> k(
-				static_cast<iclient_persistence*>(handle)->keys());
-			size_t n = k.size();
-			*nkeys = n;		// TODO: Check range
-			if (n == 0)
-				*keys = nullptr;
-			else {
-				*keys = static_cast<char**>(malloc(n*sizeof(char*)));
-				for (size_t i=0; i<n; ++i) {
-					size_t len = k[i].size();
-					(*keys)[i] = static_cast<char*>(malloc(len+1));
-					std::memcpy((*keys)[i], k[i].data(), len);
-					(*keys)[i][len] = '\0';
+			auto h = to_handle(handle);
+
+			// The snapshot from an earlier listing is still good, as
+			// anything that changed the store would have dropped it. If
+			// the store can't be read in bulk, just get the keys, and the
+			// data will be read one key at a time.
+			persistence_snapshot_ptr snap = h->snapshot();
+			if (!snap) {
+				try {
+					snap = h->store()->load_all();
 				}
+				catch (...) {}
+
+				if (snap && !snap->empty())
+					h->begin_restore(snap);
+			}
+
+			if (snap) {
+				const persistence_snapshot& s = *snap;
+				copy_keys(s.size(), [&s](size_t i) {
+					return dup_key(s.key(i), s.key_length(i));
+				}, keys, nkeys);
+			}
+			else {
+				std::vector<std::string> k(h->store()->keys());
+				copy_keys(k.size(), [&k](size_t i) {
+					return dup_key(k[i].data(), k[i].size());
+				}, keys, nkeys);
 			}
 			return MQTTASYNC_SUCCESS;
 		}
@@ -203,7 +522,9 @@ int iclient_persistence::persistence_clear(void* handle)
 {
 	try {
 		if (handle) {
-			static_cast<iclient_persistence*>(handle)->clear();
+			auto h = to_handle(handle);
+			h->end_restore();
+			h->store()->clear();
 			return MQTTASYNC_SUCCESS;
 		}
 	}
@@ -215,8 +536,7 @@ int iclient_persistence::persistence_clear(void* handle)
 int iclient_persistence::persistence_containskey(void* handle, char* key)
 {
 	try {
-		if (handle &&
-				static_cast<iclient_persistence*>(handle)->contains_key(key))
+		if (handle && to_handle(handle)->store()->contains_key(key))
 			return MQTTASYNC_SUCCESS;
 	}
 	catch (...) {}
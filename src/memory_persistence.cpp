@@ -0,0 +1,276 @@
+// memory_persistence.cpp
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#include "mqtt/memory_persistence.h"
+#include "mqtt/exception.h"
+#include <thread>
+#include <cstring>
+#include <stdexcept>
+
+namespace mqtt {
+
+const size_t memory_persistence::MAX_KEY_LEN;
+const size_t memory_persistence::DFLT_SLOT_SIZE = 4096;
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// The keys are kept in an open-addressed hash table with linear probing,
+// which is at most half full. Each entry points to a slot in the slab that
+// holds the data.
+//
+// Only one thread (the writer) changes the table at a time, so the writer
+// can compare keys and pick entries without claiming them. Readers claim
+// each entry that they look at, and the writer claims an entry that is in
+// use before changing it, so that it doesn't change under a reader.
+
+memory_persistence::memory_persistence(size_t capacity, size_t slotSize)
+		: capacity_(capacity), slotSize_(slotSize), size_(0)
+{
+	if (capacity == 0 || capacity > (size_t(1) << 30) || slotSize == 0)
+		throw std::invalid_argument("Invalid persistence capacity");
+
+	size_t n = 2;
+	while (n < 2*capacity)
+		n <<= 1;
+
+	table_.reset(new entry[n]);
+	mask_ = n - 1;
+	for (size_t i=0; i<n; ++i)
+		table_[i].state.store(FREE, std::memory_order_relaxed);
+
+	slab_.reset(new byte[capacity * slotSize]);
+
+	freeSlots_.reserve(capacity);
+	for (size_t i=capacity; i>0; --i)
+		freeSlots_.push_back(uint32_t(i-1));
+}
+
+size_t memory_persistence::home(const std::string& key) const
+{
+	uint32_t h = 2166136261U;
+	for (char c : key)
+		h = (h ^ uint8_t(c)) * 16777619U;
+	return size_t(h) & mask_;
+}
+
+bool memory_persistence::claim(entry& e)
+{
+	uint32_t st = e.state.load(std::memory_order_acquire);
+	while (true) {
+		if (st == READY) {
+			if (e.state.compare_exchange_weak(st, BUSY, std::memory_order_acquire))
+				return true;
+		}
+		else if (st == BUSY) {
+			std::this_thread::yield();
+			st = e.state.load(std::memory_order_acquire);
+		}
+		else
+			return false;
+	}
+}
+
+memory_persistence::entry* memory_persistence::find(const std::string& key)
+{
+	for (size_t i=home(key), n=0; n<=mask_; ++n, i=(i+1) & mask_) {
+		entry& e = table_[i];
+		uint32_t st = e.state.load(std::memory_order_acquire);
+		if (st == FREE)
+			break;
+		if (st != DELETED && matches(e, key))
+			return &e;
+	}
+	return nullptr;
+}
+
+memory_persistence::entry* memory_persistence::find_and_claim(const std::string& key) const
+{
+	for (size_t i=home(key), n=0; n<=mask_; ++n, i=(i+1) & mask_) {
+		entry& e = table_[i];
+		if (!claim(e)) {
+			if (e.state.load(std::memory_order_acquire) == FREE)
+				break;
+			continue;
+		}
+		if (matches(e, key))
+			return &e;
+		e.state.store(READY, std::memory_order_release);
+	}
+	return nullptr;
+}
+
+// --------------------------------------------------------------------------
+
+void memory_persistence::open(const std::string&, const std::string&)
+{
+}
+
+void memory_persistence::close()
+{
+}
+
+void memory_persistence::clear()
+{
+	for (size_t i=0; i<=mask_; ++i) {
+		claim(table_[i]);
+		table_[i].state.store(FREE, std::memory_order_release);
+	}
+
+	freeSlots_.clear();
+	for (size_t i=capacity_; i>0; --i)
+		freeSlots_.push_back(uint32_t(i-1));
+	size_ = 0;
+}
+
+bool memory_persistence::contains_key(const std::string& key)
+{
+	entry* e = find_and_claim(key);
+	if (!e)
+		return false;
+	e->state.store(READY, std::memory_order_release);
+	return true;
+}
+
+ipersistable_ptr memory_persistence::get(const std::string& key) const
+{
+	entry* e = find_and_claim(key);
+	if (!e)
+		throw persistence_exception();
+
+	byte_buffer data;
+	try {
+		data.assign(slot_data(e->slot), e->len);
+	}
+	catch (...) {
+		e->state.store(READY, std::memory_order_release);
+		throw;
+	}
+	e->state.store(READY, std::memory_order_release);
+
+	return std::make_shared<persistable_buffer>(std::move(data));
+}
+
+std::vector<std::string> memory_persistence::keys() const
+{
+	std::vector<std::string> v;
+	v.reserve(size_.load());
+
+	for (size_t i=0; i<=mask_; ++i) {
+		entry& e = table_[i];
+		if (claim(e)) {
+			try {
+				v.emplace_back(e.key, e.keylen);
+			}
+			catch (...) {
+				e.state.store(READY, std::memory_order_release);
+				throw;
+			}
+			e.state.store(READY, std::memory_order_release);
+		}
+	}
+	return v;
+}
+
+void memory_persistence::put(const std::string& key, ipersistable_ptr persistable)
+{
+	persistence_iov iov[2] = {
+		{ persistable->get_header_bytes(), persistable->get_header_length() },
+		{ persistable->get_payload_bytes(), persistable->get_payload_length() }
+	};
+	if (!iov[0].data) iov[0].len = 0;
+	if (!iov[1].data) iov[1].len = 0;
+
+	put_iov(key, iov, 2);
+}
+
+void memory_persistence::put_iov(const std::string& key,
+								 const persistence_iov* iov, size_t niov)
+{
+	size_t len = 0;
+	for (size_t i=0; i<niov; ++i)
+		len += iov[i].len;
+
+	if (key.size() > MAX_KEY_LEN || len > slotSize_)
+		throw persistence_exception();
+
+	entry* e = find(key);
+
+	if (e) {
+		// Replace the data in place
+		claim(*e);
+	}
+	else {
+		if (freeSlots_.empty())
+			throw persistence_exception();
+
+		// The table is never more than half full, so there's a spot
+		size_t i = home(key);
+		uint32_t st;
+		while ((st = table_[i].state.load(std::memory_order_acquire)) != FREE
+					&& st != DELETED)
+			i = (i+1) & mask_;
+
+		// Readers don't look at an entry in this state, so it can be
+		// filled in without claiming it.
+		e = &table_[i];
+		e->slot = freeSlots_.back();
+		freeSlots_.pop_back();
+		e->keylen = uint32_t(key.size());
+		std::memcpy(e->key, key.data(), key.size());
+		++size_;
+	}
+
+	byte* p = slot_data(e->slot);
+	for (size_t i=0; i<niov; ++i) {
+		if (iov[i].len) {
+			std::memcpy(p, iov[i].data, iov[i].len);
+			p += iov[i].len;
+		}
+	}
+	e->len = uint32_t(len);
+	e->state.store(READY, std::memory_order_release);
+}
+
+void memory_persistence::remove(const std::string& key)
+{
+	entry* e = find(key);
+	if (!e)
+		return;
+
+	claim(*e);
+	freeSlots_.push_back(e->slot);
+	--size_;
+
+	// If the next entry is free, nothing is found by probing past this
+	// one, so it can be freed too, along with any deleted entries before
+	// it. That keeps the chains from filling up with deleted entries.
+	size_t i = size_t(e - table_.get());
+	if (table_[(i+1) & mask_].state.load(std::memory_order_acquire) == FREE) {
+		e->state.store(FREE, std::memory_order_release);
+		for (i=(i-1) & mask_; table_[i].state.load(std::memory_order_acquire) == DELETED;
+				i=(i-1) & mask_)
+			table_[i].state.store(FREE, std::memory_order_release);
+	}
+	else
+		e->state.store(DELETED, std::memory_order_release);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
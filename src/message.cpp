@@ -25,18 +25,18 @@ namespace mqtt {
 
 /////////////////////////////////////////////////////////////////////////////
 
-message::message() : msg_(MQTTAsync_message_initializer)
+message::message() : msg_(MQTTAsync_message_initializer), payloadStr_(nullptr)
 {
 }
 
 message::message(const void* payload, size_t len)
-						: msg_(MQTTAsync_message_initializer)
+						: msg_(MQTTAsync_message_initializer), payloadStr_(nullptr)
 {
 	set_payload(payload, len);
 }
 
 message::message(const void* payload, size_t len, int qos, bool retained)
-						: msg_(MQTTAsync_message_initializer)
+						: msg_(MQTTAsync_message_initializer), payloadStr_(nullptr)
 {
 	set_payload(payload, len);
 	set_qos(qos);
@@ -44,34 +44,94 @@ message::message(const void* payload, size_t len, int qos, bool retained)
 }
 
 message::message(const std::string& payload)
-						: msg_(MQTTAsync_message_initializer)
+						: msg_(MQTTAsync_message_initializer), payloadStr_(nullptr)
 {
 	set_payload(payload);
 }
 
 message::message(const std::string& payload, int qos, bool retained)
-						: msg_(MQTTAsync_message_initializer)
+						: msg_(MQTTAsync_message_initializer), payloadStr_(nullptr)
 {
 	set_payload(payload);
 	set_qos(qos);
 	set_retained(retained);
 }
 
-message::message(const MQTTAsync_message& msg) : msg_(msg)
+message::message(std::string&& payload)
+						: msg_(MQTTAsync_message_initializer), payloadStr_(nullptr)
+{
+	set_payload(std::move(payload));
+}
+
+message::message(std::string&& payload, int qos, bool retained)
+						: msg_(MQTTAsync_message_initializer), payloadStr_(nullptr)
+{
+	set_payload(std::move(payload));
+	set_qos(qos);
+	set_retained(retained);
+}
+
+message::message(std::vector<byte>&& payload)
+						: msg_(MQTTAsync_message_initializer), payloadStr_(nullptr)
+{
+	set_payload(std::move(payload));
+}
+
+message::message(std::vector<byte>&& payload, int qos, bool retained)
+						: msg_(MQTTAsync_message_initializer), payloadStr_(nullptr)
+{
+	set_payload(std::move(payload));
+	set_qos(qos);
+	set_retained(retained);
+}
+
+message::message(const payload_buffer& payload)
+						: msg_(MQTTAsync_message_initializer), payloadStr_(nullptr)
+{
+	set_payload(payload);
+}
+
+message::message(const payload_buffer& payload, int qos, bool retained)
+						: msg_(MQTTAsync_message_initializer), payloadStr_(nullptr)
+{
+	set_payload(payload);
+	set_qos(qos);
+	set_retained(retained);
+}
+
+message::message(const MQTTAsync_message& msg) : msg_(msg), payloadStr_(nullptr)
 {
 	set_payload(msg.payload, msg.payloadlen);
 }
 
-message::message(const message& other) : msg_(other.msg_)
+message::message(const MQTTAsync_message& msg, std::shared_ptr<const void> owner)
+						: msg_(msg), payloadRef_(std::move(owner)), payloadStr_(nullptr)
+{
+	if (!payloadRef_)
+		set_payload(msg.payload, msg.payloadlen);
+	else if (!msg_.payload)
+		msg_.payloadlen = 0;
+}
+
+message::message(const message& other)
+						: msg_(other.msg_), topic_(other.topic_),
+							payloadRef_(other.payloadRef_),
+							payloadStr_(nullptr)
 {
-	set_payload(other.payload_);
+	if (!payloadRef_)
+		set_payload(other.payload_);
 }
 
 message::message(message&& other)
-		: msg_(other.msg_), payload_(std::move(other.payload_))
+		: msg_(other.msg_), topic_(std::move(other.topic_)),
+			payload_(std::move(other.payload_)),
+			payloadRef_(std::move(other.payloadRef_)),
+			payloadStr_(other.payloadStr_.exchange(nullptr))
 {
-	msg_.payload = const_cast<char*>(payload_.data());
-	msg_.payloadlen = payload_.length();
+	if (!payloadRef_) {
+		msg_.payload = const_cast<char*>(payload_.data());
+		msg_.payloadlen = payload_.length();
+	}
 
 	other.msg_ = MQTTAsync_message(MQTTAsync_message_initializer);
 }
@@ -85,7 +145,14 @@ message& message::operator=(const message& rhs)
 {
 	if (&rhs != this) {
 		msg_ = rhs.msg_;
-		set_payload(rhs.payload_);
+		topic_ = rhs.topic_;
+		if (rhs.payloadRef_) {
+			release_payload_ref();
+			payload_.clear();
+			payloadRef_ = rhs.payloadRef_;
+		}
+		else
+			set_payload(rhs.payload_);
 	}
 	return *this;
 }
@@ -93,39 +160,117 @@ message& message::operator=(const message& rhs)
 message& message::operator=(message&& rhs)
 {
 	if (&rhs != this) {
+		release_payload_ref();
+
 		msg_ = rhs.msg_;
+		topic_ = std::move(rhs.topic_);
 		payload_ = std::move(rhs.payload_);
+		payloadRef_ = std::move(rhs.payloadRef_);
+		payloadStr_ = rhs.payloadStr_.exchange(nullptr);
 
-		msg_.payload = const_cast<char*>(payload_.data());
-		msg_.payloadlen = payload_.length();
+		if (!payloadRef_) {
+			msg_.payload = const_cast<char*>(payload_.data());
+			msg_.payloadlen = payload_.length();
+		}
 
 		rhs.msg_ = MQTTAsync_message(MQTTAsync_message_initializer);
 	}
 	return *this;
 }
 
+void message::release_payload_ref()
+{
+	delete payloadStr_.exchange(nullptr);
+	payloadRef_.reset();
+}
+
 void message::clear_payload()
 {
+	release_payload_ref();
 	payload_.clear();
 	msg_.payload = nullptr;
 	msg_.payloadlen = 0;
 }
 
+const std::string& message::get_payload() const
+{
+	if (!payloadRef_)
+		return payload_;
+
+	// Several threads may share a const message, so the first one to
+	// install its copy wins, and the others discard theirs.
+	std::string* str = payloadStr_.load();
+	if (!str) {
+		std::string* cpy = new std::string(static_cast<const char*>(msg_.payload),
+										   size_t(msg_.payloadlen));
+		if (payloadStr_.compare_exchange_strong(str, cpy))
+			str = cpy;
+		else
+			delete cpy;
+	}
+	return *str;
+}
+
+// Note that the new payload may be a view of the old one, so it's copied
+// before the old one is released.
+
 void message::set_payload(const void* payload, size_t len)
 {
-	payload_ = std::string(static_cast<const char*>(payload), len);
+	std::string cpy(static_cast<const char*>(payload), len);
+	release_payload_ref();
+	payload_ = std::move(cpy);
 	msg_.payload = const_cast<char*>(payload_.data());
 	msg_.payloadlen = len;
 }
 
 void message::set_payload(const std::string& payload)
 {
-	payload_ = payload;
+	std::string cpy(payload);
+	release_payload_ref();
+	payload_ = std::move(cpy);
+	msg_.payload = const_cast<char*>(payload_.data());
+	msg_.payloadlen = payload_.length();
+}
+
+void message::set_payload(std::string&& payload)
+{
+	release_payload_ref();
+	payload_ = std::move(payload);
 	msg_.payload = const_cast<char*>(payload_.data());
 	msg_.payloadlen = payload_.length();
 }
 
+// The vector is moved to the heap, which keeps its buffer where it is.
+
+void message::set_payload(std::vector<byte>&& payload)
+{
+	if (payload.empty()) {
+		clear_payload();
+		return;
+	}
+	auto buf = std::make_shared<std::vector<byte>>(std::move(payload));
+	const byte* p = buf->data();
+	size_t n = buf->size();
+	set_payload_ref(std::move(buf), p, n);
+}
+
+void message::set_payload_ref(std::shared_ptr<const void> owner,
+							  const void* payload, size_t len)
+{
+	release_payload_ref();
+	payload_.clear();
+
+	if (!owner || len == 0) {
+		msg_.payload = nullptr;
+		msg_.payloadlen = 0;
+		return;
+	}
+
+	payloadRef_ = std::move(owner);
+	msg_.payload = const_cast<void*>(payload);
+	msg_.payloadlen = int(len);
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // end namespace mqtt
 }
-
@@ -0,0 +1,818 @@
+// mmap_persistence.cpp
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#include "mqtt/mmap_persistence.h"
+#include "mqtt/exception.h"
+#include <algorithm>
+#include <iterator>
+#include <unordered_set>
+#include <thread>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cctype>
+#include <cerrno>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+namespace mqtt {
+
+const size_t mmap_persistence::DFLT_SEGMENT_SIZE = 4*1024*1024;
+
+/////////////////////////////////////////////////////////////////////////////
+// The segment file format
+//
+// A segment is a sequence of records, each of which is a header, the key,
+// and the data, padded out to a multiple of 8 bytes. The records end at
+// the first one that isn't valid. A new file is all zeros, and a recycled
+// one still has the records that were written under its old ID, but the
+// checksums include the segment ID, so those don't pass.
+
+namespace {
+
+/** The header of a record in a segment */
+struct rec_hdr {
+	uint32_t magic;
+	uint32_t keylen;
+	uint32_t datalen;
+	uint32_t check;
+};
+
+const uint32_t REC_PUT = 0x31545550;	// "PUT1"
+const uint32_t REC_DEL = 0x314C4544;	// "DEL1"
+
+const size_t MAX_SEGMENT_SIZE = size_t(1) << 30;
+
+size_t page_size()
+{
+	static const size_t sz = size_t(::sysconf(_SC_PAGESIZE));
+	return sz;
+}
+
+/** Rounds 'n' up to a multiple of 'm', which is a power of two */
+inline size_t round_up(size_t n, size_t m) { return (n + m - 1) & ~(m - 1); }
+
+/** Gets the size of a record with the key and data lengths */
+inline size_t rec_size(size_t keylen, size_t datalen) {
+	return round_up(sizeof(rec_hdr) + keylen + datalen, 8);
+}
+
+// A quick checksum, to find records that weren't completely written.
+// It's not meant to stand up to deliberate tampering.
+
+uint64_t mix(uint64_t h, const byte* p, size_t n)
+{
+	const uint64_t PRIME = 0x100000001b3ULL;
+	for (; n >= 8; p += 8, n -= 8) {
+		uint64_t w;
+		std::memcpy(&w, p, 8);
+		h = (h ^ w) * PRIME;
+		h ^= h >> 32;
+	}
+	while (n--)
+		h = (h ^ *p++) * PRIME;
+	return h;
+}
+
+/** Computes the checksum of a record in the segment with the ID */
+uint32_t checksum(const rec_hdr& hdr, const byte* contents, uint32_t id)
+{
+	uint64_t h = 0xcbf29ce484222325ULL ^ hdr.magic ^ (uint64_t(id) << 32);
+	h = (h ^ ((uint64_t(hdr.keylen) << 32) | hdr.datalen)) * 0x100000001b3ULL;
+	h = mix(h, contents, size_t(hdr.keylen) + hdr.datalen);
+	return uint32_t(h ^ (h >> 32));
+}
+
+/** Gets the file name for a segment ID */
+std::string segment_name(uint32_t id)
+{
+	char buf[16];
+	snprintf(buf, sizeof(buf), "%08x.seg", unsigned(id));
+	return buf;
+}
+
+/** The name of the file for a spare segment */
+const char* SPARE_NAME = "spare";
+
+/** The least amount of data for each thread that restores the store */
+const size_t RESTORE_CHUNK_SIZE = 4*1024*1024;
+
+/** The most threads used to restore the store */
+const size_t MAX_RESTORE_THREADS = 8;
+
+/** Creates a directory, if it doesn't already exist */
+void make_dir(const std::string& path)
+{
+	if (::mkdir(path.c_str(), 0755) != 0 && errno != EEXIST)
+		throw persistence_exception();
+}
+
+}	// namespace
+
+/////////////////////////////////////////////////////////////////////////////
+
+mmap_persistence::mmap_persistence(const std::string& dir, size_t segSize)
+		: dir_(dir), segSize_(round_up(std::min(segSize, MAX_SEGMENT_SIZE), page_size())),
+			syncRecords_(0), syncInterval_(0), nunsynced_(0)
+{
+	if (segSize_ == 0)
+		segSize_ = page_size();
+	spare_.base = nullptr;
+}
+
+mmap_persistence::~mmap_persistence()
+{
+	try {
+		close();
+	}
+	catch (...) {}
+}
+
+// --------------------------------------------------------------------------
+// Segments
+
+mmap_persistence::segment& mmap_persistence::create_segment(uint32_t id, size_t n)
+{
+	size_t size = std::max(segSize_, round_up(n, page_size()));
+	std::string path = path_ + "/" + segment_name(id);
+
+	// Reusing the spare saves creating the file, and the page faults on
+	// the first writes to a new mapping.
+	if (spare_.base && spare_.size == size) {
+		if (::rename(spare_.path.c_str(), path.c_str()) == 0) {
+			segment& seg = segs_[id];
+			seg = segment{ path, spare_.base, size, 0, 0, 0 };
+			spare_.base = nullptr;
+			if (syncing())
+				sync_dir();
+			return seg;
+		}
+		close_segment(spare_, true);
+	}
+
+	int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+		throw persistence_exception();
+
+	// Reserve the disk space now, so that running out of it is an error
+	// here rather than a SIGBUS when the mapped file is written.
+	#if defined(__linux__)
+		int err = ::posix_fallocate(fd, 0, off_t(size));
+	#else
+		int err = ::ftruncate(fd, off_t(size));
+	#endif
+
+	void* p = MAP_FAILED;
+	if (err == 0)
+		p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+
+	if (p == MAP_FAILED) {
+		::unlink(path.c_str());
+		throw persistence_exception();
+	}
+
+	segment& seg = segs_[id];
+	seg = segment{ path, static_cast<byte*>(p), size, 0, 0, 0 };
+
+	if (syncing())
+		sync_dir();
+	return seg;
+}
+
+void mmap_persistence::load_segment(uint32_t id, const std::string& path, bool last)
+{
+	int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+	if (fd < 0)
+		throw persistence_exception();
+
+	struct stat st;
+	if (::fstat(fd, &st) != 0) {
+		::close(fd);
+		throw persistence_exception();
+	}
+
+	// A segment can be left empty if we went down as it was being created
+	size_t size = size_t(st.st_size);
+	if (size == 0) {
+		::close(fd);
+		::unlink(path.c_str());
+		return;
+	}
+
+	void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED)
+		throw persistence_exception();
+
+	segment& seg = segs_[id];
+	seg = segment{ path, static_cast<byte*>(p), size, 0, 0, 0 };
+
+	// Replay the records into the index, stopping at the first one that
+	// isn't complete.
+
+	size_t off = 0;
+	while (size - off >= sizeof(rec_hdr)) {
+		rec_hdr hdr;
+		std::memcpy(&hdr, seg.base + off, sizeof(rec_hdr));
+
+		if (hdr.magic != REC_PUT && hdr.magic != REC_DEL)
+			break;
+
+		size_t n = rec_size(hdr.keylen, hdr.datalen);
+		if (n > size - off)
+			break;
+
+		const byte* contents = seg.base + off + sizeof(rec_hdr);
+		if (checksum(hdr, contents, id) != hdr.check)
+			break;
+
+		std::string key(reinterpret_cast<const char*>(contents), hdr.keylen);
+		if (hdr.magic == REC_PUT)
+			update_index(key, id, uint32_t(off));
+		else
+			retire(key);
+		off += n;
+	}
+	seg.used = seg.synced = off;
+
+	// New records go after the last good one in the active segment, so
+	// clear out anything past it, or a stale record that happens to line
+	// up after a new one could be read back later.
+	if (last) {
+		byte* end = seg.base + size;
+		if (std::find_if(seg.base + off, end, [](byte b) { return b != 0; }) != end)
+			std::memset(seg.base + off, 0, size - off);
+	}
+}
+
+void mmap_persistence::close_segment(segment& seg, bool unlink)
+{
+	::munmap(seg.base, seg.size);
+	seg.base = nullptr;
+	if (unlink)
+		::unlink(seg.path.c_str());
+}
+
+void mmap_persistence::drop_segment(segment& seg)
+{
+	if (!spare_.base && seg.size == segSize_) {
+		std::string path = path_ + "/" + SPARE_NAME;
+		if (::rename(seg.path.c_str(), path.c_str()) == 0) {
+			spare_ = seg;
+			spare_.path = path;
+			seg.base = nullptr;
+			return;
+		}
+	}
+	close_segment(seg, true);
+}
+
+bool mmap_persistence::reserve(size_t n)
+{
+	segment& seg = active();
+	if (seg.size - seg.used >= n)
+		return false;
+
+	create_segment(segs_.rbegin()->first + 1, n);
+	return true;
+}
+
+size_t mmap_persistence::record_size(const location& loc) const
+{
+	rec_hdr hdr;
+	std::memcpy(&hdr, segs_.at(loc.seg).base + loc.off, sizeof(rec_hdr));
+	return rec_size(hdr.keylen, hdr.datalen);
+}
+
+void mmap_persistence::update_index(const std::string& key, uint32_t seg,
+									uint32_t off)
+{
+	location loc { seg, off };
+	auto ret = index_.emplace(key, loc);
+	if (!ret.second) {
+		location& old = ret.first->second;
+		segs_.at(old.seg).live -= record_size(old);
+		old = loc;
+	}
+	segs_.at(seg).live += record_size(loc);
+}
+
+void mmap_persistence::retire(const std::string& key)
+{
+	auto it = index_.find(key);
+	if (it != index_.end()) {
+		segs_.at(it->second.seg).live -= record_size(it->second);
+		index_.erase(it);
+	}
+}
+
+void mmap_persistence::copy_forward(uint32_t id, size_t off)
+{
+	segment& seg = segs_.at(id);
+	rec_hdr hdr;
+	std::memcpy(&hdr, seg.base + off, sizeof(rec_hdr));
+	size_t n = rec_size(hdr.keylen, hdr.datalen);
+
+	reserve(n);
+	segment& dst = active();
+	uint32_t dstId = segs_.rbegin()->first;
+	byte* p = dst.base + dst.used;
+
+	std::memcpy(p, seg.base + off, n);
+	hdr.check = checksum(hdr, p + sizeof(rec_hdr), dstId);
+	std::memcpy(p, &hdr, sizeof(rec_hdr));
+
+	if (hdr.magic == REC_PUT) {
+		std::string key(reinterpret_cast<const char*>(p + sizeof(rec_hdr)), hdr.keylen);
+		update_index(key, dstId, uint32_t(dst.used));
+	}
+	dst.used += n;
+}
+
+// The oldest segment can always be dropped once any live records in it are
+// copied forward. Its tombstones can only refer to records in the same
+// segment, as there are none older, so they don't need to be kept.
+// Reclaiming only from the front also means that a crash part way through
+// can't bring back data that was removed.
+
+void mmap_persistence::compact_front()
+{
+	while (segs_.size() > 1) {
+		auto it = segs_.begin();
+		uint32_t id = it->first;
+		segment& seg = it->second;
+
+		// Leave it while it's more than a quarter live
+		if (seg.live > seg.used / 4)
+			break;
+
+		if (seg.live != 0) {
+			for (size_t off = 0; off < seg.used; ) {
+				rec_hdr hdr;
+				std::memcpy(&hdr, seg.base + off, sizeof(rec_hdr));
+
+				if (hdr.magic == REC_PUT) {
+					std::string key(reinterpret_cast<const char*>(seg.base + off + sizeof(rec_hdr)),
+									hdr.keylen);
+					auto ix = index_.find(key);
+					if (ix != index_.end() && ix->second.seg == id && ix->second.off == off)
+						copy_forward(id, off);
+				}
+				off += rec_size(hdr.keylen, hdr.datalen);
+			}
+
+			// The copies have to be on disk before the originals are gone
+			if (syncing())
+				sync_all();
+		}
+
+		drop_segment(seg);
+		segs_.erase(it);
+
+		if (syncing())
+			sync_dir();
+	}
+
+	drop_dead();
+}
+
+// A segment behind the front that has no live data can go too, but its
+// tombstones might still be hiding records in an older segment that's
+// being kept. The ones that are, for keys that weren't put again, are
+// copied forward first. So a tombstone only lives on while the record it
+// hides does.
+
+void mmap_persistence::drop_dead()
+{
+	if (segs_.size() < 3)
+		return;
+
+	std::vector<uint32_t> ids;
+	auto last = std::prev(segs_.end());
+	for (auto it = std::next(segs_.begin()); it != last; ++it) {
+		if (it->second.live == 0)
+			ids.push_back(it->first);
+	}
+
+	if (ids.empty())
+		return;
+
+	// The keys of the records in the segments that are kept, up to the
+	// last one to go. Only these can be hidden by its tombstones.
+	std::unordered_set<std::string> hidden;
+	for (auto it = segs_.begin(); it->first < ids.back(); ++it) {
+		const segment& seg = it->second;
+		if (seg.live == 0)
+			continue;
+
+		for (size_t off = 0; off < seg.used; ) {
+			rec_hdr hdr;
+			std::memcpy(&hdr, seg.base + off, sizeof(rec_hdr));
+			if (hdr.magic == REC_PUT)
+				hidden.emplace(reinterpret_cast<const char*>(seg.base + off + sizeof(rec_hdr)),
+							   hdr.keylen);
+			off += rec_size(hdr.keylen, hdr.datalen);
+		}
+	}
+
+	for (uint32_t id : ids) {
+		segment& seg = segs_.at(id);
+		bool copied = false;
+
+		for (size_t off = 0; off < seg.used && !hidden.empty(); ) {
+			rec_hdr hdr;
+			std::memcpy(&hdr, seg.base + off, sizeof(rec_hdr));
+
+			if (hdr.magic == REC_DEL) {
+				std::string key(reinterpret_cast<const char*>(seg.base + off + sizeof(rec_hdr)),
+								hdr.keylen);
+				if (hidden.count(key) != 0 && index_.find(key) == index_.end()) {
+					copy_forward(id, off);
+					copied = true;
+				}
+			}
+			off += rec_size(hdr.keylen, hdr.datalen);
+		}
+
+		// The copies have to be on disk before the originals are gone
+		if (copied && syncing())
+			sync_all();
+
+		drop_segment(seg);
+		segs_.erase(id);
+	}
+
+	if (syncing())
+		sync_dir();
+}
+
+// --------------------------------------------------------------------------
+// Syncing
+
+void mmap_persistence::written()
+{
+	++nunsynced_;
+	if ((syncRecords_ != 0 && nunsynced_ >= syncRecords_) ||
+			(syncInterval_.count() != 0 && clock::now() - lastSync_ >= syncInterval_))
+		sync_all();
+}
+
+void mmap_persistence::sync_all()
+{
+	for (auto& s : segs_) {
+		segment& seg = s.second;
+		if (seg.synced < seg.used) {
+			size_t start = seg.synced & ~(page_size() - 1);
+			if (::msync(seg.base + start, seg.used - start, MS_SYNC) != 0)
+				throw persistence_exception();
+			seg.synced = seg.used;
+		}
+	}
+	nunsynced_ = 0;
+	lastSync_ = clock::now();
+}
+
+void mmap_persistence::sync_dir()
+{
+	int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd >= 0) {
+		::fsync(fd);
+		::close(fd);
+	}
+}
+
+void mmap_persistence::close_all()
+{
+	for (auto& s : segs_)
+		close_segment(s.second, false);
+	segs_.clear();
+	index_.clear();
+
+	if (spare_.base)
+		close_segment(spare_, true);
+}
+
+void mmap_persistence::set_sync_records(size_t n)
+{
+	guard g(lock_);
+	syncRecords_ = n;
+}
+
+void mmap_persistence::set_sync_interval(const std::chrono::milliseconds& interval)
+{
+	guard g(lock_);
+	syncInterval_ = interval;
+}
+
+void mmap_persistence::sync()
+{
+	guard g(lock_);
+	sync_all();
+}
+
+size_t mmap_persistence::num_segments() const
+{
+	guard g(lock_);
+	return segs_.size();
+}
+
+// --------------------------------------------------------------------------
+// iclient_persistence
+
+void mmap_persistence::open(const std::string& clientId,
+							const std::string& serverURI)
+{
+	guard g(lock_);
+	close_all();
+
+	std::string name = clientId + "-" + serverURI;
+	for (auto& c : name) {
+		if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_' && c != '.')
+			c = '-';
+	}
+
+	make_dir(dir_);
+	path_ = dir_ + "/" + name;
+	make_dir(path_);
+
+	// A spare is only kept while the store is open
+	::unlink((path_ + "/" + SPARE_NAME).c_str());
+
+	std::vector<uint32_t> ids;
+
+	DIR* dir = ::opendir(path_.c_str());
+	if (!dir)
+		throw persistence_exception();
+
+	while (struct dirent* ent = ::readdir(dir)) {
+		const char* s = ent->d_name;
+		char* end = nullptr;
+		unsigned long id = std::strtoul(s, &end, 16);
+		if (end == s+8 && std::strcmp(end, ".seg") == 0)
+			ids.push_back(uint32_t(id));
+	}
+	::closedir(dir);
+
+	std::sort(ids.begin(), ids.end());
+
+	try {
+		for (size_t i=0; i<ids.size(); ++i)
+			load_segment(ids[i], path_ + "/" + segment_name(ids[i]), i == ids.size()-1);
+
+		if (segs_.empty())
+			create_segment(0, 0);
+		compact_front();
+	}
+	catch (...) {
+		close_all();
+		throw;
+	}
+
+	nunsynced_ = 0;
+	lastSync_ = clock::now();
+}
+
+void mmap_persistence::close()
+{
+	guard g(lock_);
+	if (!segs_.empty() && syncing())
+		sync_all();
+	close_all();
+}
+
+void mmap_persistence::clear()
+{
+	guard g(lock_);
+	if (segs_.empty())
+		return;
+
+	// Oldest first, so that a crash part way through can't leave a put
+	// without the tombstone that removed it.
+	uint32_t next = segs_.rbegin()->first + 1;
+	for (auto& s : segs_)
+		close_segment(s.second, true);
+	segs_.clear();
+	index_.clear();
+
+	create_segment(next, 0);
+}
+
+bool mmap_persistence::contains_key(const std::string& key)
+{
+	guard g(lock_);
+	return index_.find(key) != index_.end();
+}
+
+ipersistable_ptr mmap_persistence::get(const std::string& key) const
+{
+	guard g(lock_);
+	auto it = index_.find(key);
+	if (it == index_.end())
+		throw persistence_exception();
+
+	const byte* p = segs_.at(it->second.seg).base + it->second.off;
+	rec_hdr hdr;
+	std::memcpy(&hdr, p, sizeof(rec_hdr));
+	return std::make_shared<persistable_buffer>(p + sizeof(rec_hdr) + hdr.keylen, hdr.datalen);
+}
+
+std::vector<std::string> mmap_persistence::keys() const
+{
+	guard g(lock_);
+	std::vector<std::string> v;
+	v.reserve(index_.size());
+	for (const auto& k : index_)
+		v.push_back(k.first);
+	return v;
+}
+
+persistence_snapshot_ptr mmap_persistence::load_all() const
+{
+	guard g(lock_);
+
+	// Get the kernel reading all of the files at once
+	for (const auto& s : segs_)
+		::madvise(s.second.base, s.second.used, MADV_WILLNEED);
+
+	// Take the records in the order they're in the log. The position in
+	// the log is copied out of the index so that sorting is quick.
+	struct rec_ref {
+		uint64_t pos;
+		const std::string* key;
+	};
+	std::vector<rec_ref> recs;
+	recs.reserve(index_.size());
+
+	size_t keyLen = 0;
+	for (const auto& k : index_) {
+		recs.push_back(rec_ref{ (uint64_t(k.second.seg) << 32) | k.second.off, &k.first });
+		keyLen += k.first.size();
+	}
+
+	std::sort(recs.begin(), recs.end(), [](const rec_ref& a, const rec_ref& b) {
+		return a.pos < b.pos;
+	});
+
+	auto snap = std::make_shared<persistence_snapshot>();
+	snap->reserve(recs.size(), keyLen);
+
+	std::vector<const byte*> src;
+	src.reserve(recs.size());
+
+	auto seg = segs_.end();
+	for (const auto& r : recs) {
+		uint32_t id = uint32_t(r.pos >> 32);
+		if (seg == segs_.end() || seg->first != id)
+			seg = segs_.find(id);
+
+		const byte* p = seg->second.base + uint32_t(r.pos);
+		rec_hdr hdr;
+		std::memcpy(&hdr, p, sizeof(rec_hdr));
+		snap->add(*r.key, hdr.datalen);
+		src.push_back(p + sizeof(rec_hdr) + hdr.keylen);
+	}
+	snap->allocate();
+
+	auto copy = [&snap, &src](size_t beg, size_t end) {
+		for (size_t i=beg; i<end; ++i)
+			std::memcpy(snap->data(i), src[i], snap->data_length(i));
+	};
+
+	// Split the records between the threads by the amount of data
+	size_t n = src.size(),
+		   total = snap->data_length(),
+		   nthr = std::min<size_t>({ MAX_RESTORE_THREADS,
+									 std::max(std::thread::hardware_concurrency(), 1U),
+									 total / RESTORE_CHUNK_SIZE + 1 });
+
+	std::vector<std::thread> thrs;
+	size_t beg = 0, end = 0, sum = 0;
+
+	for (size_t t=1; t<nthr; ++t) {
+		size_t target = t * (total / nthr);
+		while (end < n && sum < target)
+			sum += snap->data_length(end++);
+		try {
+			thrs.emplace_back(copy, beg, end);
+		}
+		catch (...) {
+			copy(beg, end);
+		}
+		beg = end;
+	}
+	copy(beg, n);
+
+	for (auto& thr : thrs)
+		thr.join();
+
+	return snap;
+}
+
+void mmap_persistence::put(const std::string& key, ipersistable_ptr persistable)
+{
+	persistence_iov iov[2] = {
+		{ persistable->get_header_bytes(), persistable->get_header_length() },
+		{ persistable->get_payload_bytes(), persistable->get_payload_length() }
+	};
+	if (!iov[0].data) iov[0].len = 0;
+	if (!iov[1].data) iov[1].len = 0;
+
+	put_iov(key, iov, 2);
+}
+
+// The buffers are copied straight into the mapped segment.
+
+void mmap_persistence::put_iov(const std::string& key,
+							   const persistence_iov* iov, size_t niov)
+{
+	size_t len = 0;
+	for (size_t i=0; i<niov; ++i) {
+		if (iov[i].len > MAX_SEGMENT_SIZE - len)
+			throw persistence_exception();
+		len += iov[i].len;
+	}
+
+	if (key.size() > MAX_SEGMENT_SIZE)
+		throw persistence_exception();
+
+	guard g(lock_);
+	if (segs_.empty())
+		throw persistence_exception();
+
+	rec_hdr rec { REC_PUT, uint32_t(key.size()), uint32_t(len), 0 };
+	size_t n = rec_size(key.size(), len);
+	bool rolled = reserve(n);
+
+	segment& seg = active();
+	byte* p = seg.base + seg.used;
+	byte* contents = p + sizeof(rec_hdr);
+
+	std::memcpy(contents, key.data(), key.size());
+	byte* dst = contents + key.size();
+	for (size_t i=0; i<niov; ++i) {
+		if (iov[i].len) {
+			std::memcpy(dst, iov[i].data, iov[i].len);
+			dst += iov[i].len;
+		}
+	}
+
+	rec.check = checksum(rec, contents, segs_.rbegin()->first);
+	std::memcpy(p, &rec, sizeof(rec_hdr));
+
+	update_index(key, segs_.rbegin()->first, uint32_t(seg.used));
+	seg.used += n;
+
+	if (rolled)
+		compact_front();
+	written();
+}
+
+void mmap_persistence::remove(const std::string& key)
+{
+	guard g(lock_);
+	if (index_.find(key) == index_.end())
+		return;
+
+	rec_hdr rec { REC_DEL, uint32_t(key.size()), 0, 0 };
+	size_t n = rec_size(key.size(), 0);
+	bool rolled = reserve(n);
+
+	segment& seg = active();
+	byte* p = seg.base + seg.used;
+
+	std::memcpy(p + sizeof(rec_hdr), key.data(), key.size());
+	rec.check = checksum(rec, p + sizeof(rec_hdr), segs_.rbegin()->first);
+	std::memcpy(p, &rec, sizeof(rec_hdr));
+	seg.used += n;
+
+	retire(key);
+
+	if (rolled)
+		compact_front();
+	written();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
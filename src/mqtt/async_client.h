@@ -33,10 +33,25 @@
 #include "mqtt/message.h"
 #include "mqtt/callback.h"
 #include "mqtt/iasync_client.h"
+#include "mqtt/token_registry.h"
+#include "mqtt/publish_credit.h"
+#include "mqtt/result.h"
+#include "mqtt/block_pool.h"
+#include "mqtt/executor.h"
+#include "mqtt/thread_queue.h"
+#include "mqtt/topic_router.h"
+#include "mqtt/awaitable.h"
+#include "mqtt/client_metrics.h"
 #include <string>
 #include <vector>
-#include <list>
+#include <utility>
+#include <unordered_map>
 #include <memory>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <new>
 #include <stdexcept>
 
 namespace mqtt {
@@ -45,6 +60,23 @@ const uint32_t		VERSION = 0x00050000;
 const std::string	VERSION_STR("mqttpp v. 0.5"),
 					COPYRIGHT("Copyright (c) 2013-2016 Frank Pagliughi");
 
+class topic;
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * What the client does with an incoming message when the consumer queue
+ * is full.
+ */
+enum class consumer_overflow {
+	/** Wait for the consumers to make room. This holds up the C library. */
+	BLOCK,
+	/** Discard the oldest message in the queue to make room. */
+	DROP_OLDEST,
+	/** Discard the incoming message. */
+	DROP_NEWEST
+};
+
 /////////////////////////////////////////////////////////////////////////////
 
 /**
@@ -56,6 +88,12 @@ class async_client : public virtual iasync_client
 public:
 	/** Smart/shared pointer for an object of this class */
 	using ptr_t = std::shared_ptr<async_client>;
+	/** A batch of messages to publish, each with its topic */
+	using publish_collection = std::vector<std::pair<std::string, const_message_ptr>>;
+	/** A set of message routes, each a topic filter and its handler */
+	using route_collection = std::vector<std::pair<std::string, topic_router::handler>>;
+	/** Handler that is told when there's credit to publish again */
+	using credit_handler = std::function<void()>;
 
 private:
 	/** Lock guard type for this class */
@@ -73,24 +111,167 @@ private:
 	MQTTClient_persistence* persist_;
 	/** Callback supplied by the user (if any) */
 	callback* userCallback_;
-	/** A list of tokens that are in play */
-	std::list<itoken_ptr> pendingTokens_;
-	/** A list of delivery tokens that are in play */
-	std::list<idelivery_token_ptr> pendingDeliveryTokens_;
+	/** The executor that runs the user callbacks (if any) */
+	executor_ptr exec_;
+	/** Whether incoming messages refer to the C library's payload buffers */
+	std::atomic<bool> zeroCopyRecv_;
+	/** Whether incoming messages go to the consumer queue */
+	std::atomic<bool> consuming_;
+	/** What to do with an incoming message when the consumer queue is full */
+	std::atomic<consumer_overflow> queOverflow_;
+	/** The queue of incoming messages for the consumers */
+	thread_queue<const_message_ptr> que_;
+	/**
+	 * The per-filter message handlers. This is never modified once
+	 * published; a change makes a new copy, so the message callback can
+	 * use it without holding the lock.
+	 */
+	const_topic_router_ptr router_;
+	/** Memory for the objects created for each publish */
+	block_pool_ptr pool_;
+	/** The tokens (including delivery tokens) that are in play */
+	token_registry pendingTokens_;
+	/** The budget for the messages in flight */
+	publish_credit credit_;
+	/** Told when there's credit again after a publish was refused */
+	credit_handler creditHandler_;
+	/** Lock for the shared topic cache, so publishing doesn't take the object lock */
+	mutable std::mutex topicLock_;
+	/**
+	 * Topic collections shared by the delivery tokens, keyed by topic.
+	 * This is filled once: the first MAX_PUB_TOPICS topics that are
+	 * published are kept for the life of the client, and any others get a
+	 * new collection for each publish.
+	 */
+	std::unordered_map<std::string, std::shared_ptr<const std::vector<std::string>>> pubTopics_;
+
+	/**
+	 * The metrics, once they're enabled. This is never changed after that.
+	 * It's here in every build, so that the layout of the client doesn't
+	 * depend on PAHO_MQTTPP_METRICS; without it, it's always null.
+	 */
+	std::atomic<client_metrics*> metrics_;
+
+	/** The most topics that are kept in the shared topic cache. Nothing is evicted. */
+	static const size_t MAX_PUB_TOPICS = 256;
 
 	static void on_connection_lost(void *context, char *cause);
 	static int on_message_arrived(void* context, char* topicName, int topicLen,
 								  MQTTAsync_message* msg);
 	static void on_delivery_complete(void* context, MQTTAsync_token tok);
 
+	/**
+	 * Places an incoming message in the consumer queue, applying the
+	 * overflow policy if the queue is full.
+	 */
+	void queue_message(const_message_ptr msg);
+	/**
+	 * Registers the C callbacks for incoming events.
+	 * The object lock must be held.
+	 */
+	void set_c_callbacks();
+	/**
+	 * Sets the handlers for a number of filters, with a single copy of the
+	 * router. An entry with an empty handler removes the route for its
+	 * filter.
+	 * @return The previous handler for each filter, in the same order,
+	 *  	   which can be passed back in to undo the change.
+	 * @throw std::invalid_argument if a filter is not valid, in which case
+	 *  	  nothing is changed.
+	 */
+	route_collection exchange_routes(const route_collection& routes);
+	/**
+	 * Removes the routes for the filters that have one, for an
+	 * unsubscribe.
+	 * @return The handlers that were removed, which can be passed to
+	 *  	   exchange_routes() to put them back.
+	 */
+	route_collection take_routes(const topic_filter_collection& topicFilters);
+
 	/** Manage internal list of active tokens */
 	friend class token;
+	friend class topic;
+	friend class async_client_test;
 	virtual void add_token(itoken_ptr tok);
 	virtual void add_token(idelivery_token_ptr tok);
 	virtual void remove_token(itoken* tok) override;
+	virtual void remove_token(itoken* tok, int rc) override;
 	virtual void remove_token(itoken_ptr tok) { remove_token(tok.get()); }
 	void remove_token(idelivery_token_ptr tok) { remove_token(tok.get()); }
 
+	/**
+	 * Creates a message for a publish, allocated from the client's pool.
+	 * Small payloads are copied into a pooled buffer that the message
+	 * refers to, larger ones into the message itself.
+	 */
+	message_ptr make_pooled_message(const void* payload, size_t n,
+									int qos, bool retained);
+	/**
+	 * Creates a delivery token for a publish, allocated from the client's
+	 * pool.
+	 */
+	delivery_token_ptr make_delivery_token(const std::string& topic,
+										   const_message_ptr msg);
+	/**
+	 * Creates a delivery token for a publish to a topic whose shared
+	 * collection is already known.
+	 */
+	delivery_token_ptr make_delivery_token(
+			std::shared_ptr<const std::vector<std::string>> topics,
+			const_message_ptr msg);
+	/**
+	 * Gets a topic collection for the topic that can be shared by the
+	 * delivery tokens that publish to it.
+	 */
+	std::shared_ptr<const std::vector<std::string>> shared_topics(const std::string& topic);
+	/**
+	 * Looks up or creates the shared topic collection for the topic.
+	 * The topic cache lock must be held.
+	 */
+	std::shared_ptr<const std::vector<std::string>> find_shared_topics(const std::string& topic);
+	/**
+	 * Sends a message that has its credit, tracking it with the token.
+	 * @return The C library's return code. On failure, the token is
+	 *  	   removed and the credit is given back.
+	 */
+	int send_message(const std::string& topic, const_message_ptr msg,
+					 delivery_token_ptr dtok);
+	/**
+	 * Publishes a message that already has its credit, for the calls
+	 * that don't throw.
+	 * This is compiled into the library, so that the trace points are
+	 * there for the template callers, too.
+	 * @return The C library's return code.
+	 */
+	int publish_with_credit(const std::string& topic, const_message_ptr msg,
+							idelivery_token_ptr* tok);
+	/**
+	 * Gives back the credit for a message, and tells the credit handler if
+	 * a publish was refused for lack of it.
+	 */
+	void return_credit(const const_message_ptr& msg);
+	/**
+	 * Tells the credit handler, if there is one, that there's credit to
+	 * publish again.
+	 */
+	void notify_credit();
+	/**
+	 * Counts an action that the C library refused, if metrics are on.
+	 */
+	void count_failure(int rc) {
+		#if defined(PAHO_MQTTPP_METRICS)
+			client_metrics* m = metrics_.load(std::memory_order_acquire);
+			if (m)
+				m->on_failure(rc);
+		#else
+			(void) rc;
+		#endif
+	}
+	/**
+	 * Sends a batch of messages, tracking them with the group token.
+	 */
+	itoken_ptr send_batch(const publish_collection& msgs, token_ptr batchTok);
+
 	/** Memory management for C-style filter collections */
 	std::vector<char*> alloc_topic_filters(
 							const topic_filter_collection& topicFilters);
@@ -104,6 +285,26 @@ private:
 		guard g(lock_);
 		return userCallback_;
 	}
+	/**
+	 * Convenience function to get user callback and the executor that
+	 * runs it, safely.
+	 * @param exec Receives the executor, which may be null.
+	 * @return callback*
+	 */
+	callback* get_callback(executor_ptr* exec) const {
+		guard g(lock_);
+		*exec = exec_;
+		return userCallback_;
+	}
+
+	/**
+	 * Gets the current set of message routes, safely.
+	 * @return The routes, or null if none were ever added.
+	 */
+	const_topic_router_ptr get_router() const {
+		guard g(lock_);
+		return router_;
+	}
 
 	/** Non-copyable */
 	async_client() =delete;
@@ -310,12 +511,79 @@ public:
 	 * Publishes a message to a topic on the server Takes an Message
 	 * message and delivers it to the server at the requested quality of
 	 * service.
+	 * If a budget was set with set_max_inflight(), this waits for credit
+	 * for the message.
 	 * @param topic the topic to deliver the message to
 	 * @param msg the message to deliver to the server
 	 * @return token used to track and wait for the publish to complete. The
 	 *  	   token will be passed to callback methods if set.
 	 */
 	idelivery_token_ptr publish(const std::string& topic, const_message_ptr msg) override;
+	/**
+	 * Publishes a message to a topic handle.
+	 * The handle already has the shared topic collection for the delivery
+	 * tokens, so this skips the lookup of the name that the other
+	 * overloads do. topic::publish() calls this, so a subclass that
+	 * overrides publish() should override this one too, to see the
+	 * messages that are published through a topic.
+	 * If a budget was set with set_max_inflight(), this waits for credit
+	 * for the message.
+	 * @param top The topic, which must have been made with this client.
+	 * @param msg the message to deliver to the server
+	 * @return token used to track and wait for the publish to complete. The
+	 *  	   token will be passed to callback methods if set.
+	 */
+	virtual idelivery_token_ptr publish(const topic& top, const_message_ptr msg);
+	/**
+	 * Publishes a string payload to a topic on the server, moving the
+	 * string into the message rather than copying it.
+	 * @param topic The topic to deliver the message to
+	 * @param payload The string to move into the message as the payload.
+	 * @param qos the Quality of Service to deliver the message at. Valid
+	 *  		  values are 0, 1 or 2.
+	 * @param retained whether or not this message should be retained by the
+	 *  			   server.
+	 * @return token used to track and wait for the publish to complete. The
+	 *  	   token will be passed to callback methods if set.
+	 */
+	idelivery_token_ptr publish(const std::string& topic, std::string&& payload,
+								int qos, bool retained);
+	/**
+	 * Publishes a byte vector to a topic on the server, moving its buffer
+	 * into the message rather than copying it.
+	 * @param topic The topic to deliver the message to
+	 * @param payload The vector to move into the message as the payload.
+	 * @param qos the Quality of Service to deliver the message at. Valid
+	 *  		  values are 0, 1 or 2.
+	 * @param retained whether or not this message should be retained by the
+	 *  			   server.
+	 * @return token used to track and wait for the publish to complete. The
+	 *  	   token will be passed to callback methods if set.
+	 */
+	idelivery_token_ptr publish(const std::string& topic, std::vector<byte>&& payload,
+								int qos, bool retained);
+	/**
+	 * Publishes a byte array to a topic on the server, handing the array
+	 * to the message rather than copying it. The array is released with its
+	 * deleter once the message is no longer needed.
+	 * @param topic The topic to deliver the message to
+	 * @param payload The array to use as the payload.
+	 * @param n The number of bytes in the payload.
+	 * @param qos the Quality of Service to deliver the message at. Valid
+	 *  		  values are 0, 1 or 2.
+	 * @param retained whether or not this message should be retained by the
+	 *  			   server.
+	 * @return token used to track and wait for the publish to complete. The
+	 *  	   token will be passed to callback methods if set.
+	 */
+	template <typename Deleter>
+	idelivery_token_ptr publish(const std::string& topic,
+								std::unique_ptr<byte[],Deleter>&& payload, size_t n,
+								int qos, bool retained) {
+		pool_allocator<message> alloc(pool_);
+		return publish(topic, std::allocate_shared<message>(alloc, std::move(payload),
+															n, qos, retained));
+	}
 	/**
 	 * Publishes a message to a topic on the server.
 	 * @param topic the topic to deliver the message to
@@ -330,12 +598,346 @@ public:
 	 */
 	idelivery_token_ptr publish(const std::string& topic, const_message_ptr msg,
 										void* userContext, iaction_listener& cb) override;
+	/**
+	 * Publishes a message, returning any error rather than throwing it.
+	 * This is the same as publish(), for code that expects failures, like
+	 * a full buffer in the C library, and sheds load when they happen.
+	 * Unlike publish(), this never blocks waiting for publish credit; if
+	 * the in-flight budget is spent, it fails with
+	 * MQTTASYNC_MAX_MESSAGES_INFLIGHT, as try_publish() does.
+	 * @param topic the topic to deliver the message to
+	 * @param msg the message to deliver to the server
+	 * @return The token for the publish, or the error code.
+	 */
+	result<idelivery_token_ptr> publish(std::nothrow_t, const std::string& topic,
+										const_message_ptr msg) noexcept;
+	/**
+	 * Publishes a message, returning any error rather than throwing it.
+	 * Like the overload above, this never blocks waiting for credit.
+	 * @param topic The topic to deliver the message to
+	 * @param payload the bytes to use as the message payload
+	 * @param n the number of bytes in the payload
+	 * @param qos the Quality of Service to deliver the message at. Valid
+	 *  		  values are 0, 1 or 2.
+	 * @param retained whether or not this message should be retained by the
+	 *  			   server.
+	 * @return The token for the publish, or the error code.
+	 */
+	result<idelivery_token_ptr> publish(std::nothrow_t, const std::string& topic,
+										const void* payload, size_t n,
+										int qos, bool retained) noexcept;
+	/**
+	 * Publishes a batch of messages.
+	 * The bookkeeping for the whole batch is done with a single
+	 * acquisition of each of the client's locks, rather than once per
+	 * message. Each message still gets a delivery token, which is passed
+	 * to the callback's delivery_complete(), but the caller gets a single
+	 * token for the batch. Each message waits for its credit, if a budget
+	 * was set with set_max_inflight().
+	 * @param msgs The messages, each paired with the topic to publish it
+	 *  		   on.
+	 * @return A token that completes when every message in the batch has
+	 *  	   completed. It fails with the first error from any of them.
+	 * @throw exception if the first message can't be sent. If a later one
+	 *  	  can't be sent, none of the rest are, and the batch token
+	 *  	  fails with the error once the ones that were sent complete.
+	 */
+	itoken_ptr publish_batch(const publish_collection& msgs);
+	/**
+	 * Publishes a batch of messages.
+	 * @param msgs The messages, each paired with the topic to publish it
+	 *  		   on.
+	 * @param userContext optional object used to pass context to the
+	 *  				  callback. Use @em nullptr if not required.
+	 * @param cb listener that will be notified when the whole batch has
+	 *  		 completed.
+	 * @return A token that completes when every message in the batch has
+	 *  	   completed.
+	 */
+	itoken_ptr publish_batch(const publish_collection& msgs,
+							 void* userContext, iaction_listener& cb);
+	/**
+	 * Publishes the same payload to many topics.
+	 * The messages all refer to the one payload buffer, as do their
+	 * delivery tokens, so sending a large payload to many topics doesn't
+	 * make a copy of it for each one. They're sent as a batch, as with
+	 * publish_batch().
+	 *
+	 * Note that the C library copies each payload while the message is in
+	 * flight. To bound the memory used by a large fan out, limit the bytes
+	 * in flight with set_max_inflight().
+	 * @param topics The topics to publish the payload on.
+	 * @param payload The payload.
+	 * @param qos The quality of service for the messages.
+	 * @param retained Whether the messages should be retained by the
+	 *  			   server.
+	 * @return A token that completes when the messages to every topic have
+	 *  	   completed.
+	 * @throw std::invalid_argument if the QoS is not valid.
+	 */
+	itoken_ptr publish_fanout(const std::vector<std::string>& topics,
+							  const payload_buffer& payload, int qos,
+							  bool retained=false);
+	/**
+	 * Publishes a message if there's credit for it, without waiting.
+	 * This is the same as publish(), except that it returns a status
+	 * rather than throwing.
+	 * @param topic The topic to publish on.
+	 * @param msg The message.
+	 * @param tok Receives the token for the publish, if it's not null.
+	 * @return MQTTASYNC_SUCCESS if the message was sent,
+	 *  	   MQTTASYNC_MAX_MESSAGES_INFLIGHT if there isn't credit for it,
+	 *  	   or the error from the C library.
+	 */
+	int try_publish(const std::string& topic, const_message_ptr msg,
+					idelivery_token_ptr* tok=nullptr);
+	/**
+	 * Publishes a message, waiting up to the specified time for credit if
+	 * there isn't enough.
+	 * @param topic The topic to publish on.
+	 * @param msg The message.
+	 * @param relTime The longest time to wait for credit.
+	 * @param tok Receives the token for the publish, if it's not null.
+	 * @return MQTTASYNC_SUCCESS if the message was sent,
+	 *  	   MQTTASYNC_MAX_MESSAGES_INFLIGHT if there was no credit in
+	 *  	   time, or the error from the C library.
+	 */
+	template <typename Rep, class Period>
+	int try_publish_for(const std::string& topic, const_message_ptr msg,
+						const std::chrono::duration<Rep,Period>& relTime,
+						idelivery_token_ptr* tok=nullptr) {
+		if (!credit_.try_acquire_for(msg->get_payload_length(), relTime))
+			return MQTTASYNC_MAX_MESSAGES_INFLIGHT;
+		return publish_with_credit(topic, std::move(msg), tok);
+	}
+	/**
+	 * Sets the budget for the messages in flight.
+	 * Each tracked publish takes credit for one message and the size of
+	 * its payload until it completes. When the budget is spent, publish()
+	 * waits for credit, and try_publish() refuses the message. This lets
+	 * a producer keep pace with the server, rather than piling up
+	 * messages in the client. By default, there is no limit.
+	 *
+	 * Note that the credit is given back on the C library's thread, so a
+	 * callback or action listener that runs on it must not wait for
+	 * credit.
+	 * @param maxMsgs The most messages in flight, or zero for no limit.
+	 * @param maxBytes The most payload bytes in flight, or zero for no
+	 *  			   limit. A single message larger than this is sent
+	 *  			   when nothing else is in flight.
+	 */
+	void set_max_inflight(size_t maxMsgs, size_t maxBytes=0);
+	/**
+	 * Gets the most messages that can be in flight.
+	 * @return The message limit, or zero if there is none.
+	 */
+	size_t get_max_inflight() const { return credit_.max_messages(); }
+	/**
+	 * Gets the most payload bytes that can be in flight.
+	 * @return The byte limit, or zero if there is none.
+	 */
+	size_t get_max_inflight_bytes() const { return credit_.max_bytes(); }
+	/**
+	 * Gets the number of tracked messages in flight.
+	 * @return The number of messages in flight.
+	 */
+	size_t get_inflight() const { return credit_.messages(); }
+	/**
+	 * Gets the number of payload bytes of the tracked messages in flight.
+	 * @return The number of payload bytes in flight.
+	 */
+	size_t get_inflight_bytes() const { return credit_.bytes(); }
+	/**
+	 * Sets a handler that is told when there's credit to publish again,
+	 * after a try_publish() was refused for lack of it.
+	 * It is called once for each time that publishing was refused, on
+	 * the executor if there is one, otherwise on the C library's thread.
+	 * @param handler The handler, or an empty function for none.
+	 */
+	void set_credit_handler(credit_handler handler);
+	/**
+	 * Publishes a payload at QoS 0 without tracking it.
+	 * This is the fire-and-forget path for messages that can't be
+	 * acknowledged anyway. No message object or token is created, and no
+	 * locks are taken by this library; the C library copies the payload
+	 * and sends it.
+	 * @param topic The topic to publish on.
+	 * @param payload The bytes of the payload.
+	 * @param n The size of the payload, in bytes.
+	 * @param retained Whether the server should retain the message.
+	 * @throw exception if the C library can't accept the message, e.g.
+	 *  	  when the client is not connected.
+	 */
+	void publish_nowait(const std::string& topic, const void* payload, size_t n,
+						bool retained=false);
+	/**
+	 * Publishes a message without tracking it.
+	 * The message is sent at its own QoS, but no token is created for it,
+	 * so its delivery can't be followed, and the callback's
+	 * delivery_complete() is not called for it. This is intended for QoS
+	 * 0.
+	 * @param topic The topic to publish on.
+	 * @param msg The message.
+	 * @throw exception if the C library can't accept the message, e.g.
+	 *  	  when the client is not connected.
+	 */
+	void publish_nowait(const std::string& topic, const_message_ptr msg);
+#if defined(PAHO_MQTTPP_METRICS)
+	/**
+	 * Starts keeping metrics for the client, if it isn't already.
+	 * The counts start from zero when this is first called. This is only
+	 * available if the library was built with PAHO_MQTTPP_METRICS defined;
+	 * otherwise the client has no metrics code at all.
+	 * @return The metrics, which live as long as the client.
+	 */
+	const client_metrics& enable_metrics();
+	/**
+	 * Gets the metrics for the client.
+	 * @return The metrics, or null if they weren't enabled.
+	 */
+	const client_metrics* get_metrics() const {
+		return metrics_.load(std::memory_order_acquire);
+	}
+#endif
 	/**
 	 * Sets a callback listener to use for events that happen
 	 * asynchronously.
 	 * @param cb callback which will be invoked for certain asynchronous events
 	 */
 	void set_callback(callback& cb) override;
+	/**
+	 * Sets a callback listener to use for events that happen
+	 * asynchronously, and the executor to run it.
+	 * The executor runs the calls to the callback, and to the action
+	 * listeners of the tokens, instead of the C library's thread.
+	 * @param cb callback which will be invoked for certain asynchronous events
+	 * @param exec The executor to run the callbacks. If this is null, the
+	 *  		   callbacks run on the C library's thread.
+	 */
+	void set_callback(callback& cb, executor_ptr exec);
+	/**
+	 * Gets the executor that runs the user callbacks.
+	 * @return The executor, or null if the callbacks run on the C library's
+	 *  	   thread.
+	 */
+	executor_ptr get_executor() const {
+		guard g(lock_);
+		return exec_;
+	}
+	/**
+	 * Sets a handler for the incoming messages whose topic matches a
+	 * filter, replacing any previous handler for that filter.
+	 * This does not subscribe to the filter. A message that matches one or
+	 * more filters goes to each of their handlers instead of the callback
+	 * or the consumer queue. The handlers run on the executor, if one is
+	 * set, keyed by the message topic.
+	 * @param topicFilter The topic filter, which can contain wildcards.
+	 * @param handler The handler for the matching messages.
+	 * @throw std::invalid_argument if the filter is not valid.
+	 */
+	void add_route(const std::string& topicFilter, topic_router::handler handler);
+	/**
+	 * Sets the handlers for a number of filters at once, replacing any
+	 * previous handlers for them.
+	 * The router is copied once for the whole set, rather than once for
+	 * each filter as with add_route(), so this is the way to add a large
+	 * number of routes.
+	 * @param routes The topic filters and their handlers.
+	 * @throw std::invalid_argument if a filter is not valid or a handler
+	 *  	  is empty, in which case no routes are changed.
+	 */
+	void add_routes(const route_collection& routes);
+	/**
+	 * Removes the handler for a filter.
+	 * @param topicFilter The topic filter, as given to add_route().
+	 * @return @em true if there was a handler for the filter.
+	 */
+	bool remove_route(const std::string& topicFilter);
+	/**
+	 * Starts putting incoming messages in the consumer queue, from which
+	 * the application can read them with consume_message() and friends.
+	 * While consuming, messages are not passed to the callback.
+	 * @param capacity The maximum number of messages held in the queue.
+	 * @param overflow What to do with an incoming message when the queue
+	 *  			   is full.
+	 */
+	void start_consuming(size_t capacity=std::numeric_limits<size_t>::max(),
+						 consumer_overflow overflow=consumer_overflow::BLOCK);
+	/**
+	 * Stops putting incoming messages in the consumer queue.
+	 * Messages already in the queue can still be read. A null message is
+	 * queued, if there's room, to wake up a consumer that is waiting.
+	 */
+	void stop_consuming();
+	/**
+	 * Determines if incoming messages are going to the consumer queue.
+	 * @return @em true if incoming messages are going to the consumer
+	 *  	   queue.
+	 */
+	bool is_consuming() const { return consuming_; }
+	/**
+	 * Gets the number of messages waiting in the consumer queue.
+	 * @return The number of messages waiting in the consumer queue.
+	 */
+	size_t consumer_queue_size() const { return que_.size(); }
+	/**
+	 * Gets the capacity of the consumer queue.
+	 * @return The maximum number of messages held in the consumer queue.
+	 */
+	size_t consumer_queue_capacity() const { return que_.capacity(); }
+	/**
+	 * Reads the next incoming message, waiting for one to arrive if the
+	 * queue is empty.
+	 * @return The message. This is null if consuming was stopped or the
+	 *  	   connection was lost.
+	 */
+	const_message_ptr consume_message() { return que_.get(); }
+	/**
+	 * Reads the next incoming message, if there is one, without waiting.
+	 * @param msg Receives the message.
+	 * @return @em true if a message was read, @em false if the queue is
+	 *  	   empty.
+	 */
+	bool try_consume_message(const_message_ptr* msg) {
+		return que_.try_get(msg);
+	}
+	/**
+	 * Reads the next incoming message, waiting up to the specified time
+	 * for one to arrive.
+	 * @param msg Receives the message.
+	 * @param relTime The longest time to wait.
+	 * @return @em true if a message was read, @em false on a timeout.
+	 */
+	template <typename Rep, class Period>
+	bool try_consume_message_for(const_message_ptr* msg,
+								 const std::chrono::duration<Rep,Period>& relTime) {
+		return que_.try_get_for(msg, relTime);
+	}
+	/**
+	 * Reads a number of incoming messages with a single wait.
+	 * This waits for a message if the queue is empty, then reads as many
+	 * as are available, up to the limit.
+	 * @param n The most messages to read.
+	 * @return The messages, in the order that they arrived.
+	 */
+	std::vector<const_message_ptr> consume_messages(size_t n);
+	/**
+	 * Sets whether incoming messages should take over the payload buffers
+	 * allocated by the C library, rather than copying them.
+	 * When enabled, the messages passed to the callback refer to the
+	 * library's buffer, which is freed when the last copy of the message
+	 * is destroyed. The payload can then be read in place with
+	 * message::get_payload_bytes(). This is disabled by default.
+	 * @param on @em true to hand incoming payloads to the messages
+	 *  		 without copying them.
+	 */
+	void set_zero_copy_receive(bool on) { zeroCopyRecv_ = on; }
+	/**
+	 * Determines if incoming messages take over the payload buffers
+	 * allocated by the C library.
+	 * @return @em true if incoming payloads are not copied.
+	 */
+	bool is_zero_copy_receive() const { return zeroCopyRecv_; }
 	/**
 	 * Subscribe to multiple topics, each of which may include wildcards.
 	 * @param topicFilters
@@ -393,6 +995,35 @@ public:
 	 */
 	itoken_ptr subscribe(const std::string& topicFilter, int qos,
 								 void* userContext, iaction_listener& cb) override;
+	/**
+	 * Subscribe to a topic, which may include wildcards, with a handler
+	 * for the messages that arrive on it.
+	 * The handler is set with add_route() before the request is sent, so
+	 * it doesn't miss any messages. If the request fails, the handler that
+	 * the filter had before, if any, is put back.
+	 * Unsubscribing from the filter removes the handler.
+	 * @param topicFilter the topic to subscribe to, which can include
+	 *  				  wildcards.
+	 * @param qos the maximum quality of service at which to subscribe.
+	 * @param handler the handler for the messages that match the filter.
+	 * @return token used to track and wait for the subscribe to complete.
+	 *  	   The token will be passed to callback methods if set.
+	 */
+	itoken_ptr subscribe(const std::string& topicFilter, int qos,
+						 topic_router::handler handler);
+	/**
+	 * Subscribes to multiple topics, each with a handler for the messages
+	 * that arrive on it.
+	 * The handlers are set together, as with add_routes(), before the
+	 * request is sent. If the request fails, the previous handlers are put
+	 * back.
+	 * @param routes The topic filters, which can include wildcards, and
+	 *  			 their handlers.
+	 * @param qos the maximum quality of service for each filter.
+	 * @return token used to track and wait for the subscribe to complete.
+	 *  	   The token will be passed to callback methods if set.
+	 */
+	itoken_ptr subscribe(const route_collection& routes, const qos_collection& qos);
 	/**
 	 * Requests the server unsubscribe the client from a topic.
 	 * @param topicFilter the topic to unsubscribe from. It must match a
@@ -435,6 +1066,77 @@ public:
 	 */
 	itoken_ptr unsubscribe(const std::string& topicFilter,
 								   void* userContext, iaction_listener& cb) override;
+
+#if defined(PAHO_MQTTPP_COROUTINES)
+	/**
+	 * Connects to the server using the default options, for a coroutine.
+	 * @return An awaiter that resumes the coroutine when the connection
+	 *  	   completes.
+	 */
+	token_awaiter async_connect() {
+		return token_awaiter(connect());
+	}
+	/**
+	 * Connects to the server using the specified options, for a coroutine.
+	 * @param options A set of connection parameters.
+	 * @return An awaiter that resumes the coroutine when the connection
+	 *  	   completes.
+	 */
+	token_awaiter async_connect(connect_options options) {
+		return token_awaiter(connect(std::move(options)));
+	}
+	/**
+	 * Disconnects from the server, for a coroutine.
+	 * @return An awaiter that resumes the coroutine when the disconnect
+	 *  	   completes.
+	 */
+	token_awaiter async_disconnect() {
+		return token_awaiter(disconnect());
+	}
+	/**
+	 * Publishes a message, for a coroutine.
+	 * @param topic The topic to publish on.
+	 * @param msg The message.
+	 * @return An awaiter that resumes the coroutine when the publish
+	 *  	   completes.
+	 */
+	token_awaiter async_publish(const std::string& topic, const_message_ptr msg) {
+		return token_awaiter(publish(topic, std::move(msg)));
+	}
+	/**
+	 * Publishes a payload, for a coroutine.
+	 * @param topic The topic to publish on.
+	 * @param payload The bytes of the payload.
+	 * @param n The size of the payload, in bytes.
+	 * @param qos The quality of service.
+	 * @param retained Whether the server should retain the message.
+	 * @return An awaiter that resumes the coroutine when the publish
+	 *  	   completes.
+	 */
+	token_awaiter async_publish(const std::string& topic, const void* payload,
+								size_t n, int qos, bool retained) {
+		return token_awaiter(publish(topic, payload, n, qos, retained));
+	}
+	/**
+	 * Subscribes to a topic, for a coroutine.
+	 * @param topicFilter The topic filter, which can include wildcards.
+	 * @param qos The maximum quality of service at which to subscribe.
+	 * @return An awaiter that resumes the coroutine when the subscribe
+	 *  	   completes.
+	 */
+	token_awaiter async_subscribe(const std::string& topicFilter, int qos) {
+		return token_awaiter(subscribe(topicFilter, qos));
+	}
+	/**
+	 * Unsubscribes from a topic, for a coroutine.
+	 * @param topicFilter The topic filter.
+	 * @return An awaiter that resumes the coroutine when the unsubscribe
+	 *  	   completes.
+	 */
+	token_awaiter async_unsubscribe(const std::string& topicFilter) {
+		return token_awaiter(unsubscribe(topicFilter));
+	}
+#endif
 };
 
 /** Smart/shared pointer to an asynchronous MQTT client object */
@@ -0,0 +1,138 @@
+/////////////////////////////////////////////////////////////////////////////
+/// @file awaitable.h
+/// Declaration of MQTT token_awaiter class, which lets a C++20 coroutine
+/// co_await the completion of an action.
+/// @date October 18, 2026
+/// @author agent
+/////////////////////////////////////////////////////////////////////////////
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_awaitable_h
+#define __mqtt_awaitable_h
+
+// The coroutine support is only available when the application is built
+// as C++20 (or later) with a compiler that supports coroutines. The rest
+// of the library is unaffected, and doesn't need to be built the same way.
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+	#if __has_include(<coroutine>)
+		#define PAHO_MQTTPP_COROUTINES 1
+	#endif
+#endif
+
+#if defined(PAHO_MQTTPP_COROUTINES)
+
+#include "mqtt/token.h"
+#include "mqtt/delivery_token.h"
+#include <coroutine>
+#include <stdexcept>
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * An awaiter for the completion of the action tracked by a token.
+ *
+ * This lets a coroutine wait for an action without blocking a thread:
+ *
+ * @code
+ *   co_await cli.async_publish(TOPIC, msg);
+ * @endcode
+ *
+ * The coroutine is suspended until the token completes, and is then
+ * resumed on the thread that completed it. That is normally the C
+ * library's callback thread (or the client's executor if the token has a
+ * listener), so the coroutine shouldn't block for long once it resumes.
+ *
+ * If the action failed, the co_await throws an mqtt::exception with the
+ * error code.
+ */
+class token_awaiter
+{
+	/** The token for the action */
+	token_ptr tok_;
+
+public:
+	/**
+	 * Creates an awaiter for the token.
+	 * @param tok The token. It must be of the library's token class.
+	 * @throw std::invalid_argument if the token is null, or not of the
+	 *  	  library's class.
+	 */
+	explicit token_awaiter(itoken_ptr tok)
+			: tok_(std::dynamic_pointer_cast<token>(tok)) {
+		if (!tok_)
+			throw std::invalid_argument("Not an mqtt::token");
+	}
+	/**
+	 * Determines if the action is already complete, in which case the
+	 * coroutine doesn't need to be suspended.
+	 * @return @em true if the action is complete.
+	 */
+	bool await_ready() const noexcept { return tok_->is_complete(); }
+	/**
+	 * Arranges for the coroutine to be resumed when the action completes.
+	 * @param h The handle of the suspended coroutine.
+	 * @return @em true to stay suspended, @em false if the action
+	 *  	   completed in the meantime and the coroutine should carry on.
+	 */
+	bool await_suspend(std::coroutine_handle<> h) {
+		return tok_->add_continuation([h] { h.resume(); });
+	}
+	/**
+	 * Gets the result of the action.
+	 * @throw exception if the action failed.
+	 */
+	void await_resume() {
+		// The token is complete, so this doesn't wait.
+		tok_->wait_for_completion();
+	}
+	/**
+	 * Gets the token for the action.
+	 * @return The token.
+	 */
+	token_ptr get_token() const { return tok_; }
+};
+
+/**
+ * Lets a coroutine co_await a token directly.
+ * @param tok The token.
+ * @return An awaiter for the token.
+ */
+inline token_awaiter operator co_await(itoken_ptr tok) {
+	return token_awaiter(std::move(tok));
+}
+
+/**
+ * Lets a coroutine co_await a delivery token directly.
+ * @param tok The delivery token.
+ * @return An awaiter for the token.
+ */
+inline token_awaiter operator co_await(idelivery_token_ptr tok) {
+	return token_awaiter(std::move(tok));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		// PAHO_MQTTPP_COROUTINES
+
+#endif		// __mqtt_awaitable_h
+
@@ -0,0 +1,203 @@
+/////////////////////////////////////////////////////////////////////////////
+/// @file block_pool.h
+/// Declaration of MQTT block_pool and pool_allocator classes
+/// @date October 18, 2026
+/// @author agent
+/////////////////////////////////////////////////////////////////////////////
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_block_pool_h
+#define __mqtt_block_pool_h
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A thread-safe pool of small memory blocks.
+ *
+ * Requests are rounded up to one of a few block sizes, from MIN_BLOCK_SIZE
+ * up to MAX_BLOCK_SIZE, and each size has its own free list. Blocks that
+ * are returned to the pool are kept for reuse rather than being given back
+ * to the system, so once the pool has grown to the high-water mark of the
+ * application, allocating from it does not touch the heap. Requests that
+ * are larger than MAX_BLOCK_SIZE go straight to the heap.
+ *
+ * The client uses a pool for the objects that it creates for each
+ * publish, such as the message, the delivery token, and the bookkeeping
+ * for the token.
+ */
+class block_pool
+{
+public:
+	/** Smart/shared pointer to an object of this class */
+	using ptr_t = std::shared_ptr<block_pool>;
+
+	/** The size of the smallest block */
+	static const size_t MIN_BLOCK_SIZE = 64;
+	/** The size of the largest block that is kept in the pool */
+	static const size_t MAX_BLOCK_SIZE = 1024;
+
+private:
+	/** Lock guard type for this class */
+	using guard = std::unique_lock<std::mutex>;
+
+	/** The number of block sizes (powers of two from min to max) */
+	static const size_t N_SIZES = 5;
+
+	/** A block on a free list, which holds the link to the next one */
+	struct free_block {
+		free_block* next;
+	};
+
+	/** Object monitor mutex */
+	mutable std::mutex lock_;
+	/** The free list for each block size */
+	free_block* free_[N_SIZES];
+	/** The number of blocks on each free list */
+	size_t nfree_[N_SIZES];
+
+	/**
+	 * Gets the index of the block size that fits the request.
+	 * @param n The number of bytes requested.
+	 * @return The index of the block size, or N_SIZES if the request is
+	 *  	   too large for the pool.
+	 */
+	static size_t size_index(size_t n);
+
+	/** Non-copyable */
+	block_pool(const block_pool&) =delete;
+	block_pool& operator=(const block_pool&) =delete;
+
+public:
+	/**
+	 * Creates an empty pool.
+	 */
+	block_pool();
+	/**
+	 * Destroys the pool, returning all the free blocks to the heap.
+	 * Any blocks that are still in use must not be returned to the pool
+	 * after this.
+	 */
+	~block_pool();
+	/**
+	 * Allocates a block of memory.
+	 * @param n The number of bytes required.
+	 * @return A pointer to the memory.
+	 * @throw std::bad_alloc if the memory could not be allocated.
+	 */
+	void* allocate(size_t n);
+	/**
+	 * Returns a block of memory to the pool.
+	 * @param p The memory, as returned by allocate().
+	 * @param n The number of bytes that were requested for the block.
+	 */
+	void deallocate(void* p, size_t n);
+	/**
+	 * Returns all the free blocks to the heap.
+	 */
+	void clear();
+	/**
+	 * Gets the number of free blocks held in the pool.
+	 * @return The number of free blocks held in the pool.
+	 */
+	size_t num_free() const;
+};
+
+/** Smart/shared pointer to a block pool */
+using block_pool_ptr = block_pool::ptr_t;
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A standard allocator that gets its memory from a block pool.
+ *
+ * The allocator holds a reference to the pool, so any container or shared
+ * object that uses it keeps the pool alive for as long as it needs it.
+ */
+template <typename T>
+class pool_allocator
+{
+	/** The pool that provides the memory */
+	block_pool_ptr pool_;
+
+	/** Allocators of other types can share the pool. */
+	template <typename U> friend class pool_allocator;
+
+public:
+	/** The type of object allocated */
+	using value_type = T;
+
+	/**
+	 * Creates an allocator that uses the specified pool.
+	 * @param pool The pool.
+	 */
+	explicit pool_allocator(block_pool_ptr pool) : pool_(std::move(pool)) {}
+	/**
+	 * Creates an allocator that uses the same pool as another one.
+	 * @param other The other allocator.
+	 */
+	template <typename U>
+	pool_allocator(const pool_allocator<U>& other) : pool_(other.pool_) {}
+	/**
+	 * Allocates memory for an array of objects.
+	 * @param n The number of objects.
+	 * @return A pointer to the uninitialized memory.
+	 */
+	T* allocate(size_t n) {
+		return static_cast<T*>(pool_->allocate(n * sizeof(T)));
+	}
+	/**
+	 * Returns memory to the pool.
+	 * @param p The memory, as returned by allocate().
+	 * @param n The number of objects that were requested.
+	 */
+	void deallocate(T* p, size_t n) {
+		pool_->deallocate(p, n * sizeof(T));
+	}
+	/**
+	 * Gets the pool that this allocator uses.
+	 * @return The pool that this allocator uses.
+	 */
+	const block_pool_ptr& get_pool() const { return pool_; }
+	/**
+	 * Determines if two allocators use the same pool.
+	 */
+	template <typename U>
+	bool operator==(const pool_allocator<U>& rhs) const {
+		return pool_ == rhs.pool_;
+	}
+	/**
+	 * Determines if two allocators use different pools.
+	 */
+	template <typename U>
+	bool operator!=(const pool_allocator<U>& rhs) const {
+		return pool_ != rhs.pool_;
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		// __mqtt_block_pool_h
+
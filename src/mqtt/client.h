@@ -28,6 +28,8 @@
 
 #include <string>
 #include <memory>
+#include <deque>
+#include <mutex>
 
 namespace mqtt {
 
@@ -36,6 +38,23 @@ namespace mqtt {
 /**
  * Lightweight client for talking to an MQTT server using methods that block
  * until an operation completes.
+ *
+ * By default, publish() waits for each message to be acknowledged before
+ * it returns, so the rate of publishing is limited by the round trip to
+ * the server. With a publish window larger than one, publish() returns as
+ * soon as the message is sent, as long as fewer than that many messages
+ * are waiting to be acknowledged, and only blocks when the window is full.
+ * Call flush() to wait for all of them:
+ *
+ * @code
+ *   cli.set_publish_window(64);
+ *   for (const auto& s : data)
+ *       cli.publish(TOPIC, s.data(), s.size(), 1, false);
+ *   cli.flush();
+ * @endcode
+ *
+ * In that mode, a message that fails to be delivered is reported by a
+ * later call to publish() or flush(), whichever waits for it.
  */
 class client
 {
@@ -47,6 +66,31 @@ class client
 	 * The longest amount of time to wait for an operation (in milliseconds)
 	 */
 	int timeout_;
+	/** The number of publishes that can be waiting to be acknowledged */
+	size_t window_;
+	/** The publishes that haven't been waited on, oldest first */
+	std::deque<idelivery_token_ptr> inflight_;
+	/**
+	 * Lock for the publish window. It's never held while waiting for a
+	 * token.
+	 */
+	mutable std::mutex lock_;
+
+	/** Lock guard type for this class */
+	using guard = std::unique_lock<std::mutex>;
+
+	/**
+	 * Adds a publish to the window, and waits until there's room in the
+	 * window for the next one.
+	 * @param tok The token for the publish.
+	 * @param wait Whether to wait for this publish, rather than leave it
+	 *  		   in the window, as when the message doesn't outlive the
+	 *  		   call. Any older ones are waited on first.
+	 */
+	void complete(idelivery_token_ptr tok, bool wait=false);
+
+	/** The tests can look at the window */
+	friend class client_test;
 
 	/** Non-copyable */
 	client() =delete;
@@ -109,12 +153,19 @@ public:
 	virtual void connect(connect_options options);
 	/**
 	 * Disconnects from the server.
+	 * This first waits for any messages in the publish window.
 	 */
 	virtual void disconnect();
 	/**
 	 * Disconnects from the server.
+	 * This first waits for any messages in the publish window.
 	 */
 	virtual void disconnect(long quiesceTimeout);
+	/**
+	 * Waits for all the messages in the publish window to be acknowledged.
+	 * @throw exception for the first of them that failed.
+	 */
+	virtual void flush();
 	/**
 	 * Returns a randomly generated client identifier based on the current
 	 * user's login name and the system time.
@@ -134,6 +185,12 @@ public:
 	 * @return std::string
 	 */
 	virtual std::string get_server_uri() const;
+	/**
+	 * Gets the number of messages that can be waiting to be acknowledged
+	 * before publish() blocks.
+	 * @return The size of the publish window.
+	 */
+	virtual size_t get_publish_window() const;
 	/**
 	 * Return the maximum time to wait for an action to complete.
 	 * @return int
@@ -152,7 +209,7 @@ public:
 	virtual bool is_connected() const;
 	/**
 	 * Publishes a message to a topic on the server and return once it is
-	 * delivered.
+	 * delivered, or once it is sent if there's room in the publish window.
 	 * @param top The topic to publish
 	 * @param payload The data to publish
 	 * @param n The size in bytes of the data
@@ -179,6 +236,22 @@ public:
 	 * @param cb The callback functions
 	 */
 	virtual void set_callback(callback& cb);
+	/**
+	 * Sets the callback listener to use for events that happen
+	 * asynchronously, and the executor to run it.
+	 * @param cb The callback functions
+	 * @param exec The executor to run the callbacks. If this is null, the
+	 *  		   callbacks run on the C library's thread.
+	 */
+	virtual void set_callback(callback& cb, executor_ptr exec);
+	/**
+	 * Sets the number of messages that can be waiting to be acknowledged
+	 * before publish() blocks.
+	 * The default of one has each publish() wait for its message to be
+	 * acknowledged.
+	 * @param n The size of the publish window. Zero is the same as one.
+	 */
+	virtual void set_publish_window(size_t n);
 	/**
 	 * Set the maximum time to wait for an action to complete
 	 * @param timeToWaitInMillis
@@ -0,0 +1,328 @@
+/////////////////////////////////////////////////////////////////////////////
+/// @file client_metrics.h
+/// Declaration of MQTT client_metrics and latency_histogram classes
+/// @date October 18, 2026
+/// @author agent
+/////////////////////////////////////////////////////////////////////////////
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_client_metrics_h
+#define __mqtt_client_metrics_h
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A histogram of latencies, in nanoseconds, in the style of an HDR
+ * histogram.
+ *
+ * The buckets are linear within each power of two, so every value is
+ * kept to within about 6% across the whole 64-bit range, with a fixed
+ * amount of memory. Values below 16 ns are kept exactly.
+ *
+ * Recording a value is a few atomic operations and never takes a lock.
+ * The histogram can be read at any time, from any thread, while values
+ * are being recorded. A read that runs alongside recording sees each
+ * bucket as of some moment during the read.
+ */
+class latency_histogram
+{
+public:
+	/** The number of bits of each value that are kept */
+	static const unsigned SUB_BUCKET_BITS = 4;
+	/** The number of linear buckets within each power of two */
+	static const size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+	/** The total number of buckets */
+	static const size_t NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+private:
+	/** The count of values in each bucket */
+	std::atomic<uint64_t> counts_[NUM_BUCKETS];
+	/** The total number of values */
+	std::atomic<uint64_t> count_;
+	/** The sum of the values */
+	std::atomic<uint64_t> sum_;
+	/** The smallest value */
+	std::atomic<uint64_t> min_;
+	/** The largest value */
+	std::atomic<uint64_t> max_;
+
+	/** Non-copyable */
+	latency_histogram(const latency_histogram&) =delete;
+	latency_histogram& operator=(const latency_histogram&) =delete;
+
+public:
+	/**
+	 * Creates an empty histogram.
+	 */
+	latency_histogram();
+	/**
+	 * Gets the bucket that holds a value.
+	 * @param v The value.
+	 * @return The index of the bucket.
+	 */
+	static size_t bucket_index(uint64_t v);
+	/**
+	 * Gets the smallest value that goes into a bucket.
+	 * @param i The index of the bucket.
+	 * @return The smallest value in the bucket.
+	 */
+	static uint64_t bucket_lower(size_t i);
+	/**
+	 * Gets the largest value that goes into a bucket.
+	 * @param i The index of the bucket.
+	 * @return The largest value in the bucket.
+	 */
+	static uint64_t bucket_upper(size_t i);
+	/**
+	 * Records a value.
+	 * @param ns The value, in nanoseconds.
+	 */
+	void record(uint64_t ns);
+	/**
+	 * Records a time.
+	 * @param d The time.
+	 */
+	template <typename Rep, class Period>
+	void record(const std::chrono::duration<Rep,Period>& d) {
+		auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+		record(ns < 0 ? uint64_t(0) : uint64_t(ns));
+	}
+	/**
+	 * Clears all the values.
+	 * Values that are recorded at the same time may be partly cleared.
+	 */
+	void reset();
+	/**
+	 * Gets the number of values in a bucket.
+	 * @param i The index of the bucket.
+	 * @return The number of values in the bucket.
+	 */
+	uint64_t count_at(size_t i) const {
+		return counts_[i].load(std::memory_order_relaxed);
+	}
+	/**
+	 * Gets the number of values that were recorded.
+	 * @return The number of values.
+	 */
+	uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+	/**
+	 * Gets the smallest value that was recorded.
+	 * @return The smallest value, or zero if there are none.
+	 */
+	uint64_t min() const;
+	/**
+	 * Gets the largest value that was recorded.
+	 * @return The largest value, or zero if there are none.
+	 */
+	uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+	/**
+	 * Gets the mean of the values.
+	 * @return The mean, or zero if there are none.
+	 */
+	double mean() const;
+	/**
+	 * Gets the value at a percentile: the smallest value that the given
+	 * percentage of the values are no larger than, to within the
+	 * resolution of the buckets.
+	 * @param pct The percentile, from 0 to 100.
+	 * @return The value at the percentile, or zero if there are none.
+	 */
+	uint64_t percentile(double pct) const;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Counters and latency histograms for a client.
+ *
+ * The client updates these as it works, if the library was built with
+ * PAHO_MQTTPP_METRICS defined and metrics were enabled on the client with
+ * async_client::enable_metrics(). Everything can be read at any time,
+ * from any thread, without a lock.
+ */
+class client_metrics
+{
+	/** The lowest reason code that's counted on its own */
+	static const int MIN_REASON_CODE = -32;
+	/** The highest reason code that's counted on its own */
+	static const int MAX_REASON_CODE = 255;
+	/** The number of reason codes that are counted on their own */
+	static const size_t NUM_REASON_CODES = size_t(MAX_REASON_CODE - MIN_REASON_CODE + 1);
+
+	/** The number of messages published */
+	std::atomic<uint64_t> msgsPublished_;
+	/** The number of payload bytes published */
+	std::atomic<uint64_t> bytesPublished_;
+	/** The number of messages received */
+	std::atomic<uint64_t> msgsReceived_;
+	/** The number of payload bytes received */
+	std::atomic<uint64_t> bytesReceived_;
+	/** The number of tokens in flight */
+	std::atomic<int64_t> tokensInFlight_;
+	/** The number of failures */
+	std::atomic<uint64_t> failures_;
+	/** The number of failures for each reason code in range */
+	std::atomic<uint64_t> failuresByCode_[NUM_REASON_CODES];
+	/** The number of times that the connection was lost */
+	std::atomic<uint64_t> connectionsLost_;
+	/** The number of connects requested after the connection was lost */
+	std::atomic<uint64_t> reconnects_;
+	/** Set when the connection is lost, until the next connect */
+	std::atomic<bool> lost_;
+	/** Publish to acknowledge times */
+	latency_histogram publishLatency_;
+	/** Time spent in the message arrived callback */
+	latency_histogram callbackTime_;
+
+	/** The client updates the metrics */
+	friend class async_client;
+	friend class client_metrics_test;
+
+	/** Counts a message that was published */
+	void on_publish(size_t n) {
+		msgsPublished_.fetch_add(1, std::memory_order_relaxed);
+		bytesPublished_.fetch_add(n, std::memory_order_relaxed);
+	}
+	/** Counts a message that was received */
+	void on_receive(size_t n) {
+		msgsReceived_.fetch_add(1, std::memory_order_relaxed);
+		bytesReceived_.fetch_add(n, std::memory_order_relaxed);
+	}
+	/** Counts tokens that were put in play */
+	void on_token_added(size_t n=1) {
+		tokensInFlight_.fetch_add(int64_t(n), std::memory_order_relaxed);
+	}
+	/** Counts tokens that were taken out of play */
+	void on_token_removed(size_t n=1) {
+		tokensInFlight_.fetch_sub(int64_t(n), std::memory_order_relaxed);
+	}
+	/** Counts an action that failed */
+	void on_failure(int rc);
+	/** Counts a lost connection */
+	void on_connection_lost() {
+		connectionsLost_.fetch_add(1, std::memory_order_relaxed);
+		lost_.store(true, std::memory_order_relaxed);
+	}
+	/** Counts a connect, which is a reconnect if the connection was lost */
+	void on_connect() {
+		if (lost_.exchange(false, std::memory_order_relaxed))
+			reconnects_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/** Non-copyable */
+	client_metrics(const client_metrics&) =delete;
+	client_metrics& operator=(const client_metrics&) =delete;
+
+public:
+	/**
+	 * Creates a set of metrics with everything at zero.
+	 */
+	client_metrics();
+	/**
+	 * Gets the number of messages published.
+	 * @return The number of messages published.
+	 */
+	uint64_t messages_published() const {
+		return msgsPublished_.load(std::memory_order_relaxed);
+	}
+	/**
+	 * Gets the number of payload bytes published.
+	 * @return The number of payload bytes published.
+	 */
+	uint64_t bytes_published() const {
+		return bytesPublished_.load(std::memory_order_relaxed);
+	}
+	/**
+	 * Gets the number of messages received.
+	 * @return The number of messages received.
+	 */
+	uint64_t messages_received() const {
+		return msgsReceived_.load(std::memory_order_relaxed);
+	}
+	/**
+	 * Gets the number of payload bytes received.
+	 * @return The number of payload bytes received.
+	 */
+	uint64_t bytes_received() const {
+		return bytesReceived_.load(std::memory_order_relaxed);
+	}
+	/**
+	 * Gets the number of tokens that are in flight, for all kinds of
+	 * actions.
+	 * @return The number of tokens in flight.
+	 */
+	int64_t tokens_in_flight() const {
+		return tokensInFlight_.load(std::memory_order_relaxed);
+	}
+	/**
+	 * Gets the number of actions that failed.
+	 * @return The number of failures.
+	 */
+	uint64_t failures() const {
+		return failures_.load(std::memory_order_relaxed);
+	}
+	/**
+	 * Gets the number of actions that failed with a reason code.
+	 * @param rc The reason code, from the C library or the server.
+	 * @return The number of failures with the code. This is zero for
+	 *  	   codes outside the range that's counted.
+	 */
+	uint64_t failures(int rc) const;
+	/**
+	 * Gets the number of times the connection was lost.
+	 * @return The number of times the connection was lost.
+	 */
+	uint64_t connections_lost() const {
+		return connectionsLost_.load(std::memory_order_relaxed);
+	}
+	/**
+	 * Gets the number of connects that were requested after the
+	 * connection was lost.
+	 * @return The number of reconnects.
+	 */
+	uint64_t reconnects() const {
+		return reconnects_.load(std::memory_order_relaxed);
+	}
+	/**
+	 * Gets the histogram of the times from publishing a message to its
+	 * acknowledgment.
+	 * @return The publish latency histogram.
+	 */
+	const latency_histogram& publish_latency() const { return publishLatency_; }
+	/**
+	 * Gets the histogram of the time that the client spends handling each
+	 * incoming message: running the callback or the routes, or queuing the
+	 * message.
+	 * @return The callback time histogram.
+	 */
+	const latency_histogram& callback_time() const { return callbackTime_; }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		// __mqtt_client_metrics_h
+
@@ -28,6 +28,7 @@
 #include "mqtt/token.h"
 #include "mqtt/message.h"
 #include <memory>
+#include <chrono>
 
 namespace mqtt {
 
@@ -72,6 +73,13 @@ class delivery_token : public virtual idelivery_token,
 	/** The message being tracked. */
 	const_message_ptr msg_;
 
+	/**
+	 * When the message was handed to the C library, for the metrics.
+	 * This is always here, so that the layout doesn't depend on how the
+	 * library was built, but it's only set in a metrics build.
+	 */
+	std::chrono::steady_clock::time_point sendTime_;
+
 	/** Client has special access. */
 	friend class async_client;
 
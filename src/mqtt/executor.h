@@ -0,0 +1,321 @@
+/////////////////////////////////////////////////////////////////////////////
+/// @file executor.h
+/// Declaration of MQTT executor classes, which run the user callbacks.
+/// @date October 18, 2026
+/// @author agent
+/////////////////////////////////////////////////////////////////////////////
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_executor_h
+#define __mqtt_executor_h
+
+#include "mqtt/thread_queue.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <atomic>
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * An object that runs tasks on behalf of the client.
+ *
+ * The client hands the calls to the user's callback and action listeners
+ * to an executor, which decides on which thread they run. This keeps slow
+ * application code off of the C library's thread, which also services the
+ * network connection.
+ *
+ * A task can be submitted with a key, such as the topic of a message. An
+ * executor must run tasks that have the same key in the order that they
+ * were submitted.
+ */
+class executor
+{
+public:
+	/** Smart/shared pointer to an object of this class */
+	using ptr_t = std::shared_ptr<executor>;
+	/** The type of task that the executor runs */
+	using task = std::function<void()>;
+
+	/**
+	 * Virtual destructor.
+	 */
+	virtual ~executor() {}
+	/**
+	 * Submits a task that has no ordering constraints.
+	 * @param t The task.
+	 */
+	virtual void execute(task t) =0;
+	/**
+	 * Submits a task that must run in order with the other tasks having
+	 * the same key.
+	 * @param key The key.
+	 * @param t The task.
+	 */
+	virtual void execute(const std::string& key, task t) =0;
+	/**
+	 * Submits a task that must not be dropped, even if the executor is
+	 * overloaded, such as the completion of a token that someone may be
+	 * waiting on. The client uses this for everything but the calls for
+	 * incoming messages and delivery notices.
+	 * The default is the same as execute().
+	 * @param t The task.
+	 */
+	virtual void execute_always(task t) { execute(std::move(t)); }
+};
+
+/** Smart/shared pointer to an executor */
+using executor_ptr = executor::ptr_t;
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * An executor that runs each task immediately, on the thread that submits
+ * it.
+ * When used by the client, this means that the callbacks run on the C
+ * library's thread, which is what happens when no executor is set.
+ */
+class inline_executor : public executor
+{
+public:
+	/** Smart/shared pointer to an object of this class */
+	using ptr_t = std::shared_ptr<inline_executor>;
+
+	/**
+	 * Runs the task.
+	 * @param t The task.
+	 */
+	void execute(task t) override { t(); }
+	/**
+	 * Runs the task.
+	 * @param key The key (not used).
+	 * @param t The task.
+	 */
+	void execute(const std::string& /*key*/, task t) override { t(); }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * What a thread executor does with a task when its queue is full.
+ */
+enum class executor_overflow {
+	/**
+	 * Discard the task, and count it. This never holds up the caller, which
+	 * for the client is the C library's thread.
+	 */
+	DROP,
+	/**
+	 * Wait for the thread to make room. This holds up the caller, and so,
+	 * for the client, the network.
+	 */
+	BLOCK
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * An executor that runs the tasks, one at a time, on a dedicated thread.
+ *
+ * Tasks are passed to the thread through a bounded queue. By default, if
+ * the queue is full, execute() discards the task and counts it, so that
+ * the application falling behind never holds up the network. A task
+ * submitted with execute_always() is run right away, on the caller's
+ * thread, instead. With executor_overflow::BLOCK, both wait for the thread
+ * to catch up, so the capacity limits how far the application can fall
+ * behind before the client is throttled.
+ *
+ * An exception that escapes from a task is discarded, so that it doesn't
+ * bring down the thread.
+ *
+ * When the executor is destroyed, the thread runs any tasks that remain in
+ * the queue before it exits. If the executor is destroyed by one of its
+ * own tasks, such as a callback that replaces the client's executor, the
+ * thread can't be joined, so it's detached, and exits on its own once
+ * the queue is drained.
+ *
+ * Since the tasks run one at a time, a task must not wait for another
+ * task on the same executor. In particular, a callback or action listener
+ * that runs here must not wait on a token that has an action listener,
+ * as the listener is queued behind the callback that's waiting for it,
+ * and the two deadlock.
+ */
+class thread_executor : public executor
+{
+	/** The type of queue for the tasks */
+	using queue_type = thread_queue<task>;
+
+	/**
+	 * The queue of tasks to run. This is shared with the thread, which
+	 * might outlive the executor.
+	 */
+	std::shared_ptr<queue_type> que_;
+	/** What to do with a task when the queue is full */
+	executor_overflow overflow_;
+	/** The number of tasks that were dropped because the queue was full */
+	std::atomic<size_t> dropped_;
+	/** The thread that runs the tasks */
+	std::thread thr_;
+
+	/** The thread function */
+	static void run(std::shared_ptr<queue_type> que);
+
+	/** Non-copyable */
+	thread_executor(const thread_executor&) =delete;
+	thread_executor& operator=(const thread_executor&) =delete;
+
+public:
+	/** Smart/shared pointer to an object of this class */
+	using ptr_t = std::shared_ptr<thread_executor>;
+
+	/** The default capacity of the task queue */
+	static const size_t DFLT_CAPACITY;
+
+	/**
+	 * Creates the executor and starts its thread.
+	 * @param cap The capacity of the task queue.
+	 * @param overflow What to do with a task when the queue is full.
+	 */
+	explicit thread_executor(size_t cap=DFLT_CAPACITY,
+							 executor_overflow overflow=executor_overflow::DROP);
+	/**
+	 * Runs the remaining tasks, then stops the thread.
+	 */
+	~thread_executor();
+	/**
+	 * Queues a task to run on the executor's thread.
+	 * If the queue is full, the task is dropped, or this waits for room,
+	 * depending on the overflow setting.
+	 * @param t The task.
+	 */
+	void execute(task t) override;
+	/**
+	 * Queues a task to run on the executor's thread.
+	 * Since there is only one thread, all tasks run in order.
+	 * @param key The key (not used).
+	 * @param t The task.
+	 */
+	void execute(const std::string& /*key*/, task t) override {
+		execute(std::move(t));
+	}
+	/**
+	 * Queues a task that must not be dropped.
+	 * If the queue is full, this runs the task right away, on the calling
+	 * thread, or waits for room, depending on the overflow setting.
+	 * @param t The task.
+	 */
+	void execute_always(task t) override;
+	/**
+	 * Gets the number of tasks waiting to run.
+	 * @return The number of tasks waiting to run.
+	 */
+	size_t size() const { return que_->size(); }
+	/**
+	 * Gets the capacity of the task queue.
+	 * @return The capacity of the task queue.
+	 */
+	size_t capacity() const { return que_->capacity(); }
+	/**
+	 * Gets what the executor does with a task when the queue is full.
+	 * @return What the executor does with a task when the queue is full.
+	 */
+	executor_overflow get_overflow() const { return overflow_; }
+	/**
+	 * Gets the number of tasks that were dropped because the queue was
+	 * full.
+	 * @return The number of tasks that were dropped.
+	 */
+	size_t dropped() const { return dropped_.load(); }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * An executor that runs the tasks on a fixed pool of threads.
+ *
+ * Each thread has its own bounded task queue. A task submitted with a key
+ * always goes to the same thread, chosen by a hash of the key, so tasks
+ * with the same key (e.g. messages on the same topic) run in order, while
+ * those with different keys can run in parallel. Tasks without a key are
+ * spread across the threads in turn. When a thread's queue is full, the
+ * task is handled as in thread_executor.
+ */
+class thread_pool_executor : public executor
+{
+	/** The threads */
+	std::vector<std::unique_ptr<thread_executor>> threads_;
+	/** The thread to get the next task without a key */
+	std::atomic<size_t> next_;
+
+	/** Non-copyable */
+	thread_pool_executor(const thread_pool_executor&) =delete;
+	thread_pool_executor& operator=(const thread_pool_executor&) =delete;
+
+public:
+	/** Smart/shared pointer to an object of this class */
+	using ptr_t = std::shared_ptr<thread_pool_executor>;
+
+	/**
+	 * Creates the executor and starts its threads.
+	 * @param nthreads The number of threads. The minimum is one.
+	 * @param cap The capacity of each thread's task queue.
+	 * @param overflow What to do with a task when a thread's queue is
+	 *  			   full.
+	 */
+	explicit thread_pool_executor(size_t nthreads,
+								  size_t cap=thread_executor::DFLT_CAPACITY,
+								  executor_overflow overflow=executor_overflow::DROP);
+	/**
+	 * Queues a task to run on the next thread in turn.
+	 * @param t The task.
+	 */
+	void execute(task t) override;
+	/**
+	 * Queues a task to run on the thread that handles the key.
+	 * @param key The key.
+	 * @param t The task.
+	 */
+	void execute(const std::string& key, task t) override;
+	/**
+	 * Queues a task that must not be dropped, on the next thread in turn.
+	 * @param t The task.
+	 */
+	void execute_always(task t) override;
+	/**
+	 * Gets the number of threads in the pool.
+	 * @return The number of threads in the pool.
+	 */
+	size_t num_threads() const { return threads_.size(); }
+	/**
+	 * Gets the number of tasks that were dropped because a thread's queue
+	 * was full.
+	 * @return The number of tasks that were dropped.
+	 */
+	size_t dropped() const;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		// __mqtt_executor_h
+
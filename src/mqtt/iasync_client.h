@@ -57,6 +57,17 @@ class iasync_client
 {
 	friend class token;
 	virtual void remove_token(itoken* tok) =0;
+	/**
+	 * Removes a token that the C library has finished with.
+	 * @param tok The token.
+	 * @param rc The return code the C library gave for the action. The
+	 *  		 token may not show it yet, if its completion is being run
+	 *  		 by an executor.
+	 */
+	virtual void remove_token(itoken* tok, int rc) {
+		(void) rc;
+		remove_token(tok);
+	}
 
 public:
 	/** Type for a collection of filters */
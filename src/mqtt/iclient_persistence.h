@@ -29,11 +29,145 @@
 #include <string>
 #include <memory>
 #include <vector>
+#include <cstdint>
 
 namespace mqtt {
 
 /////////////////////////////////////////////////////////////////////////////
 
+/**
+ * A read-only copy of all the data in a persistence store, taken in one
+ * go to restore a session.
+ *
+ * The keys are packed, one after the other, into a single string, and
+ * the data for all of them into a single block of memory, with a small
+ * index entry for each key. So there are a few allocations for the whole
+ * snapshot rather than a few for each key, no matter how many keys there
+ * are. Keys are looked up through a small hash table of positions in the
+ * index.
+ *
+ * A snapshot is built in two steps. First each key is added along with
+ * the length of its data. Then allocate() makes the block for the data,
+ * and the data for each key is copied in through data(). The copying
+ * can be split up between threads, since each key has its own place in
+ * the block.
+ */
+class persistence_snapshot
+{
+	/** The index entry for a key */
+	struct entry {
+		/** The offset of the data in the block */
+		uint64_t dataOff;
+		/** The length of the data */
+		uint32_t dataLen;
+		/** The offset of the key in the key string */
+		uint32_t keyOff;
+	};
+
+	/** The keys, each terminated with a NUL */
+	std::string keys_;
+	/** The index, in the order that the keys were added */
+	std::vector<entry> index_;
+	/**
+	 * The hash table for finding keys. Each slot has the position of a
+	 * key in the index, plus one, or zero if it's empty.
+	 */
+	std::vector<uint32_t> table_;
+	/** The data for all the keys */
+	std::unique_ptr<byte[]> data_;
+	/** The total length of the data */
+	size_t dataLen_;
+
+public:
+	/** Smart/shared pointer to an object of this class. */
+	using ptr_t = std::shared_ptr<persistence_snapshot>;
+
+	/** The position returned by find() for a key that isn't there */
+	static const size_t npos = size_t(-1);
+
+	/**
+	 * Creates an empty snapshot.
+	 */
+	persistence_snapshot() : dataLen_(0) {}
+	/**
+	 * Reserves space for the keys.
+	 * @param nkeys The number of keys
+	 * @param keyLen The total length of the keys
+	 */
+	void reserve(size_t nkeys, size_t keyLen);
+	/**
+	 * Adds a key, with room for the specified length of data.
+	 * This must be called before allocate().
+	 * @param key The key
+	 * @param len The length of the data for the key.
+	 * @return The position of the key in the snapshot.
+	 */
+	size_t add(const std::string& key, size_t len);
+	/**
+	 * Allocates the block for the data, after all the keys are added.
+	 */
+	void allocate();
+	/**
+	 * Gets the number of keys in the snapshot.
+	 * @return The number of keys in the snapshot.
+	 */
+	size_t size() const { return index_.size(); }
+	/**
+	 * Determines if the snapshot has no keys.
+	 * @return @em true if the snapshot has no keys.
+	 */
+	bool empty() const { return index_.empty(); }
+	/**
+	 * Gets the total length of the data for all the keys.
+	 * @return The total length of the data for all the keys.
+	 */
+	size_t data_length() const { return dataLen_; }
+	/**
+	 * Gets a key, as a NUL-terminated string.
+	 * @param i The position of the key
+	 * @return The key.
+	 */
+	const char* key(size_t i) const { return keys_.data() + index_[i].keyOff; }
+	/**
+	 * Gets the length of a key.
+	 * @param i The position of the key
+	 * @return The length of the key.
+	 */
+	size_t key_length(size_t i) const {
+		return ((i+1 < index_.size()) ? index_[i+1].keyOff : keys_.size())
+					- index_[i].keyOff - 1;
+	}
+	/**
+	 * Gets the data for a key.
+	 * @param i The position of the key
+	 * @return A pointer to the data for the key.
+	 */
+	const byte* data(size_t i) const { return data_.get() + index_[i].dataOff; }
+	/**
+	 * Gets the data for a key, to fill it in.
+	 * @param i The position of the key
+	 * @return A pointer to the data for the key.
+	 */
+	byte* data(size_t i) { return data_.get() + index_[i].dataOff; }
+	/**
+	 * Gets the length of the data for a key.
+	 * @param i The position of the key
+	 * @return The length of the data for the key.
+	 */
+	size_t data_length(size_t i) const { return index_[i].dataLen; }
+	/**
+	 * Finds a key in the snapshot.
+	 * @param key The key
+	 * @return The position of the key, or @em npos if it's not there.
+	 */
+	size_t find(const char* key) const;
+};
+
+/** Smart/shared pointer to a persistence snapshot */
+using persistence_snapshot_ptr = persistence_snapshot::ptr_t;
+
+/////////////////////////////////////////////////////////////////////////////
+
 /**
  * Represents a persistent data store, used to store outbound and inbound
  * messages while they are in flight, enabling delivery to the QoS
@@ -50,6 +184,15 @@ namespace mqtt {
  *
  * It is up to the persistence interface to log any exceptions or error
  * information which may be required when diagnosing a persistence failure.
+ *
+ * When the client starts, the C library restores any messages left over
+ * from a previous session by asking for the keys and then for the data of
+ * each one. It does this a few times, once for each kind of data, each
+ * time reading only the keys of that kind. A store that can read all of
+ * its data in bulk can override load_all(); the library then takes one
+ * snapshot the first time the keys are requested, and serves the keys and
+ * data from it until every key has been read, or the store is changed.
+ * Otherwise the data is read one key at a time with get().
  */
 class iclient_persistence
 {
@@ -111,11 +254,48 @@ public:
 	 * @param persistable
 	 */
 	virtual void put(const std::string& key, ipersistable_ptr persistable) =0;
+	/**
+	 * Puts data that is in a number of separate buffers into the
+	 * persistent store.
+	 *
+	 * This is what the library calls with the buffers that it gets from
+	 * the C library. The default implementation copies them into a
+	 * persistable object and calls put(), so a store can keep that object
+	 * around. A store that writes the data out right away can override
+	 * this to do so directly from the buffers, without the copy. A
+	 * persistable_view can be used to present the buffers as an
+	 * ipersistable, but the buffers are only valid until this returns.
+	 *
+	 * @param key The key
+	 * @param iov The buffers of data
+	 * @param n The number of buffers
+	 */
+	virtual void put_iov(const std::string& key, const persistence_iov* iov, size_t n);
 	/**
 	 * Remove the data for the specified key.
 	 * @param key
 	 */
 	virtual void remove(const std::string& key) =0;
+	/**
+	 * Flushes any data that the store has buffered out to stable storage.
+	 * The default implementation does nothing, which suits a store that
+	 * writes the data out as it's put.
+	 */
+	virtual void sync() {}
+	/**
+	 * Reads all of the data in the store in one go, for restoring a
+	 * session.
+	 *
+	 * The default implementation returns null, and the data is then read
+	 * one key at a time with keys() and get(). A store that can read its
+	 * data in bulk, faster than that, should override this.
+	 *
+	 * @return A snapshot of all the data in the store, or null if the
+	 *  	   store can't be read in bulk.
+	 */
+	virtual persistence_snapshot_ptr load_all() const {
+		return persistence_snapshot_ptr();
+	}
 };
 
 /** Smart/shared pointer to a persistence client */
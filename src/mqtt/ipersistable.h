@@ -134,6 +134,126 @@ using ipersistable_ptr = ipersistable::ptr_t ;
 /** Smart/shared pointer to a const persistable object */
 using const_ipersistable_ptr = ipersistable::const_ptr_t ;
 
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A persistable that holds its own copy of the data, in one contiguous
+ * buffer.
+ * The data is returned as the header, and the payload is empty, which is
+ * one of the forms in which a store can give back what was put into it.
+ */
+class persistable_buffer : public ipersistable
+{
+	/** The data */
+	const byte_buffer data_;
+
+public:
+	/**
+	 * Creates a persistable with a copy of the data.
+	 * @param data The data
+	 * @param n The number of bytes of data.
+	 */
+	persistable_buffer(const byte* data, size_t n) : data_(data, n) {}
+	/**
+	 * Creates a persistable that takes the data.
+	 * @param data The data
+	 */
+	explicit persistable_buffer(byte_buffer&& data) : data_(std::move(data)) {}
+
+	const byte* get_header_bytes() const override { return data_.data(); }
+	std::vector<byte> get_header_byte_arr() const override {
+		return std::vector<byte>(data_.begin(), data_.end());
+	}
+	size_t get_header_length() const override { return data_.size(); }
+	size_t get_header_offset() const override { return 0; }
+
+	const byte* get_payload_bytes() const override { return nullptr; }
+	std::vector<byte> get_payload_byte_arr() const override {
+		return std::vector<byte>();
+	}
+	size_t get_payload_length() const override { return 0; }
+	size_t get_payload_offset() const override { return 0; }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A reference to one buffer of data to be persisted.
+ * This is like a POSIX iovec, but for data that is only read.
+ */
+struct persistence_iov
+{
+	/** The start of the data */
+	const byte* data;
+	/** The number of bytes */
+	size_t len;
+};
+
+/**
+ * A persistable that refers to the buffers that the C library passes in
+ * to be persisted, without copying them.
+ *
+ * As with the copies that are made for iclient_persistence::put(), a
+ * single buffer is the payload, and for two buffers the first is the
+ * header and the second the payload. For more than two, they are all
+ * taken as the payload, which, as it has to be contiguous, is only
+ * assembled if it is asked for. A store that can write the pieces
+ * separately, such as with writev(), can use get_buffers() instead.
+ *
+ * The view doesn't own the buffers, which belong to the C library and
+ * are only valid for the duration of the iclient_persistence::put_iov()
+ * call. Anything that needs the data after that must copy it.
+ */
+class persistable_view : public ipersistable
+{
+	/** The buffers */
+	const persistence_iov* iov_;
+	/** The number of buffers */
+	size_t n_;
+	/** The payload, if it's assembled from more than one buffer */
+	mutable byte_buffer payload_;
+
+	/** Gets the payload when it's made up of more than one buffer */
+	const byte_buffer& assembled_payload() const;
+
+public:
+	/**
+	 * Creates a view of the buffers.
+	 * @param iov The buffers. These must outlive the view.
+	 * @param n The number of buffers.
+	 */
+	persistable_view(const persistence_iov* iov, size_t n) : iov_(iov), n_(n) {}
+	/**
+	 * Gets the buffers.
+	 * @return A pointer to the array of buffers.
+	 */
+	const persistence_iov* get_buffers() const { return iov_; }
+	/**
+	 * Gets the number of buffers.
+	 * @return The number of buffers.
+	 */
+	size_t get_buffer_count() const { return n_; }
+	/**
+	 * Gets the total length of the data in all the buffers.
+	 * @return The total length of the data.
+	 */
+	size_t get_length() const;
+
+	const byte* get_header_bytes() const override {
+		return (n_ == 2) ? iov_[0].data : nullptr;
+	}
+	std::vector<byte> get_header_byte_arr() const override;
+	size_t get_header_length() const override {
+		return (n_ == 2) ? iov_[0].len : 0;
+	}
+	size_t get_header_offset() const override { return 0; }
+
+	const byte* get_payload_bytes() const override;
+	std::vector<byte> get_payload_byte_arr() const override;
+	size_t get_payload_length() const override;
+	size_t get_payload_offset() const override { return 0; }
+};
+
 /////////////////////////////////////////////////////////////////////////////
 // end namespace mqtt
 }
@@ -0,0 +1,233 @@
+/////////////////////////////////////////////////////////////////////////////
+/// @file memory_persistence.h
+/// Declaration of MQTT memory_persistence class
+/// @date October 18, 2026
+/// @author agent
+/////////////////////////////////////////////////////////////////////////////
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_memory_persistence_h
+#define __mqtt_memory_persistence_h
+
+#include "mqtt/types.h"
+#include "mqtt/iclient_persistence.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A persistent store that keeps the data in memory, in a fixed number of
+ * fixed-size slots that are all allocated up front.
+ *
+ * This keeps the messages that are in flight, so that the client can
+ * retry them after a reconnect, without the cost of writing them to
+ * disk. The data doesn't outlive the process. Putting and removing data
+ * doesn't allocate memory; it's a hash lookup and a copy into a slot:
+ *
+ * @code
+ *   mqtt::memory_persistence store(1024);
+ *   mqtt::async_client cli(SERVER_URI, CLIENT_ID, &store);
+ * @endcode
+ *
+ * The capacity is a hard limit. A put that needs a new slot when they're
+ * all in use, or that has more data than fits in a slot, fails, which
+ * the C library reports as an error for the publish. The capacity should
+ * be at least the maximum number of messages in flight.
+ *
+ * The store doesn't use a lock. The C library serializes its calls into
+ * the store, so only one thread at a time changes it. Other threads can
+ * read it at the same time: each entry is claimed with a compare and swap
+ * while it's being read or changed, so operations on different keys never
+ * wait on each other.
+ */
+class memory_persistence : public iclient_persistence
+{
+public:
+	/** Smart/shared pointer to an object of this class. */
+	using ptr_t = std::shared_ptr<memory_persistence>;
+
+	/** The maximum length of a key */
+	static const size_t MAX_KEY_LEN = 32;
+	/** The default size of a slot */
+	static const size_t DFLT_SLOT_SIZE;
+
+private:
+	/** The states of an entry in the hash table */
+	enum entry_state : uint32_t {
+		FREE,		///< Never used since the last clear
+		DELETED,	///< Used, but the data was removed
+		BUSY,		///< Claimed by a thread that is reading or changing it
+		READY		///< Holds a key and its data
+	};
+
+	/** An entry in the hash table */
+	struct entry {
+		/** The state of the entry */
+		std::atomic<uint32_t> state;
+		/** The slot with the data */
+		uint32_t slot;
+		/** The length of the data */
+		uint32_t len;
+		/** The length of the key */
+		uint32_t keylen;
+		/** The key */
+		char key[MAX_KEY_LEN];
+	};
+
+	/** The maximum number of keys */
+	size_t capacity_;
+	/** The size of each slot */
+	size_t slotSize_;
+	/** The hash table. This is a power of two, at least twice the capacity */
+	std::unique_ptr<entry[]> table_;
+	/** The number of entries in the table, less one, to use as a mask */
+	size_t mask_;
+	/** The memory for the slots */
+	std::unique_ptr<byte[]> slab_;
+	/** The slots that are free. This is only used by the writer. */
+	std::vector<uint32_t> freeSlots_;
+	/** The number of keys in the store */
+	std::atomic<size_t> size_;
+
+	/** Gets the table index to start looking for the key */
+	size_t home(const std::string& key) const;
+	/** Determines if the entry has the key */
+	static bool matches(const entry& e, const std::string& key) {
+		return e.keylen == key.size() && key.compare(0, key.size(), e.key, e.keylen) == 0;
+	}
+	/** Gets the data for the slot */
+	byte* slot_data(uint32_t slot) const { return slab_.get() + size_t(slot)*slotSize_; }
+	/**
+	 * Claims a ready entry, waiting for any other thread that has it.
+	 * @return @em true if the entry was claimed, @em false if it's not
+	 *  	   ready (anymore).
+	 */
+	static bool claim(entry& e);
+	/** Finds the entry with the key, for the writer. */
+	entry* find(const std::string& key);
+	/**
+	 * Finds and claims the entry with the key, for a reader.
+	 * The caller must set the entry back to READY when done.
+	 */
+	entry* find_and_claim(const std::string& key) const;
+
+	/** Non-copyable */
+	memory_persistence(const memory_persistence&) =delete;
+	memory_persistence& operator=(const memory_persistence&) =delete;
+
+	friend class memory_persistence_test;
+
+public:
+	/**
+	 * Creates a store for the specified number of keys.
+	 * @param capacity The maximum number of keys (messages) in the store.
+	 * @param slotSize The size of each slot; the maximum amount of data
+	 *  			   for a key. This is the size of the largest message
+	 *  			   that can be persisted, plus its MQTT header.
+	 */
+	explicit memory_persistence(size_t capacity, size_t slotSize=DFLT_SLOT_SIZE);
+	/**
+	 * Gets the maximum number of keys that the store can hold.
+	 * @return The maximum number of keys that the store can hold.
+	 */
+	size_t capacity() const { return capacity_; }
+	/**
+	 * Gets the size of each slot.
+	 * @return The maximum amount of data for a key.
+	 */
+	size_t slot_size() const { return slotSize_; }
+	/**
+	 * Gets the number of keys in the store.
+	 * @return The number of keys in the store.
+	 */
+	size_t size() const { return size_.load(); }
+	/**
+	 * Opens the store. This does nothing, as the data is kept while the
+	 * object is alive.
+	 */
+	void open(const std::string& clientId, const std::string& serverURI) override;
+	/**
+	 * Closes the store. This does nothing, so that the data is still there
+	 * if the store is opened again.
+	 */
+	void close() override;
+	/**
+	 * Clears the store, deleting all of the data.
+	 */
+	void clear() override;
+	/**
+	 * Determines if there is data in the store for the key.
+	 * @param key The key
+	 * @return @em true if there is data for the key
+	 */
+	bool contains_key(const std::string& key) override;
+	/**
+	 * Gets a copy of the data for the key.
+	 * The data is returned as the header, and the payload is empty.
+	 * @param key The key
+	 * @return The data.
+	 * @throw persistence_exception if there's no data for the key.
+	 */
+	ipersistable_ptr get(const std::string& key) const override;
+	/**
+	 * Gets the keys of all the data in the store.
+	 * @return The keys
+	 */
+	std::vector<std::string> keys() const override;
+	/**
+	 * Puts data into the store, replacing any data that was there for the
+	 * key.
+	 * @param key The key
+	 * @param persistable The data
+	 * @throw persistence_exception if the key is too long, the data won't
+	 *  	  fit in a slot, or there are no free slots.
+	 */
+	void put(const std::string& key, ipersistable_ptr persistable) override;
+	/**
+	 * Puts data from a number of buffers into the store, copying them
+	 * straight into a slot.
+	 * @param key The key
+	 * @param iov The buffers of data
+	 * @param n The number of buffers
+	 * @throw persistence_exception if the key is too long, the data won't
+	 *  	  fit in a slot, or there are no free slots.
+	 */
+	void put_iov(const std::string& key, const persistence_iov* iov, size_t n) override;
+	/**
+	 * Removes the data for the key. This does nothing if there's no data
+	 * for the key.
+	 * @param key The key
+	 */
+	void remove(const std::string& key) override;
+};
+
+/** Smart/shared pointer to an in-memory persistence store */
+using memory_persistence_ptr = memory_persistence::ptr_t;
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		// __mqtt_memory_persistence_h
+
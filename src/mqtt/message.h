@@ -25,8 +25,12 @@
 #define __mqtt_message_h
 
 #include "MQTTAsync.h"
+#include "mqtt/types.h"
+#include "mqtt/payload_buffer.h"
 #include <string>
+#include <vector>
 #include <memory>
+#include <atomic>
 #include <stdexcept>
 
 namespace mqtt {
@@ -37,17 +41,43 @@ namespace mqtt {
  * An MQTT message holds the application payload and options specifying how
  * the message is to be delivered The message includes a "payload" (the body
  * of the message) represented as a byte array.
+ *
+ * Normally the message keeps its own copy of the payload. A message can
+ * also be made to refer to a buffer that it does not own, such as one
+ * allocated by the C library, in which case it keeps a shared reference
+ * to the owner of the buffer. The bytes of such a message can be read in
+ * place with get_payload_bytes() and get_payload_length(). A string copy
+ * is only made if get_payload() is called.
+ *
+ * A payload that the application has no further use for, like the output
+ * of a serializer, can be moved into the message rather than copied: a
+ * string is moved in as the message's own payload, while a byte vector or
+ * a unique_ptr to a byte array becomes an external buffer owned by the
+ * message.
+ *
+ * To send the same payload in many messages, make a payload_buffer from it
+ * once, and give that to each of the messages. They all refer to the one
+ * copy of the bytes.
  */
 class message
 {
 	/** The underlying C message struct */
 	MQTTAsync_message msg_;
+	/** The topic that the message was (or should be) published on */
+	std::string topic_;
 	/**
 	 * The message payload.
 	 * Note that this is not necessarily a printable text string, but rather
 	 * an arbitrary binary blob held in a std::string container.
 	 */
 	std::string payload_;
+	/**
+	 * The owner of an external payload buffer, if the message refers to
+	 * one rather than holding its own copy.
+	 */
+	std::shared_ptr<const void> payloadRef_;
+	/** A string copy of an external payload, made on demand */
+	mutable std::atomic<std::string*> payloadStr_;
 
 	/** The client has special access. */
 	friend class async_client;
@@ -57,6 +87,20 @@ class message
 	 * @param dup
 	 */
 	void set_duplicate(bool dup) { msg_.dup = (dup) ? (!0) : 0; }
+	/**
+	 * Drops any reference to an external payload buffer, along with the
+	 * string copy of it.
+	 */
+	void release_payload_ref();
+	/**
+	 * Makes the message refer to an external payload buffer.
+	 * @param owner The owner of the buffer. If this is null, or the length
+	 *  			is zero, the payload is cleared.
+	 * @param payload The payload bytes.
+	 * @param len The number of bytes in the payload.
+	 */
+	void set_payload_ref(std::shared_ptr<const void> owner,
+						 const void* payload, size_t len);
 
 public:
 	/** Smart/shared pointer to this class. */
@@ -98,11 +142,97 @@ public:
 	 * @param retained Whether the message should be retained by the broker.
 	 */
 	message(const std::string& payload, int qos, bool retained);
+	/**
+	 * Constructs a message that takes the string as its payload, without
+	 * copying it, and all other values set to defaults.
+	 * @param payload A string to move into the message as the payload.
+	 */
+	explicit message(std::string&& payload);
+	/**
+	 * Constructs a message that takes the string as its payload, without
+	 * copying it.
+	 * @param payload A string to move into the message as the payload.
+	 * @param qos The quality of service for the message.
+	 * @param retained Whether the message should be retained by the broker.
+	 */
+	message(std::string&& payload, int qos, bool retained);
+	/**
+	 * Constructs a message that takes ownership of the vector's buffer as
+	 * its payload, without copying it, and all other values set to
+	 * defaults.
+	 * @param payload A vector to move into the message as the payload.
+	 */
+	explicit message(std::vector<byte>&& payload);
+	/**
+	 * Constructs a message that takes ownership of the vector's buffer as
+	 * its payload, without copying it.
+	 * @param payload A vector to move into the message as the payload.
+	 * @param qos The quality of service for the message.
+	 * @param retained Whether the message should be retained by the broker.
+	 */
+	message(std::vector<byte>&& payload, int qos, bool retained);
+	/**
+	 * Constructs a message that takes ownership of a byte array as its
+	 * payload, without copying it, and all other values set to defaults.
+	 * The array is released with its deleter when the message, and any
+	 * copies of it, are gone.
+	 * @param payload The array to use as the payload. The deleter must be
+	 *  			  copyable.
+	 * @param len The number of bytes in the payload.
+	 */
+	template <typename Deleter>
+	message(std::unique_ptr<byte[],Deleter>&& payload, size_t len)
+			: msg_(MQTTAsync_message_initializer), payloadStr_(nullptr) {
+		set_payload(std::move(payload), len);
+	}
+	/**
+	 * Constructs a message that takes ownership of a byte array as its
+	 * payload, without copying it.
+	 * @param payload The array to use as the payload. The deleter must be
+	 *  			  copyable.
+	 * @param len The number of bytes in the payload.
+	 * @param qos The quality of service for the message.
+	 * @param retained Whether the message should be retained by the broker.
+	 */
+	template <typename Deleter>
+	message(std::unique_ptr<byte[],Deleter>&& payload, size_t len,
+			int qos, bool retained)
+			: msg_(MQTTAsync_message_initializer), payloadStr_(nullptr) {
+		set_payload(std::move(payload), len);
+		set_qos(qos);
+		set_retained(retained);
+	}
+	/**
+	 * Constructs a message that refers to a shared payload buffer, without
+	 * copying it, and all other values set to defaults.
+	 * @param payload The buffer to use as the payload.
+	 */
+	explicit message(const payload_buffer& payload);
+	/**
+	 * Constructs a message that refers to a shared payload buffer, without
+	 * copying it.
+	 * @param payload The buffer to use as the payload.
+	 * @param qos The quality of service for the message.
+	 * @param retained Whether the message should be retained by the broker.
+	 */
+	message(const payload_buffer& payload, int qos, bool retained);
 	/**
 	 * Constructs a message as a copy of the message structure.
 	 * @param msg A "C" MQTTAsync_message structure.
 	 */
 	message(const MQTTAsync_message& msg);
+	/**
+	 * Constructs a message that refers to the payload of the message
+	 * structure without copying it.
+	 * The payload buffer must remain valid for as long as the owner is
+	 * alive. The message, and any copies of it, keep a reference to the
+	 * owner.
+	 * @param msg A "C" MQTTAsync_message structure.
+	 * @param owner The object that owns the payload buffer. If this is
+	 *  			null, the payload is copied, as with the other
+	 *  			constructors.
+	 */
+	message(const MQTTAsync_message& msg, std::shared_ptr<const void> owner);
 	/**
 	 * Constructs a message as a copy of the other message.
 	 * @param other The message to copy into this one.
@@ -134,9 +264,48 @@ public:
 	 */
 	void clear_payload();
 	/**
-	 * Gets the payload
+	 * Gets the topic for the message.
+	 * For an incoming message, this is the topic that it was published
+	 * on.
+	 * @return The topic string for the message.
+	 */
+	const std::string& get_topic() const { return topic_; }
+	/**
+	 * Sets the topic for the message.
+	 * @param topic The topic string for the message.
+	 */
+	void set_topic(const std::string& topic) { topic_ = topic; }
+	/**
+	 * Sets the topic for the message.
+	 * @param topic The topic string for the message.
 	 */
-	const std::string& get_payload() const { return payload_; }
+	void set_topic(std::string&& topic) { topic_ = std::move(topic); }
+	/**
+	 * Gets the payload.
+	 * If the message refers to an external buffer, the first call makes a
+	 * string copy of it.
+	 * @return The payload as a string.
+	 */
+	const std::string& get_payload() const;
+	/**
+	 * Gets the payload bytes without making a copy of them.
+	 * @return A pointer to the payload bytes. This is only valid for as
+	 *  	   long as the message is alive and unmodified.
+	 */
+	const byte* get_payload_bytes() const {
+		return static_cast<const byte*>(msg_.payload);
+	}
+	/**
+	 * Gets the size of the payload.
+	 * @return The number of bytes in the payload.
+	 */
+	size_t get_payload_length() const { return size_t(msg_.payloadlen); }
+	/**
+	 * Determines if the message refers to an external payload buffer,
+	 * rather than holding its own copy of the payload.
+	 * @return @em true if the payload is held in an external buffer.
+	 */
+	bool is_payload_shared() const { return bool(payloadRef_); }
 	/**
 	 * Returns the quality of service for this message.
 	 * @return The quality of service for this message.
@@ -167,6 +336,45 @@ public:
 	 * @param payload A string to use as the message payload.
 	 */
 	void set_payload(const std::string& payload);
+	/**
+	 * Sets the payload of this message to be the specified string, moving
+	 * it into the message without a copy.
+	 * @param payload A string to use as the message payload.
+	 */
+	void set_payload(std::string&& payload);
+	/**
+	 * Sets the payload of this message to be the buffer of the specified
+	 * vector, which the message takes without a copy.
+	 * @param payload A vector to use as the message payload.
+	 */
+	void set_payload(std::vector<byte>&& payload);
+	/**
+	 * Sets the payload of this message to refer to a shared payload
+	 * buffer, without copying it.
+	 * @param payload The buffer to use as the payload.
+	 */
+	void set_payload(const payload_buffer& payload) {
+		set_payload_ref(payload.owner_, payload.data(), payload.size());
+	}
+	/**
+	 * Sets the payload of this message to be the specified byte array,
+	 * which the message takes without a copy. The array is released with
+	 * its deleter when the message, and any copies of it, are gone.
+	 * @param payload The array to use as the payload. The deleter must be
+	 *  			  copyable.
+	 * @param n The number of bytes in the payload.
+	 */
+	template <typename Deleter>
+	void set_payload(std::unique_ptr<byte[],Deleter>&& payload, size_t n) {
+		const byte* p = payload.get();
+		if (!p) {
+			clear_payload();
+			return;
+		}
+		// If making the owner fails, it deletes the array.
+		std::shared_ptr<const void> owner(payload.release(), payload.get_deleter());
+		set_payload_ref(std::move(owner), p, n);
+	}
 	/**
 	 * Sets the quality of service for this message.
 	 * @param qos The integer Quality of Service for the message
@@ -246,6 +454,91 @@ inline message_ptr make_message(const std::string& payload, int qos, bool retain
 	return std::make_shared<mqtt::message>(payload, qos, retained);
 }
 
+/**
+ * Constructs a message that takes the string as its payload, without
+ * copying it, and all other values set to defaults.
+ * @param payload A string to move into the message as the payload.
+ */
+inline message_ptr make_message(std::string&& payload) {
+	return std::make_shared<mqtt::message>(std::move(payload));
+}
+
+/**
+ * Constructs a message that takes the string as its payload, without
+ * copying it.
+ * @param payload A string to move into the message as the payload.
+ * @param qos The quality of service for the message.
+ * @param retained Whether the message should be retained by the broker.
+ */
+inline message_ptr make_message(std::string&& payload, int qos, bool retained) {
+	return std::make_shared<mqtt::message>(std::move(payload), qos, retained);
+}
+
+/**
+ * Constructs a message that takes ownership of the vector's buffer as its
+ * payload, without copying it, and all other values set to defaults.
+ * @param payload A vector to move into the message as the payload.
+ */
+inline message_ptr make_message(std::vector<byte>&& payload) {
+	return std::make_shared<mqtt::message>(std::move(payload));
+}
+
+/**
+ * Constructs a message that takes ownership of the vector's buffer as its
+ * payload, without copying it.
+ * @param payload A vector to move into the message as the payload.
+ * @param qos The quality of service for the message.
+ * @param retained Whether the message should be retained by the broker.
+ */
+inline message_ptr make_message(std::vector<byte>&& payload, int qos, bool retained) {
+	return std::make_shared<mqtt::message>(std::move(payload), qos, retained);
+}
+
+/**
+ * Constructs a message that refers to a shared payload buffer, without
+ * copying it, and all other values set to defaults.
+ * @param payload The buffer to use as the payload.
+ */
+inline message_ptr make_message(const payload_buffer& payload) {
+	return std::make_shared<mqtt::message>(payload);
+}
+
+/**
+ * Constructs a message that refers to a shared payload buffer, without
+ * copying it.
+ * @param payload The buffer to use as the payload.
+ * @param qos The quality of service for the message.
+ * @param retained Whether the message should be retained by the broker.
+ */
+inline message_ptr make_message(const payload_buffer& payload, int qos, bool retained) {
+	return std::make_shared<mqtt::message>(payload, qos, retained);
+}
+
+/**
+ * Constructs a message that takes ownership of a byte array as its
+ * payload, without copying it, and all other values set to defaults.
+ * @param payload The array to use as the payload.
+ * @param len The number of bytes in the payload.
+ */
+template <typename Deleter>
+message_ptr make_message(std::unique_ptr<byte[],Deleter>&& payload, size_t len) {
+	return std::make_shared<mqtt::message>(std::move(payload), len);
+}
+
+/**
+ * Constructs a message that takes ownership of a byte array as its
+ * payload, without copying it.
+ * @param payload The array to use as the payload.
+ * @param len The number of bytes in the payload.
+ * @param qos The quality of service for the message.
+ * @param retained Whether the message should be retained by the broker.
+ */
+template <typename Deleter>
+message_ptr make_message(std::unique_ptr<byte[],Deleter>&& payload, size_t len,
+						 int qos, bool retained) {
+	return std::make_shared<mqtt::message>(std::move(payload), len, qos, retained);
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // end namespace mqtt
 }
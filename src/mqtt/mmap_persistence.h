@@ -0,0 +1,316 @@
+/////////////////////////////////////////////////////////////////////////////
+/// @file mmap_persistence.h
+/// Declaration of MQTT mmap_persistence class
+/// @date October 18, 2026
+/// @author agent
+/////////////////////////////////////////////////////////////////////////////
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_mmap_persistence_h
+#define __mqtt_mmap_persistence_h
+
+#include "mqtt/types.h"
+#include "mqtt/iclient_persistence.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A persistent store that keeps the data in an append-only log of
+ * memory-mapped segment files.
+ *
+ * The default persistence of the C library writes each message to a file
+ * of its own, so every QoS 1 or 2 publish costs a file create, write, and
+ * close, and every acknowledgment a delete. This store instead appends
+ * each put, and a small tombstone record for each remove, to the end of
+ * a fixed-size segment file that is mapped into memory, so the common
+ * operations are a memory copy and a lookup in an in-memory index of the
+ * keys. No file system metadata is touched until a segment fills up.
+ *
+ * When the active segment is full a new one is started. The oldest
+ * segments are reclaimed as they go: one that holds no live data is
+ * dropped, and one that is no more than a quarter live has its few live
+ * records copied forward to the active segment first. Any later segment
+ * that holds no live data at all is dropped too, after its tombstones are
+ * copied forward, so a long-lived message in an old segment doesn't pin
+ * the ones behind it. One dropped segment is kept, still mapped, to be
+ * reused as the next new one.
+ *
+ * A segment that is partly live is only reclaimed once it reaches the
+ * front, and the front one only once it's no more than a quarter live. So
+ * messages that stay unacknowledged for a long time each keep their
+ * segment on disk, and the log can grow well past the live data if many
+ * of them are spread across the segments. As messages are normally
+ * acknowledged in about the order they were sent, the log stays down to
+ * a few segments.
+ *
+ * By default the store doesn't flush the data to the disk itself, but
+ * leaves that to the operating system, which gives the same guarantee as
+ * the C library's file store: the data survives a crash of the
+ * application, but not necessarily of the system. For more than that,
+ * the data can be synced to the disk after a number of records and/or
+ * after an interval of time. Either way the writes are grouped so that
+ * one sync covers all of the records written since the last one.
+ *
+ * The records are checksummed so that a record that was only partly
+ * written when the system went down is detected and dropped when the
+ * store is opened again.
+ *
+ * The files are in host byte order, and so aren't portable between
+ * machines of different architectures. This is only available on POSIX
+ * systems.
+ */
+class mmap_persistence : public iclient_persistence
+{
+public:
+	/** Smart/shared pointer to an object of this class. */
+	using ptr_t = std::shared_ptr<mmap_persistence>;
+
+	/** The default size of a segment file */
+	static const size_t DFLT_SEGMENT_SIZE;
+
+private:
+	/** Lock guard type for this class */
+	using guard = std::unique_lock<std::mutex>;
+	/** The clock used for the sync interval */
+	using clock = std::chrono::steady_clock;
+
+	/** A memory-mapped segment file */
+	struct segment {
+		/** The path to the file */
+		std::string path;
+		/** The start of the mapped file */
+		byte* base;
+		/** The size of the file */
+		size_t size;
+		/** The offset just past the last record */
+		size_t used;
+		/** The number of bytes of records that are still current */
+		size_t live;
+		/** The offset up to which the data has been synced */
+		size_t synced;
+	};
+
+	/** The location of the record for a key */
+	struct location {
+		/** The ID of the segment that holds the record */
+		uint32_t seg;
+		/** The offset of the record in the segment */
+		uint32_t off;
+	};
+
+	/** Object monitor mutex */
+	mutable std::mutex lock_;
+	/** The directory for the stores */
+	std::string dir_;
+	/** The directory of the open store */
+	std::string path_;
+	/** The nominal size of a segment file */
+	size_t segSize_;
+	/** The segments, by ID, oldest first. The last one is the active one */
+	std::map<uint32_t, segment> segs_;
+	/** A dead segment that is kept, still mapped, to be reused */
+	segment spare_;
+	/** The location of the current record for each key */
+	std::unordered_map<std::string, location> index_;
+	/** The number of records to write between syncs (0 for no limit) */
+	size_t syncRecords_;
+	/** The time between syncs (0 for no limit) */
+	std::chrono::milliseconds syncInterval_;
+	/** The number of records written since the last sync */
+	size_t nunsynced_;
+	/** The time of the last sync */
+	clock::time_point lastSync_;
+
+	/** Determines if a sync policy is in effect */
+	bool syncing() const {
+		return syncRecords_ != 0 || syncInterval_.count() != 0;
+	}
+
+	/** Creates a new, empty, segment with the ID, at least 'n' bytes long */
+	segment& create_segment(uint32_t id, size_t n);
+	/** Maps an existing segment and adds its records to the index */
+	void load_segment(uint32_t id, const std::string& path, bool last);
+	/** Unmaps and closes the segment, optionally deleting the file */
+	void close_segment(segment& seg, bool unlink);
+	/** Gets rid of a dead segment, keeping it as the spare if there's none */
+	void drop_segment(segment& seg);
+	/** Gets the active segment */
+	segment& active() { return segs_.rbegin()->second; }
+	/**
+	 * Gets space for a record of 'n' bytes at the end of the log, starting
+	 * a new segment if the active one doesn't have room.
+	 * @return @em true if a new segment was started.
+	 */
+	bool reserve(size_t n);
+	/** Points the key at its new record, retiring the old one */
+	void update_index(const std::string& key, uint32_t seg, uint32_t off);
+	/** Removes the key from the index, retiring its record */
+	void retire(const std::string& key);
+	/** Gets the size of the record at the location */
+	size_t record_size(const location& loc) const;
+	/**
+	 * Copies the record at the offset in the segment to the end of the
+	 * log. If it's a put, the key is pointed at the copy.
+	 */
+	void copy_forward(uint32_t id, size_t off);
+	/** Reclaims old segments that are mostly dead, then drop_dead() */
+	void compact_front();
+	/** Drops the segments behind the front that have no live data */
+	void drop_dead();
+	/** Syncs the data if the policy calls for it */
+	void written();
+	/** Syncs all of the unsynced data to the disk */
+	void sync_all();
+	/** Syncs the directory, after files are created or deleted */
+	void sync_dir();
+	/** Unmaps all the segments and clears the index */
+	void close_all();
+
+	/** Non-copyable */
+	mmap_persistence(const mmap_persistence&) =delete;
+	mmap_persistence& operator=(const mmap_persistence&) =delete;
+
+	friend class mmap_persistence_test;
+
+public:
+	/**
+	 * Creates a store that keeps its files under the specified directory.
+	 * Each client gets a subdirectory named from its client ID and server
+	 * URI.
+	 * @param dir The directory for the files. It is created if it doesn't
+	 *  		  exist.
+	 * @param segSize The size of the segment files. This is rounded up to
+	 *  			  a whole number of memory pages.
+	 */
+	explicit mmap_persistence(const std::string& dir,
+							  size_t segSize=DFLT_SEGMENT_SIZE);
+	/**
+	 * Destructor closes the store, if it's open.
+	 */
+	~mmap_persistence() override;
+	/**
+	 * Sets the store to sync the data to disk after the specified number
+	 * of records are written.
+	 * @param n The number of records between syncs, or zero to not sync
+	 *  		on the number of records.
+	 */
+	void set_sync_records(size_t n);
+	/**
+	 * Sets the store to sync the data to disk when the specified time has
+	 * passed since the last sync. This is checked when records are
+	 * written, so it's an upper limit on how long the data stays unsynced
+	 * as long as there is traffic.
+	 * @param interval The time between syncs, or zero to not sync on time.
+	 */
+	void set_sync_interval(const std::chrono::milliseconds& interval);
+	/**
+	 * Syncs all of the data that has been written to the disk.
+	 */
+	void sync() override;
+	/**
+	 * Gets the number of segment files in use.
+	 * @return The number of segment files in use.
+	 */
+	size_t num_segments() const;
+	/**
+	 * Opens the store for the client, recovering any data that is in it
+	 * from a previous session.
+	 * @param clientId The client ID
+	 * @param serverURI The URI of the server
+	 * @throw persistence_exception if the files can't be created or read.
+	 */
+	void open(const std::string& clientId, const std::string& serverURI) override;
+	/**
+	 * Closes the store.
+	 */
+	void close() override;
+	/**
+	 * Clears the store, deleting all of the data.
+	 */
+	void clear() override;
+	/**
+	 * Determines if there is data in the store for the key.
+	 * @param key The key
+	 * @return @em true if there is data for the key
+	 */
+	bool contains_key(const std::string& key) override;
+	/**
+	 * Gets a copy of the data for the key.
+	 * The header and payload that were put are returned contiguously as
+	 * the header, and the payload is empty.
+	 * @param key The key
+	 * @return The data.
+	 * @throw persistence_exception if there's no data for the key.
+	 */
+	ipersistable_ptr get(const std::string& key) const override;
+	/**
+	 * Gets the keys of all the data in the store.
+	 * @return The keys
+	 */
+	std::vector<std::string> keys() const override;
+	/**
+	 * Reads all of the data in the store, for restoring a session.
+	 * The records are copied out of the files in the order they were
+	 * written, and when there's a lot of data, the copying is split up
+	 * between a few threads, so that the disk is read in parallel.
+	 * @return A snapshot of all the data in the store.
+	 */
+	persistence_snapshot_ptr load_all() const override;
+	/**
+	 * Puts data into the store, replacing any data that was there for the
+	 * key.
+	 * @param key The key
+	 * @param persistable The data
+	 * @throw persistence_exception if the data can't be written.
+	 */
+	void put(const std::string& key, ipersistable_ptr persistable) override;
+	/**
+	 * Puts data from a number of buffers into the store, copying them
+	 * straight into the log.
+	 * @param key The key
+	 * @param iov The buffers of data
+	 * @param n The number of buffers
+	 * @throw persistence_exception if the data can't be written.
+	 */
+	void put_iov(const std::string& key, const persistence_iov* iov, size_t n) override;
+	/**
+	 * Removes the data for the key. This does nothing if there's no data
+	 * for the key.
+	 * @param key The key
+	 */
+	void remove(const std::string& key) override;
+};
+
+/** Smart/shared pointer to a memory-mapped persistence store */
+using mmap_persistence_ptr = mmap_persistence::ptr_t;
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		// __mqtt_mmap_persistence_h
+
@@ -0,0 +1,167 @@
+/////////////////////////////////////////////////////////////////////////////
+/// @file payload_buffer.h
+/// Declaration of MQTT payload_buffer class
+/// @date October 18, 2026
+/// @author agent
+/////////////////////////////////////////////////////////////////////////////
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_payload_buffer_h
+#define __mqtt_payload_buffer_h
+
+#include "mqtt/types.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+
+namespace mqtt {
+
+class message;
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A reference-counted, immutable buffer for a message payload.
+ *
+ * Copies of a buffer refer to the same bytes, so the payload can be given
+ * to any number of messages, and the delivery tokens that hold them,
+ * with a single allocation. This is meant for sending the same, possibly
+ * large, payload to many topics, as with async_client::publish_fanout().
+ *
+ * The bytes are freed when the last buffer and message that refer to them
+ * are gone. They must not be changed while any of them are alive.
+ */
+class payload_buffer
+{
+	/** The object that owns the bytes */
+	std::shared_ptr<const void> owner_;
+	/** The bytes */
+	const byte* data_;
+	/** The number of bytes */
+	size_t size_;
+
+	/** Messages refer to the owner directly. */
+	friend class message;
+
+	/**
+	 * Makes a buffer that holds a string.
+	 * @param str The string, which becomes the owner.
+	 */
+	void adopt(std::shared_ptr<const std::string> str) {
+		data_ = reinterpret_cast<const byte*>(str->data());
+		size_ = str->size();
+		owner_ = std::move(str);
+	}
+
+public:
+	/**
+	 * Creates an empty buffer.
+	 */
+	payload_buffer() : data_(nullptr), size_(0) {}
+	/**
+	 * Creates a buffer with a copy of the bytes.
+	 * @param data The bytes to copy.
+	 * @param n The number of bytes.
+	 */
+	payload_buffer(const void* data, size_t n) : data_(nullptr), size_(0) {
+		if (n > 0)
+			adopt(std::make_shared<const std::string>(static_cast<const char*>(data), n));
+	}
+	/**
+	 * Creates a buffer with a copy of the string.
+	 * @param str The string to copy.
+	 */
+	explicit payload_buffer(const std::string& str) : data_(nullptr), size_(0) {
+		if (!str.empty())
+			adopt(std::make_shared<const std::string>(str));
+	}
+	/**
+	 * Creates a buffer that takes over the string, without a copy.
+	 * @param str The string to move into the buffer.
+	 */
+	explicit payload_buffer(std::string&& str) : data_(nullptr), size_(0) {
+		if (!str.empty())
+			adopt(std::make_shared<const std::string>(std::move(str)));
+	}
+	/**
+	 * Creates a buffer that takes over the vector's bytes, without a copy.
+	 * @param vec The vector to move into the buffer.
+	 */
+	explicit payload_buffer(std::vector<byte>&& vec) : data_(nullptr), size_(0) {
+		if (!vec.empty()) {
+			auto p = std::make_shared<const std::vector<byte>>(std::move(vec));
+			data_ = p->data();
+			size_ = p->size();
+			owner_ = std::move(p);
+		}
+	}
+	/**
+	 * Creates a buffer that takes over a byte array, without a copy. The
+	 * array is released with its deleter when the last reference to it is
+	 * gone.
+	 * @param buf The array. The deleter must be copyable.
+	 * @param n The number of bytes in the array.
+	 */
+	template <typename Deleter>
+	payload_buffer(std::unique_ptr<byte[],Deleter>&& buf, size_t n)
+			: data_(nullptr), size_(0) {
+		if (buf && n > 0) {
+			data_ = buf.get();
+			size_ = n;
+			owner_ = std::shared_ptr<const void>(buf.release(), buf.get_deleter());
+		}
+	}
+	/**
+	 * Gets a pointer to the bytes.
+	 * @return A pointer to the bytes, or @em nullptr if the buffer is
+	 *  	   empty.
+	 */
+	const byte* data() const { return data_; }
+	/**
+	 * Gets the number of bytes in the buffer.
+	 * @return The number of bytes in the buffer.
+	 */
+	size_t size() const { return size_; }
+	/**
+	 * Determines if the buffer is empty.
+	 * @return @em true if the buffer has no bytes.
+	 */
+	bool empty() const { return size_ == 0; }
+	/**
+	 * Gets the number of buffers and messages that share the bytes.
+	 * @return The number of references to the bytes, or zero if the buffer
+	 *  	   is empty.
+	 */
+	long use_count() const { return owner_.use_count(); }
+	/**
+	 * Gets a copy of the bytes as a string.
+	 * @return A copy of the bytes as a string.
+	 */
+	std::string to_string() const {
+		return empty() ? std::string()
+			: std::string(reinterpret_cast<const char*>(data_), size_);
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		// __mqtt_payload_buffer_h
+
@@ -0,0 +1,189 @@
+/////////////////////////////////////////////////////////////////////////////
+/// @file publish_credit.h
+/// Declaration of MQTT publish_credit class
+/// @date October 18, 2026
+/// @author agent
+/////////////////////////////////////////////////////////////////////////////
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_publish_credit_h
+#define __mqtt_publish_credit_h
+
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstddef>
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The budget for the messages that a client has in flight.
+ *
+ * Each message that is published takes credit for one message and for the
+ * size of its payload, and gives it back when it completes. The budget can
+ * be limited by the number of messages, the number of bytes, or both. A
+ * limit of zero means there is no limit.
+ *
+ * A message that is larger than the byte limit on its own can still be
+ * sent when nothing else is in flight, so that it doesn't wait forever.
+ *
+ * The object is thread-safe.
+ */
+class publish_credit
+{
+	/** Lock guard type for this class */
+	using guard = std::unique_lock<std::mutex>;
+
+	/** Object monitor mutex */
+	mutable std::mutex lock_;
+	/** Signaled when credit is returned */
+	std::condition_variable cond_;
+	/** The most messages in flight (0 for no limit) */
+	size_t maxMsgs_;
+	/** The most payload bytes in flight (0 for no limit) */
+	size_t maxBytes_;
+	/** The number of messages in flight */
+	size_t msgs_;
+	/** The number of payload bytes in flight */
+	size_t bytes_;
+	/** The number of threads waiting for credit */
+	size_t nwaiting_;
+	/** Set when a request was refused, until there's credit again */
+	bool refused_;
+
+	/** Determines if there's credit for a message. The lock must be held. */
+	bool fits(size_t n) const {
+		return msgs_ == 0 || ((maxMsgs_ == 0 || msgs_ < maxMsgs_)
+								&& (maxBytes_ == 0 || bytes_ + n <= maxBytes_));
+	}
+	/** Takes the credit for a message. The lock must be held. */
+	void take(size_t n) { ++msgs_; bytes_ += n; }
+	/**
+	 * Wakes up anyone waiting for credit.
+	 * @param g The guard, which shows that the lock is held.
+	 * @return @em true if a request was refused since the last time this
+	 *  	   returned true, and there's now room for another message.
+	 */
+	bool credit_returned(guard& g);
+
+	/** Non-copyable */
+	publish_credit(const publish_credit&) =delete;
+	publish_credit& operator=(const publish_credit&) =delete;
+
+public:
+	/**
+	 * Creates a budget.
+	 * @param maxMsgs The most messages in flight, or zero for no limit.
+	 * @param maxBytes The most payload bytes in flight, or zero for no
+	 *  			   limit.
+	 */
+	explicit publish_credit(size_t maxMsgs=0, size_t maxBytes=0);
+	/**
+	 * Sets the limits of the budget.
+	 * This doesn't affect the messages that are already in flight.
+	 * @param maxMsgs The most messages in flight, or zero for no limit.
+	 * @param maxBytes The most payload bytes in flight, or zero for no
+	 *  			   limit.
+	 * @return @em true if a request was refused, and the new limits have
+	 *  	   room for another message.
+	 */
+	bool set_limits(size_t maxMsgs, size_t maxBytes);
+	/**
+	 * Gets the most messages that can be in flight.
+	 * @return The message limit, or zero if there is none.
+	 */
+	size_t max_messages() const {
+		guard g(lock_);
+		return maxMsgs_;
+	}
+	/**
+	 * Gets the most payload bytes that can be in flight.
+	 * @return The byte limit, or zero if there is none.
+	 */
+	size_t max_bytes() const {
+		guard g(lock_);
+		return maxBytes_;
+	}
+	/**
+	 * Gets the number of messages in flight.
+	 * @return The number of messages in flight.
+	 */
+	size_t messages() const {
+		guard g(lock_);
+		return msgs_;
+	}
+	/**
+	 * Gets the number of payload bytes in flight.
+	 * @return The number of payload bytes in flight.
+	 */
+	size_t bytes() const {
+		guard g(lock_);
+		return bytes_;
+	}
+	/**
+	 * Takes credit for a message, if there is enough.
+	 * @param n The size of the message payload.
+	 * @return @em true if the credit was taken, @em false if there isn't
+	 *  	   enough.
+	 */
+	bool try_acquire(size_t n);
+	/**
+	 * Takes credit for a message, waiting for it if there isn't enough.
+	 * @param n The size of the message payload.
+	 */
+	void acquire(size_t n);
+	/**
+	 * Takes credit for a message, waiting up to the specified time for it
+	 * if there isn't enough.
+	 * @param n The size of the message payload.
+	 * @param relTime The longest time to wait.
+	 * @return @em true if the credit was taken, @em false on a timeout.
+	 */
+	template <typename Rep, class Period>
+	bool try_acquire_for(size_t n, const std::chrono::duration<Rep,Period>& relTime) {
+		guard g(lock_);
+		if (!fits(n)) {
+			++nwaiting_;
+			bool ok = cond_.wait_for(g, relTime, [this,n] { return fits(n); });
+			--nwaiting_;
+			if (!ok) {
+				refused_ = true;
+				return false;
+			}
+		}
+		take(n);
+		return true;
+	}
+	/**
+	 * Gives back the credit for a message that completed, or that couldn't
+	 * be sent.
+	 * @param n The size of the message payload.
+	 * @return @em true if a request was refused since the last time this
+	 *  	   returned true, and there's now room for another message.
+	 */
+	bool release(size_t n);
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		// __mqtt_publish_credit_h
+
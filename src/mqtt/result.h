@@ -0,0 +1,127 @@
+/////////////////////////////////////////////////////////////////////////////
+/// @file result.h
+/// Declaration of MQTT result class
+/// @date October 18, 2026
+/// @author agent
+/////////////////////////////////////////////////////////////////////////////
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_result_h
+#define __mqtt_result_h
+
+#include "MQTTAsync.h"
+#include "mqtt/exception.h"
+#include <utility>
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The outcome of an operation that reports errors without throwing: either
+ * a value, or the error code from the C library.
+ *
+ * This is returned by the calls that take a std::nothrow argument, for
+ * code that expects to see errors often and doesn't want to pay to throw
+ * and catch them:
+ *
+ * @code
+ *   auto res = cli.publish(std::nothrow, TOPIC, msg);
+ *   if (!res)
+ *       shed_load(res.error());
+ *   else
+ *       track(*res);
+ * @endcode
+ *
+ * @tparam T The type of the value. It must be default constructible,
+ *  		 which the smart pointers returned by the library are.
+ */
+template <typename T>
+class result
+{
+	/** The value, if the operation succeeded */
+	T val_;
+	/** The error code, or MQTTASYNC_SUCCESS */
+	int rc_;
+
+	/** Creates an error result */
+	result() : val_(), rc_(MQTTASYNC_FAILURE) {}
+
+public:
+	/** The type of the value */
+	using value_type = T;
+
+	/**
+	 * Creates a result for an operation that succeeded.
+	 * @param val The value.
+	 */
+	result(T val) : val_(std::move(val)), rc_(MQTTASYNC_SUCCESS) {}
+	/**
+	 * Creates a result for an operation that failed.
+	 * @param rc The error code from the C library.
+	 * @return The result.
+	 */
+	static result failure(int rc) {
+		result res;
+		res.rc_ = rc;
+		return res;
+	}
+	/**
+	 * Determines if the operation succeeded.
+	 * @return @em true if there's a value.
+	 */
+	bool has_value() const noexcept { return rc_ == MQTTASYNC_SUCCESS; }
+	/**
+	 * Determines if the operation succeeded.
+	 * @return @em true if there's a value.
+	 */
+	explicit operator bool() const noexcept { return has_value(); }
+	/**
+	 * Gets the error code.
+	 * @return The error code from the C library, or MQTTASYNC_SUCCESS if
+	 *  	   the operation succeeded.
+	 */
+	int error() const noexcept { return rc_; }
+	/**
+	 * Gets the value, throwing the error if there isn't one.
+	 * @return The value.
+	 * @throw exception if the operation failed.
+	 */
+	const T& value() const {
+		if (rc_ != MQTTASYNC_SUCCESS)
+			throw exception(rc_);
+		return val_;
+	}
+	/**
+	 * Gets the value. This must only be called if there is one.
+	 * @return The value.
+	 */
+	const T& operator*() const noexcept { return val_; }
+	/**
+	 * Gets the value. This must only be called if there is one.
+	 * @return A pointer to the value.
+	 */
+	const T* operator->() const noexcept { return &val_; }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		// __mqtt_result_h
+
@@ -0,0 +1,292 @@
+/////////////////////////////////////////////////////////////////////////////
+/// @file thread_queue.h
+/// Implementation of the template class 'thread_queue', a thread-safe,
+/// blocking queue for passing data between threads, safe for use with smart
+/// pointers.
+/// @date October 18, 2026
+/// @author agent
+/////////////////////////////////////////////////////////////////////////////
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_thread_queue_h
+#define __mqtt_thread_queue_h
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <limits>
+#include <deque>
+#include <queue>
+#include <algorithm>
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A thread-safe queue for inter-thread communication.
+ *
+ * This is a locking queue with blocking operations. The get() operations
+ * can always block on an empty queue, but have variations for non-blocking
+ * (try_get) and bounded-time blocking (try_get_for).
+ *
+ * The queue has a capacity. If the number of items in the queue reaches
+ * the capacity, the put() operation blocks until an item is removed. The
+ * try_put() and try_put_for() variations fail or give up rather than
+ * blocking indefinitely. The capacity defaults to "unlimited", i.e. the
+ * maximum value of the size type.
+ *
+ * @tparam T The type of the items to be held in the queue.
+ * @tparam Container The type of the underlying container to use. It must
+ *  				 support back(), front(), push_back(), pop_front().
+ */
+template <typename T, class Container=std::deque<T>>
+class thread_queue
+{
+public:
+	/** The underlying container type to use for the queue. */
+	using container_type = Container;
+	/** The type of items to be held in the queue. */
+	using value_type = T;
+	/** The type used to specify number of items in the container. */
+	using size_type = typename Container::size_type;
+
+private:
+	/** Lock guard type for this class */
+	using guard = std::unique_lock<std::mutex>;
+
+	/** Object lock */
+	mutable std::mutex lock_;
+	/** Condition get signaled when item added to empty queue */
+	std::condition_variable notEmptyCond_;
+	/** Condition gets signaled then item removed from full queue */
+	std::condition_variable notFullCond_;
+	/** The capacity of the queue */
+	size_type cap_;
+	/** The actual STL container to hold data */
+	std::queue<T,Container> que_;
+
+public:
+	/**
+	 * Constructs a queue with the maximum capacity.
+	 * This is essentially an unbounded queue.
+	 */
+	thread_queue() : cap_(std::numeric_limits<size_type>::max()) {}
+	/**
+	 * Constructs a queue with the specified capacity.
+	 * This is a bounded queue.
+	 * @param cap The maximum number of items that can be placed in the
+	 *  		  queue. The minimum capacity is 1.
+	 */
+	explicit thread_queue(size_t cap) : cap_(std::max<size_type>(cap, 1)) {}
+	/**
+	 * Determine if the queue is empty.
+	 * @return @em true if there are no elements in the queue, @em false if
+	 *  	   there are any items in the queue.
+	 */
+	bool empty() const {
+		guard g(lock_);
+		return que_.empty();
+	}
+	/**
+	 * Gets the capacity of the queue.
+	 * @return The maximum number of elements before the queue is full.
+	 */
+	size_type capacity() const {
+		guard g(lock_);
+		return cap_;
+	}
+	/**
+	 * Sets the capacity of the queue.
+	 * Note that the capacity can be set to a value smaller than the current
+	 * size of the queue. In that event, all calls to put() will block until
+	 * a sufficient number of items are removed.
+	 * @param cap The new capacity. The minimum capacity is 1.
+	 */
+	void capacity(size_type cap) {
+		guard g(lock_);
+		cap_ = std::max<size_type>(cap, 1);
+		g.unlock();
+		notFullCond_.notify_all();
+	}
+	/**
+	 * Gets the number of items in the queue.
+	 * @return The number of items in the queue.
+	 */
+	size_type size() const {
+		guard g(lock_);
+		return que_.size();
+	}
+	/**
+	 * Put an item into the queue.
+	 * If the queue is full, this will block the caller until items are
+	 * removed bringing the size less than the capacity.
+	 * @param val The value to add to the queue.
+	 */
+	void put(value_type val) {
+		guard g(lock_);
+		notFullCond_.wait(g, [this]{return que_.size() < cap_;});
+
+		que_.emplace(std::move(val));
+		g.unlock();
+		notEmptyCond_.notify_one();
+	}
+	/**
+	 * Non-blocking attempt to place an item into the queue.
+	 * @param val The value to add to the queue.
+	 * @return @em true if the item was added to the queue, @em false if the
+	 *  	   item was not added because the queue is currently full.
+	 */
+	bool try_put(value_type val) {
+		guard g(lock_);
+		if (que_.size() >= cap_)
+			return false;
+
+		que_.emplace(std::move(val));
+		g.unlock();
+		notEmptyCond_.notify_one();
+		return true;
+	}
+	/**
+	 * Attempt to place an item in the queue with a bounded wait.
+	 * This will attempt to place the value in the queue, but if it is full,
+	 * it will wait up to the specified time duration before timing out.
+	 * @param val The value to add to the queue.
+	 * @param relTime The amount of time to wait until timing out.
+	 * @return @em true if the value was added to the queue, @em false if a
+	 *  	   timeout occurred.
+	 */
+	template <typename Rep, class Period>
+	bool try_put_for(value_type val, const std::chrono::duration<Rep,Period>& relTime) {
+		guard g(lock_);
+		if (!notFullCond_.wait_for(g, relTime, [this]{return que_.size() < cap_;}))
+			return false;
+
+		que_.emplace(std::move(val));
+		g.unlock();
+		notEmptyCond_.notify_one();
+		return true;
+	}
+	/**
+	 * Retrieve a value from the queue.
+	 * If the queue is empty, this will block indefinitely until a value is
+	 * added to the queue by another thread,
+	 * @param val Pointer to a variable to receive the value.
+	 */
+	void get(value_type* val) {
+		guard g(lock_);
+		notEmptyCond_.wait(g, [this]{return !que_.empty();});
+
+		*val = std::move(que_.front());
+		que_.pop();
+		g.unlock();
+		notFullCond_.notify_one();
+	}
+	/**
+	 * Retrieve a value from the queue.
+	 * If the queue is empty, this will block indefinitely until a value is
+	 * added to the queue by another thread,
+	 * @return The value removed from the queue
+	 */
+	value_type get() {
+		guard g(lock_);
+		notEmptyCond_.wait(g, [this]{return !que_.empty();});
+
+		value_type val = std::move(que_.front());
+		que_.pop();
+		g.unlock();
+		notFullCond_.notify_one();
+		return val;
+	}
+	/**
+	 * Retrieve a number of values from the queue with a single wait.
+	 * If the queue is empty, this will block until a value is added to the
+	 * queue by another thread. It then removes as many values as are
+	 * available, up to the limit, without waiting for more.
+	 * @param out An output iterator to receive the values.
+	 * @param n The maximum number of values to remove.
+	 * @return The number of values removed from the queue. This is only
+	 *  	   zero if @em n is zero.
+	 */
+	template <class OutputIt>
+	size_type get_batch(OutputIt out, size_type n) {
+		if (n == 0)
+			return 0;
+
+		guard g(lock_);
+		notEmptyCond_.wait(g, [this]{return !que_.empty();});
+
+		size_type i = 0;
+		for (; i < n && !que_.empty(); ++i) {
+			*out++ = std::move(que_.front());
+			que_.pop();
+		}
+		g.unlock();
+		notFullCond_.notify_all();
+		return i;
+	}
+	/**
+	 * Attempts to remove a value from the queue without blocking.
+	 * If the queue is currently empty, this will return immediately with a
+	 * failure, otherwise it will get the next value and return it.
+	 * @param val Pointer to a variable to receive the value.
+	 * @return @em true if a value was removed from the queue, @em false if
+	 *  	   the queue is empty.
+	 */
+	bool try_get(value_type* val) {
+		guard g(lock_);
+		if (que_.empty())
+			return false;
+
+		*val = std::move(que_.front());
+		que_.pop();
+		g.unlock();
+		notFullCond_.notify_one();
+		return true;
+	}
+	/**
+	 * Attempt to remove an item from the queue for a bounded amount of time.
+	 * This will retrieve the next item from the queue. If the queue is
+	 * empty, it will wait the specified amount of time for an item to arrive
+	 * before timing out.
+	 * @param val Pointer to a variable to receive the value.
+	 * @param relTime The amount of time to wait until timing out.
+	 * @return @em true if the value was removed the queue, @em false if a
+	 *  	   timeout occurred.
+	 */
+	template <typename Rep, class Period>
+	bool try_get_for(value_type* val, const std::chrono::duration<Rep,Period>& relTime) {
+		guard g(lock_);
+		if (!notEmptyCond_.wait_for(g, relTime, [this]{return !que_.empty();}))
+			return false;
+
+		*val = std::move(que_.front());
+		que_.pop();
+		g.unlock();
+		notFullCond_.notify_one();
+		return true;
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		// __mqtt_thread_queue_h
+
@@ -34,6 +34,8 @@
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
+#include <future>
+#include <functional>
 
 namespace mqtt {
 
@@ -112,17 +114,116 @@ public:
 	 * @param timeout
 	 */
 	virtual void wait_for_completion(long timeout) =0;
+	/**
+	 * Gets the result of the action, if it has finished, without waiting
+	 * or throwing.
+	 * The default implementation is built on is_complete() and
+	 * wait_for_completion(), for tokens from outside the library that
+	 * don't override it.
+	 * @return MQTTASYNC_SUCCESS if the action succeeded, its error code if
+	 *  	   it failed, or MQTTASYNC_OPERATION_INCOMPLETE if it hasn't
+	 *  	   finished.
+	 */
+	virtual int try_get_result() const noexcept {
+		return const_cast<itoken*>(this)->try_wait_for_result(0);
+	}
+	/**
+	 * Waits for the action to finish, and gets its result without
+	 * throwing.
+	 * The default implementation is built on is_complete() and
+	 * wait_for_completion(), for tokens from outside the library that
+	 * don't override it. An error that isn't an mqtt::exception is
+	 * reported as MQTTASYNC_FAILURE.
+	 * @param timeout The longest time to wait, in milliseconds. Zero
+	 *  			  doesn't wait, and a negative value waits forever.
+	 * @return MQTTASYNC_SUCCESS if the action succeeded, its error code if
+	 *  	   it failed, or MQTTASYNC_OPERATION_INCOMPLETE on a timeout.
+	 */
+	virtual int try_wait_for_result(long timeout) noexcept {
+		try {
+			if (timeout == 0 && !is_complete())
+				return MQTTASYNC_OPERATION_INCOMPLETE;
+			if (timeout > 0)
+				wait_for_completion(timeout);
+			else
+				wait_for_completion();
+			return MQTTASYNC_SUCCESS;
+		}
+		catch (const exception& ex) {
+			return is_complete() ? ex.get_reason_code() : MQTTASYNC_OPERATION_INCOMPLETE;
+		}
+		catch (...) {
+			return is_complete() ? MQTTASYNC_FAILURE : MQTTASYNC_OPERATION_INCOMPLETE;
+		}
+	}
+	/**
+	 * Gets a future that becomes ready when the action completes.
+	 * If the action fails, the future holds an mqtt::exception with the
+	 * error code.
+	 * The default implementation, for tokens from outside the library,
+	 * returns a deferred future that calls wait_for_completion() when it's
+	 * first waited on. So the token must outlive that wait, and a timed
+	 * wait on the future reports std::future_status::deferred rather than
+	 * waiting.
+	 * @return A future for the completion of the action.
+	 */
+	virtual std::shared_future<void> get_future() {
+		return std::async(std::launch::deferred,
+						  [this] { wait_for_completion(); }).share();
+	}
 };
 
 using itoken_ptr = itoken::ptr_t;
 
+/**
+ * Creates a token that completes when all of the specified tokens have
+ * completed.
+ * It fails with the first error from any of them, once they're all done.
+ * @param toks The tokens. They must all be of the library's token class.
+ * @return A token for the group.
+ * @throw std::invalid_argument if a token is not of the library's class.
+ */
+itoken_ptr when_all(const std::vector<itoken_ptr>& toks);
+/**
+ * Creates a token that completes when any one of the specified tokens
+ * has completed, with the result of that one.
+ * The token is complete right away if the collection is empty.
+ * @param toks The tokens. They must all be of the library's token class.
+ * @return A token for the group.
+ * @throw std::invalid_argument if a token is not of the library's class.
+ */
+itoken_ptr when_any(const std::vector<itoken_ptr>& toks);
+/**
+ * Creates a token that completes when all of the tokens in a range have
+ * completed.
+ * @param first An iterator to the first of the tokens.
+ * @param last An iterator past the last of the tokens.
+ * @return A token for the group.
+ */
+template <class InputIt>
+itoken_ptr when_all(InputIt first, InputIt last) {
+	return when_all(std::vector<itoken_ptr>(first, last));
+}
+/**
+ * Creates a token that completes when any of the tokens in a range has
+ * completed.
+ * @param first An iterator to the first of the tokens.
+ * @param last An iterator past the last of the tokens.
+ * @return A token for the group.
+ */
+template <class InputIt>
+itoken_ptr when_any(InputIt first, InputIt last) {
+	return when_any(std::vector<itoken_ptr>(first, last));
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 /**
  * Provides a mechanism for tracking the completion of an asynchronous
  * action.
  */
-class token : public virtual itoken
+class token : public virtual itoken,
+				public std::enable_shared_from_this<token>
 {
 	/** Lock guard type for this class. */
 	using guard = std::unique_lock<std::mutex>;
@@ -135,6 +236,8 @@ class token : public virtual itoken
 	MQTTAsync_token tok_;
 	/** The topic string(s) for the action being tracked by this token */
 	std::vector<std::string> topics_;
+	/** A shared collection of topics, used in place of our own, if set */
+	std::shared_ptr<const std::vector<std::string>> topicsRef_;
 	/** The MQTT client that is processing this action */
 	iasync_client* cli_;
 	/** User supplied context */
@@ -149,6 +252,27 @@ class token : public virtual itoken
 	bool complete_;
 	/** The action success/failure code */
 	int rc_;
+	/**
+	 * The token for a group of actions that includes this one, such as a
+	 * batch of publishes. It's told when this action completes.
+	 */
+	std::shared_ptr<token> parent_;
+	/** Any other groups that include this action */
+	std::vector<std::shared_ptr<token>> moreParents_;
+	/**
+	 * For a group token, the number of actions that have yet to complete.
+	 * This is the only thing the group needs to track, however many
+	 * actions it has.
+	 */
+	size_t nPending_;
+	/** Whether a group token completes with the first of its actions */
+	bool waitAny_;
+	/** The promise behind get_future(), created on first use */
+	std::unique_ptr<std::promise<void>> promise_;
+	/** The future for the promise */
+	std::shared_future<void> future_;
+	/** Functions to call when the action completes */
+	std::vector<std::function<void()>> continuations_;
 
 	/** Client and token-related options have special access */
 	friend class async_client;
@@ -159,13 +283,44 @@ class token : public virtual itoken
 	friend class delivery_response_options;
 	friend class disconnect_options;
 
+	friend class token_awaiter;
+
+	friend itoken_ptr when_all(const std::vector<itoken_ptr>& toks);
+	friend itoken_ptr when_any(const std::vector<itoken_ptr>& toks);
+
+	/**
+	 * Constructs a token for a group of actions.
+	 * @param cli The client, which may be null.
+	 * @param n The number of actions in the group.
+	 * @param waitAny Whether to complete with the first of the actions,
+	 *  			  rather than all of them.
+	 */
+	token(iasync_client* cli, size_t n, bool waitAny);
+	/**
+	 * Creates a token for a group of actions, and adds it as a parent to
+	 * each of them.
+	 */
+	static std::shared_ptr<token> make_group(const std::vector<itoken_ptr>& toks,
+											 bool waitAny);
+
 	void set_topics(const std::string& top) {
+		topicsRef_.reset();
 		topics_.clear();
 		topics_.push_back(top);
 	}
 	void set_topics(const std::vector<std::string>& top) {
+		topicsRef_.reset();
 		topics_ = top;
 	}
+	/**
+	 * Sets the topics to a collection that is shared with other tokens,
+	 * which saves making a copy of it for each one.
+	 * @param top The shared topic collection.
+	 */
+	void set_topics(std::shared_ptr<const std::vector<std::string>> top) {
+		topics_.clear();
+		topicsRef_ = std::move(top);
+	}
 
 	/**
 	 * Sets the ID for the message.
@@ -201,11 +356,56 @@ class token : public virtual itoken
 	 * @param rsp The success response.
 	 */
 	void on_success(MQTTAsync_successData* rsp);
+	/**
+	 * Marks the action complete, calls the listener, then signals the
+	 * token.
+	 * @param listener The user listener, if any.
+	 */
+	void complete(iaction_listener* listener);
+	/**
+	 * Completes the action, on the client's executor if there is one and
+	 * the user has a listener to call.
+	 * @param listener The user listener, if any.
+	 */
+	void dispatch_complete(iaction_listener* listener);
 	/**
 	 * Internal handler for the failure callback.
 	 * @param rsp The failure response.
 	 */
 	void on_failure(MQTTAsync_failureData* rsp);
+	/**
+	 * Makes this token part of a group, which is notified when this
+	 * action completes. If it's already complete, the group is notified
+	 * right away.
+	 * @param parent The token for the group.
+	 */
+	void add_parent(std::shared_ptr<token> parent);
+	/**
+	 * Makes this the token for a group of actions, which completes when
+	 * all of them have.
+	 * @param n The number of actions in the group.
+	 */
+	void set_num_pending(size_t n) {
+		guard g(lock_);
+		nPending_ = n;
+	}
+	/**
+	 * Adds a function to call when the action completes.
+	 * It is called on the thread that completes the token, after the
+	 * token is signaled.
+	 * @param f The function.
+	 * @return @em true if the function was added, @em false if the action
+	 *  	   is already complete, in which case it is not called.
+	 */
+	bool add_continuation(std::function<void()> f);
+	/**
+	 * Called when one of the actions in the group completes.
+	 * A group that waits for all of its actions fails with the first
+	 * error reported by any of them. One that waits for any of them takes
+	 * the result of the first.
+	 * @param rc The result of the action.
+	 */
+	void on_child_complete(int rc);
 
 public:
 	/** Smart/shared pointer to an object of this class */
@@ -266,7 +466,7 @@ public:
 	 * token.
 	 */
 	const std::vector<std::string>& get_topics() const override {
-		return topics_;
+		return topicsRef_ ? *topicsRef_ : topics_;
 	}
 	/**
 	 * Retrieve the context associated with an action.
@@ -307,6 +507,30 @@ public:
 	 * @param timeout The timeout (in milliseconds)
 	 */
 	void wait_for_completion(long timeout) override;
+	/**
+	 * Gets the result of the action, if it has finished, without waiting
+	 * or throwing.
+	 * @return MQTTASYNC_SUCCESS if the action succeeded, its error code if
+	 *  	   it failed, or MQTTASYNC_OPERATION_INCOMPLETE if it hasn't
+	 *  	   finished.
+	 */
+	int try_get_result() const noexcept override;
+	/**
+	 * Waits for the action to finish, and gets its result without
+	 * throwing.
+	 * @param timeout The longest time to wait, in milliseconds. Zero
+	 *  			  doesn't wait, and a negative value waits forever.
+	 * @return MQTTASYNC_SUCCESS if the action succeeded, its error code if
+	 *  	   it failed, or MQTTASYNC_OPERATION_INCOMPLETE on a timeout.
+	 */
+	int try_wait_for_result(long timeout) noexcept override;
+	/**
+	 * Gets a future that becomes ready when the action completes.
+	 * If the action fails, the future holds an mqtt::exception with the
+	 * error code.
+	 * @return A future for the completion of the action.
+	 */
+	std::shared_future<void> get_future() override;
 	/**
 	 * Waits a relative amount of time for the action to complete.
 	 * @param relTime The amount of time to wait for the event.
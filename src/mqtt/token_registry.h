@@ -0,0 +1,178 @@
+/////////////////////////////////////////////////////////////////////////////
+/// @file token_registry.h
+/// Declaration of MQTT token_registry class
+/// @date October 18, 2026
+/// @author agent
+/////////////////////////////////////////////////////////////////////////////
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_token_registry_h
+#define __mqtt_token_registry_h
+
+#include "mqtt/token.h"
+#include "mqtt/delivery_token.h"
+#include "mqtt/block_pool.h"
+#include <unordered_map>
+#include <vector>
+#include <utility>
+#include <memory>
+#include <mutex>
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The collection of tokens that a client has in play.
+ *
+ * Tokens are keyed by the address of the token object, since that is what
+ * the C library hands back to us on completion, and delivery tokens are
+ * additionally indexed by their message ID. All the operations are
+ * constant-time, so the cost of completing an action does not depend on
+ * the number of actions that are in flight.
+ *
+ * The bookkeeping for the tokens is allocated from a block pool, so that
+ * a steady flow of actions does not need the heap.
+ *
+ * The object is thread-safe.
+ */
+class token_registry
+{
+	/** Lock guard type for this class */
+	using guard = std::unique_lock<std::mutex>;
+
+	/** A token in play and, if it tracks a publish, its delivery view */
+	struct entry
+	{
+		/** The token */
+		itoken_ptr tok;
+		/** The same token as a delivery token, if it is one */
+		idelivery_token_ptr dtok;
+		/** The message ID under which a delivery token is indexed */
+		int msgId;
+	};
+
+	/** Map of the tokens in play, keyed by address */
+	using token_map = std::unordered_map<const itoken*, entry,
+							std::hash<const itoken*>, std::equal_to<const itoken*>,
+							pool_allocator<std::pair<const itoken* const, entry>>>;
+
+	/** Map of the delivery tokens in play, keyed by message ID */
+	using msg_id_map = std::unordered_map<int, const itoken*,
+							std::hash<int>, std::equal_to<int>,
+							pool_allocator<std::pair<const int, const itoken*>>>;
+
+	/** Object monitor mutex */
+	mutable std::mutex lock_;
+	/** The tokens in play, keyed by address */
+	token_map tokens_;
+	/** The delivery tokens in play, keyed by message ID */
+	msg_id_map msgIds_;
+
+	/**
+	 * Indexes a delivery token by its message ID.
+	 * The object lock must be held.
+	 */
+	void index_message_id(const itoken* tok, int msgId);
+
+	/** Non-copyable */
+	token_registry(const token_registry&) =delete;
+	token_registry& operator=(const token_registry&) =delete;
+
+public:
+	/**
+	 * Creates an empty registry with its own block pool.
+	 */
+	token_registry();
+	/**
+	 * Creates an empty registry that allocates from the specified pool.
+	 * @param pool The block pool.
+	 */
+	explicit token_registry(block_pool_ptr pool);
+	/**
+	 * Adds a token to the registry.
+	 * @param tok The token. A null pointer is ignored.
+	 */
+	void add(itoken_ptr tok);
+	/**
+	 * Adds a delivery token to the registry.
+	 * @param tok The delivery token. A null pointer is ignored.
+	 */
+	void add(idelivery_token_ptr tok);
+	/**
+	 * Adds a number of delivery tokens to the registry with a single lock.
+	 * @param toks The delivery tokens. Null pointers are ignored.
+	 */
+	void add(const std::vector<delivery_token_ptr>& toks);
+	/**
+	 * Indexes a delivery token by the message ID assigned to it.
+	 * This is a no-op if the token is no longer in the registry, as
+	 * happens when the action completes before the ID gets recorded.
+	 * @param tok The token.
+	 * @param msgId The message ID. Non-positive values are not indexed.
+	 */
+	void set_message_id(const itoken* tok, int msgId);
+	/**
+	 * Indexes a number of delivery tokens by their message ID's, with a
+	 * single lock.
+	 * @param ids The tokens and their message ID's.
+	 */
+	void set_message_ids(const std::vector<std::pair<const itoken*,int>>& ids);
+	/**
+	 * Removes a token from the registry.
+	 * @param tok The token.
+	 * @param dtok If the token was a delivery token, this receives it. Can
+	 *  		   be null if the caller is not interested.
+	 * @return @em true if the token was found and removed, @em false if
+	 *  	   it was not in the registry.
+	 */
+	bool remove(const itoken* tok, idelivery_token_ptr* dtok=nullptr);
+	/**
+	 * Looks up the delivery token for a message ID.
+	 * @param msgId The message ID.
+	 * @return The delivery token, or null if there is none in flight with
+	 *  	   that ID.
+	 */
+	idelivery_token_ptr get_delivery_token(int msgId) const;
+	/**
+	 * Gets the delivery tokens for the messages that are awaiting an
+	 * acknowledgment from the server (i.e. that have a message ID).
+	 * @return The pending delivery tokens, in no particular order.
+	 */
+	std::vector<idelivery_token_ptr> get_delivery_tokens() const;
+	/**
+	 * Gets the number of tokens in the registry.
+	 * @return The number of tokens in the registry.
+	 */
+	size_t size() const {
+		guard g(lock_);
+		return tokens_.size();
+	}
+	/**
+	 * Determines if the registry is empty.
+	 * @return @em true if there are no tokens in the registry.
+	 */
+	bool empty() const { return size() == 0; }
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		// __mqtt_token_registry_h
+
@@ -39,16 +39,32 @@ class async_client;
 
 /**
  * Represents a topic destination, used for publish/subscribe messaging.
+ *
+ * A topic is a handle that is resolved once, when it's created, for
+ * publishing to the same topic many times. The name is validated then,
+ * and interned in a collection that's shared with the delivery token of
+ * every message published through the handle, so a publish doesn't copy
+ * or look up the name. When the client is an async_client, publishing
+ * goes through async_client::publish(const topic&, const_message_ptr),
+ * rather than the overloads that take the name. A subclass of the client
+ * that overrides publish() needs to override that one too, to see the
+ * messages published through a topic.
  */
 class topic
 {
-	/** The topic name */
-	std::string name_;
+	/** The topic name, as a collection shared with the delivery tokens */
+	std::shared_ptr<const std::vector<std::string>> names_;
 
 	/** The client to which this topic is connected */
 	// TODO: Make this a smart pointer
 	iasync_client* cli_;
 
+	/** The client, if it's an async_client, to publish with the handle */
+	async_client* acli_;
+
+	/** The client has special access. */
+	friend class async_client;
+
 public:
 	/**
 	 * A smart/shared pointer to this class.
@@ -56,15 +72,26 @@ public:
 	using ptr_t = std::shared_ptr<topic>;
 	/**
 	 * Construct an MQTT topic destination for messages.
-	 * @param name
-	 * @param cli
+	 * @param name The topic name. This can't contain wildcards.
+	 * @param cli The client to publish with.
+	 * @throw exception with the code MQTTASYNC_BAD_UTF8_STRING if the name
+	 *  	  is not a valid topic name. Earlier versions accepted any
+	 *  	  name here, and a bad one only failed when publishing.
+	 */
+	topic(const std::string& name, iasync_client& cli);
+	/**
+	 * Determines if a string is a valid topic name for publishing.
+	 * A name must not be empty, contain wildcards or a null character, or
+	 * be longer than the 65535 bytes that MQTT allows.
+	 * @param name The string to check.
+	 * @return @em true if the name is valid.
 	 */
-	topic(const std::string& name, iasync_client& cli) : name_{name}, cli_{&cli} {}
+	static bool is_valid_name(const std::string& name);
 	/**
 	 * Returns the name of the queue or topic.
 	 * @return std::string
 	 */
-	std::string get_name() const { return name_; }
+	const std::string& get_name() const { return names_->front(); }
 	/**
 	 * Publishes a message on the topic.
 	 * @param payload
@@ -95,7 +122,7 @@ public:
 	 * Returns a string representation of this topic.
 	 * @return std::string
 	 */
-	std::string to_str() const { return name_; }
+	std::string to_str() const { return get_name(); }
 };
 
 /**
@@ -0,0 +1,311 @@
+/////////////////////////////////////////////////////////////////////////////
+/// @file topic_router.h
+/// Declaration of MQTT topic_router class, which matches incoming topics
+/// against a set of subscription filters.
+/// @date October 18, 2026
+/// @author agent
+/////////////////////////////////////////////////////////////////////////////
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_topic_router_h
+#define __mqtt_topic_router_h
+
+#include "mqtt/message.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Routes incoming messages to handlers by topic filter.
+ *
+ * The filters are kept in a trie with one level of the topic per node, so
+ * finding the handlers for a topic takes time proportional to the number
+ * of levels in the topic, not the number of filters. The single-level
+ * (`+`) and multi-level (`#`) wildcards are supported with the semantics
+ * of the MQTT spec, including that a filter starting with a wildcard
+ * doesn't match a topic that starts with `$`.
+ *
+ * The text of each level is interned: the trie stores a small integer ID
+ * for it, and the edges are held in a single hash table keyed by the
+ * parent node and level ID. A lookup scans the topic in place and never
+ * allocates memory.
+ *
+ * This class is not thread-safe. The client keeps an immutable copy that
+ * it replaces when the set of routes changes.
+ */
+class topic_router
+{
+public:
+	/** Smart/shared pointer to an object of this class */
+	using ptr_t = std::shared_ptr<topic_router>;
+	/** Smart/shared pointer to a const object of this class */
+	using const_ptr_t = std::shared_ptr<const topic_router>;
+	/** The type of function that handles the messages for a filter */
+	using handler = std::function<void(const_message_ptr)>;
+
+private:
+	/** Marker for a missing node */
+	static const size_t NONE;
+
+	/** A node in the trie. */
+	struct node {
+		/** The parent node, or NONE for the root */
+		size_t parent;
+		/** The level ID on the edge from the parent, or NONE for a wildcard */
+		size_t level;
+		/** The number of literal children */
+		size_t nchild;
+		/** The child for the '+' wildcard */
+		size_t plus;
+		/** The child for the '#' wildcard */
+		size_t hash;
+		/** The handler for the filter that ends at this node */
+		handler h;
+
+		node(size_t par, size_t lvl)
+			: parent(par), level(lvl), nchild(0), plus(NONE), hash(NONE) {}
+	};
+
+	/** A reference to the text of a topic level, within some string. */
+	struct level_ref {
+		const char* p;
+		size_t n;
+	};
+	/** FNV-1a hash of a level */
+	struct level_hash {
+		size_t operator()(const level_ref& r) const {
+			uint32_t h = 2166136261u;
+			for (size_t i=0; i<r.n; ++i)
+				h = (h ^ uint8_t(r.p[i])) * 16777619u;
+			return size_t(h);
+		}
+	};
+	/** Compares two levels */
+	struct level_equal {
+		bool operator()(const level_ref& a, const level_ref& b) const {
+			return a.n == b.n && std::memcmp(a.p, b.p, a.n) == 0;
+		}
+	};
+
+	/**
+	 * The interned level strings. A deque never moves its elements, so the
+	 * references in the ID table stay valid.
+	 */
+	std::deque<std::string> levels_;
+	/** Map of the level text to its ID */
+	std::unordered_map<level_ref, size_t, level_hash, level_equal> levelIds_;
+	/** The nodes of the trie. Node zero is the root. */
+	std::vector<node> nodes_;
+	/** The unused slots in the node vector */
+	std::vector<size_t> freeNodes_;
+	/** The literal edges, keyed by the parent node and level ID */
+	std::unordered_map<uint64_t, size_t> edges_;
+	/** The number of filters with a handler */
+	size_t nroutes_;
+
+	/** Makes the key for an edge */
+	static uint64_t edge_key(size_t parent, size_t level) {
+		return (uint64_t(parent) << 32) | uint64_t(level);
+	}
+	/** Looks up the ID of a level without adding it. */
+	size_t find_level(const char* p, size_t n) const {
+		auto it = levelIds_.find(level_ref{ p, n });
+		return (it == levelIds_.end()) ? NONE : it->second;
+	}
+	/** Gets the ID of a level, interning it if it's new. */
+	size_t intern_level(const char* p, size_t n);
+	/** Gets a new node */
+	size_t new_node(size_t parent, size_t level);
+	/** Finds the node for a filter, optionally creating it. */
+	size_t find_node(const std::string& filter, bool create);
+	/** Removes empty nodes, working up from the specified one. */
+	void prune(size_t n);
+
+	/**
+	 * Calls the function for the handler in the node, if there is one.
+	 */
+	template <typename Func>
+	void report(size_t n, Func& f, size_t& count) const {
+		const handler& h = nodes_[n].h;
+		if (h) {
+			f(h);
+			++count;
+		}
+	}
+	/**
+	 * Matches the rest of a topic below the specified node.
+	 * @param n The node
+	 * @param p The start of the current level of the topic.
+	 * @param end The end of the topic.
+	 * @param first Whether this is the first level of the topic.
+	 */
+	template <typename Func>
+	void match_level(size_t n, const char* p, const char* end, bool first,
+					 Func& f, size_t& count) const {
+		const node& nd = nodes_[n];
+		bool wild = !(first && p != end && *p == '$');
+
+		if (nd.hash != NONE && wild)
+			report(nd.hash, f, count);
+
+		const char* q = std::find(p, end, '/');
+
+		if (nd.nchild != 0) {
+			size_t lvl = find_level(p, size_t(q - p));
+			if (lvl != NONE) {
+				auto it = edges_.find(edge_key(n, lvl));
+				if (it != edges_.end())
+					advance(it->second, q, end, f, count);
+			}
+		}
+
+		if (nd.plus != NONE && wild)
+			advance(nd.plus, q, end, f, count);
+	}
+	/**
+	 * Moves to a child node, after the level ending at 'q' was matched.
+	 */
+	template <typename Func>
+	void advance(size_t n, const char* q, const char* end,
+				 Func& f, size_t& count) const {
+		if (q == end) {
+			report(n, f, count);
+			// A "#" also matches the parent level, so "a/#" matches "a".
+			if (nodes_[n].hash != NONE)
+				report(nodes_[n].hash, f, count);
+		}
+		else
+			match_level(n, q+1, end, false, f, count);
+	}
+
+public:
+	/**
+	 * Creates an empty router.
+	 */
+	topic_router();
+	/**
+	 * Copy constructor.
+	 * The level table of the copy refers to its own strings.
+	 * @param other The router to copy.
+	 */
+	topic_router(const topic_router& other);
+	/**
+	 * Copy assignment.
+	 * @param rhs The router to copy.
+	 * @return A reference to this router.
+	 */
+	topic_router& operator=(const topic_router& rhs);
+	/**
+	 * Determines if a string is a valid topic filter.
+	 * A filter must not be empty, and a wildcard must occupy a whole
+	 * level, with '#' only allowed as the last one.
+	 * @param filter The string to check.
+	 * @return @em true if the filter is valid.
+	 */
+	static bool is_valid_filter(const std::string& filter);
+	/**
+	 * Adds a route, replacing any handler already set for the filter.
+	 * @param filter The topic filter, which can contain wildcards.
+	 * @param h The handler for messages that match the filter.
+	 * @throw std::invalid_argument if the filter is not valid or the
+	 *  	  handler is empty.
+	 */
+	void add(const std::string& filter, handler h);
+	/**
+	 * Removes the route for a filter.
+	 * @param filter The topic filter.
+	 * @return @em true if the filter had a route, @em false otherwise.
+	 */
+	bool remove(const std::string& filter);
+	/**
+	 * Removes all the routes.
+	 */
+	void clear();
+	/**
+	 * Determines if there are any routes.
+	 * @return @em true if there are no routes.
+	 */
+	bool empty() const { return nroutes_ == 0; }
+	/**
+	 * Gets the number of routes.
+	 * @return The number of filters that have a handler.
+	 */
+	size_t size() const { return nroutes_; }
+	/**
+	 * Determines if there is a route for the filter.
+	 * @param filter The topic filter, as given to add().
+	 * @return @em true if the filter has a route.
+	 */
+	bool contains(const std::string& filter) const;
+	/**
+	 * Gets the handler for a filter.
+	 * @param filter The topic filter, as given to add().
+	 * @return A copy of the handler, or an empty function if the filter
+	 *  	   has no route.
+	 */
+	handler get_handler(const std::string& filter) const;
+	/**
+	 * Finds the handlers for all the filters that match a topic.
+	 * This does not allocate any memory.
+	 * @param topic The topic of a message. This must not contain wildcards.
+	 * @param f A function called with each matching handler, as
+	 *  		`f(const handler&)`
+	 * @return The number of matching filters.
+	 */
+	template <typename Func>
+	size_t match(const std::string& topic, Func f) const {
+		size_t count = 0;
+		if (nroutes_ != 0) {
+			const char *p = topic.data();
+			match_level(0, p, p + topic.size(), true, f, count);
+		}
+		return count;
+	}
+	/**
+	 * Calls the handlers for all the filters that match the topic of a
+	 * message.
+	 * @param msg The message.
+	 * @return The number of handlers called.
+	 */
+	size_t route(const_message_ptr msg) const {
+		return match(msg->get_topic(), [&msg](const handler& h) { h(msg); });
+	}
+};
+
+/** Smart/shared pointer to a topic_router */
+using topic_router_ptr = topic_router::ptr_t;
+
+/** Smart/shared pointer to a const topic_router */
+using const_topic_router_ptr = topic_router::const_ptr_t;
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		// __mqtt_topic_router_h
+
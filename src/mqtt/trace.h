@@ -0,0 +1,256 @@
+/////////////////////////////////////////////////////////////////////////////
+/// @file trace.h
+/// Declaration of MQTT tracing hooks, trace_buffer, and the Chrome trace
+/// exporter
+/// @date October 18, 2026
+/// @author agent
+/////////////////////////////////////////////////////////////////////////////
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_trace_h
+#define __mqtt_trace_h
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The points on the hot paths of the client that can be traced.
+ *
+ * A publish is traced by its token, from the call to publish() to the
+ * completion of the token. The token events are traced for every kind of
+ * token, but only a publish has a beginning.
+ *
+ * A receive is traced by the C library's message, from the C callback
+ * to the return from the user callback, or the hand-off of the message if
+ * the callbacks run on an executor or the message is queued.
+ */
+enum class trace_event : uint8_t {
+	PUBLISH_BEGIN,		///< A publish was called
+	PUBLISH_SENT,		///< The C library took the message, or refused it
+	TOKEN_ACKED,		///< The C library completed the token
+	TOKEN_LISTENER,		///< The token's action listener is called
+	TOKEN_COMPLETE,		///< The token was signaled, or dropped when its send was refused
+	RECEIVE_BEGIN,		///< The C library delivered a message
+	RECEIVE_MESSAGE,	///< The message object was made
+	RECEIVE_COMPLETE	///< The message was dispatched
+};
+
+/**
+ * Gets the name of a trace event.
+ * @param evt The event.
+ * @return The name of the event, like "publish_sent".
+ */
+const char* trace_event_name(trace_event evt);
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Receives the trace events from the library.
+ *
+ * This is called on the thread that hits the trace point, which is often
+ * the C library's thread, in the middle of the work being traced. It must
+ * be quick, and must not block.
+ */
+class trace_sink
+{
+public:
+	/**
+	 * Virtual destructor
+	 */
+	virtual ~trace_sink() {}
+	/**
+	 * Called when a trace point is hit.
+	 * @param evt The event.
+	 * @param id The object being traced: the token for a publish, or the
+	 *  		 C library's message for a receive.
+	 */
+	virtual void on_trace(trace_event evt, const void* id) noexcept =0;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The connection between the trace points and the sink.
+ *
+ * The trace points are only compiled in when the library is built with
+ * PAHO_MQTTPP_TRACE defined. Otherwise, they're nothing at all, and a
+ * sink that's set here never hears from the library.
+ */
+class tracer
+{
+	/** The sink for the events, if any */
+	static std::atomic<trace_sink*> sink_;
+
+public:
+	/**
+	 * Sets the sink for the trace events.
+	 * The sink must outlive its use: it should be cleared, and the client
+	 * quiet, before it's destroyed.
+	 * @param sink The sink, or null to stop tracing.
+	 */
+	static void set_sink(trace_sink* sink) {
+		sink_.store(sink, std::memory_order_release);
+	}
+	/**
+	 * Gets the sink for the trace events.
+	 * @return The sink, or null if none was set.
+	 */
+	static trace_sink* get_sink() {
+		return sink_.load(std::memory_order_acquire);
+	}
+	/**
+	 * Hits a trace point, passing the event to the sink, if there is one.
+	 * @param evt The event.
+	 * @param id The object being traced.
+	 */
+	static void point(trace_event evt, const void* id) {
+		trace_sink* sink = sink_.load(std::memory_order_acquire);
+		if (sink)
+			sink->on_trace(evt, id);
+	}
+};
+
+/**
+ * A trace point in the library.
+ * This is a no-op unless the library is built with PAHO_MQTTPP_TRACE
+ * defined. The id is never evaluated then, but still counts as used.
+ */
+#if defined(PAHO_MQTTPP_TRACE)
+	#define PAHO_MQTTPP_TRACE_POINT(evt, id) \
+		::mqtt::tracer::point(::mqtt::trace_event::evt, (id))
+#else
+	#define PAHO_MQTTPP_TRACE_POINT(evt, id) ((void) sizeof(id))
+#endif
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * An event that was kept by a trace buffer.
+ */
+struct trace_record
+{
+	/** The time of the event, in nanoseconds from the steady clock's epoch */
+	uint64_t ns;
+	/** The object that was traced */
+	const void* id;
+	/** A small number for the thread that hit the trace point */
+	uint32_t thread;
+	/** The event */
+	trace_event evt;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A fixed-size, in-memory ring of the most recent trace events.
+ *
+ * Recording an event takes a timestamp and a few atomic operations, but
+ * never a lock, so any number of threads can record at once. When the
+ * buffer is full, the oldest events are overwritten.
+ */
+class trace_buffer : public trace_sink
+{
+	/** A slot in the ring */
+	struct slot {
+		/** One more than the event's place in the sequence, or zero while writing */
+		std::atomic<uint64_t> seq;
+		/** The time of the event */
+		std::atomic<uint64_t> ns;
+		/** The object that was traced */
+		std::atomic<uintptr_t> id;
+		/** The thread number and event, packed together */
+		std::atomic<uint64_t> threadEvt;
+	};
+
+	/** The slots; the count is a power of two */
+	std::unique_ptr<slot[]> slots_;
+	/** One less than the number of slots */
+	size_t mask_;
+	/** The number of events that were ever recorded */
+	std::atomic<uint64_t> head_;
+
+	/** Non-copyable */
+	trace_buffer(const trace_buffer&) =delete;
+	trace_buffer& operator=(const trace_buffer&) =delete;
+
+public:
+	/** The default number of events that are kept */
+	static const size_t DFLT_CAPACITY;
+
+	/**
+	 * Creates an empty trace buffer.
+	 * @param capacity The number of events to keep. This is rounded up to
+	 *  			   a power of two.
+	 */
+	explicit trace_buffer(size_t capacity=DFLT_CAPACITY);
+	/**
+	 * Records an event.
+	 * @param evt The event.
+	 * @param id The object being traced.
+	 */
+	void on_trace(trace_event evt, const void* id) noexcept override;
+	/**
+	 * Gets the number of events that are kept.
+	 * @return The capacity of the buffer.
+	 */
+	size_t capacity() const { return mask_ + 1; }
+	/**
+	 * Gets the number of events that were ever recorded, including the
+	 * ones that were overwritten.
+	 * @return The number of events recorded.
+	 */
+	uint64_t total() const { return head_.load(std::memory_order_relaxed); }
+	/**
+	 * Gets a copy of the events in the buffer, oldest first.
+	 * This can be called while events are being recorded. Any that are
+	 * being written at the time are left out.
+	 * @return The events.
+	 */
+	std::vector<trace_record> snapshot() const;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Writes trace events in the Chrome trace event format, for viewing in
+ * chrome://tracing or Perfetto.
+ *
+ * Each publish and receive is written as an async span, with its stages
+ * as steps along the way. Events for objects that have no beginning in
+ * the records, like the tokens for a connect, or a publish that started
+ * before the oldest record in a buffer, are left out.
+ *
+ * @param os The stream to write to.
+ * @param recs The events, oldest first.
+ */
+void write_chrome_trace(std::ostream& os, const std::vector<trace_record>& recs);
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		// __mqtt_trace_h
+
@@ -0,0 +1,256 @@
+/////////////////////////////////////////////////////////////////////////////
+/// @file write_behind_persistence.h
+/// Declaration of MQTT write_behind_persistence class
+/// @date October 18, 2026
+/// @author agent
+/////////////////////////////////////////////////////////////////////////////
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_write_behind_persistence_h
+#define __mqtt_write_behind_persistence_h
+
+#include "mqtt/iclient_persistence.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A persistent store that sits in front of another store and writes to it
+ * from a background thread.
+ *
+ * The C library calls into the persistence store on the same thread that
+ * services the network, so a slow disk holds up the connection. This
+ * store takes a put or remove into a table in memory and returns right
+ * away. A background thread then writes the changes to the backing store
+ * in batches, and calls the backing store's sync() after each batch:
+ *
+ * @code
+ *   mqtt::mmap_persistence disk("/var/lib/myapp");
+ *   mqtt::write_behind_persistence store(disk);
+ *   store.set_sync_interval(std::chrono::milliseconds(5));
+ *   store.set_sync_records(1000);
+ *   mqtt::async_client cli(SERVER_URI, CLIENT_ID, &store);
+ * @endcode
+ *
+ * A batch is written when the oldest change in it is as old as the sync
+ * interval, or when it has the sync number of records, whichever comes
+ * first. That is the window in which a change that the client thinks is
+ * persisted could be lost in a crash.
+ *
+ * Only the latest change to each key is written. A message that is put
+ * and then removed within the same window, because the server was quick
+ * to acknowledge it, never reaches the backing store at all.
+ *
+ * If the backing store fails to write a batch, this store fails all the
+ * puts and removes that follow, so the client sees the error.
+ *
+ * The backing store must outlive this object. It is only used from one
+ * thread at a time.
+ */
+class write_behind_persistence : public iclient_persistence
+{
+public:
+	/** Smart/shared pointer to an object of this class. */
+	using ptr_t = std::shared_ptr<write_behind_persistence>;
+
+	/** The default time that a change waits before it's written */
+	static const std::chrono::milliseconds DFLT_SYNC_INTERVAL;
+	/** The default number of changes that are written in a batch */
+	static const size_t DFLT_SYNC_RECORDS;
+
+private:
+	/** Lock guard type for this class */
+	using guard = std::unique_lock<std::mutex>;
+	/** The clock used for the sync interval */
+	using clock = std::chrono::steady_clock;
+
+	/** A change that hasn't been written to the backing store yet */
+	struct change {
+		/** The new data for the key, or null if it was removed */
+		ipersistable_ptr data;
+		/** Whether the backing store has data for the key from before */
+		bool stored;
+	};
+
+	/** The changes, by key */
+	using change_map = std::unordered_map<std::string, change>;
+
+	/** The backing store */
+	iclient_persistence& store_;
+	/** Object monitor mutex */
+	mutable std::mutex lock_;
+	/** Serializes the calls into the backing store */
+	mutable std::mutex storeLock_;
+	/** Signaled when there are changes to write, or the thread should quit */
+	std::condition_variable changeCond_;
+	/** Signaled when a batch has been written */
+	std::condition_variable writtenCond_;
+	/** The keys that are in the store, as the client sees it */
+	std::unordered_set<std::string> keys_;
+	/** The changes waiting to be written */
+	change_map pending_;
+	/** The batch that is being written */
+	change_map writing_;
+	/** The time of the oldest pending change */
+	clock::time_point firstPending_;
+	/** The time between syncs */
+	std::chrono::milliseconds syncInterval_;
+	/** The number of records to write between syncs */
+	size_t syncRecords_;
+	/** The maximum number of pending changes (0 for no limit) */
+	size_t maxPending_;
+	/** Set to have the thread write the pending changes now */
+	bool flushNow_;
+	/** Set to have the thread quit */
+	bool stop_;
+	/** Whether the thread is running */
+	bool running_;
+	/** Set when the backing store failed to write a batch */
+	bool failed_;
+	/** The thread that writes to the backing store */
+	std::thread thr_;
+
+	/** The thread function */
+	void run();
+	/** Writes a batch to the backing store */
+	void write(const change_map& batch);
+	/** Adds a change for the key. The lock must be held. */
+	void add_change(guard& g, const std::string& key, ipersistable_ptr data);
+	/** Waits until there are no changes pending or being written */
+	void wait_written(guard& g);
+	/** Writes out the pending changes and stops the thread */
+	void stop_thread();
+
+	/** Non-copyable */
+	write_behind_persistence(const write_behind_persistence&) =delete;
+	write_behind_persistence& operator=(const write_behind_persistence&) =delete;
+
+	friend class write_behind_persistence_test;
+
+public:
+	/**
+	 * Creates a store in front of the backing store.
+	 * @param store The backing store. This must outlive this object.
+	 */
+	explicit write_behind_persistence(iclient_persistence& store);
+	/**
+	 * Destructor writes out any pending changes and closes the store, if
+	 * it's open.
+	 */
+	~write_behind_persistence() override;
+	/**
+	 * Sets the longest time that a change waits before it is written to
+	 * the backing store and synced.
+	 * @param interval The time between syncs.
+	 */
+	void set_sync_interval(const std::chrono::milliseconds& interval);
+	/**
+	 * Sets the number of changes that trigger a write to the backing store,
+	 * before the sync interval is up.
+	 * @param n The number of records between syncs. Zero means that
+	 *  		they're only written on the interval.
+	 */
+	void set_sync_records(size_t n);
+	/**
+	 * Sets the maximum number of changes that can wait to be written. When
+	 * this many are pending, put() and remove() block until the background
+	 * thread catches up.
+	 * @param n The maximum number of pending changes, or zero for no limit.
+	 */
+	void set_max_pending(size_t n);
+	/**
+	 * Gets the number of changes waiting to be written to the backing
+	 * store.
+	 * @return The number of changes waiting to be written
+	 */
+	size_t pending() const;
+	/**
+	 * Opens the backing store and starts the thread that writes to it.
+	 * @param clientId The client ID
+	 * @param serverURI The URI of the server
+	 */
+	void open(const std::string& clientId, const std::string& serverURI) override;
+	/**
+	 * Writes out any pending changes, stops the thread, and closes the
+	 * backing store.
+	 */
+	void close() override;
+	/**
+	 * Clears the store, deleting all of the data.
+	 */
+	void clear() override;
+	/**
+	 * Determines if there is data in the store for the key.
+	 * @param key The key
+	 * @return @em true if there is data for the key
+	 */
+	bool contains_key(const std::string& key) override;
+	/**
+	 * Gets the data for the key. This is the pending data, if there is
+	 * any, otherwise it's read from the backing store.
+	 * @param key The key
+	 * @return The data.
+	 * @throw persistence_exception if there's no data for the key.
+	 */
+	ipersistable_ptr get(const std::string& key) const override;
+	/**
+	 * Gets the keys of all the data in the store.
+	 * @return The keys
+	 */
+	std::vector<std::string> keys() const override;
+	/**
+	 * Puts data into the store, to be written to the backing store later.
+	 * @param key The key
+	 * @param persistable The data
+	 * @throw persistence_exception if the backing store has failed.
+	 */
+	void put(const std::string& key, ipersistable_ptr persistable) override;
+	/**
+	 * Removes the data for the key, to be removed from the backing store
+	 * later.
+	 * @param key The key
+	 * @throw persistence_exception if the backing store has failed.
+	 */
+	void remove(const std::string& key) override;
+	/**
+	 * Writes out all the pending changes and syncs the backing store,
+	 * waiting until it's done.
+	 * @throw persistence_exception if the backing store has failed.
+	 */
+	void sync() override;
+};
+
+/** Smart/shared pointer to a write-behind persistence store */
+using write_behind_persistence_ptr = write_behind_persistence::ptr_t;
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		// __mqtt_write_behind_persistence_h
+
@@ -0,0 +1,88 @@
+// publish_credit.cpp
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#include "mqtt/publish_credit.h"
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+publish_credit::publish_credit(size_t maxMsgs /*=0*/, size_t maxBytes /*=0*/)
+		: maxMsgs_(maxMsgs), maxBytes_(maxBytes), msgs_(0), bytes_(0),
+			nwaiting_(0), refused_(false)
+{
+}
+
+bool publish_credit::credit_returned(guard& /*g*/)
+{
+	if (nwaiting_ != 0)
+		cond_.notify_all();
+
+	// The notification is only for someone who was turned away. A message
+	// with a payload of any size fits if a slot is open.
+	if (!refused_ || !fits(0))
+		return false;
+
+	refused_ = false;
+	return true;
+}
+
+bool publish_credit::set_limits(size_t maxMsgs, size_t maxBytes)
+{
+	guard g(lock_);
+	maxMsgs_ = maxMsgs;
+	maxBytes_ = maxBytes;
+	return credit_returned(g);
+}
+
+bool publish_credit::try_acquire(size_t n)
+{
+	guard g(lock_);
+	if (!fits(n)) {
+		refused_ = true;
+		return false;
+	}
+	take(n);
+	return true;
+}
+
+void publish_credit::acquire(size_t n)
+{
+	guard g(lock_);
+	if (!fits(n)) {
+		++nwaiting_;
+		cond_.wait(g, [this,n] { return fits(n); });
+		--nwaiting_;
+	}
+	take(n);
+}
+
+bool publish_credit::release(size_t n)
+{
+	guard g(lock_);
+	if (msgs_ != 0) {
+		--msgs_;
+		bytes_ = (n < bytes_) ? (bytes_ - n) : 0;
+	}
+	return credit_returned(g);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
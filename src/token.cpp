@@ -18,8 +18,10 @@
 
 #include "mqtt/token.h"
 #include "mqtt/async_client.h"
+#include "mqtt/trace.h"
 #include <string>
 #include <cstring>
+#include <stdexcept>
 
 namespace mqtt {
 
@@ -32,8 +34,9 @@ void token::on_failure(void* context, MQTTAsync_failureData* rsp)
 {
 	if (context) {
 		token* tok = static_cast<token*>(context);
+		PAHO_MQTTPP_TRACE_POINT(TOKEN_ACKED, tok);
 		tok->on_failure(rsp);
-		tok->get_client()->remove_token(tok);
+		tok->get_client()->remove_token(tok, rsp ? rsp->code : MQTTASYNC_FAILURE);
 	}
 }
 
@@ -41,8 +44,9 @@ void token::on_success(void* context, MQTTAsync_successData* rsp)
 {
 	if (context) {
 		token* tok = static_cast<token*>(context);
+		PAHO_MQTTPP_TRACE_POINT(TOKEN_ACKED, tok);
 		tok->on_success(rsp);
-		tok->get_client()->remove_token(tok);
+		tok->get_client()->remove_token(tok, MQTTASYNC_SUCCESS);
 	}
 }
 
@@ -55,13 +59,9 @@ void token::on_success(MQTTAsync_successData* rsp)
 	iaction_listener* listener = listener_;
 	tok_ = (rsp) ? rsp->token : 0;
 	rc_ = MQTTASYNC_SUCCESS;
-	complete_ = true;
 	g.unlock();
 
-	// Note: callback always completes before the object is signaled.
-	if (listener)
-		listener->on_success(*this);
-	cond_.notify_all();
+	dispatch_complete(listener);
 }
 
 void token::on_failure(MQTTAsync_failureData* rsp)
@@ -76,13 +76,115 @@ void token::on_failure(MQTTAsync_failureData* rsp)
 		tok_ = 0;
 		rc_ = -1;
 	}
+	g.unlock();
+
+	dispatch_complete(listener);
+}
+
+void token::complete(iaction_listener* listener)
+{
+	guard g(lock_);
+	bool first = !complete_;
 	complete_ = true;
+	int rc = rc_;
+	ptr_t parent = std::move(parent_);
+	std::vector<ptr_t> moreParents;
+	moreParents.swap(moreParents_);
+	std::promise<void>* prom = first ? promise_.get() : nullptr;
+	std::vector<std::function<void()>> conts;
+	conts.swap(continuations_);
 	g.unlock();
 
-	// Note: callback always completes before the obect is signaled.
-	if (listener)
-		listener->on_failure(*this);
+	// Note: callback always completes before the object is signaled.
+	if (listener) {
+		PAHO_MQTTPP_TRACE_POINT(TOKEN_LISTENER, this);
+		if (rc == MQTTASYNC_SUCCESS)
+			listener->on_success(*this);
+		else
+			listener->on_failure(*this);
+	}
+
+	if (prom) {
+		if (rc == MQTTASYNC_SUCCESS)
+			prom->set_value();
+		else
+			prom->set_exception(std::make_exception_ptr(exception(rc)));
+	}
 	cond_.notify_all();
+	PAHO_MQTTPP_TRACE_POINT(TOKEN_COMPLETE, this);
+
+	if (parent)
+		parent->on_child_complete(rc);
+	for (auto& p : moreParents)
+		p->on_child_complete(rc);
+	for (auto& f : conts)
+		f();
+}
+
+bool token::add_continuation(std::function<void()> f)
+{
+	guard g(lock_);
+	if (complete_)
+		return false;
+	continuations_.push_back(std::move(f));
+	return true;
+}
+
+void token::add_parent(ptr_t parent)
+{
+	guard g(lock_);
+	if (!complete_) {
+		if (!parent_)
+			parent_ = std::move(parent);
+		else
+			moreParents_.push_back(std::move(parent));
+		return;
+	}
+	int rc = rc_;
+	g.unlock();
+	parent->on_child_complete(rc);
+}
+
+void token::on_child_complete(int rc)
+{
+	guard g(lock_);
+	if (nPending_ == 0)
+		return;
+
+	if (waitAny_) {
+		rc_ = rc;
+		nPending_ = 0;
+	}
+	else {
+		if (rc != MQTTASYNC_SUCCESS && rc_ == MQTTASYNC_SUCCESS)
+			rc_ = rc;
+		if (--nPending_ != 0)
+			return;
+	}
+
+	iaction_listener* listener = listener_;
+	g.unlock();
+
+	dispatch_complete(listener);
+}
+
+void token::dispatch_complete(iaction_listener* listener)
+{
+	executor_ptr exec;
+	if (listener) {
+		async_client* cli = dynamic_cast<async_client*>(cli_);
+		if (cli)
+			exec = cli->get_executor();
+	}
+
+	if (exec) {
+		// The client lets go of the token as soon as we return, so the
+		// task keeps it alive until the listener is done with it.
+		ptr_t self = shared_from_this();
+		exec->execute_always([self, listener] { self->complete(listener); });
+	}
+	else
+		complete(listener);
 }
 
 // --------------------------------------------------------------------------
@@ -94,7 +196,7 @@ token::token(iasync_client& cli) : token(cli, MQTTAsync_token(0))
 token::token(iasync_client& cli, MQTTAsync_token tok)
 				: tok_(tok), cli_(&cli),
 					userContext_(nullptr), listener_(nullptr),
-					complete_(false), rc_(0)
+					complete_(false), rc_(0), nPending_(0), waitAny_(false)
 {
 }
 
@@ -107,8 +209,49 @@ token::token(iasync_client& cli, const std::string& top)
 token::token(iasync_client& cli, const std::vector<std::string>& topics)
 				: tok_(MQTTAsync_token(0)), topics_(topics), cli_(&cli),
 						userContext_(nullptr), listener_(nullptr),
-						complete_(false), rc_(0)
+						complete_(false), rc_(0), nPending_(0), waitAny_(false)
+{
+}
+
+token::token(iasync_client* cli, size_t n, bool waitAny)
+				: tok_(MQTTAsync_token(0)), cli_(cli),
+					userContext_(nullptr), listener_(nullptr),
+					complete_(false), rc_(0), nPending_(n), waitAny_(waitAny)
+{
+}
+
+token::ptr_t token::make_group(const std::vector<itoken_ptr>& toks, bool waitAny)
+{
+	std::vector<ptr_t> children;
+	children.reserve(toks.size());
+
+	for (const auto& tok : toks) {
+		ptr_t t = std::dynamic_pointer_cast<token>(tok);
+		if (!t)
+			throw std::invalid_argument("Not an mqtt::token");
+		children.push_back(std::move(t));
+	}
+
+	iasync_client* cli = children.empty() ? nullptr : children.front()->cli_;
+	ptr_t grp(new token(cli, children.size(), waitAny));
+
+	if (children.empty())
+		grp->complete(nullptr);
+
+	for (auto& t : children)
+		t->add_parent(grp);
+
+	return grp;
+}
+
+itoken_ptr when_all(const std::vector<itoken_ptr>& toks)
 {
+	return token::make_group(toks, false);
+}
+
+itoken_ptr when_any(const std::vector<itoken_ptr>& toks)
+{
+	return token::make_group(toks, true);
 }
 
 void token::wait_for_completion()
@@ -138,6 +281,40 @@ void token::wait_for_completion(long timeout)
 		throw exception(rc_);
 }
 
+int token::try_get_result() const noexcept
+{
+	guard g(lock_);
+	return complete_ ? rc_ : MQTTASYNC_OPERATION_INCOMPLETE;
+}
+
+int token::try_wait_for_result(long timeout) noexcept
+{
+	guard g(lock_);
+	if (timeout < 0)
+		cond_.wait(g, [this]{return complete_;});
+	else if (timeout > 0)
+		cond_.wait_for(g, std::chrono::milliseconds(timeout), [this]{return complete_;});
+	return complete_ ? rc_ : MQTTASYNC_OPERATION_INCOMPLETE;
+}
+
+std::shared_future<void> token::get_future()
+{
+	guard g(lock_);
+	if (!promise_) {
+		promise_.reset(new std::promise<void>());
+		future_ = promise_->get_future().share();
+
+		// If the action is already done, complete() won't get to it.
+		if (complete_) {
+			if (rc_ == MQTTASYNC_SUCCESS)
+				promise_->set_value();
+			else
+				promise_->set_exception(std::make_exception_ptr(exception(rc_)));
+		}
+	}
+	return future_;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // end namespace mqtt
 }
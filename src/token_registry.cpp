@@ -0,0 +1,152 @@
+// token_registry.cpp
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#include "mqtt/token_registry.h"
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+token_registry::token_registry()
+		: token_registry(std::make_shared<block_pool>())
+{
+}
+
+token_registry::token_registry(block_pool_ptr pool)
+		: tokens_(0, std::hash<const itoken*>(), std::equal_to<const itoken*>(),
+				  token_map::allocator_type(pool)),
+			msgIds_(0, std::hash<int>(), std::equal_to<int>(),
+					msg_id_map::allocator_type(pool))
+{
+}
+
+void token_registry::add(itoken_ptr tok)
+{
+	if (tok) {
+		const itoken* key = tok.get();
+		guard g(lock_);
+		tokens_[key] = entry{ std::move(tok), idelivery_token_ptr(), 0 };
+	}
+}
+
+void token_registry::add(idelivery_token_ptr tok)
+{
+	if (tok) {
+		// Note that the key must be the address of the 'itoken' base, as
+		// that is what comes back to us in remove().
+		const itoken* key = tok.get();
+		guard g(lock_);
+		tokens_[key] = entry{ tok, tok, 0 };
+	}
+}
+
+void token_registry::add(const std::vector<delivery_token_ptr>& toks)
+{
+	guard g(lock_);
+	for (const auto& tok : toks) {
+		if (tok)
+			tokens_[tok.get()] = entry{ tok, tok, 0 };
+	}
+}
+
+void token_registry::set_message_id(const itoken* tok, int msgId)
+{
+	if (!tok || msgId <= 0)
+		return;
+
+	guard g(lock_);
+	index_message_id(tok, msgId);
+}
+
+void token_registry::set_message_ids(const std::vector<std::pair<const itoken*,int>>& ids)
+{
+	guard g(lock_);
+	for (const auto& id : ids) {
+		if (id.first && id.second > 0)
+			index_message_id(id.first, id.second);
+	}
+}
+
+void token_registry::index_message_id(const itoken* tok, int msgId)
+{
+	auto p = tokens_.find(tok);
+	if (p != tokens_.end() && p->second.dtok) {
+		p->second.msgId = msgId;
+		msgIds_[msgId] = tok;
+	}
+}
+
+bool token_registry::remove(const itoken* tok, idelivery_token_ptr* dtok /*=nullptr*/)
+{
+	if (!tok)
+		return false;
+
+	guard g(lock_);
+	auto p = tokens_.find(tok);
+	if (p == tokens_.end())
+		return false;
+
+	// Message ID's get reused, so only drop the index entry if it's ours.
+	if (p->second.msgId > 0) {
+		auto q = msgIds_.find(p->second.msgId);
+		if (q != msgIds_.end() && q->second == tok)
+			msgIds_.erase(q);
+	}
+
+	if (dtok)
+		*dtok = std::move(p->second.dtok);
+
+	// Release the token outside the lock, since it may be the last
+	// reference to it.
+	itoken_ptr last = std::move(p->second.tok);
+	tokens_.erase(p);
+	g.unlock();
+	return true;
+}
+
+idelivery_token_ptr token_registry::get_delivery_token(int msgId) const
+{
+	if (msgId > 0) {
+		guard g(lock_);
+		auto q = msgIds_.find(msgId);
+		if (q != msgIds_.end()) {
+			auto p = tokens_.find(q->second);
+			if (p != tokens_.end())
+				return p->second.dtok;
+		}
+	}
+	return idelivery_token_ptr();
+}
+
+std::vector<idelivery_token_ptr> token_registry::get_delivery_tokens() const
+{
+	std::vector<idelivery_token_ptr> toks;
+	guard g(lock_);
+	toks.reserve(msgIds_.size());
+	for (const auto& p : msgIds_) {
+		auto q = tokens_.find(p.second);
+		if (q != tokens_.end())
+			toks.push_back(q->second.dtok);
+	}
+	return toks;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
@@ -19,15 +19,41 @@
 
 #include "mqtt/topic.h"
 #include "mqtt/async_client.h"
+#include "mqtt/exception.h"
 
 namespace mqtt {
 
 /////////////////////////////////////////////////////////////////////////////
 
+// The name is interned in the async_client's topic cache, if it has room,
+// so that the handle and plain publishes to the topic share it.
+
+topic::topic(const std::string& name, iasync_client& cli)
+				: cli_(&cli), acli_(dynamic_cast<async_client*>(&cli))
+{
+	if (!is_valid_name(name))
+		throw exception(MQTTASYNC_BAD_UTF8_STRING);
+
+	if (acli_)
+		names_ = acli_->shared_topics(name);
+	else
+		names_ = std::make_shared<const std::vector<std::string>>(1, name);
+}
+
+bool topic::is_valid_name(const std::string& name)
+{
+	const size_t MAX_TOPIC_LEN = 65535;
+
+	return !name.empty() && name.length() <= MAX_TOPIC_LEN
+		&& name.find_first_of(std::string("+#\0", 3)) == std::string::npos;
+}
+
 idelivery_token_ptr topic::publish(const void* payload, size_t n,
 								   int qos, bool retained)
 {
-	return cli_->publish(name_, payload, n, qos, retained);
+	if (acli_)
+		return acli_->publish(*this, acli_->make_pooled_message(payload, n, qos, retained));
+	return cli_->publish(get_name(), payload, n, qos, retained);
 }
 
 idelivery_token_ptr topic::publish(const std::string& payload, int qos, bool retained)
@@ -37,7 +63,9 @@ idelivery_token_ptr topic::publish(const std::string& payload, int qos, bool ret
 
 idelivery_token_ptr topic::publish(const_message_ptr msg)
 {
-	return cli_->publish(name_, msg);
+	if (acli_)
+		return acli_->publish(*this, std::move(msg));
+	return cli_->publish(get_name(), msg);
 }
 
 /////////////////////////////////////////////////////////////////////////////
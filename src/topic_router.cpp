@@ -0,0 +1,232 @@
+// topic_router.cpp
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#include "mqtt/topic_router.h"
+#include <stdexcept>
+
+namespace mqtt {
+
+const size_t topic_router::NONE = size_t(-1);
+
+/////////////////////////////////////////////////////////////////////////////
+
+topic_router::topic_router() : nroutes_(0)
+{
+	nodes_.emplace_back(NONE, NONE);
+}
+
+topic_router::topic_router(const topic_router& other)
+		: levels_(other.levels_), nodes_(other.nodes_),
+			freeNodes_(other.freeNodes_), edges_(other.edges_),
+			nroutes_(other.nroutes_)
+{
+	levelIds_.reserve(levels_.size());
+	for (size_t i=0; i<levels_.size(); ++i)
+		levelIds_[level_ref{ levels_[i].data(), levels_[i].size() }] = i;
+}
+
+topic_router& topic_router::operator=(const topic_router& rhs)
+{
+	if (&rhs != this) {
+		topic_router tmp(rhs);
+		levels_.swap(tmp.levels_);
+		levelIds_.swap(tmp.levelIds_);
+		nodes_.swap(tmp.nodes_);
+		freeNodes_.swap(tmp.freeNodes_);
+		edges_.swap(tmp.edges_);
+		nroutes_ = tmp.nroutes_;
+	}
+	return *this;
+}
+
+bool topic_router::is_valid_filter(const std::string& filter)
+{
+	if (filter.empty())
+		return false;
+
+	const size_t n = filter.size();
+	for (size_t i=0; i<n; ++i) {
+		char c = filter[i];
+		if (c == '+' || c == '#') {
+			if (i > 0 && filter[i-1] != '/')
+				return false;
+			if (c == '#' && i != n-1)
+				return false;
+			if (c == '+' && i != n-1 && filter[i+1] != '/')
+				return false;
+		}
+	}
+	return true;
+}
+
+size_t topic_router::intern_level(const char* p, size_t n)
+{
+	size_t id = find_level(p, n);
+	if (id == NONE) {
+		id = levels_.size();
+		levels_.emplace_back(p, n);
+		const std::string& s = levels_.back();
+		levelIds_[level_ref{ s.data(), s.size() }] = id;
+	}
+	return id;
+}
+
+size_t topic_router::new_node(size_t parent, size_t level)
+{
+	if (freeNodes_.empty()) {
+		nodes_.emplace_back(parent, level);
+		return nodes_.size() - 1;
+	}
+	size_t n = freeNodes_.back();
+	freeNodes_.pop_back();
+	nodes_[n] = node(parent, level);
+	return n;
+}
+
+size_t topic_router::find_node(const std::string& filter, bool create)
+{
+	size_t n = 0;
+	const char *p = filter.data(), *end = p + filter.size();
+
+	while (true) {
+		const char* q = std::find(p, end, '/');
+		size_t len = size_t(q - p);
+
+		if (len == 1 && (*p == '+' || *p == '#')) {
+			size_t& child = (*p == '+') ? nodes_[n].plus : nodes_[n].hash;
+			if (child == NONE) {
+				if (!create)
+					return NONE;
+				size_t c = new_node(n, NONE);
+				// The vector may have moved, so don't use 'child'
+				((*p == '+') ? nodes_[n].plus : nodes_[n].hash) = c;
+				n = c;
+			}
+			else
+				n = child;
+		}
+		else {
+			size_t lvl = create ? intern_level(p, len) : find_level(p, len);
+			if (lvl == NONE)
+				return NONE;
+
+			auto it = edges_.find(edge_key(n, lvl));
+			if (it != edges_.end())
+				n = it->second;
+			else if (!create)
+				return NONE;
+			else {
+				size_t c = new_node(n, lvl);
+				edges_[edge_key(n, lvl)] = c;
+				++nodes_[n].nchild;
+				n = c;
+			}
+		}
+
+		if (q == end)
+			break;
+		p = q + 1;
+	}
+	return n;
+}
+
+void topic_router::prune(size_t n)
+{
+	while (n != 0) {
+		node& nd = nodes_[n];
+		if (nd.h || nd.nchild != 0 || nd.plus != NONE || nd.hash != NONE)
+			break;
+
+		size_t parent = nd.parent;
+		node& par = nodes_[parent];
+
+		if (nd.level != NONE) {
+			edges_.erase(edge_key(parent, nd.level));
+			--par.nchild;
+		}
+		else if (par.plus == n)
+			par.plus = NONE;
+		else
+			par.hash = NONE;
+
+		freeNodes_.push_back(n);
+		n = parent;
+	}
+}
+
+void topic_router::add(const std::string& filter, handler h)
+{
+	if (!is_valid_filter(filter))
+		throw std::invalid_argument("Invalid topic filter: " + filter);
+	if (!h)
+		throw std::invalid_argument("Empty handler");
+
+	size_t n = find_node(filter, true);
+	if (!nodes_[n].h)
+		++nroutes_;
+	nodes_[n].h = std::move(h);
+}
+
+bool topic_router::remove(const std::string& filter)
+{
+	if (!is_valid_filter(filter))
+		return false;
+
+	size_t n = find_node(filter, false);
+	if (n == NONE || !nodes_[n].h)
+		return false;
+
+	nodes_[n].h = nullptr;
+	--nroutes_;
+	prune(n);
+	return true;
+}
+
+void topic_router::clear()
+{
+	levels_.clear();
+	levelIds_.clear();
+	nodes_.clear();
+	freeNodes_.clear();
+	edges_.clear();
+	nroutes_ = 0;
+	nodes_.emplace_back(NONE, NONE);
+}
+
+bool topic_router::contains(const std::string& filter) const
+{
+	if (!is_valid_filter(filter))
+		return false;
+
+	size_t n = const_cast<topic_router*>(this)->find_node(filter, false);
+	return n != NONE && bool(nodes_[n].h);
+}
+
+topic_router::handler topic_router::get_handler(const std::string& filter) const
+{
+	if (!is_valid_filter(filter))
+		return handler();
+
+	size_t n = const_cast<topic_router*>(this)->find_node(filter, false);
+	return (n != NONE) ? nodes_[n].h : handler();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
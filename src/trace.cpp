@@ -0,0 +1,192 @@
+// trace.cpp
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#include "mqtt/trace.h"
+#include <chrono>
+#include <unordered_map>
+#include <cstdio>
+#include <cinttypes>
+
+namespace mqtt {
+
+std::atomic<trace_sink*> tracer::sink_(nullptr);
+
+const size_t trace_buffer::DFLT_CAPACITY = 64*1024;
+
+/////////////////////////////////////////////////////////////////////////////
+
+const char* trace_event_name(trace_event evt)
+{
+	switch (evt) {
+		case trace_event::PUBLISH_BEGIN:	return "publish_begin";
+		case trace_event::PUBLISH_SENT:		return "publish_sent";
+		case trace_event::TOKEN_ACKED:		return "token_acked";
+		case trace_event::TOKEN_LISTENER:	return "token_listener";
+		case trace_event::TOKEN_COMPLETE:	return "token_complete";
+		case trace_event::RECEIVE_BEGIN:	return "receive_begin";
+		case trace_event::RECEIVE_MESSAGE:	return "receive_message";
+		case trace_event::RECEIVE_COMPLETE:	return "receive_complete";
+	}
+	return "unknown";
+}
+
+// A small number for the current thread, which is easier to read in a
+// trace than a native thread ID.
+static uint32_t trace_thread_id()
+{
+	static std::atomic<uint32_t> next(0);
+	static thread_local uint32_t id = ++next;
+	return id;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// trace_buffer
+
+trace_buffer::trace_buffer(size_t capacity /*=DFLT_CAPACITY*/) : head_(0)
+{
+	size_t n = 1;
+	while (n < capacity)
+		n <<= 1;
+
+	slots_.reset(new slot[n]);
+	mask_ = n - 1;
+
+	for (size_t i=0; i<n; ++i) {
+		slots_[i].seq.store(0, std::memory_order_relaxed);
+		slots_[i].ns.store(0, std::memory_order_relaxed);
+		slots_[i].id.store(0, std::memory_order_relaxed);
+		slots_[i].threadEvt.store(0, std::memory_order_relaxed);
+	}
+}
+
+void trace_buffer::on_trace(trace_event evt, const void* id) noexcept
+{
+	using namespace std::chrono;
+	uint64_t ns = uint64_t(duration_cast<nanoseconds>(
+						steady_clock::now().time_since_epoch()).count());
+
+	uint64_t n = head_.fetch_add(1, std::memory_order_relaxed);
+	slot& s = slots_[n & mask_];
+
+	// The slot reads as empty while it's being filled in.
+	s.seq.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	s.ns.store(ns, std::memory_order_relaxed);
+	s.id.store(reinterpret_cast<uintptr_t>(id), std::memory_order_relaxed);
+	s.threadEvt.store((uint64_t(trace_thread_id()) << 8) | uint64_t(evt),
+					  std::memory_order_relaxed);
+
+	s.seq.store(n + 1, std::memory_order_release);
+}
+
+std::vector<trace_record> trace_buffer::snapshot() const
+{
+	std::vector<trace_record> recs;
+
+	uint64_t head = head_.load(std::memory_order_acquire),
+			 cap = uint64_t(capacity()),
+			 first = (head > cap) ? (head - cap) : 0;
+
+	recs.reserve(size_t(head - first));
+
+	for (uint64_t n = first; n < head; ++n) {
+		const slot& s = slots_[n & mask_];
+
+		uint64_t seq = s.seq.load(std::memory_order_acquire);
+		trace_record rec;
+		rec.ns = s.ns.load(std::memory_order_relaxed);
+		rec.id = reinterpret_cast<const void*>(s.id.load(std::memory_order_relaxed));
+		uint64_t te = s.threadEvt.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		// Skip a slot that's being written, or was overwritten by a newer
+		// event while it was read.
+		if (seq != n + 1 || s.seq.load(std::memory_order_relaxed) != seq)
+			continue;
+
+		rec.thread = uint32_t(te >> 8);
+		rec.evt = trace_event(te & 0xFF);
+		recs.push_back(rec);
+	}
+	return recs;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Chrome trace exporter
+
+void write_chrome_trace(std::ostream& os, const std::vector<trace_record>& recs)
+{
+	// The spans that were begun, and not yet ended, with their names
+	std::unordered_map<const void*, const char*> spans;
+
+	// Events from different threads can be a little out of order in time.
+	uint64_t t0 = recs.empty() ? 0 : recs.front().ns;
+	for (const auto& rec : recs) {
+		if (rec.ns < t0)
+			t0 = rec.ns;
+	}
+	bool first = true;
+
+	os << "{\"traceEvents\":[";
+
+	for (const auto& rec : recs) {
+		const char *span = nullptr, *ph = "n";
+
+		switch (rec.evt) {
+			case trace_event::PUBLISH_BEGIN:
+			case trace_event::RECEIVE_BEGIN:
+				span = (rec.evt == trace_event::PUBLISH_BEGIN) ? "publish" : "receive";
+				spans[rec.id] = span;
+				ph = "b";
+				break;
+
+			default: {
+				auto p = spans.find(rec.id);
+				if (p == spans.end())
+					continue;
+				span = p->second;
+				if (rec.evt == trace_event::TOKEN_COMPLETE
+						|| rec.evt == trace_event::RECEIVE_COMPLETE) {
+					spans.erase(p);
+					ph = "e";
+				}
+			}
+		}
+
+		// The begin and end take the name of the span; the steps are named
+		// for the stage.
+		const char* name = (*ph == 'n') ? trace_event_name(rec.evt) : span;
+
+		char buf[256];
+		std::snprintf(buf, sizeof(buf),
+			"%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%s\",\"id\":\"0x%" PRIxPTR "\","
+			"\"pid\":1,\"tid\":%u,\"ts\":%.3f}",
+			first ? "" : ",", name, span, ph, reinterpret_cast<uintptr_t>(rec.id), unsigned(rec.thread),
+			double(rec.ns - t0) / 1000.0);
+		os << buf;
+		first = false;
+	}
+
+	os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
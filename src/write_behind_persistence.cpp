@@ -0,0 +1,306 @@
+// write_behind_persistence.cpp
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#include "mqtt/write_behind_persistence.h"
+#include "mqtt/exception.h"
+
+namespace mqtt {
+
+const std::chrono::milliseconds write_behind_persistence::DFLT_SYNC_INTERVAL(5);
+const size_t write_behind_persistence::DFLT_SYNC_RECORDS = 1000;
+
+/////////////////////////////////////////////////////////////////////////////
+
+write_behind_persistence::write_behind_persistence(iclient_persistence& store)
+		: store_(store), syncInterval_(DFLT_SYNC_INTERVAL),
+			syncRecords_(DFLT_SYNC_RECORDS), maxPending_(0),
+			flushNow_(false), stop_(false), running_(false), failed_(false)
+{
+}
+
+write_behind_persistence::~write_behind_persistence()
+{
+	if (thr_.joinable()) {
+		try {
+			close();
+		}
+		catch (...) {}
+	}
+}
+
+// --------------------------------------------------------------------------
+// The background thread
+
+void write_behind_persistence::run()
+{
+	guard g(lock_);
+	while (true) {
+		changeCond_.wait(g, [this]{ return stop_ || !pending_.empty(); });
+		if (pending_.empty())
+			break;
+
+		// Give the batch until the oldest change is due, unless it fills
+		// up first.
+		if (!stop_) {
+			changeCond_.wait_until(g, firstPending_ + syncInterval_, [this] {
+				return stop_ || flushNow_ || pending_.empty()
+					|| (syncRecords_ != 0 && pending_.size() >= syncRecords_)
+					|| (maxPending_ != 0 && pending_.size() >= maxPending_);
+			});
+		}
+
+		flushNow_ = false;
+		writing_.swap(pending_);
+		g.unlock();
+
+		bool ok = true;
+		try {
+			write(writing_);
+		}
+		catch (...) {
+			ok = false;
+		}
+
+		g.lock();
+		if (!ok)
+			failed_ = true;
+		writing_.clear();
+		writtenCond_.notify_all();
+	}
+}
+
+void write_behind_persistence::write(const change_map& batch)
+{
+	guard g(storeLock_);
+
+	// Removes go first, so that a store with a fixed number of slots has
+	// room for the puts.
+	for (const auto& c : batch) {
+		if (!c.second.data)
+			store_.remove(c.first);
+	}
+	for (const auto& c : batch) {
+		if (c.second.data)
+			store_.put(c.first, c.second.data);
+	}
+	store_.sync();
+}
+
+// --------------------------------------------------------------------------
+
+void write_behind_persistence::add_change(guard& g, const std::string& key,
+										  ipersistable_ptr data)
+{
+	if (maxPending_ != 0 && pending_.size() >= maxPending_ && !pending_.count(key)) {
+		writtenCond_.wait(g, [this] {
+			return failed_ || !running_ || pending_.size() < maxPending_;
+		});
+	}
+
+	if (failed_)
+		throw persistence_exception();
+
+	auto it = pending_.find(key);
+
+	if (it == pending_.end()) {
+		// With no change pending for the key, the backing store will have
+		// it once the batch being written is done, if the client has it.
+		bool wasEmpty = pending_.empty();
+		if (wasEmpty)
+			firstPending_ = clock::now();
+
+		pending_.emplace(key, change{ std::move(data), keys_.count(key) != 0 });
+
+		if (wasEmpty || pending_.size() == syncRecords_ || pending_.size() == maxPending_)
+			changeCond_.notify_one();
+	}
+	else if (!data && !it->second.stored) {
+		// Put and removed before it was written. The backing store never
+		// needs to see it.
+		pending_.erase(it);
+	}
+	else
+		it->second.data = std::move(data);
+}
+
+void write_behind_persistence::wait_written(guard& g)
+{
+	writtenCond_.wait(g, [this] {
+		return !running_ || (pending_.empty() && writing_.empty());
+	});
+}
+
+void write_behind_persistence::stop_thread()
+{
+	if (!thr_.joinable())
+		return;
+
+	{
+		guard g(lock_);
+		stop_ = true;
+	}
+	changeCond_.notify_all();
+	thr_.join();
+
+	guard g(lock_);
+	running_ = false;
+	writtenCond_.notify_all();
+}
+
+// --------------------------------------------------------------------------
+
+void write_behind_persistence::set_sync_interval(const std::chrono::milliseconds& interval)
+{
+	guard g(lock_);
+	syncInterval_ = interval;
+	changeCond_.notify_all();
+}
+
+void write_behind_persistence::set_sync_records(size_t n)
+{
+	guard g(lock_);
+	syncRecords_ = n;
+	changeCond_.notify_all();
+}
+
+void write_behind_persistence::set_max_pending(size_t n)
+{
+	guard g(lock_);
+	maxPending_ = n;
+	changeCond_.notify_all();
+	writtenCond_.notify_all();
+}
+
+size_t write_behind_persistence::pending() const
+{
+	guard g(lock_);
+	return pending_.size() + writing_.size();
+}
+
+// --------------------------------------------------------------------------
+
+void write_behind_persistence::open(const std::string& clientId,
+									const std::string& serverURI)
+{
+	stop_thread();
+
+	std::vector<std::string> v;
+	{
+		guard g(storeLock_);
+		store_.open(clientId, serverURI);
+		v = store_.keys();
+	}
+
+	guard g(lock_);
+	keys_.clear();
+	keys_.insert(v.begin(), v.end());
+	pending_.clear();
+	flushNow_ = stop_ = failed_ = false;
+	running_ = true;
+	thr_ = std::thread(&write_behind_persistence::run, this);
+}
+
+void write_behind_persistence::close()
+{
+	stop_thread();
+
+	{
+		guard g(lock_);
+		keys_.clear();
+	}
+
+	guard g(storeLock_);
+	store_.close();
+}
+
+void write_behind_persistence::clear()
+{
+	guard g(lock_);
+	pending_.clear();
+	wait_written(g);
+	keys_.clear();
+
+	guard sg(storeLock_);
+	store_.clear();
+}
+
+bool write_behind_persistence::contains_key(const std::string& key)
+{
+	guard g(lock_);
+	return keys_.count(key) != 0;
+}
+
+ipersistable_ptr write_behind_persistence::get(const std::string& key) const
+{
+	{
+		guard g(lock_);
+		for (const change_map* m : { &pending_, &writing_ }) {
+			auto it = m->find(key);
+			if (it != m->end()) {
+				if (!it->second.data)
+					throw persistence_exception();
+				return it->second.data;
+			}
+		}
+	}
+
+	guard g(storeLock_);
+	return store_.get(key);
+}
+
+std::vector<std::string> write_behind_persistence::keys() const
+{
+	guard g(lock_);
+	return std::vector<std::string>(keys_.begin(), keys_.end());
+}
+
+void write_behind_persistence::put(const std::string& key, ipersistable_ptr persistable)
+{
+	guard g(lock_);
+	add_change(g, key, std::move(persistable));
+	keys_.insert(key);
+}
+
+void write_behind_persistence::remove(const std::string& key)
+{
+	guard g(lock_);
+	if (keys_.count(key) == 0) {
+		if (failed_)
+			throw persistence_exception();
+		return;
+	}
+	add_change(g, key, ipersistable_ptr());
+	keys_.erase(key);
+}
+
+void write_behind_persistence::sync()
+{
+	guard g(lock_);
+	if (!pending_.empty()) {
+		flushNow_ = true;
+		changeCond_.notify_one();
+	}
+	wait_written(g);
+	if (failed_)
+		throw persistence_exception();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
@@ -22,12 +22,19 @@
 
 #include <stdexcept>
 #include <vector>
+#include <thread>
+#include <future>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 
 #include <cppunit/ui/text/TestRunner.h>
 #include <cppunit/extensions/HelperMacros.h>
 
 #include "mqtt/iasync_client.h"
 #include "mqtt/async_client.h"
+#include "mqtt/trace.h"
 
 #include "dummy_client_persistence.h"
 #include "dummy_action_listener.h"
@@ -68,13 +75,51 @@ class async_client_test : public CppUnit::TestFixture
 	CPPUNIT_TEST( test_publish_4_args_failure );
 	CPPUNIT_TEST( test_publish_5_args );
 	CPPUNIT_TEST( test_publish_7_args );
+	CPPUNIT_TEST( test_publish_move );
+	CPPUNIT_TEST( test_publish_batch );
+	CPPUNIT_TEST( test_publish_fanout );
+	CPPUNIT_TEST( test_publish_topic );
+	CPPUNIT_TEST( test_publish_topic_override );
+	CPPUNIT_TEST( test_publish_batch_failure );
+	CPPUNIT_TEST( test_publish_nowait );
+	CPPUNIT_TEST( test_publish_nowait_failure );
+	CPPUNIT_TEST( test_publish_nothrow );
+	CPPUNIT_TEST( test_publish_nothrow_failure );
+	CPPUNIT_TEST( test_try_publish );
+	CPPUNIT_TEST( test_try_publish_failure );
+	CPPUNIT_TEST( test_publish_waits_for_credit );
+	CPPUNIT_TEST( test_credit_handler );
+#if defined(PAHO_MQTTPP_METRICS)
+	CPPUNIT_TEST( test_metrics_publish );
+	CPPUNIT_TEST( test_metrics_failure );
+	CPPUNIT_TEST( test_metrics_executor );
+	CPPUNIT_TEST( test_metrics_receive );
+#endif
+#if defined(PAHO_MQTTPP_TRACE)
+	CPPUNIT_TEST( test_trace_publish );
+	CPPUNIT_TEST( test_trace_try_publish_for );
+#endif
 
 	CPPUNIT_TEST( test_set_callback );
+	CPPUNIT_TEST( test_set_callback_executor );
+	CPPUNIT_TEST( test_zero_copy_receive );
+
+	CPPUNIT_TEST( test_start_stop_consuming );
+	CPPUNIT_TEST( test_consume_message );
+	CPPUNIT_TEST( test_consume_messages );
+	CPPUNIT_TEST( test_consumer_overflow_drop_oldest );
+	CPPUNIT_TEST( test_consumer_overflow_drop_newest );
+	CPPUNIT_TEST( test_add_remove_route );
+	CPPUNIT_TEST( test_add_routes );
 
 	CPPUNIT_TEST( test_subscribe_single_topic_2_args );
 	CPPUNIT_TEST( test_subscribe_single_topic_2_args_failure );
 	CPPUNIT_TEST( test_subscribe_single_topic_4_args );
 	CPPUNIT_TEST( test_subscribe_single_topic_4_args_failure );
+	CPPUNIT_TEST( test_subscribe_single_topic_handler );
+	CPPUNIT_TEST( test_subscribe_single_topic_handler_failure );
+	CPPUNIT_TEST( test_subscribe_many_topics_handlers );
+	CPPUNIT_TEST( test_subscribe_many_topics_handlers_failure );
 	CPPUNIT_TEST( test_subscribe_many_topics_2_args );
 	CPPUNIT_TEST( test_subscribe_many_topics_2_args_failure );
 	CPPUNIT_TEST( test_subscribe_many_topics_4_args );
@@ -88,6 +133,7 @@ class async_client_test : public CppUnit::TestFixture
 	CPPUNIT_TEST( test_unsubscribe_many_topics_1_arg_failure );
 	CPPUNIT_TEST( test_unsubscribe_many_topics_3_args );
 	CPPUNIT_TEST( test_unsubscribe_many_topics_3_args_failure );
+	CPPUNIT_TEST( test_unsubscribe_handler_failure );
 
 	CPPUNIT_TEST_SUITE_END();
 
@@ -508,6 +554,607 @@ public:
 		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_DISCONNECTED, reason_code);
 	}
 
+	void test_publish_move() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+
+		mqtt::itoken_ptr token_conn { cli.connect() };
+		token_conn->wait_for_completion();
+		CPPUNIT_ASSERT(cli.is_connected());
+
+		// A string
+		std::string str(PAYLOAD);
+		mqtt::idelivery_token_ptr token_pub { cli.publish(TOPIC, std::move(str), GOOD_QOS, RETAINED) };
+		CPPUNIT_ASSERT(token_pub);
+		token_pub->wait_for_completion(TIMEOUT);
+
+		mqtt::const_message_ptr msg { token_pub->get_message() };
+		CPPUNIT_ASSERT_EQUAL(PAYLOAD, msg->get_payload());
+		CPPUNIT_ASSERT_EQUAL(GOOD_QOS, msg->get_qos());
+		CPPUNIT_ASSERT_EQUAL(RETAINED, msg->is_retained());
+
+		// A byte vector, which the message takes without a copy
+		std::vector<mqtt::byte> vec(PAYLOAD.begin(), PAYLOAD.end());
+		const mqtt::byte* p = vec.data();
+		token_pub = cli.publish(TOPIC, std::move(vec), GOOD_QOS, RETAINED);
+		token_pub->wait_for_completion(TIMEOUT);
+		CPPUNIT_ASSERT(token_pub->get_message()->get_payload_bytes() == p);
+		CPPUNIT_ASSERT_EQUAL(PAYLOAD, token_pub->get_message()->get_payload());
+
+		// A byte array
+		std::unique_ptr<mqtt::byte[]> buf(new mqtt::byte[PAYLOAD.size()]);
+		std::memcpy(buf.get(), PAYLOAD.data(), PAYLOAD.size());
+		p = buf.get();
+		token_pub = cli.publish(TOPIC, std::move(buf), PAYLOAD.size(), GOOD_QOS, RETAINED);
+		token_pub->wait_for_completion(TIMEOUT);
+		CPPUNIT_ASSERT(token_pub->get_message()->get_payload_bytes() == p);
+		CPPUNIT_ASSERT_EQUAL(PAYLOAD, token_pub->get_message()->get_payload());
+
+		cli.disconnect()->wait_for_completion();
+	}
+
+	void test_publish_batch() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+
+		mqtt::itoken_ptr token_conn { cli.connect() };
+		token_conn->wait_for_completion();
+		CPPUNIT_ASSERT(cli.is_connected());
+
+		mqtt::async_client::publish_collection msgs;
+		for (int i=0; i<10; ++i) {
+			msgs.emplace_back(TOPIC, mqtt::make_message(std::to_string(i),
+														i % 3, false));
+		}
+
+		mqtt::itoken_ptr token_pub { cli.publish_batch(msgs) };
+		CPPUNIT_ASSERT(token_pub);
+		token_pub->wait_for_completion(TIMEOUT);
+		CPPUNIT_ASSERT(wait_no_tokens(cli));
+
+		// An empty batch is done right away
+		mqtt::itoken_ptr token_empty { cli.publish_batch(mqtt::async_client::publish_collection()) };
+		CPPUNIT_ASSERT(token_empty->is_complete());
+
+		mqtt::itoken_ptr token_disconn { cli.disconnect() };
+		token_disconn->wait_for_completion();
+		CPPUNIT_ASSERT_EQUAL(false, cli.is_connected());
+	}
+
+	void test_publish_fanout() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+
+		mqtt::itoken_ptr token_conn { cli.connect() };
+		token_conn->wait_for_completion();
+		CPPUNIT_ASSERT(cli.is_connected());
+
+		std::vector<std::string> topics;
+		for (int i=0; i<10; ++i)
+			topics.push_back(TOPIC + "/" + std::to_string(i));
+
+		mqtt::payload_buffer payload(PAYLOAD);
+
+		mqtt::itoken_ptr token_pub { cli.publish_fanout(topics, payload, GOOD_QOS) };
+		CPPUNIT_ASSERT(token_pub);
+		token_pub->wait_for_completion(TIMEOUT);
+		CPPUNIT_ASSERT(wait_no_tokens(cli));
+
+		// Nothing holds on to the payload once the messages are done
+		CPPUNIT_ASSERT_EQUAL(1L, payload.use_count());
+
+		// An empty set of topics is done right away
+		token_pub = cli.publish_fanout(std::vector<std::string>(), payload, GOOD_QOS);
+		CPPUNIT_ASSERT(token_pub->is_complete());
+
+		try {
+			cli.publish_fanout(topics, payload, BAD_QOS);
+			CPPUNIT_FAIL("publish_fanout() shouldn't accept a bad QoS");
+		}
+		catch (const std::invalid_argument&) {}
+
+		cli.disconnect()->wait_for_completion();
+	}
+
+	void test_publish_topic() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+
+		mqtt::itoken_ptr token_conn { cli.connect() };
+		token_conn->wait_for_completion();
+		CPPUNIT_ASSERT(cli.is_connected());
+
+		mqtt::topic top { TOPIC, cli };
+
+		mqtt::idelivery_token_ptr token_pub { top.publish(PAYLOAD, GOOD_QOS, RETAINED) };
+		token_pub->wait_for_completion(TIMEOUT);
+		CPPUNIT_ASSERT_EQUAL(PAYLOAD, token_pub->get_message()->get_payload());
+		CPPUNIT_ASSERT_EQUAL(RETAINED, token_pub->get_message()->is_retained());
+
+		// The tokens share the topic's name, rather than a copy of it
+		CPPUNIT_ASSERT_EQUAL(TOPIC, token_pub->get_topics()[0]);
+		CPPUNIT_ASSERT(&token_pub->get_topics()[0] == &top.get_name());
+
+		mqtt::idelivery_token_ptr token_pub2 { top.publish(mqtt::make_message(PAYLOAD)) };
+		token_pub2->wait_for_completion(TIMEOUT);
+		CPPUNIT_ASSERT(&token_pub2->get_topics()[0] == &top.get_name());
+
+		// ...as do plain publishes to the same topic
+		token_pub2 = cli.publish(TOPIC, mqtt::make_message(PAYLOAD));
+		token_pub2->wait_for_completion(TIMEOUT);
+		CPPUNIT_ASSERT(&token_pub2->get_topics()[0] == &top.get_name());
+
+		cli.disconnect()->wait_for_completion();
+	}
+
+	// A subclass that overrides the topic publish sees what's published
+	// through a topic.
+	void test_publish_topic_override() {
+		struct counting_client : public mqtt::async_client {
+			int n = 0;
+			counting_client(const std::string& uri, const std::string& id)
+					: async_client(uri, id) {}
+			using async_client::publish;
+			mqtt::idelivery_token_ptr publish(const mqtt::topic& top,
+											  mqtt::const_message_ptr msg) override {
+				++n;
+				return async_client::publish(top, std::move(msg));
+			}
+		};
+
+		counting_client cli { GOOD_SERVER_URI, CLIENT_ID };
+		cli.connect()->wait_for_completion(TIMEOUT);
+
+		mqtt::topic top { TOPIC, cli };
+		top.publish(PAYLOAD, GOOD_QOS, RETAINED)->wait_for_completion(TIMEOUT);
+		top.publish(mqtt::make_message(PAYLOAD))->wait_for_completion(TIMEOUT);
+		CPPUNIT_ASSERT_EQUAL(2, cli.n);
+
+		cli.disconnect()->wait_for_completion(TIMEOUT);
+	}
+
+	void test_publish_batch_failure() {
+		mqtt::async_client cli { BAD_SERVER_URI, CLIENT_ID };
+
+		mqtt::async_client::publish_collection msgs;
+		msgs.emplace_back(TOPIC, mqtt::make_message(PAYLOAD));
+		msgs.emplace_back(TOPIC, mqtt::make_message(PAYLOAD));
+
+		int reason_code = MQTTASYNC_SUCCESS;
+		try {
+			mqtt::itoken_ptr token_pub { cli.publish_batch(msgs) };
+			token_pub->wait_for_completion(TIMEOUT);
+		}
+		catch (mqtt::exception& ex) {
+			reason_code = ex.get_reason_code();
+		}
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_DISCONNECTED, reason_code);
+		CPPUNIT_ASSERT(cli.pendingTokens_.empty());
+	}
+
+	void test_publish_nowait() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+
+		mqtt::itoken_ptr token_conn { cli.connect() };
+		token_conn->wait_for_completion();
+		CPPUNIT_ASSERT(cli.is_connected());
+		CPPUNIT_ASSERT(wait_no_tokens(cli));
+
+		cli.publish_nowait(TOPIC, PAYLOAD.data(), PAYLOAD.size());
+		cli.publish_nowait(TOPIC, mqtt::make_message(PAYLOAD));
+
+		// Nothing is tracked
+		CPPUNIT_ASSERT(cli.pendingTokens_.empty());
+
+		mqtt::itoken_ptr token_disconn { cli.disconnect() };
+		token_disconn->wait_for_completion();
+		CPPUNIT_ASSERT_EQUAL(false, cli.is_connected());
+	}
+
+	void test_publish_nowait_failure() {
+		mqtt::async_client cli { BAD_SERVER_URI, CLIENT_ID };
+
+		int reason_code = MQTTASYNC_SUCCESS;
+		try {
+			cli.publish_nowait(TOPIC, PAYLOAD.data(), PAYLOAD.size());
+		}
+		catch (mqtt::exception& ex) {
+			reason_code = ex.get_reason_code();
+		}
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_DISCONNECTED, reason_code);
+	}
+
+	// A token is signaled just before the client drops it, so wait for
+	// the client to catch up.
+	static bool wait_no_tokens(const mqtt::async_client& cli) {
+		for (int i=0; i<1000 && !cli.pendingTokens_.empty(); ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		return cli.pendingTokens_.empty();
+	}
+
+	// The credit for a message is given back just after its token is
+	// signaled, so wait for it to show up.
+	static bool wait_inflight(const mqtt::async_client& cli, size_t n) {
+		for (int i=0; i<1000 && cli.get_inflight() > n; ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		return cli.get_inflight() <= n;
+	}
+
+	void test_publish_nothrow() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+
+		mqtt::itoken_ptr token_conn { cli.connect() };
+		token_conn->wait_for_completion();
+		CPPUNIT_ASSERT(cli.is_connected());
+
+		auto res = cli.publish(std::nothrow, TOPIC, mqtt::make_message(PAYLOAD, 1, false));
+		CPPUNIT_ASSERT(res);
+		CPPUNIT_ASSERT(res.has_value());
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, res.error());
+		CPPUNIT_ASSERT(*res);
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, (*res)->try_wait_for_result(TIMEOUT));
+
+		auto res2 = cli.publish(std::nothrow, TOPIC, PAYLOAD.data(), PAYLOAD.size(),
+								GOOD_QOS, RETAINED);
+		CPPUNIT_ASSERT(res2);
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, res2.value()->try_wait_for_result(TIMEOUT));
+
+		// Out of credit: refused rather than blocking
+		CPPUNIT_ASSERT(wait_inflight(cli, 0));
+		cli.set_max_inflight(1);
+		auto res3 = cli.publish(std::nothrow, TOPIC, mqtt::make_message(PAYLOAD, 1, false));
+		CPPUNIT_ASSERT(res3);
+		auto res4 = cli.publish(std::nothrow, TOPIC, mqtt::make_message(PAYLOAD, 1, false));
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_MAX_MESSAGES_INFLIGHT, res4.error());
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, res3.value()->try_wait_for_result(TIMEOUT));
+
+		mqtt::itoken_ptr token_disconn { cli.disconnect() };
+		token_disconn->wait_for_completion();
+		CPPUNIT_ASSERT_EQUAL(false, cli.is_connected());
+	}
+
+	void test_publish_nothrow_failure() {
+		mqtt::async_client cli { BAD_SERVER_URI, CLIENT_ID };
+
+		auto res = cli.publish(std::nothrow, TOPIC, mqtt::make_message(PAYLOAD));
+		CPPUNIT_ASSERT(!res);
+		CPPUNIT_ASSERT(!res.has_value());
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_DISCONNECTED, res.error());
+		CPPUNIT_ASSERT(cli.pendingTokens_.empty());
+
+		auto res2 = cli.publish(std::nothrow, TOPIC, PAYLOAD.data(), PAYLOAD.size(),
+								BAD_QOS, RETAINED);
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_BAD_QOS, res2.error());
+
+		// Asking for the value throws the error
+		int reason_code = MQTTASYNC_SUCCESS;
+		try {
+			res.value();
+		}
+		catch (mqtt::exception& ex) {
+			reason_code = ex.get_reason_code();
+		}
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_DISCONNECTED, reason_code);
+	}
+
+	void test_try_publish() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+		CPPUNIT_ASSERT_EQUAL(size_t(0), cli.get_max_inflight());
+		CPPUNIT_ASSERT_EQUAL(size_t(0), cli.get_max_inflight_bytes());
+
+		mqtt::itoken_ptr token_conn { cli.connect() };
+		token_conn->wait_for_completion();
+		CPPUNIT_ASSERT(cli.is_connected());
+
+		cli.set_max_inflight(2, 100);
+		CPPUNIT_ASSERT_EQUAL(size_t(2), cli.get_max_inflight());
+		CPPUNIT_ASSERT_EQUAL(size_t(100), cli.get_max_inflight_bytes());
+
+		auto msg = mqtt::make_message(PAYLOAD, 1, false);
+		mqtt::idelivery_token_ptr tok1, tok2, tok3;
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, cli.try_publish(TOPIC, msg, &tok1));
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, cli.try_publish(TOPIC, msg, &tok2));
+		CPPUNIT_ASSERT(tok1 && tok2);
+		CPPUNIT_ASSERT_EQUAL(size_t(2), cli.get_inflight());
+		CPPUNIT_ASSERT_EQUAL(2*PAYLOAD.size(), cli.get_inflight_bytes());
+
+		// Out of credit: refused, without a token
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_MAX_MESSAGES_INFLIGHT,
+							 cli.try_publish(TOPIC, msg, &tok3));
+		CPPUNIT_ASSERT(!tok3);
+		CPPUNIT_ASSERT_EQUAL(size_t(2), cli.get_pending_delivery_tokens().size());
+
+		tok1->wait_for_completion(TIMEOUT);
+		CPPUNIT_ASSERT(wait_inflight(cli, 1));
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, cli.try_publish(TOPIC, msg, &tok3));
+
+		// The byte limit
+		tok2->wait_for_completion(TIMEOUT);
+		tok3->wait_for_completion(TIMEOUT);
+		CPPUNIT_ASSERT(wait_inflight(cli, 0));
+		cli.set_max_inflight(10, 100);
+		auto big = mqtt::make_message(std::string(60, 'x'), 1, false);
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, cli.try_publish(TOPIC, big));
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_MAX_MESSAGES_INFLIGHT, cli.try_publish(TOPIC, big));
+		CPPUNIT_ASSERT_EQUAL(size_t(60), cli.get_inflight_bytes());
+
+		mqtt::itoken_ptr token_disconn { cli.disconnect() };
+		token_disconn->wait_for_completion();
+		CPPUNIT_ASSERT_EQUAL(false, cli.is_connected());
+	}
+
+	void test_try_publish_failure() {
+		mqtt::async_client cli { BAD_SERVER_URI, CLIENT_ID };
+		cli.set_max_inflight(1);
+
+		// The error comes back, rather than being thrown, and the credit
+		// is given back.
+		mqtt::idelivery_token_ptr tok;
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_DISCONNECTED,
+							 cli.try_publish(TOPIC, mqtt::make_message(PAYLOAD), &tok));
+		CPPUNIT_ASSERT(!tok);
+		CPPUNIT_ASSERT_EQUAL(size_t(0), cli.get_inflight());
+		CPPUNIT_ASSERT(cli.pendingTokens_.empty());
+
+		try {
+			cli.publish(TOPIC, mqtt::make_message(PAYLOAD));
+			CPPUNIT_FAIL("publish() should throw when disconnected");
+		}
+		catch (mqtt::exception&) {}
+		CPPUNIT_ASSERT_EQUAL(size_t(0), cli.get_inflight());
+	}
+
+	void test_publish_waits_for_credit() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+
+		mqtt::itoken_ptr token_conn { cli.connect() };
+		token_conn->wait_for_completion();
+		CPPUNIT_ASSERT(cli.is_connected());
+
+		cli.set_max_inflight(1);
+		auto msg = mqtt::make_message(PAYLOAD, 1, false);
+
+		mqtt::idelivery_token_ptr tok1 { cli.publish(TOPIC, msg) };
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_MAX_MESSAGES_INFLIGHT,
+			cli.try_publish_for(TOPIC, msg, std::chrono::milliseconds(1)));
+
+		// Waits until the first one is done
+		mqtt::idelivery_token_ptr tok2 { cli.publish(TOPIC, msg) };
+		CPPUNIT_ASSERT(tok1->is_complete());
+		CPPUNIT_ASSERT_EQUAL(size_t(1), cli.get_inflight());
+
+		mqtt::idelivery_token_ptr tok3;
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS,
+			cli.try_publish_for(TOPIC, msg, std::chrono::seconds(5), &tok3));
+		CPPUNIT_ASSERT(tok2->is_complete());
+		tok3->wait_for_completion(TIMEOUT);
+
+		mqtt::itoken_ptr token_disconn { cli.disconnect() };
+		token_disconn->wait_for_completion();
+		CPPUNIT_ASSERT_EQUAL(false, cli.is_connected());
+	}
+
+	void test_credit_handler() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+
+		std::atomic<int> ncalls(0);
+		cli.set_credit_handler([&ncalls] { ++ncalls; });
+
+		mqtt::itoken_ptr token_conn { cli.connect() };
+		token_conn->wait_for_completion();
+		CPPUNIT_ASSERT(cli.is_connected());
+
+		cli.set_max_inflight(1);
+		auto msg = mqtt::make_message(PAYLOAD, 1, false);
+
+		// Not called unless a publish was refused
+		cli.publish(TOPIC, msg)->wait_for_completion(TIMEOUT);
+		CPPUNIT_ASSERT(wait_inflight(cli, 0));
+		CPPUNIT_ASSERT_EQUAL(0, ncalls.load());
+
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, cli.try_publish(TOPIC, msg));
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_MAX_MESSAGES_INFLIGHT, cli.try_publish(TOPIC, msg));
+		CPPUNIT_ASSERT(wait_inflight(cli, 0));
+		CPPUNIT_ASSERT_EQUAL(1, ncalls.load());
+
+		// Raising the limit gives credit, too
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, cli.try_publish(TOPIC, msg));
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_MAX_MESSAGES_INFLIGHT, cli.try_publish(TOPIC, msg));
+		cli.set_max_inflight(0);
+		CPPUNIT_ASSERT_EQUAL(2, ncalls.load());
+
+		mqtt::itoken_ptr token_disconn { cli.disconnect() };
+		token_disconn->wait_for_completion();
+		CPPUNIT_ASSERT_EQUAL(false, cli.is_connected());
+	}
+
+#if defined(PAHO_MQTTPP_METRICS)
+	void test_metrics_publish() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+		CPPUNIT_ASSERT(!cli.get_metrics());
+
+		const mqtt::client_metrics& m = cli.enable_metrics();
+		CPPUNIT_ASSERT_EQUAL(&m, cli.get_metrics());
+		CPPUNIT_ASSERT_EQUAL(&m, &cli.enable_metrics());
+
+		mqtt::itoken_ptr token_conn { cli.connect() };
+		token_conn->wait_for_completion();
+		CPPUNIT_ASSERT(cli.is_connected());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), m.reconnects());
+
+		auto msg = mqtt::make_message(PAYLOAD, 1, false);
+		mqtt::idelivery_token_ptr tok { cli.publish(TOPIC, msg) };
+		tok->wait_for_completion(TIMEOUT);
+		cli.publish_nowait(TOPIC, PAYLOAD.data(), PAYLOAD.size());
+
+		CPPUNIT_ASSERT_EQUAL(uint64_t(2), m.messages_published());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(2*PAYLOAD.size()), m.bytes_published());
+		CPPUNIT_ASSERT(wait_inflight(cli, 0));
+		CPPUNIT_ASSERT_EQUAL(int64_t(0), m.tokens_in_flight());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(1), m.publish_latency().count());
+		CPPUNIT_ASSERT(m.publish_latency().max() > 0);
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), m.failures());
+
+		// A lost connection, and the connect after it
+		async_client::on_connection_lost(&cli, nullptr);
+		CPPUNIT_ASSERT_EQUAL(uint64_t(1), m.connections_lost());
+		token_conn = cli.connect();
+		token_conn->wait_for_completion();
+		CPPUNIT_ASSERT_EQUAL(uint64_t(1), m.reconnects());
+
+		mqtt::itoken_ptr token_disconn { cli.disconnect() };
+		token_disconn->wait_for_completion();
+		CPPUNIT_ASSERT_EQUAL(false, cli.is_connected());
+	}
+
+	void test_metrics_failure() {
+		mqtt::async_client cli { BAD_SERVER_URI, CLIENT_ID };
+		const mqtt::client_metrics& m = cli.enable_metrics();
+
+		try {
+			cli.publish(TOPIC, mqtt::make_message(PAYLOAD));
+			CPPUNIT_FAIL("publish() should throw when disconnected");
+		}
+		catch (const mqtt::exception&) {}
+
+		auto res = cli.publish(std::nothrow, TOPIC, mqtt::make_message(PAYLOAD));
+		CPPUNIT_ASSERT(!res);
+
+		CPPUNIT_ASSERT_EQUAL(uint64_t(2), m.failures());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(2), m.failures(MQTTASYNC_DISCONNECTED));
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), m.messages_published());
+		CPPUNIT_ASSERT_EQUAL(int64_t(0), m.tokens_in_flight());
+	}
+
+	// With an executor, the token is removed before its listener runs and
+	// it's signaled, so the metrics can't wait for the token's result.
+	void test_metrics_executor() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+		const mqtt::client_metrics& m = cli.enable_metrics();
+
+		auto exec = std::make_shared<mqtt::thread_executor>();
+		mqtt::test::dummy_callback cb;
+		cli.set_callback(cb, exec);
+
+		cli.connect()->wait_for_completion(TIMEOUT);
+		CPPUNIT_ASSERT(cli.is_connected());
+
+		// Hold up the executor, so the listener can't run yet
+		std::promise<void> hold;
+		std::shared_future<void> held = hold.get_future().share();
+		exec->execute([held] { held.wait(); });
+
+		mqtt::test::dummy_action_listener lsnr;
+		auto tok = cli.publish(TOPIC, mqtt::make_message(PAYLOAD, 1, false),
+							   nullptr, lsnr);
+
+		for (int i=0; i<1000 && m.tokens_in_flight() > 0; ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		CPPUNIT_ASSERT_EQUAL(int64_t(0), m.tokens_in_flight());
+		CPPUNIT_ASSERT(!tok->is_complete());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(1), m.publish_latency().count());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), m.failures());
+
+		hold.set_value();
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, tok->try_wait_for_result(TIMEOUT));
+		CPPUNIT_ASSERT(lsnr.on_success_called);
+
+		cli.disconnect()->wait_for_completion(TIMEOUT);
+	}
+
+	void test_metrics_receive() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+		const mqtt::client_metrics& m = cli.enable_metrics();
+		cli.start_consuming(4);
+
+		// The message and topic, as the C library hands them over
+		MQTTAsync_message* cmsg =
+			static_cast<MQTTAsync_message*>(std::malloc(sizeof(MQTTAsync_message)));
+		*cmsg = MQTTAsync_message(MQTTAsync_message_initializer);
+		cmsg->payload = std::malloc(PAYLOAD.size());
+		std::memcpy(cmsg->payload, PAYLOAD.data(), PAYLOAD.size());
+		cmsg->payloadlen = int(PAYLOAD.size());
+
+		char* topic = static_cast<char*>(std::malloc(TOPIC.size()+1));
+		std::strcpy(topic, TOPIC.c_str());
+
+		async_client::on_message_arrived(&cli, topic, int(TOPIC.size()), cmsg);
+
+		CPPUNIT_ASSERT_EQUAL(uint64_t(1), m.messages_received());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(PAYLOAD.size()), m.bytes_received());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(1), m.callback_time().count());
+		CPPUNIT_ASSERT_EQUAL(size_t(1), cli.consumer_queue_size());
+	}
+#endif
+
+#if defined(PAHO_MQTTPP_TRACE)
+	void test_trace_publish() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+
+		mqtt::itoken_ptr token_conn { cli.connect() };
+		token_conn->wait_for_completion();
+
+		mqtt::trace_buffer buf(64);
+		mqtt::tracer::set_sink(&buf);
+
+		mqtt::test::dummy_action_listener listener;
+		auto msg = mqtt::make_message(PAYLOAD, 1, false);
+		mqtt::idelivery_token_ptr tok { cli.publish(TOPIC, msg, nullptr, listener) };
+		tok->wait_for_completion(TIMEOUT);
+		CPPUNIT_ASSERT(wait_inflight(cli, 0));
+
+		mqtt::tracer::set_sink(nullptr);
+
+		const void* id = dynamic_cast<mqtt::token*>(tok.get());
+		std::vector<mqtt::trace_event> evts;
+		for (const auto& rec : buf.snapshot()) {
+			if (rec.id == id)
+				evts.push_back(rec.evt);
+		}
+
+		std::vector<mqtt::trace_event> expected {
+			mqtt::trace_event::PUBLISH_BEGIN,
+			mqtt::trace_event::PUBLISH_SENT,
+			mqtt::trace_event::TOKEN_ACKED,
+			mqtt::trace_event::TOKEN_LISTENER,
+			mqtt::trace_event::TOKEN_COMPLETE
+		};
+		CPPUNIT_ASSERT(expected == evts);
+
+		mqtt::itoken_ptr token_disconn { cli.disconnect() };
+		token_disconn->wait_for_completion();
+	}
+
+	void test_trace_try_publish_for() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+
+		mqtt::itoken_ptr token_conn { cli.connect() };
+		token_conn->wait_for_completion();
+
+		mqtt::trace_buffer buf(64);
+		mqtt::tracer::set_sink(&buf);
+
+		auto msg = mqtt::make_message(PAYLOAD, 1, false);
+		mqtt::idelivery_token_ptr tok;
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS,
+			cli.try_publish_for(TOPIC, msg, std::chrono::seconds(5), &tok));
+		tok->wait_for_completion(TIMEOUT);
+		CPPUNIT_ASSERT(wait_inflight(cli, 0));
+
+		mqtt::tracer::set_sink(nullptr);
+
+		// The span has its start, so a trace viewer can show it
+		const void* id = dynamic_cast<mqtt::token*>(tok.get());
+		std::vector<mqtt::trace_event> evts;
+		for (const auto& rec : buf.snapshot()) {
+			if (rec.id == id)
+				evts.push_back(rec.evt);
+		}
+		CPPUNIT_ASSERT(!evts.empty());
+		CPPUNIT_ASSERT(mqtt::trace_event::PUBLISH_BEGIN == evts.front());
+		CPPUNIT_ASSERT(mqtt::trace_event::TOKEN_COMPLETE == evts.back());
+
+		mqtt::itoken_ptr token_disconn { cli.disconnect() };
+		token_disconn->wait_for_completion();
+	}
+#endif
+
 	void test_publish_4_args() {
 		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
 		CPPUNIT_ASSERT_EQUAL(false, cli.is_connected());
@@ -563,6 +1210,16 @@ public:
 		CPPUNIT_ASSERT(token_pub);
 		token_pub->wait_for_completion(TIMEOUT);
 
+		// The token and message are pooled, but look just like any others
+		mqtt::const_message_ptr msg { token_pub->get_message() };
+		CPPUNIT_ASSERT(msg);
+		CPPUNIT_ASSERT_EQUAL(PAYLOAD, msg->get_payload());
+		CPPUNIT_ASSERT_EQUAL(payload_size, msg->get_payload_length());
+		CPPUNIT_ASSERT_EQUAL(GOOD_QOS, msg->get_qos());
+		CPPUNIT_ASSERT_EQUAL(RETAINED, msg->is_retained());
+		CPPUNIT_ASSERT_EQUAL(size_t(1), token_pub->get_topics().size());
+		CPPUNIT_ASSERT_EQUAL(TOPIC, token_pub->get_topics()[0]);
+
 		mqtt::itoken_ptr token_disconn { cli.disconnect() };
 		CPPUNIT_ASSERT(token_disconn);
 		token_disconn->wait_for_completion();
@@ -606,6 +1263,227 @@ public:
 		//CPPUNIT_ASSERT(cb.delivery_complete_called);
 	}
 
+//----------------------------------------------------------------------
+// Test async_client::set_callback() with an executor
+//----------------------------------------------------------------------
+
+	void test_set_callback_executor() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+		CPPUNIT_ASSERT(!cli.get_executor());
+
+		auto exec = std::make_shared<mqtt::thread_executor>();
+		std::thread::id execId;
+		exec->execute([&execId] { execId = std::this_thread::get_id(); });
+
+		mqtt::test::dummy_callback cb;
+		cli.set_callback(cb, exec);
+		CPPUNIT_ASSERT(cli.get_executor() == exec);
+
+		// The action listener runs on the executor's thread, and the token
+		// is signaled after it's done.
+		struct listener : public mqtt::test::dummy_action_listener {
+			std::thread::id id;
+			void on_success(const mqtt::itoken& tok) override {
+				id = std::this_thread::get_id();
+				dummy_action_listener::on_success(tok);
+			}
+		} lsnr;
+
+		mqtt::itoken_ptr token_conn { cli.connect(nullptr, lsnr) };
+		token_conn->wait_for_completion(TIMEOUT);
+
+		// Let the executor catch up, so we can look at what it did
+		std::promise<void> done;
+		exec->execute([&done] { done.set_value(); });
+		done.get_future().wait();
+
+		CPPUNIT_ASSERT(lsnr.on_success_called);
+		CPPUNIT_ASSERT(lsnr.id == execId);
+
+		cli.disconnect()->wait_for_completion(TIMEOUT);
+
+		// Setting a callback without an executor clears it
+		cli.set_callback(cb);
+		CPPUNIT_ASSERT(!cli.get_executor());
+	}
+
+//----------------------------------------------------------------------
+// Test async_client::set_zero_copy_receive()
+//----------------------------------------------------------------------
+
+	void test_zero_copy_receive() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+		CPPUNIT_ASSERT(!cli.is_zero_copy_receive());
+
+		cli.set_zero_copy_receive(true);
+		CPPUNIT_ASSERT(cli.is_zero_copy_receive());
+
+		cli.set_zero_copy_receive(false);
+		CPPUNIT_ASSERT(!cli.is_zero_copy_receive());
+	}
+
+//----------------------------------------------------------------------
+// Test the consumer queue
+//----------------------------------------------------------------------
+
+	mqtt::const_message_ptr make_msg(int i) {
+		auto msg = mqtt::make_message(std::to_string(i));
+		msg->set_topic(TOPIC);
+		return msg;
+	}
+
+	void test_start_stop_consuming() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+		CPPUNIT_ASSERT(!cli.is_consuming());
+
+		cli.start_consuming(16);
+		CPPUNIT_ASSERT(cli.is_consuming());
+		CPPUNIT_ASSERT_EQUAL(size_t(16), cli.consumer_queue_capacity());
+		CPPUNIT_ASSERT_EQUAL(size_t(0), cli.consumer_queue_size());
+
+		// Stopping wakes a waiting consumer with a null message
+		std::thread thr([&cli] {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			cli.stop_consuming();
+		});
+		mqtt::const_message_ptr msg { make_msg(0) };
+		CPPUNIT_ASSERT(cli.try_consume_message_for(&msg, std::chrono::seconds(5)));
+		CPPUNIT_ASSERT(!msg);
+		thr.join();
+		CPPUNIT_ASSERT(!cli.is_consuming());
+	}
+
+	void test_consume_message() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+		cli.start_consuming();
+
+		mqtt::const_message_ptr msg;
+		CPPUNIT_ASSERT(!cli.try_consume_message(&msg));
+		CPPUNIT_ASSERT(!cli.try_consume_message_for(&msg, std::chrono::milliseconds(10)));
+
+		cli.queue_message(make_msg(1));
+		cli.queue_message(make_msg(2));
+		cli.queue_message(make_msg(3));
+		CPPUNIT_ASSERT_EQUAL(size_t(3), cli.consumer_queue_size());
+
+		msg = cli.consume_message();
+		CPPUNIT_ASSERT_EQUAL(std::string("1"), msg->get_payload());
+		CPPUNIT_ASSERT_EQUAL(TOPIC, msg->get_topic());
+
+		CPPUNIT_ASSERT(cli.try_consume_message(&msg));
+		CPPUNIT_ASSERT_EQUAL(std::string("2"), msg->get_payload());
+
+		CPPUNIT_ASSERT(cli.try_consume_message_for(&msg, std::chrono::milliseconds(10)));
+		CPPUNIT_ASSERT_EQUAL(std::string("3"), msg->get_payload());
+	}
+
+	void test_consume_messages() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+		cli.start_consuming();
+
+		for (int i=0; i<10; ++i)
+			cli.queue_message(make_msg(i));
+
+		auto msgs = cli.consume_messages(4);
+		CPPUNIT_ASSERT_EQUAL(size_t(4), msgs.size());
+		for (int i=0; i<4; ++i)
+			CPPUNIT_ASSERT_EQUAL(std::to_string(i), msgs[i]->get_payload());
+
+		msgs = cli.consume_messages(100);
+		CPPUNIT_ASSERT_EQUAL(size_t(6), msgs.size());
+		CPPUNIT_ASSERT_EQUAL(std::string("9"), msgs.back()->get_payload());
+	}
+
+	void test_consumer_overflow_drop_oldest() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+		cli.start_consuming(2, mqtt::consumer_overflow::DROP_OLDEST);
+
+		for (int i=0; i<5; ++i)
+			cli.queue_message(make_msg(i));
+
+		CPPUNIT_ASSERT_EQUAL(size_t(2), cli.consumer_queue_size());
+		CPPUNIT_ASSERT_EQUAL(std::string("3"), cli.consume_message()->get_payload());
+		CPPUNIT_ASSERT_EQUAL(std::string("4"), cli.consume_message()->get_payload());
+	}
+
+	void test_consumer_overflow_drop_newest() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+		cli.start_consuming(2, mqtt::consumer_overflow::DROP_NEWEST);
+
+		for (int i=0; i<5; ++i)
+			cli.queue_message(make_msg(i));
+
+		CPPUNIT_ASSERT_EQUAL(size_t(2), cli.consumer_queue_size());
+		CPPUNIT_ASSERT_EQUAL(std::string("0"), cli.consume_message()->get_payload());
+		CPPUNIT_ASSERT_EQUAL(std::string("1"), cli.consume_message()->get_payload());
+	}
+
+//----------------------------------------------------------------------
+// Test the message routes
+//----------------------------------------------------------------------
+
+	void test_add_remove_route() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+		CPPUNIT_ASSERT(!cli.get_router());
+
+		int n = 0;
+		cli.add_route("a/+", [&n](mqtt::const_message_ptr) { ++n; });
+
+		auto router = cli.get_router();
+		CPPUNIT_ASSERT(router);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), router->size());
+
+		auto msg = mqtt::make_message("x");
+		msg->set_topic("a/b");
+		CPPUNIT_ASSERT_EQUAL(size_t(1), router->route(msg));
+		CPPUNIT_ASSERT_EQUAL(1, n);
+
+		CPPUNIT_ASSERT(cli.remove_route("a/+"));
+		CPPUNIT_ASSERT(!cli.remove_route("a/+"));
+		CPPUNIT_ASSERT(cli.get_router()->empty());
+
+		// The old copy is unchanged, for any callback still using it
+		CPPUNIT_ASSERT_EQUAL(size_t(1), router->size());
+
+		try {
+			cli.add_route("a/#/b", [](mqtt::const_message_ptr) {});
+			CPPUNIT_FAIL("client shouldn't accept an invalid filter");
+		}
+		catch (std::invalid_argument& ex) {}
+	}
+
+	void test_add_routes() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+
+		int n = 0;
+		auto h = [&n](mqtt::const_message_ptr) { ++n; };
+		cli.add_routes({ { "a/+", h }, { "b/c", h }, { "#", h } });
+
+		auto router = cli.get_router();
+		CPPUNIT_ASSERT_EQUAL(size_t(3), router->size());
+
+		auto msg = mqtt::make_message("x");
+		msg->set_topic("a/b");
+		CPPUNIT_ASSERT_EQUAL(size_t(2), router->route(msg));
+		CPPUNIT_ASSERT_EQUAL(2, n);
+
+		// A bad entry leaves all the routes as they were
+		try {
+			cli.add_routes({ { "d", h }, { "a/#/b", h } });
+			CPPUNIT_FAIL("client shouldn't accept an invalid filter");
+		}
+		catch (std::invalid_argument& ex) {}
+
+		try {
+			cli.add_routes({ { "d", h }, { "e", mqtt::topic_router::handler() } });
+			CPPUNIT_FAIL("client shouldn't accept an empty handler");
+		}
+		catch (std::invalid_argument& ex) {}
+
+		CPPUNIT_ASSERT_EQUAL(size_t(3), cli.get_router()->size());
+		CPPUNIT_ASSERT(!cli.get_router()->contains("d"));
+	}
+
 //----------------------------------------------------------------------
 // Test async_client::subscribe()
 //----------------------------------------------------------------------
@@ -645,6 +1523,115 @@ public:
 		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_DISCONNECTED, reason_code);
 	}
 
+	void test_subscribe_single_topic_handler() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+
+		mqtt::itoken_ptr token_conn { cli.connect() };
+		token_conn->wait_for_completion();
+		CPPUNIT_ASSERT(cli.is_connected());
+
+		mqtt::itoken_ptr token_sub { cli.subscribe(TOPIC, GOOD_QOS,
+											[](mqtt::const_message_ptr) {}) };
+		CPPUNIT_ASSERT(token_sub);
+		CPPUNIT_ASSERT(cli.get_router()->contains(TOPIC));
+		token_sub->wait_for_completion(TIMEOUT);
+
+		mqtt::itoken_ptr token_unsub { cli.unsubscribe(TOPIC) };
+		CPPUNIT_ASSERT(!cli.get_router()->contains(TOPIC));
+		token_unsub->wait_for_completion(TIMEOUT);
+
+		mqtt::itoken_ptr token_disconn { cli.disconnect() };
+		token_disconn->wait_for_completion();
+		CPPUNIT_ASSERT_EQUAL(false, cli.is_connected());
+	}
+
+	void test_subscribe_single_topic_handler_failure() {
+		mqtt::async_client cli { BAD_SERVER_URI, CLIENT_ID };
+
+		int reason_code = MQTTASYNC_SUCCESS;
+		try {
+			mqtt::itoken_ptr token_sub { cli.subscribe(TOPIC, BAD_QOS,
+											[](mqtt::const_message_ptr) {}) };
+			token_sub->wait_for_completion(TIMEOUT);
+		}
+		catch (mqtt::exception& ex) {
+			reason_code = ex.get_reason_code();
+		}
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_DISCONNECTED, reason_code);
+
+		// The handler isn't left behind
+		CPPUNIT_ASSERT(!cli.get_router()->contains(TOPIC));
+
+		// ...and one that was already there is put back
+		int n = 0;
+		cli.add_route(TOPIC, [&n](mqtt::const_message_ptr) { ++n; });
+
+		reason_code = MQTTASYNC_SUCCESS;
+		try {
+			cli.subscribe(TOPIC, BAD_QOS, [](mqtt::const_message_ptr) {});
+		}
+		catch (mqtt::exception& ex) {
+			reason_code = ex.get_reason_code();
+		}
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_DISCONNECTED, reason_code);
+
+		auto msg = mqtt::make_message("x");
+		msg->set_topic(TOPIC);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), cli.get_router()->route(msg));
+		CPPUNIT_ASSERT_EQUAL(1, n);
+	}
+
+	void test_subscribe_many_topics_handlers() {
+		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
+
+		mqtt::itoken_ptr token_conn { cli.connect() };
+		token_conn->wait_for_completion();
+		CPPUNIT_ASSERT(cli.is_connected());
+
+		mqtt::async_client::route_collection routes {
+			{ "a/+", [](mqtt::const_message_ptr) {} },
+			{ "b/#", [](mqtt::const_message_ptr) {} }
+		};
+		mqtt::itoken_ptr token_sub { cli.subscribe(routes, { 0, 1 }) };
+		CPPUNIT_ASSERT(token_sub);
+		CPPUNIT_ASSERT_EQUAL(size_t(2), cli.get_router()->size());
+		token_sub->wait_for_completion(TIMEOUT);
+
+		mqtt::itoken_ptr token_disconn { cli.disconnect() };
+		token_disconn->wait_for_completion();
+	}
+
+	void test_subscribe_many_topics_handlers_failure() {
+		mqtt::async_client cli { BAD_SERVER_URI, CLIENT_ID };
+
+		int n = 0;
+		cli.add_route("a/+", [&n](mqtt::const_message_ptr) { ++n; });
+
+		mqtt::async_client::route_collection routes {
+			{ "a/+", [](mqtt::const_message_ptr) {} },
+			{ "b/#", [](mqtt::const_message_ptr) {} }
+		};
+
+		int reason_code = MQTTASYNC_SUCCESS;
+		try {
+			cli.subscribe(routes, { 0, 1 });
+		}
+		catch (mqtt::exception& ex) {
+			reason_code = ex.get_reason_code();
+		}
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_DISCONNECTED, reason_code);
+
+		// The routes are back as they were
+		auto router = cli.get_router();
+		CPPUNIT_ASSERT_EQUAL(size_t(1), router->size());
+		CPPUNIT_ASSERT(!router->contains("b/#"));
+
+		auto msg = mqtt::make_message("x");
+		msg->set_topic("a/b");
+		router->route(msg);
+		CPPUNIT_ASSERT_EQUAL(1, n);
+	}
+
 	void test_subscribe_single_topic_4_args() {
 		mqtt::async_client cli { GOOD_SERVER_URI, CLIENT_ID };
 		CPPUNIT_ASSERT_EQUAL(false, cli.is_connected());
@@ -921,6 +1908,34 @@ public:
 		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_DISCONNECTED, reason_code);
 	}
 
+	// A failed unsubscribe leaves the handlers in place, since the server
+	// still sends on the subscriptions.
+	void test_unsubscribe_handler_failure() {
+		mqtt::async_client cli { BAD_SERVER_URI, CLIENT_ID };
+		cli.add_routes({
+			{ "a/+", [](mqtt::const_message_ptr) {} },
+			{ "b/#", [](mqtt::const_message_ptr) {} }
+		});
+
+		try {
+			cli.unsubscribe("a/+");
+			CPPUNIT_FAIL("unsubscribe() should throw when disconnected");
+		}
+		catch (const mqtt::exception&) {}
+		CPPUNIT_ASSERT(cli.get_router()->contains("a/+"));
+
+		mqtt::test::dummy_action_listener listener;
+		try {
+			cli.unsubscribe(mqtt::iasync_client::topic_filter_collection{ "a/+", "b/#", "c" },
+							nullptr, listener);
+			CPPUNIT_FAIL("unsubscribe() should throw when disconnected");
+		}
+		catch (const mqtt::exception&) {}
+		CPPUNIT_ASSERT(cli.get_router()->contains("a/+"));
+		CPPUNIT_ASSERT(cli.get_router()->contains("b/#"));
+		CPPUNIT_ASSERT_EQUAL(size_t(2), cli.get_router()->size());
+	}
+
 };
 
 /////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,195 @@
+// block_pool_test.h
+// Unit tests for the block_pool and pool_allocator classes in the Paho
+// MQTT C++ library.
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_block_pool_test_h
+#define __mqtt_block_pool_test_h
+
+#include <memory>
+#include <unordered_map>
+
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "mqtt/block_pool.h"
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+class block_pool_test : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( block_pool_test );
+
+	CPPUNIT_TEST( test_dflt_constructor );
+	CPPUNIT_TEST( test_reuse );
+	CPPUNIT_TEST( test_block_sizes );
+	CPPUNIT_TEST( test_large_block );
+	CPPUNIT_TEST( test_clear );
+	CPPUNIT_TEST( test_allocate_shared );
+	CPPUNIT_TEST( test_container );
+
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp() {}
+	void tearDown() {}
+
+// ----------------------------------------------------------------------
+// Test the default constructor
+// ----------------------------------------------------------------------
+
+	void test_dflt_constructor() {
+		mqtt::block_pool pool;
+		CPPUNIT_ASSERT_EQUAL(size_t(0), pool.num_free());
+	}
+
+// ----------------------------------------------------------------------
+// Test that freed blocks get reused
+// ----------------------------------------------------------------------
+
+	void test_reuse() {
+		mqtt::block_pool pool;
+
+		void* p = pool.allocate(40);
+		CPPUNIT_ASSERT(p != nullptr);
+		pool.deallocate(p, 40);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), pool.num_free());
+
+		void* q = pool.allocate(40);
+		CPPUNIT_ASSERT(p == q);
+		CPPUNIT_ASSERT_EQUAL(size_t(0), pool.num_free());
+		pool.deallocate(q, 40);
+	}
+
+// ----------------------------------------------------------------------
+// Test that blocks are only reused for requests of the same size
+// ----------------------------------------------------------------------
+
+	void test_block_sizes() {
+		mqtt::block_pool pool;
+
+		void* p = pool.allocate(block_pool::MIN_BLOCK_SIZE);
+		pool.deallocate(p, block_pool::MIN_BLOCK_SIZE);
+
+		// A larger request needs a larger block
+		void* q = pool.allocate(block_pool::MIN_BLOCK_SIZE+1);
+		CPPUNIT_ASSERT(p != q);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), pool.num_free());
+
+		// A smaller one rounds up to the same block
+		void* r = pool.allocate(1);
+		CPPUNIT_ASSERT(p == r);
+
+		pool.deallocate(q, block_pool::MIN_BLOCK_SIZE+1);
+		pool.deallocate(r, 1);
+		CPPUNIT_ASSERT_EQUAL(size_t(2), pool.num_free());
+	}
+
+// ----------------------------------------------------------------------
+// Test that large blocks bypass the pool
+// ----------------------------------------------------------------------
+
+	void test_large_block() {
+		mqtt::block_pool pool;
+		const size_t N = block_pool::MAX_BLOCK_SIZE+1;
+
+		void* p = pool.allocate(N);
+		CPPUNIT_ASSERT(p != nullptr);
+		pool.deallocate(p, N);
+		CPPUNIT_ASSERT_EQUAL(size_t(0), pool.num_free());
+
+		p = pool.allocate(block_pool::MAX_BLOCK_SIZE);
+		pool.deallocate(p, block_pool::MAX_BLOCK_SIZE);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), pool.num_free());
+	}
+
+// ----------------------------------------------------------------------
+// Test clear()
+// ----------------------------------------------------------------------
+
+	void test_clear() {
+		mqtt::block_pool pool;
+
+		void* p = pool.allocate(10);
+		void* q = pool.allocate(200);
+		pool.deallocate(p, 10);
+		pool.deallocate(q, 200);
+		CPPUNIT_ASSERT_EQUAL(size_t(2), pool.num_free());
+
+		pool.clear();
+		CPPUNIT_ASSERT_EQUAL(size_t(0), pool.num_free());
+	}
+
+// ----------------------------------------------------------------------
+// Test shared objects created with a pool allocator
+// ----------------------------------------------------------------------
+
+	void test_allocate_shared() {
+		auto pool = std::make_shared<mqtt::block_pool>();
+		std::weak_ptr<mqtt::block_pool> wpool(pool);
+
+		auto p = std::allocate_shared<std::string>(
+					mqtt::pool_allocator<std::string>(pool), "Hello");
+		CPPUNIT_ASSERT_EQUAL(std::string("Hello"), *p);
+
+		// The object keeps the pool alive
+		pool.reset();
+		CPPUNIT_ASSERT(!wpool.expired());
+
+		p.reset();
+		CPPUNIT_ASSERT(wpool.expired());
+	}
+
+// ----------------------------------------------------------------------
+// Test a container that uses a pool allocator
+// ----------------------------------------------------------------------
+
+	void test_container() {
+		using alloc_type = mqtt::pool_allocator<std::pair<const int, int>>;
+		using map_type = std::unordered_map<int, int, std::hash<int>,
+											std::equal_to<int>, alloc_type>;
+
+		auto pool = std::make_shared<mqtt::block_pool>();
+		{
+			map_type m(0, std::hash<int>(), std::equal_to<int>(), alloc_type(pool));
+			for (int i=0; i<100; ++i)
+				m[i] = i;
+			CPPUNIT_ASSERT_EQUAL(size_t(100), m.size());
+			m.clear();
+		}
+		size_t n = pool->num_free();
+		CPPUNIT_ASSERT(n >= 100);
+
+		// Refilling the map reuses the nodes
+		map_type m(0, std::hash<int>(), std::equal_to<int>(), alloc_type(pool));
+		m.rehash(128);
+		for (int i=0; i<100; ++i)
+			m[i] = i;
+		CPPUNIT_ASSERT(pool->num_free() < n);
+		CPPUNIT_ASSERT(m.get_allocator() == alloc_type(pool));
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		//  __mqtt_block_pool_test_h
+
@@ -0,0 +1,244 @@
+// client_metrics_test.h
+// Unit tests for the client_metrics and latency_histogram classes in the
+// Paho MQTT C++ library.
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_client_metrics_test_h
+#define __mqtt_client_metrics_test_h
+
+#include <thread>
+#include <vector>
+#include <chrono>
+
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "MQTTAsync.h"
+#include "mqtt/client_metrics.h"
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+class client_metrics_test : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( client_metrics_test );
+
+	CPPUNIT_TEST( test_bucket_index );
+	CPPUNIT_TEST( test_bucket_bounds );
+	CPPUNIT_TEST( test_record );
+	CPPUNIT_TEST( test_record_duration );
+	CPPUNIT_TEST( test_percentile );
+	CPPUNIT_TEST( test_reset );
+	CPPUNIT_TEST( test_record_threads );
+
+	CPPUNIT_TEST( test_dflt_constructor );
+	CPPUNIT_TEST( test_counters );
+	CPPUNIT_TEST( test_failures );
+	CPPUNIT_TEST( test_reconnects );
+
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp() {}
+	void tearDown() {}
+
+// ----------------------------------------------------------------------
+// latency_histogram
+// ----------------------------------------------------------------------
+
+	void test_bucket_index() {
+		// Small values are exact
+		for (uint64_t v=0; v<16; ++v)
+			CPPUNIT_ASSERT_EQUAL(size_t(v), latency_histogram::bucket_index(v));
+
+		CPPUNIT_ASSERT_EQUAL(size_t(16), latency_histogram::bucket_index(16));
+		CPPUNIT_ASSERT_EQUAL(size_t(31), latency_histogram::bucket_index(31));
+		CPPUNIT_ASSERT_EQUAL(size_t(32), latency_histogram::bucket_index(32));
+		CPPUNIT_ASSERT_EQUAL(size_t(32), latency_histogram::bucket_index(33));
+		CPPUNIT_ASSERT_EQUAL(size_t(33), latency_histogram::bucket_index(34));
+
+		CPPUNIT_ASSERT_EQUAL(latency_histogram::NUM_BUCKETS-1,
+							 latency_histogram::bucket_index(~uint64_t(0)));
+	}
+
+	void test_bucket_bounds() {
+		for (size_t i=0; i<latency_histogram::NUM_BUCKETS; ++i) {
+			uint64_t lo = latency_histogram::bucket_lower(i),
+					 hi = latency_histogram::bucket_upper(i);
+			CPPUNIT_ASSERT(lo <= hi);
+			CPPUNIT_ASSERT_EQUAL(i, latency_histogram::bucket_index(lo));
+			CPPUNIT_ASSERT_EQUAL(i, latency_histogram::bucket_index(hi));
+
+			// The buckets are contiguous
+			if (i+1 < latency_histogram::NUM_BUCKETS)
+				CPPUNIT_ASSERT_EQUAL(hi+1, latency_histogram::bucket_lower(i+1));
+
+			// ...and no wider than 1/16 of their values
+			CPPUNIT_ASSERT((hi - lo) <= lo / 16);
+		}
+	}
+
+	void test_record() {
+		latency_histogram h;
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), h.count());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), h.min());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), h.max());
+		CPPUNIT_ASSERT_EQUAL(0.0, h.mean());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), h.percentile(50));
+
+		h.record(uint64_t(100));
+		h.record(uint64_t(300));
+		h.record(uint64_t(5));
+
+		CPPUNIT_ASSERT_EQUAL(uint64_t(3), h.count());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(5), h.min());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(300), h.max());
+		CPPUNIT_ASSERT_EQUAL(135.0, h.mean());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(1), h.count_at(5));
+		CPPUNIT_ASSERT_EQUAL(uint64_t(1), h.count_at(latency_histogram::bucket_index(100)));
+	}
+
+	void test_record_duration() {
+		latency_histogram h;
+		h.record(std::chrono::microseconds(2));
+		h.record(std::chrono::nanoseconds(-5));
+
+		CPPUNIT_ASSERT_EQUAL(uint64_t(2), h.count());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), h.min());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(2000), h.max());
+	}
+
+	void test_percentile() {
+		latency_histogram h;
+		for (uint64_t v=1; v<=1000; ++v)
+			h.record(v * 1000);
+
+		// Within the resolution of the buckets
+		uint64_t p50 = h.percentile(50),
+				 p99 = h.percentile(99);
+		CPPUNIT_ASSERT(p50 >= 500000 && p50 <= 500000 + 500000/16);
+		CPPUNIT_ASSERT(p99 >= 990000 && p99 <= 990000 + 990000/16);
+
+		// The ends are exact
+		CPPUNIT_ASSERT_EQUAL(uint64_t(1000000), h.percentile(100));
+		CPPUNIT_ASSERT_EQUAL(uint64_t(1000000), h.percentile(150));
+		CPPUNIT_ASSERT(h.percentile(0) <= 1000 + 1000/16);
+	}
+
+	void test_reset() {
+		latency_histogram h;
+		h.record(uint64_t(42));
+		h.reset();
+
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), h.count());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), h.count_at(latency_histogram::bucket_index(42)));
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), h.min());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), h.max());
+
+		h.record(uint64_t(7));
+		CPPUNIT_ASSERT_EQUAL(uint64_t(7), h.min());
+	}
+
+	void test_record_threads() {
+		const int N_THR = 4, N = 10000;
+		latency_histogram h;
+
+		std::vector<std::thread> thrs;
+		for (int i=0; i<N_THR; ++i) {
+			thrs.emplace_back([&h, i] {
+				for (int j=0; j<N; ++j)
+					h.record(uint64_t(i*N + j));
+			});
+		}
+		for (auto& thr : thrs)
+			thr.join();
+
+		CPPUNIT_ASSERT_EQUAL(uint64_t(N_THR*N), h.count());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), h.min());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(N_THR*N-1), h.max());
+	}
+
+// ----------------------------------------------------------------------
+// client_metrics
+// ----------------------------------------------------------------------
+
+	void test_dflt_constructor() {
+		client_metrics m;
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), m.messages_published());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), m.bytes_published());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), m.messages_received());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), m.bytes_received());
+		CPPUNIT_ASSERT_EQUAL(int64_t(0), m.tokens_in_flight());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), m.failures());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), m.connections_lost());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), m.reconnects());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), m.publish_latency().count());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), m.callback_time().count());
+	}
+
+	void test_counters() {
+		client_metrics m;
+		m.on_publish(10);
+		m.on_publish(20);
+		m.on_receive(5);
+		m.on_token_added(3);
+		m.on_token_removed();
+
+		CPPUNIT_ASSERT_EQUAL(uint64_t(2), m.messages_published());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(30), m.bytes_published());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(1), m.messages_received());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(5), m.bytes_received());
+		CPPUNIT_ASSERT_EQUAL(int64_t(2), m.tokens_in_flight());
+	}
+
+	void test_failures() {
+		client_metrics m;
+		m.on_failure(MQTTASYNC_DISCONNECTED);
+		m.on_failure(MQTTASYNC_DISCONNECTED);
+		m.on_failure(0x87);		// Not authorized, from the server
+		m.on_failure(-1000);	// Out of range
+
+		CPPUNIT_ASSERT_EQUAL(uint64_t(4), m.failures());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(2), m.failures(MQTTASYNC_DISCONNECTED));
+		CPPUNIT_ASSERT_EQUAL(uint64_t(1), m.failures(0x87));
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), m.failures(MQTTASYNC_FAILURE));
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), m.failures(-1000));
+	}
+
+	void test_reconnects() {
+		client_metrics m;
+
+		// The first connect isn't a reconnect
+		m.on_connect();
+		CPPUNIT_ASSERT_EQUAL(uint64_t(0), m.reconnects());
+
+		m.on_connection_lost();
+		CPPUNIT_ASSERT_EQUAL(uint64_t(1), m.connections_lost());
+		m.on_connect();
+		m.on_connect();
+		CPPUNIT_ASSERT_EQUAL(uint64_t(1), m.reconnects());
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		//  __mqtt_client_metrics_test_h
+
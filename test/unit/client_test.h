@@ -22,6 +22,8 @@
 
 #include <stdexcept>
 #include <vector>
+#include <thread>
+#include <chrono>
 
 #include <cppunit/ui/text/TestRunner.h>
 #include <cppunit/extensions/HelperMacros.h>
@@ -60,6 +62,8 @@ class client_test : public CppUnit::TestFixture
 	CPPUNIT_TEST( test_publish_pointer_2_args_failure );
 	CPPUNIT_TEST( test_publish_reference_2_args );
 	CPPUNIT_TEST( test_publish_5_args );
+	CPPUNIT_TEST( test_publish_window );
+	CPPUNIT_TEST( test_publish_window_reference );
 
 	CPPUNIT_TEST( test_set_callback );
 
@@ -305,6 +309,82 @@ public:
 		CPPUNIT_ASSERT_EQUAL(false, cli.is_connected());
 	}
 
+	// A token is signaled just before the client drops it, so wait for
+	// the client to catch up.
+	static bool wait_no_tokens(const mqtt::client& cli) {
+		for (int i=0; i<1000 && !cli.get_pending_delivery_tokens().empty(); ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		return cli.get_pending_delivery_tokens().empty();
+	}
+
+	void test_publish_window() {
+		mqtt::client cli { GOOD_SERVER_URI, CLIENT_ID };
+		CPPUNIT_ASSERT_EQUAL(size_t(1), cli.get_publish_window());
+
+		cli.connect();
+		CPPUNIT_ASSERT(cli.is_connected());
+
+		// By default, each message is acknowledged before publish() returns
+		const void* payload { PAYLOAD.c_str() };
+		const size_t payload_size { PAYLOAD.size() };
+		cli.publish(TOPIC, payload, payload_size, 1, RETAINED);
+		CPPUNIT_ASSERT(wait_no_tokens(cli));
+
+		// With a window, publish() doesn't wait until it's full
+		const size_t WINDOW = 8;
+		cli.set_publish_window(WINDOW);
+		CPPUNIT_ASSERT_EQUAL(WINDOW, cli.get_publish_window());
+
+		for (size_t i=1; i<WINDOW; ++i)
+			cli.publish(TOPIC, payload, payload_size, 1, RETAINED);
+		CPPUNIT_ASSERT(!cli.inflight_.empty());
+
+		// ...and when it is, it waits for room
+		for (size_t i=0; i<2*WINDOW; ++i) {
+			cli.publish(TOPIC, payload, payload_size, 1, RETAINED);
+			CPPUNIT_ASSERT(cli.inflight_.size() < WINDOW);
+		}
+
+		cli.flush();
+		CPPUNIT_ASSERT(cli.inflight_.empty());
+		CPPUNIT_ASSERT(wait_no_tokens(cli));
+
+		// A message that's waited on right away waits for the older ones
+		// first, even when the window was shrunk under them
+		for (size_t i=0; i<WINDOW-1; ++i)
+			cli.publish(TOPIC, payload, payload_size, 1, RETAINED);
+		CPPUNIT_ASSERT(!cli.inflight_.empty());
+		cli.set_publish_window(1);
+		mqtt::message msg(PAYLOAD, 1, RETAINED);
+		cli.publish(TOPIC, msg);
+		CPPUNIT_ASSERT(cli.inflight_.empty());
+		cli.set_publish_window(WINDOW);
+
+		// Disconnecting waits for the window
+		cli.publish(TOPIC, payload, payload_size, 1, RETAINED);
+		cli.disconnect();
+		CPPUNIT_ASSERT_EQUAL(false, cli.is_connected());
+		CPPUNIT_ASSERT(cli.inflight_.empty());
+		CPPUNIT_ASSERT(wait_no_tokens(cli));
+	}
+
+	void test_publish_window_reference() {
+		mqtt::client cli { GOOD_SERVER_URI, CLIENT_ID };
+		cli.set_publish_window(4);
+		cli.connect();
+
+		// The message goes out of scope while it's in the window
+		{
+			mqtt::message msg { PAYLOAD };
+			msg.set_qos(1);
+			cli.publish(TOPIC, msg);
+		}
+		cli.flush();
+
+		cli.disconnect();
+		CPPUNIT_ASSERT_EQUAL(false, cli.is_connected());
+	}
+
 //----------------------------------------------------------------------
 // Test client::set_callback()
 //----------------------------------------------------------------------
@@ -0,0 +1,273 @@
+// executor_test.h
+// Unit tests for the executor classes in the Paho MQTT C++ library.
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_executor_test_h
+#define __mqtt_executor_test_h
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+#include <map>
+#include <string>
+#include <stdexcept>
+
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "mqtt/executor.h"
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+class executor_test : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( executor_test );
+
+	CPPUNIT_TEST( test_inline_executor );
+	CPPUNIT_TEST( test_thread_executor );
+	CPPUNIT_TEST( test_thread_executor_exception );
+	CPPUNIT_TEST( test_thread_executor_capacity );
+	CPPUNIT_TEST( test_thread_executor_overflow );
+	CPPUNIT_TEST( test_thread_executor_destroy_from_task );
+	CPPUNIT_TEST( test_thread_pool_executor );
+	CPPUNIT_TEST( test_thread_pool_executor_key_order );
+
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp() {}
+	void tearDown() {}
+
+// ----------------------------------------------------------------------
+// Test that the inline executor runs tasks right away, on the caller's
+// thread.
+// ----------------------------------------------------------------------
+
+	void test_inline_executor() {
+		mqtt::inline_executor exec;
+		std::thread::id id;
+
+		exec.execute([&id] { id = std::this_thread::get_id(); });
+		CPPUNIT_ASSERT(id == std::this_thread::get_id());
+
+		int n = 0;
+		exec.execute("key", [&n] { ++n; });
+		CPPUNIT_ASSERT_EQUAL(1, n);
+	}
+
+// ----------------------------------------------------------------------
+// Test that the thread executor runs all the tasks, in order, on another
+// thread.
+// ----------------------------------------------------------------------
+
+	void test_thread_executor() {
+		std::vector<int> v;
+		std::thread::id id;
+		{
+			mqtt::thread_executor exec;
+			exec.execute([&id] { id = std::this_thread::get_id(); });
+			for (int i=0; i<100; ++i)
+				exec.execute("key", [&v, i] { v.push_back(i); });
+		}
+		// The destructor ran the tasks that were still queued.
+		CPPUNIT_ASSERT(id != std::thread::id());
+		CPPUNIT_ASSERT(id != std::this_thread::get_id());
+
+		CPPUNIT_ASSERT_EQUAL(size_t(100), v.size());
+		for (int i=0; i<100; ++i)
+			CPPUNIT_ASSERT_EQUAL(i, v[i]);
+	}
+
+// ----------------------------------------------------------------------
+// Test that an exception in a task doesn't stop the thread.
+// ----------------------------------------------------------------------
+
+	void test_thread_executor_exception() {
+		bool ran = false;
+		{
+			mqtt::thread_executor exec;
+			exec.execute([] { throw std::runtime_error("oops"); });
+			exec.execute([&ran] { ran = true; });
+		}
+		CPPUNIT_ASSERT(ran);
+	}
+
+// ----------------------------------------------------------------------
+// Test the queue capacity of the thread executor
+// ----------------------------------------------------------------------
+
+	void test_thread_executor_capacity() {
+		mqtt::thread_executor exec(8);
+		CPPUNIT_ASSERT_EQUAL(size_t(8), exec.capacity());
+
+		mqtt::thread_executor dflt;
+		CPPUNIT_ASSERT_EQUAL(mqtt::thread_executor::DFLT_CAPACITY, dflt.capacity());
+		CPPUNIT_ASSERT(mqtt::executor_overflow::DROP == dflt.get_overflow());
+	}
+
+// ----------------------------------------------------------------------
+// Test that a full thread executor drops tasks without waiting, but still
+// runs the ones that must not be lost.
+// ----------------------------------------------------------------------
+
+	void test_thread_executor_overflow() {
+		std::mutex m;
+		std::condition_variable cv;
+		bool started = false, release = false;
+		int n = 0;
+		std::thread::id always_id;
+
+		{
+			mqtt::thread_executor exec(1);
+
+			// Hold up the thread, then fill the queue
+			exec.execute([&m, &cv, &started, &release] {
+				std::unique_lock<std::mutex> g(m);
+				started = true;
+				cv.notify_all();
+				cv.wait(g, [&release] { return release; });
+			});
+			{
+				std::unique_lock<std::mutex> g(m);
+				cv.wait(g, [&started] { return started; });
+			}
+			exec.execute([&n] { ++n; });
+			CPPUNIT_ASSERT_EQUAL(size_t(1), exec.size());
+
+			exec.execute([&n] { ++n; });
+			exec.execute([&n] { ++n; });
+			CPPUNIT_ASSERT_EQUAL(size_t(2), exec.dropped());
+
+			exec.execute_always([&always_id] {
+				always_id = std::this_thread::get_id();
+			});
+			CPPUNIT_ASSERT(std::this_thread::get_id() == always_id);
+			CPPUNIT_ASSERT_EQUAL(size_t(2), exec.dropped());
+
+			std::lock_guard<std::mutex> g(m);
+			release = true;
+			cv.notify_all();
+		}
+		CPPUNIT_ASSERT_EQUAL(1, n);
+	}
+
+// ----------------------------------------------------------------------
+// Test that a task can drop the last reference to its own executor, and
+// that the tasks queued behind it still run.
+// ----------------------------------------------------------------------
+
+	void test_thread_executor_destroy_from_task() {
+		std::mutex m;
+		std::condition_variable cv;
+		int n = 0;
+
+		auto exec = std::make_shared<mqtt::thread_executor>(1,
+						mqtt::executor_overflow::BLOCK);
+		auto p = exec.get();
+
+		p->execute([&exec, &m, &cv, &n] {
+			// Wait for the next task to fill the queue.
+			{
+				std::unique_lock<std::mutex> g(m);
+				cv.wait(g, [&n] { return n == 1; });
+			}
+			exec.reset();
+		});
+
+		p->execute([&m, &cv, &n] {
+			std::unique_lock<std::mutex> g(m);
+			++n;
+			cv.notify_all();
+		});
+
+		{
+			std::unique_lock<std::mutex> g(m);
+			++n;
+			cv.notify_all();
+			CPPUNIT_ASSERT(cv.wait_for(g, std::chrono::seconds(5),
+									   [&n] { return n == 2; }));
+		}
+		CPPUNIT_ASSERT(!exec);
+	}
+
+// ----------------------------------------------------------------------
+// Test that the thread pool runs all the tasks
+// ----------------------------------------------------------------------
+
+	void test_thread_pool_executor() {
+		std::mutex m;
+		int n = 0;
+		{
+			mqtt::thread_pool_executor exec(4);
+			CPPUNIT_ASSERT_EQUAL(size_t(4), exec.num_threads());
+
+			for (int i=0; i<100; ++i) {
+				exec.execute([&m, &n] {
+					std::lock_guard<std::mutex> g(m);
+					++n;
+				});
+			}
+		}
+		CPPUNIT_ASSERT_EQUAL(100, n);
+
+		// There's always at least one thread
+		mqtt::thread_pool_executor exec0(0);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), exec0.num_threads());
+	}
+
+// ----------------------------------------------------------------------
+// Test that the thread pool runs the tasks for each key in order.
+// ----------------------------------------------------------------------
+
+	void test_thread_pool_executor_key_order() {
+		const int N_KEYS = 8, N = 200;
+
+		std::mutex m;
+		std::map<std::string, std::vector<int>> seqs;
+		{
+			mqtt::thread_pool_executor exec(4, 16, mqtt::executor_overflow::BLOCK);
+			for (int i=0; i<N; ++i) {
+				for (int k=0; k<N_KEYS; ++k) {
+					std::string key = "topic/" + std::to_string(k);
+					exec.execute(key, [&m, &seqs, key, i] {
+						std::lock_guard<std::mutex> g(m);
+						seqs[key].push_back(i);
+					});
+				}
+			}
+		}
+
+		CPPUNIT_ASSERT_EQUAL(size_t(N_KEYS), seqs.size());
+		for (const auto& s : seqs) {
+			CPPUNIT_ASSERT_EQUAL(size_t(N), s.second.size());
+			for (int i=0; i<N; ++i)
+				CPPUNIT_ASSERT_EQUAL(i, s.second[i]);
+		}
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		//  __mqtt_executor_test_h
+
@@ -22,6 +22,11 @@
 
 #include <algorithm>
 #include <memory>
+#include <vector>
+#include <string>
+#include <map>
+#include <cstring>
+#include <cstdlib>
 #include <stdexcept>
 
 #include <cppunit/ui/text/TestRunner.h>
@@ -47,9 +52,17 @@ class iclient_persistence_test : public CppUnit::TestFixture
 	CPPUNIT_TEST( test_persistence_put_2_buffers );
 	CPPUNIT_TEST( test_persistence_put_3_buffers );
 	CPPUNIT_TEST( test_persistence_put_3_empty_buffers );
+	CPPUNIT_TEST( test_persistence_put_copies );
+	CPPUNIT_TEST( test_persistence_put_iov );
+	CPPUNIT_TEST( test_persistable_view );
 	CPPUNIT_TEST( test_persistence_get );
 	CPPUNIT_TEST( test_persistence_remove );
 	CPPUNIT_TEST( test_persistence_keys );
+	CPPUNIT_TEST( test_persistence_restore );
+	CPPUNIT_TEST( test_persistence_restore_by_key );
+	CPPUNIT_TEST( test_persistence_restore_by_prefix );
+	CPPUNIT_TEST( test_snapshot );
+	CPPUNIT_TEST( test_load_all );
 	CPPUNIT_TEST( test_persistence_clear );
 	CPPUNIT_TEST( test_persistence_containskey );
 
@@ -60,6 +73,106 @@ class iclient_persistence_test : public CppUnit::TestFixture
 
 	mqtt::test::dummy_client_persistence cli_per;
 
+	// Keeps what it's given, by either put() or put_iov()
+	class capture_persistence : public dcp
+	{
+		bool overrideIov_;
+
+	public:
+		mqtt::ipersistable_ptr stored;
+		std::vector<mqtt::persistence_iov> iov;
+
+		capture_persistence(bool overrideIov) : overrideIov_(overrideIov) {}
+
+		void put(const std::string&, mqtt::ipersistable_ptr persistable) override {
+			stored = persistable;
+		}
+		void put_iov(const std::string& key, const mqtt::persistence_iov* iov,
+					 size_t n) override {
+			if (overrideIov_)
+				this->iov.assign(iov, iov+n);
+			else
+				dcp::put_iov(key, iov, n);
+		}
+	};
+
+	// A store in a map, that can be read in bulk, and counts the snapshots
+	// taken of it and the keys read one at a time.
+	class map_persistence : public mqtt::iclient_persistence
+	{
+		std::map<std::string, mqtt::ipersistable_ptr> store_;
+
+	public:
+		mutable int nsnapshots = 0;
+		mutable int ngets = 0;
+
+		void open(const std::string&, const std::string&) override {}
+		void close() override {}
+		void clear() override { store_.clear(); }
+		bool contains_key(const std::string& key) override {
+			return store_.count(key) != 0;
+		}
+		mqtt::ipersistable_ptr get(const std::string& key) const override {
+			++ngets;
+			return store_.at(key);
+		}
+		std::vector<std::string> keys() const override {
+			std::vector<std::string> k;
+			for (const auto& p : store_)
+				k.push_back(p.first);
+			return k;
+		}
+		void put(const std::string& key, mqtt::ipersistable_ptr p) override {
+			store_[key] = p;
+		}
+		void remove(const std::string& key) override { store_.erase(key); }
+		mqtt::persistence_snapshot_ptr load_all() const override {
+			++nsnapshots;
+			auto snap = std::make_shared<mqtt::persistence_snapshot>();
+			for (const auto& p : store_)
+				snap->add(p.first, p.second->get_header_length()
+									+ p.second->get_payload_length());
+			snap->allocate();
+
+			size_t i = 0;
+			for (const auto& p : store_) {
+				const ipersistable& v = *p.second;
+				byte* buf = snap->data(i++);
+				std::memcpy(buf, v.get_header_bytes(), v.get_header_length());
+				std::memcpy(buf + v.get_header_length(), v.get_payload_bytes(),
+							v.get_payload_length());
+			}
+			return snap;
+		}
+	};
+
+	// Opens a store through the C callbacks, and closes it when done
+	class opened
+	{
+		void* handle_;
+
+	public:
+		opened(mqtt::iclient_persistence& per) : handle_(nullptr) {
+			dcp::persistence_open(&handle_, dcp::CLIENT_ID, dcp::SERVER_URI, &per);
+		}
+		~opened() {
+			if (handle_)
+				dcp::persistence_close(handle_);
+		}
+		operator void*() const { return handle_; }
+	};
+
+	// Frees the keys from persistence_keys(), as the C library does
+	static void free_keys(char** keys, int nkeys) {
+		for (int i=0; i<nkeys; ++i)
+			free(keys[i]);
+		free(keys);
+	}
+
+	static std::string to_string(const mqtt::byte* p, size_t n) {
+		return p ? std::string(reinterpret_cast<const char*>(p), n) : std::string();
+	}
+
 public:
 	void setUp() {}
 	void tearDown() {}
@@ -74,7 +187,8 @@ public:
 		CPPUNIT_ASSERT_EQUAL(MQTTCLIENT_PERSISTENCE_ERROR, dcp::persistence_open(&handle, dcp::CLIENT_ID, "", context));
 		CPPUNIT_ASSERT_EQUAL(MQTTCLIENT_PERSISTENCE_ERROR, dcp::persistence_open(&handle, "", dcp::SERVER_URI, context));
 		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_open(&handle, dcp::CLIENT_ID, dcp::SERVER_URI, context));
-		CPPUNIT_ASSERT_EQUAL(handle, context);
+		CPPUNIT_ASSERT(handle);
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_close(handle));
 	}
 
 // ----------------------------------------------------------------------
@@ -82,7 +196,8 @@ public:
 // ----------------------------------------------------------------------
 
 	void test_persistence_close() {
-		void* handle = static_cast<void*>(&cli_per);
+		void* handle = nullptr;
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_open(&handle, dcp::CLIENT_ID, dcp::SERVER_URI, &cli_per));
 		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_close(handle));
 	}
 
@@ -91,7 +206,7 @@ public:
 // ----------------------------------------------------------------------
 
 	void test_persistence_put_0_buffer() {
-		void* handle = static_cast<void*>(&cli_per);
+		opened handle(cli_per);
 
 		// Put no buffer
 		int bufcount = 0;
@@ -102,7 +217,7 @@ public:
 	}
 
 	void test_persistence_put_1_buffer() {
-		void* handle = static_cast<void*>(&cli_per);
+		opened handle(cli_per);
 
 		// Put one buffer
 		int bufcount = 1;
@@ -113,7 +228,7 @@ public:
 	}
 
 	void test_persistence_put_2_buffers() {
-		void* handle = static_cast<void*>(&cli_per);
+		opened handle(cli_per);
 
 		// Put two buffers
 		int bufcount = 2;
@@ -124,7 +239,7 @@ public:
 	}
 
 	void test_persistence_put_3_buffers() {
-		void* handle = static_cast<void*>(&cli_per);
+		opened handle(cli_per);
 
 		// Put three buffers
 		int bufcount = 3;
@@ -135,7 +250,7 @@ public:
 	}
 
 	void test_persistence_put_3_empty_buffers() {
-		void* handle = static_cast<void*>(&cli_per);
+		opened handle(cli_per);
 
 		// Put three empty buffers
 		int bufcount = 3;
@@ -144,12 +259,80 @@ public:
 		CPPUNIT_ASSERT_EQUAL(MQTTCLIENT_PERSISTENCE_ERROR, dcp::persistence_put(handle, const_cast<char*>(dcp::KEY_VALID), bufcount, const_cast<char**>(buffers), buflens));
 	}
 
+	void test_persistence_put_copies() {
+		capture_persistence per(false);
+		opened handle(per);
+
+		char buf0[] = "ab", buf1[] = "cde", buf2[] = "f";
+		char* buffers[] = { buf0, buf1, buf2 };
+		int buflens[] = { 2, 3, 1 };
+
+		// The data is copied, so the store can keep it
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_put(handle, const_cast<char*>(dcp::KEY_VALID), 2, buffers, buflens));
+		buf0[0] = buf1[0] = 'x';
+		CPPUNIT_ASSERT(per.stored);
+		CPPUNIT_ASSERT_EQUAL(std::string("ab"), to_string(per.stored->get_header_bytes(), per.stored->get_header_length()));
+		CPPUNIT_ASSERT_EQUAL(std::string("cde"), to_string(per.stored->get_payload_bytes(), per.stored->get_payload_length()));
+
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_put(handle, const_cast<char*>(dcp::KEY_VALID), 3, buffers, buflens));
+		buf2[0] = 'x';
+		CPPUNIT_ASSERT_EQUAL(size_t(0), per.stored->get_header_length());
+		CPPUNIT_ASSERT_EQUAL(std::string("xbxdef"), to_string(per.stored->get_payload_bytes(), per.stored->get_payload_length()));
+	}
+
+	void test_persistence_put_iov() {
+		capture_persistence per(true);
+		opened handle(per);
+
+		const char* buffers[] = { "ab", "cde", "f" };
+		int buflens[] = { 2, 3, 1 };
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_put(handle, const_cast<char*>(dcp::KEY_VALID), 3, const_cast<char**>(buffers), buflens));
+
+		// The store gets the C library's buffers, not copies of them
+		CPPUNIT_ASSERT(!per.stored);
+		CPPUNIT_ASSERT_EQUAL(size_t(3), per.iov.size());
+		for (size_t i=0; i<3; ++i) {
+			CPPUNIT_ASSERT(per.iov[i].data == reinterpret_cast<const mqtt::byte*>(buffers[i]));
+			CPPUNIT_ASSERT_EQUAL(size_t(buflens[i]), per.iov[i].len);
+		}
+	}
+
+	void test_persistable_view() {
+		const char *hdr = "hdr", *payload = "payload", *more = "more";
+		mqtt::persistence_iov iov[] = {
+			{ reinterpret_cast<const mqtt::byte*>(hdr), 3 },
+			{ reinterpret_cast<const mqtt::byte*>(payload), 7 },
+			{ reinterpret_cast<const mqtt::byte*>(more), 4 }
+		};
+
+		mqtt::persistable_view v1(iov, 1);
+		CPPUNIT_ASSERT_EQUAL(size_t(0), v1.get_header_length());
+		CPPUNIT_ASSERT(v1.get_payload_bytes() == iov[0].data);
+		CPPUNIT_ASSERT_EQUAL(size_t(3), v1.get_payload_length());
+
+		mqtt::persistable_view v2(iov, 2);
+		CPPUNIT_ASSERT(v2.get_header_bytes() == iov[0].data);
+		CPPUNIT_ASSERT_EQUAL(size_t(3), v2.get_header_length());
+		CPPUNIT_ASSERT(v2.get_payload_bytes() == iov[1].data);
+		CPPUNIT_ASSERT_EQUAL(size_t(7), v2.get_payload_length());
+		CPPUNIT_ASSERT_EQUAL(size_t(10), v2.get_length());
+
+		mqtt::persistable_view v3(iov, 3);
+		CPPUNIT_ASSERT_EQUAL(size_t(3), v3.get_buffer_count());
+		CPPUNIT_ASSERT(v3.get_buffers() == iov);
+		CPPUNIT_ASSERT_EQUAL(size_t(0), v3.get_header_length());
+		CPPUNIT_ASSERT_EQUAL(size_t(14), v3.get_payload_length());
+		CPPUNIT_ASSERT_EQUAL(std::string("hdrpayloadmore"), to_string(v3.get_payload_bytes(), v3.get_payload_length()));
+		auto arr = v3.get_payload_byte_arr();
+		CPPUNIT_ASSERT_EQUAL(std::string("hdrpayloadmore"), to_string(arr.data(), arr.size()));
+	}
+
 // ----------------------------------------------------------------------
 // Test static method persistence_get()
 // ----------------------------------------------------------------------
 
 	void test_persistence_get() {
-		void* handle = static_cast<void*>(&cli_per);
+		opened handle(cli_per);
 		char* buffer = nullptr;
 		int buflen = 0;
 		CPPUNIT_ASSERT_EQUAL(MQTTCLIENT_PERSISTENCE_ERROR, dcp::persistence_get(handle, const_cast<char*>(dcp::KEY_INVALID), &buffer, &buflen));
@@ -158,6 +341,7 @@ public:
 		header_payload += dp::PAYLOAD;
 		CPPUNIT_ASSERT_EQUAL(static_cast<int>(header_payload.size()), buflen);
 		CPPUNIT_ASSERT(std::equal(buffer, buffer + buflen, header_payload.c_str()));
+		free(buffer);
 	}
 
 // ----------------------------------------------------------------------
@@ -165,7 +349,7 @@ public:
 // ----------------------------------------------------------------------
 
 	void test_persistence_remove() {
-		void* handle = static_cast<void*>(&cli_per);
+		opened handle(cli_per);
 		CPPUNIT_ASSERT_EQUAL(MQTTCLIENT_PERSISTENCE_ERROR, dcp::persistence_remove(handle, const_cast<char*>(dcp::KEY_INVALID)));
 		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_remove(handle, const_cast<char*>(dcp::KEY_VALID)));
 	}
@@ -175,12 +359,148 @@ public:
 // ----------------------------------------------------------------------
 
 	void test_persistence_keys() {
-		void* handle = static_cast<void*>(&cli_per);
+		opened handle(cli_per);
 		char** keys = nullptr;
 		int nkeys = 0;
 		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_keys(handle, &keys, &nkeys));
 		CPPUNIT_ASSERT_EQUAL(1, nkeys);
 		CPPUNIT_ASSERT(std::equal(keys[0], keys[0] + strlen(keys[0]), dcp::KEY_VALID));
+		free_keys(keys, nkeys);
+	}
+
+	// The data is read from the snapshot taken when the keys were read
+	void test_persistence_restore() {
+		map_persistence per;
+		per.put(dcp::KEY_VALID, std::make_shared<dp>());
+		per.put("s-2", std::make_shared<dp>());
+
+		opened handle(per);
+		char** keys = nullptr;
+		int nkeys = 0;
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_keys(handle, &keys, &nkeys));
+		CPPUNIT_ASSERT_EQUAL(2, nkeys);
+		CPPUNIT_ASSERT_EQUAL(1, per.nsnapshots);
+
+		char* buffer = nullptr;
+		int buflen = 0;
+		for (int i=0; i<nkeys; ++i) {
+			CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_get(handle, keys[i], &buffer, &buflen));
+			CPPUNIT_ASSERT_EQUAL(std::string(dp::HEADER) + dp::PAYLOAD, std::string(buffer, buflen));
+			free(buffer);
+		}
+		free_keys(keys, nkeys);
+		CPPUNIT_ASSERT_EQUAL(0, per.ngets);
+
+		// Everything was read, so it's gone
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_get(handle, const_cast<char*>(dcp::KEY_VALID), &buffer, &buflen));
+		free(buffer);
+		CPPUNIT_ASSERT_EQUAL(1, per.ngets);
+
+		// ...and changing the store drops it, too
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_keys(handle, &keys, &nkeys));
+		free_keys(keys, nkeys);
+		CPPUNIT_ASSERT_EQUAL(2, per.nsnapshots);
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_remove(handle, const_cast<char*>(dcp::KEY_VALID)));
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_get(handle, const_cast<char*>("s-2"), &buffer, &buflen));
+		free(buffer);
+		CPPUNIT_ASSERT_EQUAL(2, per.ngets);
+	}
+
+	// A store that can't be read in bulk is read one key at a time
+	void test_persistence_restore_by_key() {
+		opened handle(cli_per);
+		char** keys = nullptr;
+		int nkeys = 0;
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_keys(handle, &keys, &nkeys));
+		CPPUNIT_ASSERT_EQUAL(1, nkeys);
+
+		char* buffer = nullptr;
+		int buflen = 0;
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_get(handle, keys[0], &buffer, &buflen));
+		CPPUNIT_ASSERT_EQUAL(std::string(dp::HEADER) + dp::PAYLOAD, std::string(buffer, buflen));
+		free(buffer);
+		free_keys(keys, nkeys);
+	}
+
+	// The C library lists the keys once for each kind of data, and reads
+	// only the ones of that kind each time. One snapshot serves them all.
+	void test_persistence_restore_by_prefix() {
+		map_persistence per;
+		for (const char* key : { "c-1", "q-1", "s-1", "s-2", "sc-3" })
+			per.put(key, std::make_shared<dp>());
+
+		opened handle(per);
+		for (const std::string prefix : { "c-", "q-", "s" }) {
+			char** keys = nullptr;
+			int nkeys = 0;
+			CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_keys(handle, &keys, &nkeys));
+			CPPUNIT_ASSERT_EQUAL(5, nkeys);
+			CPPUNIT_ASSERT_EQUAL(1, per.nsnapshots);
+
+			for (int i=0; i<nkeys; ++i) {
+				if (std::strncmp(keys[i], prefix.c_str(), prefix.size()) != 0)
+					continue;
+				char* buffer = nullptr;
+				int buflen = 0;
+				CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_get(handle, keys[i], &buffer, &buflen));
+				CPPUNIT_ASSERT_EQUAL(std::string(dp::HEADER) + dp::PAYLOAD, std::string(buffer, buflen));
+				free(buffer);
+			}
+			free_keys(keys, nkeys);
+		}
+		CPPUNIT_ASSERT_EQUAL(0, per.ngets);
+
+		// Every key was read, so the snapshot is gone
+		char** keys = nullptr;
+		int nkeys = 0;
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_keys(handle, &keys, &nkeys));
+		free_keys(keys, nkeys);
+		CPPUNIT_ASSERT_EQUAL(2, per.nsnapshots);
+	}
+
+// ----------------------------------------------------------------------
+// Test the persistence_snapshot class
+// ----------------------------------------------------------------------
+
+	void test_snapshot() {
+		persistence_snapshot snap;
+		CPPUNIT_ASSERT(snap.empty());
+
+		const std::vector<std::string> KEYS { "s-2", "s-10", "", "s-1" };
+		snap.reserve(KEYS.size(), 9);
+		for (size_t i=0; i<KEYS.size(); ++i)
+			CPPUNIT_ASSERT_EQUAL(i, snap.add(KEYS[i], i*10));
+		snap.allocate();
+
+		CPPUNIT_ASSERT_EQUAL(KEYS.size(), snap.size());
+		CPPUNIT_ASSERT_EQUAL(size_t(60), snap.data_length());
+
+		for (size_t i=0; i<KEYS.size(); ++i) {
+			CPPUNIT_ASSERT_EQUAL(KEYS[i], std::string(snap.key(i)));
+			CPPUNIT_ASSERT_EQUAL(KEYS[i].size(), snap.key_length(i));
+			CPPUNIT_ASSERT_EQUAL(i*10, snap.data_length(i));
+			std::fill(snap.data(i), snap.data(i)+snap.data_length(i), byte(i));
+			CPPUNIT_ASSERT_EQUAL(i, snap.find(KEYS[i].c_str()));
+		}
+		CPPUNIT_ASSERT_EQUAL(persistence_snapshot::npos, snap.find("s-3"));
+
+		// The data for each key doesn't overlap the others
+		for (size_t i=0; i<KEYS.size(); ++i) {
+			const byte* p = const_cast<const persistence_snapshot&>(snap).data(i);
+			CPPUNIT_ASSERT(std::all_of(p, p+snap.data_length(i),
+									   [i](byte b) { return b == byte(i); }));
+		}
+
+		try {
+			snap.add("s-3", 1);
+			CPPUNIT_FAIL("keys can't be added after allocating");
+		}
+		catch (const std::logic_error&) {}
+	}
+
+	// By default, a store can't be read in bulk
+	void test_load_all() {
+		CPPUNIT_ASSERT(!cli_per.load_all());
 	}
 
 // ----------------------------------------------------------------------
@@ -188,7 +508,7 @@ public:
 // ----------------------------------------------------------------------
 
 	void test_persistence_clear() {
-		void* handle = static_cast<void*>(&cli_per);
+		opened handle(cli_per);
 		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_clear(handle));
 	}
 
@@ -197,7 +517,7 @@ public:
 // ----------------------------------------------------------------------
 
 	void test_persistence_containskey() {
-		void* handle = static_cast<void*>(&cli_per);
+		opened handle(cli_per);
 		CPPUNIT_ASSERT_EQUAL(MQTTCLIENT_PERSISTENCE_ERROR, dcp::persistence_containskey(handle, const_cast<char*>(dcp::KEY_INVALID)));
 		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, dcp::persistence_containskey(handle, const_cast<char*>(dcp::KEY_VALID)));
 	}
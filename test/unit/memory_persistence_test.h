@@ -0,0 +1,315 @@
+// memory_persistence_test.h
+// Unit tests for the memory_persistence class in the Paho MQTT C++ library.
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_memory_persistence_test_h
+#define __mqtt_memory_persistence_test_h
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+#include <cstdlib>
+
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "mqtt/memory_persistence.h"
+#include "mqtt/exception.h"
+#include "dummy_persistable.h"
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+class memory_persistence_test : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( memory_persistence_test );
+
+	CPPUNIT_TEST( test_constructor );
+	CPPUNIT_TEST( test_put_get );
+	CPPUNIT_TEST( test_replace );
+	CPPUNIT_TEST( test_remove );
+	CPPUNIT_TEST( test_limits );
+	CPPUNIT_TEST( test_clear );
+	CPPUNIT_TEST( test_reuse );
+	CPPUNIT_TEST( test_c_callbacks );
+	CPPUNIT_TEST( test_concurrent_readers );
+
+	CPPUNIT_TEST_SUITE_END();
+
+	static ipersistable_ptr make_data(const std::string& s) {
+		return std::make_shared<persistable_buffer>(
+					reinterpret_cast<const byte*>(s.data()), s.size());
+	}
+
+	/** Gets the header and payload as one string */
+	static std::string to_string(ipersistable_ptr p) {
+		std::string s;
+		if (p->get_header_bytes())
+			s.append(reinterpret_cast<const char*>(p->get_header_bytes()),
+					 p->get_header_length());
+		if (p->get_payload_bytes())
+			s.append(reinterpret_cast<const char*>(p->get_payload_bytes()),
+					 p->get_payload_length());
+		return s;
+	}
+
+	static std::vector<std::string> sorted_keys(const memory_persistence& per) {
+		auto v = per.keys();
+		std::sort(v.begin(), v.end());
+		return v;
+	}
+
+	using strvec = std::vector<std::string>;
+
+public:
+	void setUp() {}
+	void tearDown() {}
+
+// ----------------------------------------------------------------------
+// Test the constructor
+// ----------------------------------------------------------------------
+
+	void test_constructor() {
+		memory_persistence per(100);
+		CPPUNIT_ASSERT_EQUAL(size_t(100), per.capacity());
+		CPPUNIT_ASSERT_EQUAL(memory_persistence::DFLT_SLOT_SIZE, per.slot_size());
+		CPPUNIT_ASSERT_EQUAL(size_t(0), per.size());
+		CPPUNIT_ASSERT(per.keys().empty());
+
+		// The table is a power of two, at least twice the capacity
+		CPPUNIT_ASSERT_EQUAL(size_t(255), per.mask_);
+
+		try {
+			memory_persistence per0(0);
+			CPPUNIT_FAIL("store shouldn't have zero capacity");
+		}
+		catch (const std::invalid_argument&) {}
+	}
+
+// ----------------------------------------------------------------------
+// Test the basic operations
+// ----------------------------------------------------------------------
+
+	void test_put_get() {
+		memory_persistence per(16);
+		per.open("client", "tcp://localhost:1883");
+
+		per.put("s-1", make_data("one"));
+		per.put("s-2", std::make_shared<test::dummy_persistable>());
+		CPPUNIT_ASSERT_EQUAL(size_t(2), per.size());
+
+		CPPUNIT_ASSERT(per.contains_key("s-1"));
+		CPPUNIT_ASSERT(per.contains_key("s-2"));
+		CPPUNIT_ASSERT(!per.contains_key("s-3"));
+		CPPUNIT_ASSERT((sorted_keys(per) == strvec{ "s-1", "s-2" }));
+
+		CPPUNIT_ASSERT_EQUAL(std::string("one"), to_string(per.get("s-1")));
+		CPPUNIT_ASSERT_EQUAL(std::string("HEADERPAYLOAD"), to_string(per.get("s-2")));
+
+		try {
+			per.get("s-3");
+			CPPUNIT_FAIL("get() of a missing key should throw");
+		}
+		catch (const persistence_exception&) {}
+
+		// The data is kept when the store is closed
+		per.close();
+		per.open("client", "tcp://localhost:1883");
+		CPPUNIT_ASSERT_EQUAL(std::string("one"), to_string(per.get("s-1")));
+	}
+
+	void test_replace() {
+		memory_persistence per(4);
+		per.put("s-1", make_data("first"));
+		per.put("s-1", make_data("second"));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), per.size());
+		CPPUNIT_ASSERT_EQUAL(size_t(3), per.freeSlots_.size());
+		CPPUNIT_ASSERT_EQUAL(std::string("second"), to_string(per.get("s-1")));
+	}
+
+	void test_remove() {
+		memory_persistence per(4);
+		per.put("s-1", make_data("one"));
+		per.put("s-2", make_data("two"));
+
+		per.remove("s-1");
+		per.remove("s-9");		// not there; does nothing
+
+		CPPUNIT_ASSERT_EQUAL(size_t(1), per.size());
+		CPPUNIT_ASSERT(!per.contains_key("s-1"));
+		CPPUNIT_ASSERT((per.keys() == strvec{ "s-2" }));
+	}
+
+	void test_limits() {
+		memory_persistence per(2, 8);
+
+		try {
+			per.put("s-1", make_data("123456789"));
+			CPPUNIT_FAIL("data larger than a slot shouldn't fit");
+		}
+		catch (const persistence_exception&) {}
+
+		try {
+			per.put(std::string(memory_persistence::MAX_KEY_LEN+1, 'k'), make_data("x"));
+			CPPUNIT_FAIL("key that's too long shouldn't fit");
+		}
+		catch (const persistence_exception&) {}
+
+		per.put("s-1", make_data("12345678"));
+		per.put("s-2", make_data("x"));
+		try {
+			per.put("s-3", make_data("x"));
+			CPPUNIT_FAIL("store should be full");
+		}
+		catch (const persistence_exception&) {}
+
+		// ...but a key that's there can be replaced
+		per.put("s-2", make_data("y"));
+		CPPUNIT_ASSERT_EQUAL(std::string("y"), to_string(per.get("s-2")));
+		CPPUNIT_ASSERT_EQUAL(std::string("12345678"), to_string(per.get("s-1")));
+	}
+
+	void test_clear() {
+		memory_persistence per(8);
+		for (int i=0; i<8; ++i)
+			per.put("s-" + std::to_string(i), make_data("x"));
+
+		per.clear();
+		CPPUNIT_ASSERT_EQUAL(size_t(0), per.size());
+		CPPUNIT_ASSERT(per.keys().empty());
+		CPPUNIT_ASSERT_EQUAL(size_t(8), per.freeSlots_.size());
+
+		per.put("s-1", make_data("one"));
+		CPPUNIT_ASSERT_EQUAL(std::string("one"), to_string(per.get("s-1")));
+	}
+
+	// Cycles through many more keys than the capacity, like the message IDs
+	// of QoS 1 traffic, and checks that the deleted entries don't pile up.
+	void test_reuse() {
+		const int WINDOW = 10;
+		memory_persistence per(WINDOW);
+
+		for (int i=0; i<10000; ++i) {
+			if (i >= WINDOW)
+				per.remove("s-" + std::to_string(i-WINDOW));
+			per.put("s-" + std::to_string(i), make_data(std::to_string(i)));
+		}
+
+		CPPUNIT_ASSERT_EQUAL(size_t(WINDOW), per.size());
+		for (int i=10000-WINDOW; i<10000; ++i)
+			CPPUNIT_ASSERT_EQUAL(std::to_string(i), to_string(per.get("s-" + std::to_string(i))));
+		CPPUNIT_ASSERT(!per.contains_key("s-0"));
+
+		size_t nused = 0;
+		for (size_t i=0; i<=per.mask_; ++i) {
+			if (per.table_[i].state.load() != memory_persistence::FREE)
+				++nused;
+		}
+		CPPUNIT_ASSERT(nused < per.mask_);
+	}
+
+// ----------------------------------------------------------------------
+// Test through the C library's callbacks
+// ----------------------------------------------------------------------
+
+	void test_c_callbacks() {
+		memory_persistence per(4);
+		void* handle = nullptr;
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS,
+			 iclient_persistence::persistence_open(&handle, "client",
+												   "tcp://localhost:1883", &per));
+
+		char key[] = "s-1";
+		const char* buffers[] = { "ab", "cde", "f" };
+		int buflens[] = { 2, 3, 1 };
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS,
+			 iclient_persistence::persistence_put(handle, key, 3,
+												  const_cast<char**>(buffers), buflens));
+
+		char* buf = nullptr;
+		int buflen = 0;
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS,
+			 iclient_persistence::persistence_get(handle, key, &buf, &buflen));
+		CPPUNIT_ASSERT_EQUAL(std::string("abcdef"), std::string(buf, buflen));
+		free(buf);
+
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS,
+			 iclient_persistence::persistence_remove(handle, key));
+		CPPUNIT_ASSERT_EQUAL(MQTTCLIENT_PERSISTENCE_ERROR,
+			 iclient_persistence::persistence_containskey(handle, key));
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS,
+			 iclient_persistence::persistence_close(handle));
+	}
+
+// ----------------------------------------------------------------------
+// Test reading while the store is being changed
+// ----------------------------------------------------------------------
+
+	void test_concurrent_readers() {
+		const int WINDOW = 8, N = 20000;
+		memory_persistence per(WINDOW+1);
+
+		// Each value is its key repeated, so a torn read would show
+		per.put("fixed", make_data("fixed"));
+
+		std::atomic<bool> done(false);
+		std::atomic<int> nbad(0);
+
+		auto reader = [&] {
+			while (!done) {
+				for (const auto& key : per.keys()) {
+					try {
+						std::string s = to_string(per.get(key));
+						if (s != key + key)
+							if (key != "fixed" || s != "fixed")
+								++nbad;
+					}
+					catch (const persistence_exception&) {}	// removed
+				}
+				if (!per.contains_key("fixed"))
+					++nbad;
+			}
+		};
+
+		std::thread thr1(reader), thr2(reader);
+
+		for (int i=0; i<N; ++i) {
+			std::string key = "s-" + std::to_string(i % 50);
+			if (i >= WINDOW)
+				per.remove("s-" + std::to_string((i - WINDOW) % 50));
+			per.put(key, make_data(key + key));
+		}
+
+		done = true;
+		thr1.join();
+		thr2.join();
+
+		CPPUNIT_ASSERT_EQUAL(0, nbad.load());
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		//  __mqtt_memory_persistence_test_h
+
@@ -25,6 +25,7 @@
 
 #include "mqtt/message.h"
 #include <cstring>
+#include <vector>
 
 namespace mqtt {
 
@@ -39,11 +40,21 @@ class message_test : public CppUnit::TestFixture
 	CPPUNIT_TEST( test_buf_constructor  );
 	CPPUNIT_TEST( test_string_constructor  );
 	CPPUNIT_TEST( test_string_qos_constructor );
+	CPPUNIT_TEST( test_string_move_constructor );
+	CPPUNIT_TEST( test_vector_constructor );
+	CPPUNIT_TEST( test_unique_ptr_constructor );
+	CPPUNIT_TEST( test_set_payload_move );
+	CPPUNIT_TEST( test_make_message_move );
+	CPPUNIT_TEST( test_payload_buffer );
 	CPPUNIT_TEST( test_c_struct_constructor );
+	CPPUNIT_TEST( test_c_struct_owner_constructor );
+	CPPUNIT_TEST( test_shared_payload_copy );
+	CPPUNIT_TEST( test_shared_payload_set );
 	CPPUNIT_TEST( test_copy_constructor );
 	CPPUNIT_TEST( test_move_constructor );
 	CPPUNIT_TEST( test_copy_assignment );
 	CPPUNIT_TEST( test_move_assignment );
+	CPPUNIT_TEST( test_topic );
 	CPPUNIT_TEST( test_validate_qos );
 
 	CPPUNIT_TEST_SUITE_END();
@@ -56,8 +67,25 @@ class message_test : public CppUnit::TestFixture
 	const std::string PAYLOAD = std::string(BUF);
 	const int QOS = 1;
 
+	// A payload too long to be kept in a short string
+	const std::string LONG_PAYLOAD = std::string(100, 'x');
+
 	mqtt::message orgMsg;
 
+	// A deleter that counts the arrays it deletes
+	struct counting_deleter {
+		int* n;
+		void operator()(mqtt::byte* p) const { ++*n; delete[] p; }
+	};
+
+	static std::unique_ptr<mqtt::byte[],counting_deleter> make_array(
+			const std::string& s, int* ndel) {
+		std::unique_ptr<mqtt::byte[],counting_deleter> buf(
+			new mqtt::byte[s.size()], counting_deleter{ ndel });
+		std::memcpy(buf.get(), s.data(), s.size());
+		return buf;
+	}
+
 public:
 	void setUp() {
 		orgMsg = mqtt::message(PAYLOAD, QOS, true);
@@ -121,6 +149,204 @@ public:
 		CPPUNIT_ASSERT(msg.is_retained());
 	}
 
+// ----------------------------------------------------------------------
+// Test the constructors that move a string in as the payload
+// ----------------------------------------------------------------------
+
+	void test_string_move_constructor() {
+		std::string payload(LONG_PAYLOAD);
+		const char* p = payload.data();
+
+		mqtt::message msg(std::move(payload));
+		CPPUNIT_ASSERT_EQUAL(LONG_PAYLOAD, msg.get_payload());
+		CPPUNIT_ASSERT(!msg.is_payload_shared());
+		CPPUNIT_ASSERT_EQUAL(DFLT_QOS, msg.get_qos());
+		CPPUNIT_ASSERT(!msg.is_retained());
+
+		// The string's buffer was taken, not copied
+		CPPUNIT_ASSERT(msg.get_payload_bytes() == reinterpret_cast<const mqtt::byte*>(p));
+
+		std::string payload2(LONG_PAYLOAD);
+		mqtt::message msg2(std::move(payload2), QOS, true);
+		CPPUNIT_ASSERT_EQUAL(LONG_PAYLOAD, msg2.get_payload());
+		CPPUNIT_ASSERT_EQUAL(QOS, msg2.get_qos());
+		CPPUNIT_ASSERT(msg2.is_retained());
+	}
+
+// ----------------------------------------------------------------------
+// Test the constructors that take the buffer of a byte vector
+// ----------------------------------------------------------------------
+
+	void test_vector_constructor() {
+		std::vector<mqtt::byte> payload(PAYLOAD.begin(), PAYLOAD.end());
+		const mqtt::byte* p = payload.data();
+
+		mqtt::message msg(std::move(payload));
+		CPPUNIT_ASSERT(msg.is_payload_shared());
+		CPPUNIT_ASSERT(msg.get_payload_bytes() == p);
+		CPPUNIT_ASSERT_EQUAL(N, msg.get_payload_length());
+		CPPUNIT_ASSERT_EQUAL(PAYLOAD, msg.get_payload());
+		CPPUNIT_ASSERT_EQUAL(DFLT_QOS, msg.get_qos());
+
+		// Copies share the buffer
+		mqtt::message cpy(msg);
+		CPPUNIT_ASSERT(cpy.get_payload_bytes() == p);
+
+		std::vector<mqtt::byte> payload2(PAYLOAD.begin(), PAYLOAD.end());
+		mqtt::message msg2(std::move(payload2), QOS, true);
+		CPPUNIT_ASSERT_EQUAL(PAYLOAD, msg2.get_payload());
+		CPPUNIT_ASSERT_EQUAL(QOS, msg2.get_qos());
+		CPPUNIT_ASSERT(msg2.is_retained());
+
+		// An empty vector gives an empty payload
+		mqtt::message msg3(std::vector<mqtt::byte>{});
+		CPPUNIT_ASSERT(!msg3.is_payload_shared());
+		CPPUNIT_ASSERT_EQUAL(size_t(0), msg3.get_payload_length());
+		CPPUNIT_ASSERT_EQUAL(EMPTY_STR, msg3.get_payload());
+	}
+
+// ----------------------------------------------------------------------
+// Test the constructors that take a byte array with its deleter
+// ----------------------------------------------------------------------
+
+	void test_unique_ptr_constructor() {
+		int ndel = 0;
+		{
+			auto buf = make_array(PAYLOAD, &ndel);
+			const mqtt::byte* p = buf.get();
+
+			mqtt::message msg(std::move(buf), N);
+			CPPUNIT_ASSERT(!buf);
+			CPPUNIT_ASSERT(msg.is_payload_shared());
+			CPPUNIT_ASSERT(msg.get_payload_bytes() == p);
+			CPPUNIT_ASSERT_EQUAL(N, msg.get_payload_length());
+			CPPUNIT_ASSERT_EQUAL(PAYLOAD, msg.get_payload());
+
+			mqtt::message cpy(msg);
+			msg.clear_payload();
+			CPPUNIT_ASSERT_EQUAL(0, ndel);
+			CPPUNIT_ASSERT_EQUAL(PAYLOAD, cpy.get_payload());
+		}
+		// Deleted once, by the deleter, when the last copy was gone
+		CPPUNIT_ASSERT_EQUAL(1, ndel);
+
+		{
+			mqtt::message msg(make_array(PAYLOAD, &ndel), N, QOS, true);
+			CPPUNIT_ASSERT_EQUAL(PAYLOAD, msg.get_payload());
+			CPPUNIT_ASSERT_EQUAL(QOS, msg.get_qos());
+			CPPUNIT_ASSERT(msg.is_retained());
+		}
+		CPPUNIT_ASSERT_EQUAL(2, ndel);
+
+		// With the default deleter
+		std::unique_ptr<mqtt::byte[]> buf(new mqtt::byte[N]);
+		std::memcpy(buf.get(), BUF, N);
+		mqtt::message msg(std::move(buf), N);
+		CPPUNIT_ASSERT_EQUAL(PAYLOAD, msg.get_payload());
+	}
+
+// ----------------------------------------------------------------------
+// Test setting the payload by moving it in
+// ----------------------------------------------------------------------
+
+	void test_set_payload_move() {
+		int ndel = 0;
+		mqtt::message msg;
+
+		msg.set_payload(make_array(PAYLOAD, &ndel), N);
+		CPPUNIT_ASSERT(msg.is_payload_shared());
+		CPPUNIT_ASSERT_EQUAL(PAYLOAD, msg.get_payload());
+
+		// Replacing the payload releases the array
+		std::string payload(LONG_PAYLOAD);
+		const char* p = payload.data();
+		msg.set_payload(std::move(payload));
+		CPPUNIT_ASSERT_EQUAL(1, ndel);
+		CPPUNIT_ASSERT(!msg.is_payload_shared());
+		CPPUNIT_ASSERT(msg.get_payload_bytes() == reinterpret_cast<const mqtt::byte*>(p));
+		CPPUNIT_ASSERT_EQUAL(LONG_PAYLOAD, msg.get_payload());
+
+		std::vector<mqtt::byte> vec(PAYLOAD.begin(), PAYLOAD.end());
+		const mqtt::byte* pv = vec.data();
+		msg.set_payload(std::move(vec));
+		CPPUNIT_ASSERT(msg.is_payload_shared());
+		CPPUNIT_ASSERT(msg.get_payload_bytes() == pv);
+		CPPUNIT_ASSERT_EQUAL(PAYLOAD, msg.get_payload());
+
+		// A null array clears the payload
+		msg.set_payload(std::unique_ptr<mqtt::byte[]>(), 0);
+		CPPUNIT_ASSERT(!msg.is_payload_shared());
+		CPPUNIT_ASSERT_EQUAL(size_t(0), msg.get_payload_length());
+		CPPUNIT_ASSERT_EQUAL(EMPTY_STR, msg.get_payload());
+	}
+
+// ----------------------------------------------------------------------
+// Test the make_message() overloads that move the payload in
+// ----------------------------------------------------------------------
+
+	void test_make_message_move() {
+		int ndel = 0;
+
+		std::string payload(LONG_PAYLOAD);
+		const char* p = payload.data();
+		auto msg = mqtt::make_message(std::move(payload));
+		CPPUNIT_ASSERT(msg->get_payload_bytes() == reinterpret_cast<const mqtt::byte*>(p));
+
+		msg = mqtt::make_message(std::string(PAYLOAD), QOS, true);
+		CPPUNIT_ASSERT_EQUAL(PAYLOAD, msg->get_payload());
+		CPPUNIT_ASSERT_EQUAL(QOS, msg->get_qos());
+
+		msg = mqtt::make_message(std::vector<mqtt::byte>(PAYLOAD.begin(), PAYLOAD.end()));
+		CPPUNIT_ASSERT(msg->is_payload_shared());
+		CPPUNIT_ASSERT_EQUAL(PAYLOAD, msg->get_payload());
+
+		msg = mqtt::make_message(std::vector<mqtt::byte>(PAYLOAD.begin(), PAYLOAD.end()),
+								 QOS, true);
+		CPPUNIT_ASSERT(msg->is_retained());
+
+		msg = mqtt::make_message(make_array(PAYLOAD, &ndel), N);
+		CPPUNIT_ASSERT_EQUAL(PAYLOAD, msg->get_payload());
+
+		msg = mqtt::make_message(make_array(PAYLOAD, &ndel), N, QOS, true);
+		CPPUNIT_ASSERT_EQUAL(1, ndel);
+		CPPUNIT_ASSERT_EQUAL(QOS, msg->get_qos());
+
+		msg.reset();
+		CPPUNIT_ASSERT_EQUAL(2, ndel);
+	}
+
+// ----------------------------------------------------------------------
+// Test that messages share a payload buffer
+// ----------------------------------------------------------------------
+
+	void test_payload_buffer() {
+		mqtt::payload_buffer buf(PAYLOAD);
+		{
+			mqtt::message msg(buf);
+			CPPUNIT_ASSERT(msg.is_payload_shared());
+			CPPUNIT_ASSERT(msg.get_payload_bytes() == buf.data());
+			CPPUNIT_ASSERT_EQUAL(PAYLOAD, msg.get_payload());
+			CPPUNIT_ASSERT_EQUAL(DFLT_QOS, msg.get_qos());
+
+			auto msg2 = mqtt::make_message(buf, QOS, true);
+			CPPUNIT_ASSERT(msg2->get_payload_bytes() == buf.data());
+			CPPUNIT_ASSERT_EQUAL(QOS, msg2->get_qos());
+			CPPUNIT_ASSERT(msg2->is_retained());
+
+			mqtt::message msg3;
+			msg3.set_payload(buf);
+			CPPUNIT_ASSERT(msg3.get_payload_bytes() == buf.data());
+
+			CPPUNIT_ASSERT_EQUAL(4L, buf.use_count());
+		}
+		CPPUNIT_ASSERT_EQUAL(1L, buf.use_count());
+
+		// An empty buffer gives an empty payload
+		mqtt::message msg(mqtt::payload_buffer{});
+		CPPUNIT_ASSERT(!msg.is_payload_shared());
+		CPPUNIT_ASSERT_EQUAL(EMPTY_STR, msg.get_payload());
+	}
+
 // ----------------------------------------------------------------------
 // Test the initialization by C struct
 // ----------------------------------------------------------------------
@@ -140,6 +366,105 @@ public:
 		CPPUNIT_ASSERT(msg.is_duplicate());
 	}
 
+// ----------------------------------------------------------------------
+// Test the constructor for a C struct with an external payload owner
+// ----------------------------------------------------------------------
+
+	void test_c_struct_owner_constructor() {
+		auto buf = std::make_shared<std::string>(PAYLOAD);
+
+		MQTTAsync_message c_msg = MQTTAsync_message_initializer;
+		c_msg.payload = const_cast<char*>(buf->data());
+		c_msg.payloadlen = int(buf->length());
+		c_msg.qos = QOS;
+		c_msg.retained = 1;
+
+		std::weak_ptr<std::string> wbuf(buf);
+		{
+			mqtt::message msg(c_msg, std::move(buf));
+
+			CPPUNIT_ASSERT(msg.is_payload_shared());
+			CPPUNIT_ASSERT(!wbuf.expired());
+
+			// The bytes are read in place
+			CPPUNIT_ASSERT(msg.get_payload_bytes() ==
+						   reinterpret_cast<const mqtt::byte*>(c_msg.payload));
+			CPPUNIT_ASSERT_EQUAL(N, msg.get_payload_length());
+
+			CPPUNIT_ASSERT_EQUAL(PAYLOAD, msg.get_payload());
+			CPPUNIT_ASSERT_EQUAL(QOS, msg.get_qos());
+			CPPUNIT_ASSERT(msg.is_retained());
+		}
+		// The message released the buffer
+		CPPUNIT_ASSERT(wbuf.expired());
+
+		// Without an owner, the payload is copied
+		mqtt::message msg(c_msg, nullptr);
+		CPPUNIT_ASSERT(!msg.is_payload_shared());
+		CPPUNIT_ASSERT(msg.get_payload_bytes() !=
+					   reinterpret_cast<const mqtt::byte*>(c_msg.payload));
+	}
+
+// ----------------------------------------------------------------------
+// Test that copies and moves of a message share an external payload
+// ----------------------------------------------------------------------
+
+	void test_shared_payload_copy() {
+		auto buf = std::make_shared<std::string>(PAYLOAD);
+		std::weak_ptr<std::string> wbuf(buf);
+
+		MQTTAsync_message c_msg = MQTTAsync_message_initializer;
+		c_msg.payload = const_cast<char*>(buf->data());
+		c_msg.payloadlen = int(buf->length());
+
+		mqtt::message msg(c_msg, std::move(buf));
+		{
+			mqtt::message cpy(msg);
+			CPPUNIT_ASSERT(cpy.is_payload_shared());
+			CPPUNIT_ASSERT(cpy.get_payload_bytes() == msg.get_payload_bytes());
+			CPPUNIT_ASSERT_EQUAL(PAYLOAD, cpy.get_payload());
+
+			mqtt::message asg;
+			asg = cpy;
+			CPPUNIT_ASSERT(asg.get_payload_bytes() == msg.get_payload_bytes());
+			CPPUNIT_ASSERT_EQUAL(PAYLOAD, asg.get_payload());
+
+			mqtt::message mv(std::move(cpy));
+			CPPUNIT_ASSERT(mv.get_payload_bytes() == msg.get_payload_bytes());
+			CPPUNIT_ASSERT_EQUAL(PAYLOAD, mv.get_payload());
+			CPPUNIT_ASSERT(!cpy.is_payload_shared());
+			CPPUNIT_ASSERT_EQUAL(EMPTY_STR, cpy.get_payload());
+		}
+		CPPUNIT_ASSERT(!wbuf.expired());
+
+		msg.clear_payload();
+		CPPUNIT_ASSERT(wbuf.expired());
+		CPPUNIT_ASSERT_EQUAL(size_t(0), msg.get_payload_length());
+	}
+
+// ----------------------------------------------------------------------
+// Test setting the payload of a message that shares an external payload
+// ----------------------------------------------------------------------
+
+	void test_shared_payload_set() {
+		auto buf = std::make_shared<std::string>(PAYLOAD);
+		std::weak_ptr<std::string> wbuf(buf);
+
+		MQTTAsync_message c_msg = MQTTAsync_message_initializer;
+		c_msg.payload = const_cast<char*>(buf->data());
+		c_msg.payloadlen = int(buf->length());
+
+		mqtt::message msg(c_msg, std::move(buf));
+
+		// Setting the payload from the message's own view of it is safe
+		msg.set_payload(msg.get_payload());
+		CPPUNIT_ASSERT(!msg.is_payload_shared());
+		CPPUNIT_ASSERT(wbuf.expired());
+		CPPUNIT_ASSERT_EQUAL(PAYLOAD, msg.get_payload());
+		CPPUNIT_ASSERT(msg.get_payload_bytes() ==
+					   reinterpret_cast<const mqtt::byte*>(msg.get_payload().data()));
+	}
+
 // ----------------------------------------------------------------------
 // Test the copy constructor
 // ----------------------------------------------------------------------
@@ -236,6 +561,36 @@ public:
 		#endif
 	}
 
+// ----------------------------------------------------------------------
+// Test the topic, and that it goes along with copies and moves
+// ----------------------------------------------------------------------
+
+	void test_topic() {
+		const std::string TOPIC { "hello/world" };
+
+		CPPUNIT_ASSERT_EQUAL(EMPTY_STR, orgMsg.get_topic());
+		orgMsg.set_topic(TOPIC);
+		CPPUNIT_ASSERT_EQUAL(TOPIC, orgMsg.get_topic());
+
+		mqtt::message cpy(orgMsg);
+		CPPUNIT_ASSERT_EQUAL(TOPIC, cpy.get_topic());
+
+		mqtt::message asg;
+		asg = orgMsg;
+		CPPUNIT_ASSERT_EQUAL(TOPIC, asg.get_topic());
+
+		mqtt::message mv(std::move(cpy));
+		CPPUNIT_ASSERT_EQUAL(TOPIC, mv.get_topic());
+
+		mqtt::message mvasg;
+		mvasg = std::move(asg);
+		CPPUNIT_ASSERT_EQUAL(TOPIC, mvasg.get_topic());
+
+		std::string top { "other" };
+		mvasg.set_topic(std::move(top));
+		CPPUNIT_ASSERT_EQUAL(std::string("other"), mvasg.get_topic());
+	}
+
 // ----------------------------------------------------------------------
 // Test the validate_qos()
 // ----------------------------------------------------------------------
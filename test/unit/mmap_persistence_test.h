@@ -0,0 +1,471 @@
+// mmap_persistence_test.h
+// Unit tests for the mmap_persistence class in the Paho MQTT C++ library.
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_mmap_persistence_test_h
+#define __mqtt_mmap_persistence_test_h
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ftw.h>
+
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "mqtt/mmap_persistence.h"
+#include "mqtt/exception.h"
+#include "dummy_persistable.h"
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+class mmap_persistence_test : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( mmap_persistence_test );
+
+	CPPUNIT_TEST( test_put_get );
+	CPPUNIT_TEST( test_replace );
+	CPPUNIT_TEST( test_remove );
+	CPPUNIT_TEST( test_clear );
+	CPPUNIT_TEST( test_reopen );
+	CPPUNIT_TEST( test_compaction );
+	CPPUNIT_TEST( test_compaction_pinned_front );
+	CPPUNIT_TEST( test_large_record );
+	CPPUNIT_TEST( test_torn_record );
+	CPPUNIT_TEST( test_sync );
+	CPPUNIT_TEST( test_load_all );
+	CPPUNIT_TEST( test_c_callbacks );
+
+	CPPUNIT_TEST_SUITE_END();
+
+	const std::string CLIENT_ID { "mmap_persistence_test" };
+	const std::string SERVER_URI { "tcp://localhost:1883" };
+
+	/** The temporary directory for the stores */
+	std::string dir_;
+
+	/** Simple data to put into the store */
+	class data : public ipersistable
+	{
+		std::string hdr_, payload_;
+
+	public:
+		data(const std::string& hdr, const std::string& payload)
+			: hdr_(hdr), payload_(payload) {}
+
+		const byte* get_header_bytes() const override {
+			return reinterpret_cast<const byte*>(hdr_.data());
+		}
+		size_t get_header_length() const override { return hdr_.size(); }
+		size_t get_header_offset() const override { return 0; }
+
+		const byte* get_payload_bytes() const override {
+			return reinterpret_cast<const byte*>(payload_.data());
+		}
+		size_t get_payload_length() const override { return payload_.size(); }
+		size_t get_payload_offset() const override { return 0; }
+
+		std::vector<byte> get_header_byte_arr() const override {
+			return std::vector<byte>(hdr_.begin(), hdr_.end());
+		}
+		std::vector<byte> get_payload_byte_arr() const override {
+			return std::vector<byte>(payload_.begin(), payload_.end());
+		}
+	};
+
+	static ipersistable_ptr make_data(const std::string& hdr,
+									  const std::string& payload="") {
+		return std::make_shared<data>(hdr, payload);
+	}
+
+	/** Gets the header and payload as one string */
+	static std::string to_string(ipersistable_ptr p) {
+		std::string s;
+		if (p->get_header_bytes())
+			s.append(reinterpret_cast<const char*>(p->get_header_bytes()),
+					 p->get_header_length());
+		if (p->get_payload_bytes())
+			s.append(reinterpret_cast<const char*>(p->get_payload_bytes()),
+					 p->get_payload_length());
+		return s;
+	}
+
+	static std::vector<std::string> sorted_keys(const mmap_persistence& per) {
+		auto v = per.keys();
+		std::sort(v.begin(), v.end());
+		return v;
+	}
+
+	/** Gets the path to the active segment file */
+	static std::string active_path(const mmap_persistence& per) {
+		return per.segs_.rbegin()->second.path;
+	}
+
+	static int remove_entry(const char* path, const struct stat*, int, struct FTW*) {
+		return ::remove(path);
+	}
+
+	using strvec = std::vector<std::string>;
+
+public:
+	void setUp() {
+		char tmpl[] = "/tmp/mqttpp-test-XXXXXX";
+		dir_ = ::mkdtemp(tmpl);
+	}
+	void tearDown() {
+		::nftw(dir_.c_str(), remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+	}
+
+// ----------------------------------------------------------------------
+// Test the basic operations
+// ----------------------------------------------------------------------
+
+	void test_put_get() {
+		mmap_persistence per(dir_);
+		per.open(CLIENT_ID, SERVER_URI);
+		CPPUNIT_ASSERT(per.keys().empty());
+		CPPUNIT_ASSERT_EQUAL(size_t(1), per.num_segments());
+
+		per.put("s-1", make_data("hdr", "payload"));
+		per.put("s-2", std::make_shared<test::dummy_persistable>());
+
+		CPPUNIT_ASSERT(per.contains_key("s-1"));
+		CPPUNIT_ASSERT(per.contains_key("s-2"));
+		CPPUNIT_ASSERT(!per.contains_key("s-3"));
+		CPPUNIT_ASSERT((sorted_keys(per) == strvec{ "s-1", "s-2" }));
+
+		CPPUNIT_ASSERT_EQUAL(std::string("hdrpayload"), to_string(per.get("s-1")));
+		CPPUNIT_ASSERT_EQUAL(std::string("HEADERPAYLOAD"), to_string(per.get("s-2")));
+
+		try {
+			per.get("s-3");
+			CPPUNIT_FAIL("get() of a missing key should throw");
+		}
+		catch (const persistence_exception&) {}
+	}
+
+	void test_replace() {
+		mmap_persistence per(dir_);
+		per.open(CLIENT_ID, SERVER_URI);
+
+		per.put("s-1", make_data("first"));
+		per.put("s-1", make_data("second"));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), per.keys().size());
+		CPPUNIT_ASSERT_EQUAL(std::string("second"), to_string(per.get("s-1")));
+	}
+
+	void test_remove() {
+		mmap_persistence per(dir_);
+		per.open(CLIENT_ID, SERVER_URI);
+
+		per.put("s-1", make_data("one"));
+		per.put("s-2", make_data("two"));
+		per.remove("s-1");
+		per.remove("s-9");		// not there; does nothing
+
+		CPPUNIT_ASSERT(!per.contains_key("s-1"));
+		CPPUNIT_ASSERT((per.keys() == strvec{ "s-2" }));
+	}
+
+	void test_clear() {
+		mmap_persistence per(dir_, 4096);
+		per.open(CLIENT_ID, SERVER_URI);
+
+		for (int i=0; i<100; ++i)
+			per.put("s-" + std::to_string(i), make_data(std::string(100, 'x')));
+		CPPUNIT_ASSERT(per.num_segments() > 1);
+
+		per.clear();
+		CPPUNIT_ASSERT(per.keys().empty());
+		CPPUNIT_ASSERT_EQUAL(size_t(1), per.num_segments());
+
+		per.put("s-1", make_data("one"));
+		per.close();
+
+		per.open(CLIENT_ID, SERVER_URI);
+		CPPUNIT_ASSERT((per.keys() == strvec{ "s-1" }));
+	}
+
+// ----------------------------------------------------------------------
+// Test recovering the data
+// ----------------------------------------------------------------------
+
+	void test_reopen() {
+		{
+			mmap_persistence per(dir_);
+			per.open(CLIENT_ID, SERVER_URI);
+			per.put("s-1", make_data("one"));
+			per.put("s-2", make_data("two"));
+			per.put("s-3", make_data("three"));
+			per.remove("s-2");
+			per.put("s-3", make_data("THREE"));
+			// Destructor closes
+		}
+
+		mmap_persistence per(dir_);
+		per.open(CLIENT_ID, SERVER_URI);
+		CPPUNIT_ASSERT((sorted_keys(per) == strvec{ "s-1", "s-3" }));
+		CPPUNIT_ASSERT_EQUAL(std::string("one"), to_string(per.get("s-1")));
+		CPPUNIT_ASSERT_EQUAL(std::string("THREE"), to_string(per.get("s-3")));
+
+		// The other client's store is separate
+		mmap_persistence other(dir_);
+		other.open("other", SERVER_URI);
+		CPPUNIT_ASSERT(other.keys().empty());
+	}
+
+	void test_compaction() {
+		const std::string PAYLOAD(200, 'x');
+		mmap_persistence per(dir_, 4096);
+		per.open(CLIENT_ID, SERVER_URI);
+
+		// One message that is never acknowledged
+		per.put("s-0", make_data("keep"));
+
+		// ...and lots that are, in order, like QoS 1 traffic
+		for (int i=1; i<1000; ++i) {
+			std::string key = "s-" + std::to_string(i);
+			per.put(key, make_data(PAYLOAD));
+			if (i > 4)
+				per.remove("s-" + std::to_string(i-4));
+		}
+
+		// The log doesn't keep growing
+		CPPUNIT_ASSERT(per.num_segments() <= 3);
+
+		strvec expected { "s-0", "s-996", "s-997", "s-998", "s-999" };
+		CPPUNIT_ASSERT(sorted_keys(per) == expected);
+		CPPUNIT_ASSERT_EQUAL(std::string("keep"), to_string(per.get("s-0")));
+		per.close();
+
+		per.open(CLIENT_ID, SERVER_URI);
+		CPPUNIT_ASSERT(sorted_keys(per) == expected);
+		CPPUNIT_ASSERT_EQUAL(std::string("keep"), to_string(per.get("s-0")));
+		CPPUNIT_ASSERT_EQUAL(PAYLOAD, to_string(per.get("s-999")));
+	}
+
+	void test_compaction_pinned_front() {
+		const std::string PAYLOAD(200, 'x');
+		mmap_persistence per(dir_, 4096);
+		per.open(CLIENT_ID, SERVER_URI);
+
+		// A message that keeps the first segment well over a quarter live,
+		// and one in it that's removed once the segment is behind us.
+		per.put("pin", make_data(std::string(1500, 'p')));
+		per.put("gone", make_data(PAYLOAD));
+
+		for (int i=1; i<1000; ++i) {
+			std::string key = "s-" + std::to_string(i);
+			per.put(key, make_data(PAYLOAD));
+			if (i > 4)
+				per.remove("s-" + std::to_string(i-4));
+			if (i == 50)
+				per.remove("gone");
+		}
+
+		// The dead segments behind the front are still dropped
+		CPPUNIT_ASSERT(per.num_segments() <= 4);
+
+		strvec expected { "pin", "s-996", "s-997", "s-998", "s-999" };
+		CPPUNIT_ASSERT(sorted_keys(per) == expected);
+		per.close();
+
+		// ...and the removed message doesn't come back
+		per.open(CLIENT_ID, SERVER_URI);
+		CPPUNIT_ASSERT(sorted_keys(per) == expected);
+		CPPUNIT_ASSERT_EQUAL(std::string(1500, 'p'), to_string(per.get("pin")));
+	}
+
+	void test_large_record() {
+		const std::string BIG(20000, 'b');
+		mmap_persistence per(dir_, 4096);
+		per.open(CLIENT_ID, SERVER_URI);
+
+		per.put("s-1", make_data("small"));
+		per.put("s-2", make_data("hdr", BIG));
+		per.put("s-3", make_data("small"));
+
+		CPPUNIT_ASSERT_EQUAL("hdr" + BIG, to_string(per.get("s-2")));
+		per.close();
+
+		per.open(CLIENT_ID, SERVER_URI);
+		CPPUNIT_ASSERT_EQUAL(size_t(3), per.keys().size());
+		CPPUNIT_ASSERT_EQUAL("hdr" + BIG, to_string(per.get("s-2")));
+	}
+
+	void test_torn_record() {
+		std::string path;
+		{
+			mmap_persistence per(dir_);
+			per.open(CLIENT_ID, SERVER_URI);
+			per.put("s-1", make_data("one"));
+			per.put("s-2", make_data("two"));
+			path = active_path(per);
+		}
+
+		// Damage the last record, as if it was only partly written
+		FILE* f = fopen(path.c_str(), "r+b");
+		CPPUNIT_ASSERT(f != nullptr);
+		std::vector<char> buf(4096);
+		size_t n = fread(buf.data(), 1, buf.size(), f);
+		CPPUNIT_ASSERT_EQUAL(buf.size(), n);
+		auto it = std::search(buf.begin(), buf.end(), std::begin("s-2two"), std::end("s-2two")-1);
+		CPPUNIT_ASSERT(it != buf.end());
+		fseek(f, long(it - buf.begin()) + 3, SEEK_SET);
+		fputc('X', f);
+		fclose(f);
+
+		mmap_persistence per(dir_);
+		per.open(CLIENT_ID, SERVER_URI);
+		CPPUNIT_ASSERT((per.keys() == strvec{ "s-1" }));
+
+		// New records are written over the damaged one
+		per.put("s-3", make_data("three"));
+		per.close();
+
+		per.open(CLIENT_ID, SERVER_URI);
+		CPPUNIT_ASSERT((sorted_keys(per) == strvec{ "s-1", "s-3" }));
+		CPPUNIT_ASSERT_EQUAL(std::string("three"), to_string(per.get("s-3")));
+	}
+
+// ----------------------------------------------------------------------
+// Test syncing
+// ----------------------------------------------------------------------
+
+	void test_sync() {
+		mmap_persistence per(dir_, 4096);
+		per.set_sync_records(10);
+		per.open(CLIENT_ID, SERVER_URI);
+
+		for (int i=0; i<9; ++i)
+			per.put("s-" + std::to_string(i), make_data("data"));
+		CPPUNIT_ASSERT_EQUAL(size_t(9), per.nunsynced_);
+
+		per.remove("s-0");
+		CPPUNIT_ASSERT_EQUAL(size_t(0), per.nunsynced_);
+
+		per.put("s-0", make_data("data"));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), per.nunsynced_);
+		per.sync();
+		CPPUNIT_ASSERT_EQUAL(size_t(0), per.nunsynced_);
+
+		per.set_sync_records(0);
+		per.set_sync_interval(std::chrono::milliseconds(1));
+		per.put("s-1", make_data("data"));
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		per.put("s-2", make_data("data"));
+		CPPUNIT_ASSERT_EQUAL(size_t(0), per.nunsynced_);
+	}
+
+// ----------------------------------------------------------------------
+// Test reading the whole store to restore a session
+// ----------------------------------------------------------------------
+
+	void test_load_all() {
+		// Enough data to be split between threads
+		const int N = 3000;
+		const size_t SZ = 5000;
+
+		auto value = [SZ](int i) {
+			std::string s = std::to_string(i) + ":";
+			s.resize(SZ, char('a' + i % 26));
+			return s;
+		};
+
+		{
+			mmap_persistence per(dir_);
+			per.open(CLIENT_ID, SERVER_URI);
+			for (int i=0; i<N; ++i)
+				per.put("s-" + std::to_string(i), make_data("hdr", value(i)));
+			for (int i=0; i<N; i+=3)
+				per.remove("s-" + std::to_string(i));
+			for (int i=1; i<N; i+=3)
+				per.put("s-" + std::to_string(i), make_data("HDR", value(i)));
+		}
+
+		mmap_persistence per(dir_);
+		per.open(CLIENT_ID, SERVER_URI);
+		auto snap = per.load_all();
+
+		CPPUNIT_ASSERT_EQUAL(per.keys().size(), snap->size());
+		CPPUNIT_ASSERT_EQUAL(size_t(N - N/3), snap->size());
+
+		for (int i=0; i<N; ++i) {
+			std::string key = "s-" + std::to_string(i);
+			size_t j = snap->find(key.c_str());
+			if (i % 3 == 0) {
+				CPPUNIT_ASSERT_EQUAL(persistence_snapshot::npos, j);
+				continue;
+			}
+			CPPUNIT_ASSERT(j != persistence_snapshot::npos);
+			std::string s(reinterpret_cast<const char*>(snap->data(j)), snap->data_length(j));
+			CPPUNIT_ASSERT_EQUAL((i % 3 == 1 ? "HDR" : "hdr") + value(i), s);
+		}
+
+		per.clear();
+		CPPUNIT_ASSERT(per.load_all()->empty());
+	}
+
+// ----------------------------------------------------------------------
+// Test through the C library's callbacks
+// ----------------------------------------------------------------------
+
+	void test_c_callbacks() {
+		mmap_persistence per(dir_);
+		void* handle = nullptr;
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS,
+			 iclient_persistence::persistence_open(&handle, CLIENT_ID.c_str(),
+												   SERVER_URI.c_str(), &per));
+
+		char key[] = "s-1";
+		const char* buffers[] = { "ab", "cde", "f" };
+		int buflens[] = { 2, 3, 1 };
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS,
+			 iclient_persistence::persistence_put(handle, key, 3,
+												  const_cast<char**>(buffers), buflens));
+
+		char* buf = nullptr;
+		int buflen = 0;
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS,
+			 iclient_persistence::persistence_get(handle, key, &buf, &buflen));
+		CPPUNIT_ASSERT_EQUAL(std::string("abcdef"), std::string(buf, buflen));
+		free(buf);
+
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS,
+			 iclient_persistence::persistence_containskey(handle, key));
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS,
+			 iclient_persistence::persistence_remove(handle, key));
+		CPPUNIT_ASSERT_EQUAL(MQTTCLIENT_PERSISTENCE_ERROR,
+			 iclient_persistence::persistence_get(handle, key, &buf, &buflen));
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS,
+			 iclient_persistence::persistence_close(handle));
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		//  __mqtt_mmap_persistence_test_h
+
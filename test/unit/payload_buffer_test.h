@@ -0,0 +1,143 @@
+// payload_buffer_test.h
+// Unit tests for the payload_buffer class in the Paho MQTT C++ library.
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_payload_buffer_test_h
+#define __mqtt_payload_buffer_test_h
+
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "mqtt/payload_buffer.h"
+#include <string>
+#include <vector>
+#include <cstring>
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+class payload_buffer_test : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( payload_buffer_test );
+
+	CPPUNIT_TEST( test_dflt_constructor );
+	CPPUNIT_TEST( test_copy_constructors );
+	CPPUNIT_TEST( test_move_constructors );
+	CPPUNIT_TEST( test_unique_ptr_constructor );
+	CPPUNIT_TEST( test_shared );
+
+	CPPUNIT_TEST_SUITE_END();
+
+	const std::string PAYLOAD { "Hello there" };
+	const size_t N = PAYLOAD.size();
+
+	// A payload too long to be kept in a short string
+	const std::string LONG_PAYLOAD = std::string(100, 'x');
+
+	// A deleter that counts the arrays it deletes
+	struct counting_deleter {
+		int* n;
+		void operator()(byte* p) const { ++*n; delete[] p; }
+	};
+
+public:
+	void setUp() {}
+	void tearDown() {}
+
+	void test_dflt_constructor() {
+		payload_buffer buf;
+		CPPUNIT_ASSERT(buf.empty());
+		CPPUNIT_ASSERT_EQUAL(size_t(0), buf.size());
+		CPPUNIT_ASSERT(!buf.data());
+		CPPUNIT_ASSERT_EQUAL(0L, buf.use_count());
+		CPPUNIT_ASSERT_EQUAL(std::string(), buf.to_string());
+	}
+
+	void test_copy_constructors() {
+		payload_buffer buf(PAYLOAD.data(), N);
+		CPPUNIT_ASSERT_EQUAL(N, buf.size());
+		CPPUNIT_ASSERT(buf.data() != reinterpret_cast<const byte*>(PAYLOAD.data()));
+		CPPUNIT_ASSERT_EQUAL(PAYLOAD, buf.to_string());
+
+		payload_buffer buf2(PAYLOAD);
+		CPPUNIT_ASSERT_EQUAL(PAYLOAD, buf2.to_string());
+
+		CPPUNIT_ASSERT(payload_buffer(PAYLOAD.data(), 0).empty());
+		CPPUNIT_ASSERT(payload_buffer(std::string()).empty());
+	}
+
+	void test_move_constructors() {
+		std::string str(LONG_PAYLOAD);
+		const char* p = str.data();
+
+		payload_buffer buf(std::move(str));
+		CPPUNIT_ASSERT(buf.data() == reinterpret_cast<const byte*>(p));
+		CPPUNIT_ASSERT_EQUAL(LONG_PAYLOAD, buf.to_string());
+
+		std::vector<byte> vec(PAYLOAD.begin(), PAYLOAD.end());
+		const byte* pv = vec.data();
+
+		payload_buffer buf2(std::move(vec));
+		CPPUNIT_ASSERT(buf2.data() == pv);
+		CPPUNIT_ASSERT_EQUAL(PAYLOAD, buf2.to_string());
+
+		CPPUNIT_ASSERT(payload_buffer(std::vector<byte>()).empty());
+	}
+
+	void test_unique_ptr_constructor() {
+		int ndel = 0;
+		{
+			std::unique_ptr<byte[],counting_deleter> arr(new byte[N],
+														 counting_deleter{ &ndel });
+			std::memcpy(arr.get(), PAYLOAD.data(), N);
+			const byte* p = arr.get();
+
+			payload_buffer buf(std::move(arr), N);
+			CPPUNIT_ASSERT(!arr);
+			CPPUNIT_ASSERT(buf.data() == p);
+			CPPUNIT_ASSERT_EQUAL(PAYLOAD, buf.to_string());
+		}
+		CPPUNIT_ASSERT_EQUAL(1, ndel);
+
+		CPPUNIT_ASSERT(payload_buffer(std::unique_ptr<byte[]>(), 0).empty());
+	}
+
+	void test_shared() {
+		payload_buffer buf(PAYLOAD);
+		CPPUNIT_ASSERT_EQUAL(1L, buf.use_count());
+		{
+			payload_buffer cpy(buf);
+			CPPUNIT_ASSERT(cpy.data() == buf.data());
+			CPPUNIT_ASSERT_EQUAL(2L, buf.use_count());
+
+			payload_buffer asg;
+			asg = buf;
+			CPPUNIT_ASSERT(asg.data() == buf.data());
+			CPPUNIT_ASSERT_EQUAL(3L, buf.use_count());
+		}
+		CPPUNIT_ASSERT_EQUAL(1L, buf.use_count());
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		//  __mqtt_payload_buffer_test_h
+
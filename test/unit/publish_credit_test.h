@@ -0,0 +1,182 @@
+// publish_credit_test.h
+// Unit tests for the publish_credit class in the Paho MQTT C++ library.
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_publish_credit_test_h
+#define __mqtt_publish_credit_test_h
+
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "mqtt/publish_credit.h"
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+class publish_credit_test : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( publish_credit_test );
+
+	CPPUNIT_TEST( test_dflt_constructor );
+	CPPUNIT_TEST( test_message_limit );
+	CPPUNIT_TEST( test_byte_limit );
+	CPPUNIT_TEST( test_large_message );
+	CPPUNIT_TEST( test_refused_notice );
+	CPPUNIT_TEST( test_set_limits );
+	CPPUNIT_TEST( test_acquire_waits );
+	CPPUNIT_TEST( test_try_acquire_for );
+
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp() {}
+	void tearDown() {}
+
+	void test_dflt_constructor() {
+		publish_credit cr;
+		CPPUNIT_ASSERT_EQUAL(size_t(0), cr.max_messages());
+		CPPUNIT_ASSERT_EQUAL(size_t(0), cr.max_bytes());
+
+		// No limit
+		for (int i=0; i<1000; ++i)
+			CPPUNIT_ASSERT(cr.try_acquire(1000000));
+		CPPUNIT_ASSERT_EQUAL(size_t(1000), cr.messages());
+		CPPUNIT_ASSERT_EQUAL(size_t(1000000000), cr.bytes());
+	}
+
+	void test_message_limit() {
+		publish_credit cr(2);
+		CPPUNIT_ASSERT(cr.try_acquire(10));
+		CPPUNIT_ASSERT(cr.try_acquire(10));
+		CPPUNIT_ASSERT(!cr.try_acquire(10));
+		CPPUNIT_ASSERT_EQUAL(size_t(2), cr.messages());
+		CPPUNIT_ASSERT_EQUAL(size_t(20), cr.bytes());
+
+		cr.release(10);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), cr.messages());
+		CPPUNIT_ASSERT_EQUAL(size_t(10), cr.bytes());
+		CPPUNIT_ASSERT(cr.try_acquire(10));
+	}
+
+	void test_byte_limit() {
+		publish_credit cr(0, 100);
+		CPPUNIT_ASSERT(cr.try_acquire(60));
+		CPPUNIT_ASSERT(cr.try_acquire(40));
+		CPPUNIT_ASSERT(!cr.try_acquire(1));
+
+		// A message with no payload still needs room
+		CPPUNIT_ASSERT(cr.try_acquire(0));
+
+		cr.release(60);
+		CPPUNIT_ASSERT(!cr.try_acquire(61));
+		CPPUNIT_ASSERT(cr.try_acquire(60));
+	}
+
+	void test_large_message() {
+		publish_credit cr(10, 100);
+
+		// Bigger than the whole budget, but it goes when nothing else is
+		// in flight.
+		CPPUNIT_ASSERT(cr.try_acquire(500));
+		CPPUNIT_ASSERT(!cr.try_acquire(1));
+		cr.release(500);
+
+		CPPUNIT_ASSERT(cr.try_acquire(1));
+		CPPUNIT_ASSERT(!cr.try_acquire(500));
+	}
+
+	void test_refused_notice() {
+		publish_credit cr(1);
+		CPPUNIT_ASSERT(cr.try_acquire(1));
+
+		// Nobody was turned away
+		CPPUNIT_ASSERT(!cr.release(1));
+
+		CPPUNIT_ASSERT(cr.try_acquire(1));
+		CPPUNIT_ASSERT(!cr.try_acquire(1));
+		CPPUNIT_ASSERT(!cr.try_acquire(1));
+
+		// Once, no matter how many times it was refused
+		CPPUNIT_ASSERT(cr.release(1));
+		CPPUNIT_ASSERT(cr.try_acquire(1));
+		CPPUNIT_ASSERT(!cr.release(1));
+	}
+
+	void test_set_limits() {
+		publish_credit cr(1);
+		CPPUNIT_ASSERT(cr.try_acquire(1));
+		CPPUNIT_ASSERT(!cr.try_acquire(1));
+
+		CPPUNIT_ASSERT(cr.set_limits(2, 50));
+		CPPUNIT_ASSERT_EQUAL(size_t(2), cr.max_messages());
+		CPPUNIT_ASSERT_EQUAL(size_t(50), cr.max_bytes());
+		CPPUNIT_ASSERT(cr.try_acquire(1));
+
+		// Lowering the limit doesn't touch what's in flight
+		CPPUNIT_ASSERT(!cr.set_limits(1, 0));
+		CPPUNIT_ASSERT_EQUAL(size_t(2), cr.messages());
+		cr.release(1);
+		CPPUNIT_ASSERT(!cr.try_acquire(1));
+		cr.release(1);
+		CPPUNIT_ASSERT(cr.try_acquire(1));
+	}
+
+	void test_acquire_waits() {
+		publish_credit cr(1);
+		cr.acquire(1);
+
+		std::atomic<bool> got(false);
+		std::thread thr([&] {
+			cr.acquire(1);
+			got = true;
+		});
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		CPPUNIT_ASSERT(!got);
+
+		cr.release(1);
+		thr.join();
+		CPPUNIT_ASSERT(got);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), cr.messages());
+	}
+
+	void test_try_acquire_for() {
+		publish_credit cr(1);
+		CPPUNIT_ASSERT(cr.try_acquire_for(1, std::chrono::milliseconds(10)));
+		CPPUNIT_ASSERT(!cr.try_acquire_for(1, std::chrono::milliseconds(10)));
+
+		std::thread thr([&] {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			cr.release(1);
+		});
+		CPPUNIT_ASSERT(cr.try_acquire_for(1, std::chrono::seconds(5)));
+		thr.join();
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		//  __mqtt_publish_credit_test_h
+
@@ -20,6 +20,7 @@
 #include "async_client_test.h"
 #include "client_test.h"
 #include "message_test.h"
+#include "payload_buffer_test.h"
 #include "will_options_test.h"
 #include "ssl_options_test.h"
 #include "connect_options_test.h"
@@ -27,8 +28,21 @@
 #include "response_options_test.h"
 #include "delivery_response_options_test.h"
 #include "iclient_persistence_test.h"
+#include "memory_persistence_test.h"
+#include "write_behind_persistence_test.h"
+#if !defined(_WIN32)
+	#include "mmap_persistence_test.h"
+#endif
 #include "token_test.h"
+#include "token_registry_test.h"
+#include "publish_credit_test.h"
+#include "client_metrics_test.h"
+#include "trace_test.h"
+#include "block_pool_test.h"
+#include "thread_queue_test.h"
+#include "executor_test.h"
 #include "topic_test.h"
+#include "topic_router_test.h"
 #include "exception_test.h"
 
 using namespace CppUnit;
@@ -46,10 +60,24 @@ int main(int argc, char* argv[])
 	CPPUNIT_TEST_SUITE_REGISTRATION( mqtt::response_options_test );
 
 	CPPUNIT_TEST_SUITE_REGISTRATION( mqtt::message_test );
+	CPPUNIT_TEST_SUITE_REGISTRATION( mqtt::payload_buffer_test );
 	CPPUNIT_TEST_SUITE_REGISTRATION( mqtt::delivery_response_options_test );
 	CPPUNIT_TEST_SUITE_REGISTRATION( mqtt::iclient_persistence_test );
+	CPPUNIT_TEST_SUITE_REGISTRATION( mqtt::memory_persistence_test );
+	CPPUNIT_TEST_SUITE_REGISTRATION( mqtt::write_behind_persistence_test );
+#if !defined(_WIN32)
+	CPPUNIT_TEST_SUITE_REGISTRATION( mqtt::mmap_persistence_test );
+#endif
 	CPPUNIT_TEST_SUITE_REGISTRATION( mqtt::token_test );
+	CPPUNIT_TEST_SUITE_REGISTRATION( mqtt::token_registry_test );
+	CPPUNIT_TEST_SUITE_REGISTRATION( mqtt::publish_credit_test );
+	CPPUNIT_TEST_SUITE_REGISTRATION( mqtt::client_metrics_test );
+	CPPUNIT_TEST_SUITE_REGISTRATION( mqtt::trace_test );
+	CPPUNIT_TEST_SUITE_REGISTRATION( mqtt::block_pool_test );
+	CPPUNIT_TEST_SUITE_REGISTRATION( mqtt::thread_queue_test );
+	CPPUNIT_TEST_SUITE_REGISTRATION( mqtt::executor_test );
 	CPPUNIT_TEST_SUITE_REGISTRATION( mqtt::topic_test );
+	CPPUNIT_TEST_SUITE_REGISTRATION( mqtt::topic_router_test );
 	CPPUNIT_TEST_SUITE_REGISTRATION( mqtt::exception_test );
 
 	CPPUNIT_TEST_SUITE_REGISTRATION( mqtt::async_client_test );
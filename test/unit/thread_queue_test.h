@@ -0,0 +1,238 @@
+// thread_queue_test.h
+// Unit tests for the thread_queue class in the Paho MQTT C++ library.
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_thread_queue_test_h
+#define __mqtt_thread_queue_test_h
+
+#include <thread>
+#include <chrono>
+#include <limits>
+#include <vector>
+#include <iterator>
+
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "mqtt/thread_queue.h"
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+class thread_queue_test : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( thread_queue_test );
+
+	CPPUNIT_TEST( test_dflt_constructor );
+	CPPUNIT_TEST( test_capacity_constructor );
+	CPPUNIT_TEST( test_put_get );
+	CPPUNIT_TEST( test_try_put );
+	CPPUNIT_TEST( test_try_get );
+	CPPUNIT_TEST( test_try_get_for );
+	CPPUNIT_TEST( test_try_put_for );
+	CPPUNIT_TEST( test_put_blocks_when_full );
+	CPPUNIT_TEST( test_set_capacity );
+	CPPUNIT_TEST( test_get_batch );
+
+	CPPUNIT_TEST_SUITE_END();
+
+	using queue_type = mqtt::thread_queue<int>;
+
+public:
+	void setUp() {}
+	void tearDown() {}
+
+// ----------------------------------------------------------------------
+// Test the default constructor
+// ----------------------------------------------------------------------
+
+	void test_dflt_constructor() {
+		queue_type que;
+		CPPUNIT_ASSERT(que.empty());
+		CPPUNIT_ASSERT_EQUAL(size_t(0), que.size());
+		CPPUNIT_ASSERT_EQUAL(std::numeric_limits<queue_type::size_type>::max(),
+							 que.capacity());
+	}
+
+// ----------------------------------------------------------------------
+// Test the capacity constructor
+// ----------------------------------------------------------------------
+
+	void test_capacity_constructor() {
+		queue_type que(16);
+		CPPUNIT_ASSERT(que.empty());
+		CPPUNIT_ASSERT_EQUAL(size_t(16), que.capacity());
+
+		// The minimum capacity is one
+		queue_type que0(0);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), que0.capacity());
+	}
+
+// ----------------------------------------------------------------------
+// Test that items come out in the order they went in
+// ----------------------------------------------------------------------
+
+	void test_put_get() {
+		queue_type que;
+		for (int i=0; i<10; ++i)
+			que.put(i);
+		CPPUNIT_ASSERT_EQUAL(size_t(10), que.size());
+
+		for (int i=0; i<5; ++i)
+			CPPUNIT_ASSERT_EQUAL(i, que.get());
+
+		int n;
+		for (int i=5; i<10; ++i) {
+			que.get(&n);
+			CPPUNIT_ASSERT_EQUAL(i, n);
+		}
+		CPPUNIT_ASSERT(que.empty());
+	}
+
+// ----------------------------------------------------------------------
+// Test try_put() on a full queue
+// ----------------------------------------------------------------------
+
+	void test_try_put() {
+		queue_type que(2);
+		CPPUNIT_ASSERT(que.try_put(1));
+		CPPUNIT_ASSERT(que.try_put(2));
+		CPPUNIT_ASSERT(!que.try_put(3));
+		CPPUNIT_ASSERT_EQUAL(size_t(2), que.size());
+	}
+
+// ----------------------------------------------------------------------
+// Test try_get() on an empty queue
+// ----------------------------------------------------------------------
+
+	void test_try_get() {
+		queue_type que;
+		int n = 0;
+		CPPUNIT_ASSERT(!que.try_get(&n));
+
+		que.put(42);
+		CPPUNIT_ASSERT(que.try_get(&n));
+		CPPUNIT_ASSERT_EQUAL(42, n);
+	}
+
+// ----------------------------------------------------------------------
+// Test try_get_for(), with a timeout and with an item from another thread
+// ----------------------------------------------------------------------
+
+	void test_try_get_for() {
+		queue_type que;
+		int n = 0;
+		CPPUNIT_ASSERT(!que.try_get_for(&n, std::chrono::milliseconds(10)));
+
+		std::thread thr([&que] {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			que.put(42);
+		});
+		CPPUNIT_ASSERT(que.try_get_for(&n, std::chrono::seconds(5)));
+		CPPUNIT_ASSERT_EQUAL(42, n);
+		thr.join();
+	}
+
+// ----------------------------------------------------------------------
+// Test try_put_for() on a full queue
+// ----------------------------------------------------------------------
+
+	void test_try_put_for() {
+		queue_type que(1);
+		que.put(1);
+		CPPUNIT_ASSERT(!que.try_put_for(2, std::chrono::milliseconds(10)));
+
+		std::thread thr([&que] {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			que.get();
+		});
+		CPPUNIT_ASSERT(que.try_put_for(2, std::chrono::seconds(5)));
+		thr.join();
+		CPPUNIT_ASSERT_EQUAL(2, que.get());
+	}
+
+// ----------------------------------------------------------------------
+// Test that put() waits for room in a full queue
+// ----------------------------------------------------------------------
+
+	void test_put_blocks_when_full() {
+		queue_type que(1);
+		que.put(1);
+
+		std::thread thr([&que] { que.put(2); });
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), que.size());
+
+		CPPUNIT_ASSERT_EQUAL(1, que.get());
+		thr.join();
+		CPPUNIT_ASSERT_EQUAL(2, que.get());
+	}
+
+// ----------------------------------------------------------------------
+// Test changing the capacity
+// ----------------------------------------------------------------------
+
+	void test_set_capacity() {
+		queue_type que(1);
+		que.put(1);
+		CPPUNIT_ASSERT(!que.try_put(2));
+
+		que.capacity(2);
+		CPPUNIT_ASSERT_EQUAL(size_t(2), que.capacity());
+		CPPUNIT_ASSERT(que.try_put(2));
+	}
+
+// ----------------------------------------------------------------------
+// Test get_batch()
+// ----------------------------------------------------------------------
+
+	void test_get_batch() {
+		queue_type que(8);
+		for (int i=0; i<8; ++i)
+			que.put(i);
+
+		std::vector<int> v;
+		CPPUNIT_ASSERT_EQUAL(size_t(0), que.get_batch(std::back_inserter(v), 0));
+		CPPUNIT_ASSERT_EQUAL(size_t(5), que.get_batch(std::back_inserter(v), 5));
+		CPPUNIT_ASSERT_EQUAL(size_t(3), que.get_batch(std::back_inserter(v), 5));
+		CPPUNIT_ASSERT(que.empty());
+
+		CPPUNIT_ASSERT_EQUAL(size_t(8), v.size());
+		for (int i=0; i<8; ++i)
+			CPPUNIT_ASSERT_EQUAL(i, v[i]);
+
+		// Waits for the first value
+		std::thread thr([&que] {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			que.put(42);
+		});
+		v.clear();
+		CPPUNIT_ASSERT_EQUAL(size_t(1), que.get_batch(std::back_inserter(v), 5));
+		CPPUNIT_ASSERT_EQUAL(42, v[0]);
+		thr.join();
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		//  __mqtt_thread_queue_test_h
+
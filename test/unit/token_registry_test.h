@@ -0,0 +1,263 @@
+// token_registry_test.h
+// Unit tests for the token_registry class in the Paho MQTT C++ library.
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_token_registry_test_h
+#define __mqtt_token_registry_test_h
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "mqtt/token_registry.h"
+#include "dummy_async_client.h"
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+class token_registry_test : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( token_registry_test );
+
+	CPPUNIT_TEST( test_dflt_constructor );
+	CPPUNIT_TEST( test_add_remove_token );
+	CPPUNIT_TEST( test_add_remove_delivery_token );
+	CPPUNIT_TEST( test_remove_unknown );
+	CPPUNIT_TEST( test_set_message_id );
+	CPPUNIT_TEST( test_set_message_id_after_remove );
+	CPPUNIT_TEST( test_reused_message_id );
+	CPPUNIT_TEST( test_get_delivery_tokens );
+	CPPUNIT_TEST( test_add_batch );
+
+	CPPUNIT_TEST_SUITE_END();
+
+	const std::string TOPIC { "TOPIC" };
+
+	mqtt::test::dummy_async_client cli;
+
+public:
+	void setUp() {}
+	void tearDown() {}
+
+// ----------------------------------------------------------------------
+// Test default constructor
+// ----------------------------------------------------------------------
+
+	void test_dflt_constructor() {
+		mqtt::token_registry reg;
+		CPPUNIT_ASSERT(reg.empty());
+		CPPUNIT_ASSERT_EQUAL(size_t(0), reg.size());
+		CPPUNIT_ASSERT(reg.get_delivery_tokens().empty());
+		CPPUNIT_ASSERT(!reg.get_delivery_token(1));
+	}
+
+// ----------------------------------------------------------------------
+// Test add/remove of a generic token
+// ----------------------------------------------------------------------
+
+	void test_add_remove_token() {
+		mqtt::token_registry reg;
+		mqtt::itoken_ptr tok { std::make_shared<mqtt::token>(cli) };
+
+		reg.add(tok);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), reg.size());
+
+		// Null tokens are ignored
+		reg.add(mqtt::itoken_ptr());
+		CPPUNIT_ASSERT_EQUAL(size_t(1), reg.size());
+
+		mqtt::idelivery_token_ptr dtok;
+		CPPUNIT_ASSERT(reg.remove(tok.get(), &dtok));
+		CPPUNIT_ASSERT(!dtok);
+		CPPUNIT_ASSERT(reg.empty());
+	}
+
+// ----------------------------------------------------------------------
+// Test add/remove of a delivery token
+// ----------------------------------------------------------------------
+
+	void test_add_remove_delivery_token() {
+		mqtt::token_registry reg;
+		mqtt::idelivery_token_ptr tok {
+			std::make_shared<mqtt::delivery_token>(cli, TOPIC)
+		};
+
+		reg.add(tok);
+		CPPUNIT_ASSERT_EQUAL(size_t(1), reg.size());
+
+		// The token comes back to us as a raw 'itoken' pointer
+		mqtt::itoken* itok = tok.get();
+
+		mqtt::idelivery_token_ptr dtok;
+		CPPUNIT_ASSERT(reg.remove(itok, &dtok));
+		CPPUNIT_ASSERT(dtok == tok);
+		CPPUNIT_ASSERT(reg.empty());
+	}
+
+// ----------------------------------------------------------------------
+// Test removing a token that isn't there
+// ----------------------------------------------------------------------
+
+	void test_remove_unknown() {
+		mqtt::token_registry reg;
+		mqtt::itoken_ptr tok { std::make_shared<mqtt::token>(cli) };
+
+		CPPUNIT_ASSERT(!reg.remove(nullptr));
+		CPPUNIT_ASSERT(!reg.remove(tok.get()));
+
+		reg.add(tok);
+		CPPUNIT_ASSERT(reg.remove(tok.get()));
+		CPPUNIT_ASSERT(!reg.remove(tok.get()));
+	}
+
+// ----------------------------------------------------------------------
+// Test the message ID index
+// ----------------------------------------------------------------------
+
+	void test_set_message_id() {
+		mqtt::token_registry reg;
+		mqtt::idelivery_token_ptr tok {
+			std::make_shared<mqtt::delivery_token>(cli, TOPIC)
+		};
+		mqtt::itoken_ptr gtok { std::make_shared<mqtt::token>(cli) };
+
+		reg.add(tok);
+		reg.add(gtok);
+
+		reg.set_message_id(tok.get(), 42);
+		CPPUNIT_ASSERT(reg.get_delivery_token(42) == tok);
+		CPPUNIT_ASSERT(!reg.get_delivery_token(43));
+
+		// Only delivery tokens get indexed, and only with a positive ID
+		reg.set_message_id(gtok.get(), 43);
+		CPPUNIT_ASSERT(!reg.get_delivery_token(43));
+		reg.set_message_id(tok.get(), 0);
+		CPPUNIT_ASSERT(!reg.get_delivery_token(0));
+
+		reg.remove(tok.get());
+		CPPUNIT_ASSERT(!reg.get_delivery_token(42));
+	}
+
+// ----------------------------------------------------------------------
+// Test that a token completing before it's indexed doesn't linger
+// ----------------------------------------------------------------------
+
+	void test_set_message_id_after_remove() {
+		mqtt::token_registry reg;
+		mqtt::idelivery_token_ptr tok {
+			std::make_shared<mqtt::delivery_token>(cli, TOPIC)
+		};
+
+		reg.add(tok);
+		reg.remove(tok.get());
+		reg.set_message_id(tok.get(), 7);
+
+		CPPUNIT_ASSERT(!reg.get_delivery_token(7));
+		CPPUNIT_ASSERT(reg.empty());
+	}
+
+// ----------------------------------------------------------------------
+// Test that an old token doesn't clobber a reused message ID
+// ----------------------------------------------------------------------
+
+	void test_reused_message_id() {
+		mqtt::token_registry reg;
+		mqtt::idelivery_token_ptr tok1 {
+			std::make_shared<mqtt::delivery_token>(cli, TOPIC)
+		};
+		mqtt::idelivery_token_ptr tok2 {
+			std::make_shared<mqtt::delivery_token>(cli, TOPIC)
+		};
+
+		reg.add(tok1);
+		reg.set_message_id(tok1.get(), 1);
+		reg.add(tok2);
+		reg.set_message_id(tok2.get(), 1);
+
+		reg.remove(tok1.get());
+		CPPUNIT_ASSERT(reg.get_delivery_token(1) == tok2);
+	}
+
+// ----------------------------------------------------------------------
+// Test getting all the pending delivery tokens
+// ----------------------------------------------------------------------
+
+	void test_get_delivery_tokens() {
+		mqtt::token_registry reg;
+		const int N = 100;
+
+		std::vector<mqtt::idelivery_token_ptr> toks;
+		for (int i=0; i<N; ++i) {
+			toks.push_back(std::make_shared<mqtt::delivery_token>(cli, TOPIC));
+			reg.add(toks.back());
+			reg.add(mqtt::itoken_ptr(std::make_shared<mqtt::token>(cli)));
+		}
+
+		// Only the ones with a message ID are awaiting an ACK
+		for (int i=0; i<N; i+=2)
+			reg.set_message_id(toks[i].get(), i+1);
+
+		CPPUNIT_ASSERT_EQUAL(size_t(2*N), reg.size());
+
+		auto pending = reg.get_delivery_tokens();
+		CPPUNIT_ASSERT_EQUAL(size_t(N/2), pending.size());
+
+		for (const auto& tok : pending) {
+			auto p = std::find(toks.begin(), toks.end(), tok);
+			CPPUNIT_ASSERT(p != toks.end());
+			CPPUNIT_ASSERT((p - toks.begin()) % 2 == 0);
+		}
+	}
+
+// ----------------------------------------------------------------------
+// Test adding and indexing a batch of delivery tokens
+// ----------------------------------------------------------------------
+
+	void test_add_batch() {
+		mqtt::token_registry reg;
+		const int N = 10;
+
+		std::vector<mqtt::delivery_token_ptr> toks;
+		std::vector<std::pair<const mqtt::itoken*,int>> ids;
+		for (int i=0; i<N; ++i) {
+			toks.push_back(std::make_shared<mqtt::delivery_token>(cli, TOPIC));
+			ids.emplace_back(toks.back().get(), i+1);
+		}
+
+		reg.add(toks);
+		CPPUNIT_ASSERT_EQUAL(size_t(N), reg.size());
+
+		reg.set_message_ids(ids);
+		for (int i=0; i<N; ++i)
+			CPPUNIT_ASSERT(reg.get_delivery_token(i+1) == mqtt::idelivery_token_ptr(toks[i]));
+
+		for (int i=0; i<N; ++i)
+			CPPUNIT_ASSERT(reg.remove(toks[i].get()));
+		CPPUNIT_ASSERT(reg.empty());
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace 'mqtt'
+}
+
+#endif //  __mqtt_token_registry_test_h
@@ -24,11 +24,17 @@
 #include <algorithm>
 #include <memory>
 #include <stdexcept>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <future>
 
 #include <cppunit/ui/text/TestRunner.h>
 #include <cppunit/extensions/HelperMacros.h>
 
 #include "mqtt/token.h"
+#include "mqtt/delivery_token.h"
+#include "mqtt/awaitable.h"
 #include "dummy_async_client.h"
 #include "dummy_action_listener.h"
 
@@ -53,11 +59,58 @@ class token_test : public CppUnit::TestFixture
 	CPPUNIT_TEST( test_wait_for_completion_failure );
 	CPPUNIT_TEST( test_wait_for_completion_timeout_success );
 	CPPUNIT_TEST( test_wait_for_completion_timeout_failure );
+	CPPUNIT_TEST( test_try_get_result );
+	CPPUNIT_TEST( test_try_wait_for_result );
+	CPPUNIT_TEST( test_group_success );
+	CPPUNIT_TEST( test_group_failure );
+	CPPUNIT_TEST( test_get_future );
+	CPPUNIT_TEST( test_get_future_failure );
+	CPPUNIT_TEST( test_get_future_after_complete );
+	CPPUNIT_TEST( test_itoken_defaults );
+	CPPUNIT_TEST( test_when_all );
+	CPPUNIT_TEST( test_when_any );
+	CPPUNIT_TEST( test_when_empty );
+	CPPUNIT_TEST( test_add_continuation );
+#if defined(PAHO_MQTTPP_COROUTINES)
+	CPPUNIT_TEST( test_co_await );
+#endif
 
 	CPPUNIT_TEST_SUITE_END();
 
 	mqtt::test::dummy_async_client cli;
 
+	/**
+	 * A token from outside the library, which implements only the
+	 * original itoken interface.
+	 */
+	class user_token : public virtual mqtt::itoken
+	{
+		std::vector<std::string> topics_;
+	public:
+		bool complete = false;
+		int rc = MQTTASYNC_SUCCESS;
+
+		iaction_listener* get_action_callback() const override { return nullptr; }
+		iasync_client* get_client() const override { return nullptr; }
+		int get_message_id() const override { return 0; }
+		const std::vector<std::string>& get_topics() const override { return topics_; }
+		void* get_user_context() const override { return nullptr; }
+		bool is_complete() const override { return complete; }
+		void set_action_callback(iaction_listener&) override {}
+		void set_user_context(void*) override {}
+		void wait_for_completion() override {
+			if (!complete)
+				throw std::logic_error("would block");
+			if (rc != MQTTASYNC_SUCCESS)
+				throw exception(rc);
+		}
+		void wait_for_completion(long) override {
+			if (!complete)
+				throw exception(MQTTASYNC_FAILURE);
+			wait_for_completion();
+		}
+	};
+
 public:
 	void setUp() {}
 	void tearDown() {}
@@ -323,6 +376,329 @@ public:
 		}
 	}
 
+// ----------------------------------------------------------------------
+// Test getting the result without throwing
+// ----------------------------------------------------------------------
+
+	void test_try_get_result() {
+		mqtt::token tok{ cli };
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_OPERATION_INCOMPLETE, tok.try_get_result());
+
+		token::on_success(&tok, nullptr);
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, tok.try_get_result());
+
+		mqtt::token ftok{ cli };
+		MQTTAsync_failureData data = {
+				.token = 12,
+				.code = MQTTASYNC_DISCONNECTED,
+				.message = nullptr,
+		};
+		token::on_failure(&ftok, &data);
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_DISCONNECTED, ftok.try_get_result());
+
+		// Through the interface
+		itoken_ptr itok = std::make_shared<mqtt::token>(cli);
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_OPERATION_INCOMPLETE, itok->try_get_result());
+	}
+
+	void test_try_wait_for_result() {
+		mqtt::token tok{ cli };
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_OPERATION_INCOMPLETE, tok.try_wait_for_result(0));
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_OPERATION_INCOMPLETE, tok.try_wait_for_result(10));
+
+		std::thread thr([&tok] {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			MQTTAsync_failureData data = {
+					.token = 12,
+					.code = MQTTASYNC_FAILURE,
+					.message = nullptr,
+			};
+			token::on_failure(&tok, &data);
+		});
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_FAILURE, tok.try_wait_for_result(-1));
+		thr.join();
+
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_FAILURE, tok.try_wait_for_result(0));
+	}
+
+// ----------------------------------------------------------------------
+// Test a token for a group of actions
+// ----------------------------------------------------------------------
+
+	void test_group_success() {
+		mqtt::test::dummy_action_listener listener;
+		auto group = std::make_shared<mqtt::token>(cli);
+		group->set_action_callback(listener);
+
+		const int N = 3;
+		group->set_num_pending(N);
+
+		std::vector<mqtt::token_ptr> toks;
+		for (int i=0; i<N; ++i) {
+			toks.push_back(std::make_shared<mqtt::token>(cli));
+			toks.back()->add_parent(group);
+		}
+
+		for (int i=0; i<N; ++i) {
+			CPPUNIT_ASSERT_EQUAL(false, group->is_complete());
+			token::on_success(toks[i].get(), nullptr);
+		}
+
+		CPPUNIT_ASSERT_EQUAL(true, group->is_complete());
+		CPPUNIT_ASSERT_EQUAL(true, listener.on_success_called);
+		group->wait_for_completion(0);
+	}
+
+	void test_group_failure() {
+		auto group = std::make_shared<mqtt::token>(cli);
+		group->set_num_pending(2);
+
+		mqtt::token_ptr tok1 = std::make_shared<mqtt::token>(cli),
+						tok2 = std::make_shared<mqtt::token>(cli);
+		tok1->add_parent(group);
+		tok2->add_parent(group);
+
+		MQTTAsync_failureData data = {
+				.token = 0,
+				.code = MQTTASYNC_FAILURE,
+				.message = nullptr,
+		};
+		token::on_failure(tok1.get(), &data);
+		CPPUNIT_ASSERT_EQUAL(false, group->is_complete());
+
+		token::on_success(tok2.get(), nullptr);
+		CPPUNIT_ASSERT_EQUAL(true, group->is_complete());
+
+		int reason_code = MQTTASYNC_SUCCESS;
+		try {
+			group->wait_for_completion(0);
+		}
+		catch (mqtt::exception& ex) {
+			reason_code = ex.get_reason_code();
+		}
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_FAILURE, reason_code);
+	}
+
+// ----------------------------------------------------------------------
+// Test the futures
+// ----------------------------------------------------------------------
+
+	void test_get_future() {
+		mqtt::token tok{ cli };
+		auto fut = tok.get_future();
+		CPPUNIT_ASSERT(fut.wait_for(std::chrono::seconds(0)) == std::future_status::timeout);
+
+		std::thread thr([&tok] {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			token::on_success(&tok, nullptr);
+		});
+		fut.get();
+		CPPUNIT_ASSERT_EQUAL(true, tok.is_complete());
+		thr.join();
+
+		// The same future every time
+		tok.get_future().get();
+	}
+
+	void test_get_future_failure() {
+		mqtt::token tok{ cli };
+		auto fut = tok.get_future();
+
+		MQTTAsync_failureData data = {
+				.token = 0,
+				.code = MQTTASYNC_FAILURE,
+				.message = nullptr,
+		};
+		token::on_failure(&tok, &data);
+
+		int reason_code = MQTTASYNC_SUCCESS;
+		try {
+			fut.get();
+		}
+		catch (mqtt::exception& ex) {
+			reason_code = ex.get_reason_code();
+		}
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_FAILURE, reason_code);
+	}
+
+	void test_get_future_after_complete() {
+		mqtt::token tok{ cli };
+		token::on_success(&tok, nullptr);
+
+		auto fut = tok.get_future();
+		CPPUNIT_ASSERT(fut.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+		fut.get();
+	}
+
+// ----------------------------------------------------------------------
+// Test the default implementations of the newer itoken calls
+// ----------------------------------------------------------------------
+
+	void test_itoken_defaults() {
+		user_token tok;
+		mqtt::itoken& itok = tok;
+
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_OPERATION_INCOMPLETE, itok.try_get_result());
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_OPERATION_INCOMPLETE, itok.try_wait_for_result(0));
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_OPERATION_INCOMPLETE, itok.try_wait_for_result(10));
+
+		tok.complete = true;
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, itok.try_get_result());
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_SUCCESS, itok.try_wait_for_result(-1));
+		itok.get_future().get();
+
+		tok.rc = MQTTASYNC_DISCONNECTED;
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_DISCONNECTED, itok.try_get_result());
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_DISCONNECTED, itok.try_wait_for_result(10));
+
+		int reason_code = MQTTASYNC_SUCCESS;
+		try {
+			itok.get_future().get();
+		}
+		catch (mqtt::exception& ex) {
+			reason_code = ex.get_reason_code();
+		}
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_DISCONNECTED, reason_code);
+	}
+
+// ----------------------------------------------------------------------
+// Test when_all() and when_any()
+// ----------------------------------------------------------------------
+
+	void test_when_all() {
+		const int N = 100;
+		std::vector<mqtt::itoken_ptr> toks;
+		for (int i=0; i<N; ++i)
+			toks.push_back(std::make_shared<mqtt::token>(cli));
+
+		// One is already done
+		token::on_success(dynamic_cast<mqtt::token*>(toks[0].get()), nullptr);
+
+		auto all = mqtt::when_all(toks);
+		auto fut = all->get_future();
+
+		std::thread thr([&toks] {
+			for (size_t i=1; i<toks.size(); ++i)
+				token::on_success(dynamic_cast<mqtt::token*>(toks[i].get()), nullptr);
+		});
+		fut.get();
+		CPPUNIT_ASSERT(all->is_complete());
+		for (const auto& tok : toks)
+			CPPUNIT_ASSERT(tok->is_complete());
+		thr.join();
+
+		// Works with delivery tokens too
+		std::vector<mqtt::idelivery_token_ptr> dtoks {
+			std::make_shared<mqtt::delivery_token>(cli)
+		};
+		auto dall = mqtt::when_all(dtoks.begin(), dtoks.end());
+		CPPUNIT_ASSERT(!dall->is_complete());
+		token::on_success(dynamic_cast<mqtt::token*>(dtoks[0].get()), nullptr);
+		CPPUNIT_ASSERT(dall->is_complete());
+	}
+
+	void test_when_any() {
+		mqtt::token_ptr tok1 = std::make_shared<mqtt::token>(cli),
+						tok2 = std::make_shared<mqtt::token>(cli);
+
+		auto any = mqtt::when_any({ tok1, tok2 });
+		CPPUNIT_ASSERT(!any->is_complete());
+
+		MQTTAsync_failureData data = {
+				.token = 0,
+				.code = MQTTASYNC_FAILURE,
+				.message = nullptr,
+		};
+		token::on_failure(tok2.get(), &data);
+		CPPUNIT_ASSERT(any->is_complete());
+
+		// Takes the result of the first one
+		int reason_code = MQTTASYNC_SUCCESS;
+		try {
+			any->get_future().get();
+		}
+		catch (mqtt::exception& ex) {
+			reason_code = ex.get_reason_code();
+		}
+		CPPUNIT_ASSERT_EQUAL(MQTTASYNC_FAILURE, reason_code);
+
+		token::on_success(tok1.get(), nullptr);
+	}
+
+	void test_when_empty() {
+		CPPUNIT_ASSERT(mqtt::when_all(std::vector<mqtt::itoken_ptr>())->is_complete());
+		CPPUNIT_ASSERT(mqtt::when_any(std::vector<mqtt::itoken_ptr>())->is_complete());
+	}
+
+// ----------------------------------------------------------------------
+// Test the continuations, which resume coroutines
+// ----------------------------------------------------------------------
+
+	void test_add_continuation() {
+		mqtt::token tok{ cli };
+		int n = 0;
+		CPPUNIT_ASSERT(tok.add_continuation([&n] { ++n; }));
+		CPPUNIT_ASSERT(tok.add_continuation([&n] { ++n; }));
+		CPPUNIT_ASSERT_EQUAL(0, n);
+
+		token::on_success(&tok, nullptr);
+		CPPUNIT_ASSERT_EQUAL(2, n);
+
+		// Too late
+		CPPUNIT_ASSERT(!tok.add_continuation([&n] { ++n; }));
+		CPPUNIT_ASSERT_EQUAL(2, n);
+	}
+
+#if defined(PAHO_MQTTPP_COROUTINES)
+	/** A coroutine that runs eagerly and can't be awaited */
+	struct task {
+		struct promise_type {
+			task get_return_object() { return {}; }
+			std::suspend_never initial_suspend() noexcept { return {}; }
+			std::suspend_never final_suspend() noexcept { return {}; }
+			void return_void() {}
+			void unhandled_exception() {}
+		};
+	};
+
+	task wait_for(mqtt::itoken_ptr tok, int* state) {
+		*state = 1;
+		try {
+			co_await tok;
+			*state = 2;
+		}
+		catch (const mqtt::exception& exc) {
+			*state = -exc.get_reason_code();
+		}
+	}
+
+	void test_co_await() {
+		auto tok = std::make_shared<mqtt::token>(cli);
+		int state = 0;
+
+		wait_for(tok, &state);
+		CPPUNIT_ASSERT_EQUAL(1, state);		// suspended
+
+		token::on_success(tok.get(), nullptr);
+		CPPUNIT_ASSERT_EQUAL(2, state);		// resumed
+
+		// An already-complete token doesn't suspend
+		state = 0;
+		wait_for(tok, &state);
+		CPPUNIT_ASSERT_EQUAL(2, state);
+
+		// A failure is thrown into the coroutine
+		tok = std::make_shared<mqtt::token>(cli);
+		wait_for(tok, &state);
+		MQTTAsync_failureData data = {
+				.token = 0,
+				.code = MQTTASYNC_FAILURE,
+				.message = nullptr,
+		};
+		token::on_failure(tok.get(), &data);
+		CPPUNIT_ASSERT_EQUAL(-MQTTASYNC_FAILURE, state);
+	}
+#endif
 };
 
 /////////////////////////////////////////////////////////////////////////////
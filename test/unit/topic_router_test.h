@@ -0,0 +1,308 @@
+// topic_router_test.h
+// Unit tests for the topic_router class in the Paho MQTT C++ library.
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_topic_router_test_h
+#define __mqtt_topic_router_test_h
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "mqtt/topic_router.h"
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+class topic_router_test : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( topic_router_test );
+
+	CPPUNIT_TEST( test_dflt_constructor );
+	CPPUNIT_TEST( test_valid_filter );
+	CPPUNIT_TEST( test_add_invalid );
+	CPPUNIT_TEST( test_literal );
+	CPPUNIT_TEST( test_single_level_wildcard );
+	CPPUNIT_TEST( test_multi_level_wildcard );
+	CPPUNIT_TEST( test_dollar_topics );
+	CPPUNIT_TEST( test_multiple_matches );
+	CPPUNIT_TEST( test_replace );
+	CPPUNIT_TEST( test_get_handler );
+	CPPUNIT_TEST( test_remove );
+	CPPUNIT_TEST( test_copy );
+	CPPUNIT_TEST( test_route );
+
+	CPPUNIT_TEST_SUITE_END();
+
+	/** Records the filters of the handlers that are called */
+	std::vector<std::string> hits_;
+
+	topic_router::handler make_handler(const std::string& filter) {
+		return [this, filter](const_message_ptr) { hits_.push_back(filter); };
+	}
+
+	/** Gets the sorted list of filters that match the topic */
+	std::vector<std::string> matches(const topic_router& router,
+									 const std::string& topic) {
+		hits_.clear();
+		auto msg = make_message("");
+		size_t n = router.match(topic, [&msg](const topic_router::handler& h) { h(msg); });
+		CPPUNIT_ASSERT_EQUAL(hits_.size(), n);
+		std::sort(hits_.begin(), hits_.end());
+		return hits_;
+	}
+
+	using strvec = std::vector<std::string>;
+
+public:
+	void setUp() {}
+	void tearDown() {}
+
+// ----------------------------------------------------------------------
+// Test the default constructor
+// ----------------------------------------------------------------------
+
+	void test_dflt_constructor() {
+		topic_router router;
+		CPPUNIT_ASSERT(router.empty());
+		CPPUNIT_ASSERT_EQUAL(size_t(0), router.size());
+		CPPUNIT_ASSERT(matches(router, "a/b").empty());
+	}
+
+// ----------------------------------------------------------------------
+// Test the filter validation
+// ----------------------------------------------------------------------
+
+	void test_valid_filter() {
+		CPPUNIT_ASSERT(topic_router::is_valid_filter("a"));
+		CPPUNIT_ASSERT(topic_router::is_valid_filter("a/b/c"));
+		CPPUNIT_ASSERT(topic_router::is_valid_filter("+"));
+		CPPUNIT_ASSERT(topic_router::is_valid_filter("#"));
+		CPPUNIT_ASSERT(topic_router::is_valid_filter("a/+/c"));
+		CPPUNIT_ASSERT(topic_router::is_valid_filter("+/+/#"));
+		CPPUNIT_ASSERT(topic_router::is_valid_filter("/"));
+
+		CPPUNIT_ASSERT(!topic_router::is_valid_filter(""));
+		CPPUNIT_ASSERT(!topic_router::is_valid_filter("a+"));
+		CPPUNIT_ASSERT(!topic_router::is_valid_filter("a/+b"));
+		CPPUNIT_ASSERT(!topic_router::is_valid_filter("a/b#"));
+		CPPUNIT_ASSERT(!topic_router::is_valid_filter("a/#/c"));
+		CPPUNIT_ASSERT(!topic_router::is_valid_filter("##"));
+	}
+
+	void test_add_invalid() {
+		topic_router router;
+		try {
+			router.add("a/#/c", make_handler("x"));
+			CPPUNIT_FAIL("router shouldn't accept an invalid filter");
+		}
+		catch (std::invalid_argument& ex) {}
+
+		try {
+			router.add("a/b", topic_router::handler());
+			CPPUNIT_FAIL("router shouldn't accept an empty handler");
+		}
+		catch (std::invalid_argument& ex) {}
+		CPPUNIT_ASSERT(router.empty());
+	}
+
+// ----------------------------------------------------------------------
+// Test matching
+// ----------------------------------------------------------------------
+
+	void test_literal() {
+		topic_router router;
+		router.add("a/b", make_handler("a/b"));
+		router.add("a/b/c", make_handler("a/b/c"));
+		router.add("/a", make_handler("/a"));
+		CPPUNIT_ASSERT_EQUAL(size_t(3), router.size());
+
+		CPPUNIT_ASSERT(matches(router, "a/b") == strvec{ "a/b" });
+		CPPUNIT_ASSERT(matches(router, "a/b/c") == strvec{ "a/b/c" });
+		CPPUNIT_ASSERT(matches(router, "/a") == strvec{ "/a" });
+		CPPUNIT_ASSERT(matches(router, "a").empty());
+		CPPUNIT_ASSERT(matches(router, "a/b/").empty());
+		CPPUNIT_ASSERT(matches(router, "a/bc").empty());
+		CPPUNIT_ASSERT(matches(router, "x/y").empty());
+	}
+
+	void test_single_level_wildcard() {
+		topic_router router;
+		router.add("a/+/c", make_handler("a/+/c"));
+		router.add("+", make_handler("+"));
+
+		CPPUNIT_ASSERT(matches(router, "a/b/c") == strvec{ "a/+/c" });
+		CPPUNIT_ASSERT(matches(router, "a/xyz/c") == strvec{ "a/+/c" });
+		CPPUNIT_ASSERT(matches(router, "a//c") == strvec{ "a/+/c" });
+		CPPUNIT_ASSERT(matches(router, "a/b/c/d").empty());
+		CPPUNIT_ASSERT(matches(router, "a/c").empty());
+
+		CPPUNIT_ASSERT(matches(router, "a") == strvec{ "+" });
+		CPPUNIT_ASSERT(matches(router, "a/b").empty());
+		CPPUNIT_ASSERT(matches(router, "/a").empty());
+	}
+
+	void test_multi_level_wildcard() {
+		topic_router router;
+		router.add("a/#", make_handler("a/#"));
+
+		CPPUNIT_ASSERT(matches(router, "a") == strvec{ "a/#" });
+		CPPUNIT_ASSERT(matches(router, "a/b") == strvec{ "a/#" });
+		CPPUNIT_ASSERT(matches(router, "a/b/c/d") == strvec{ "a/#" });
+		CPPUNIT_ASSERT(matches(router, "b/a").empty());
+
+		router.add("#", make_handler("#"));
+		CPPUNIT_ASSERT(matches(router, "b/a") == strvec{ "#" });
+		CPPUNIT_ASSERT((matches(router, "a/b") == strvec{ "#", "a/#" }));
+	}
+
+	void test_dollar_topics() {
+		topic_router router;
+		router.add("#", make_handler("#"));
+		router.add("+/info", make_handler("+/info"));
+		router.add("$SYS/#", make_handler("$SYS/#"));
+		router.add("$SYS/+", make_handler("$SYS/+"));
+
+		// A leading wildcard doesn't match a '$' topic
+		CPPUNIT_ASSERT((matches(router, "$SYS/info") == strvec{ "$SYS/#", "$SYS/+" }));
+		CPPUNIT_ASSERT((matches(router, "sys/info") == strvec{ "#", "+/info" }));
+
+		// ...but only at the start
+		router.add("a/+", make_handler("a/+"));
+		CPPUNIT_ASSERT((matches(router, "a/$x") == strvec{ "#", "a/+" }));
+	}
+
+	void test_multiple_matches() {
+		topic_router router;
+		for (const auto& filt : strvec{ "a/b/c", "a/+/c", "+/b/+", "a/#", "+/+/+", "#", "a/b" })
+			router.add(filt, make_handler(filt));
+
+		strvec expected { "#", "+/+/+", "+/b/+", "a/#", "a/+/c", "a/b/c" };
+		CPPUNIT_ASSERT(matches(router, "a/b/c") == expected);
+	}
+
+// ----------------------------------------------------------------------
+// Test changing the routes
+// ----------------------------------------------------------------------
+
+	void test_replace() {
+		topic_router router;
+		router.add("a/+", make_handler("first"));
+		router.add("a/+", make_handler("second"));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), router.size());
+		CPPUNIT_ASSERT(matches(router, "a/b") == strvec{ "second" });
+	}
+
+	void test_get_handler() {
+		topic_router router;
+		router.add("a/+", make_handler("a/+"));
+		router.add("a/b/c", make_handler("a/b/c"));
+
+		hits_.clear();
+		auto h = router.get_handler("a/+");
+		CPPUNIT_ASSERT(bool(h));
+		h(make_message(""));
+		CPPUNIT_ASSERT(hits_ == strvec{ "a/+" });
+
+		// An interior node, a missing filter, and an invalid one
+		CPPUNIT_ASSERT(!router.get_handler("a/b"));
+		CPPUNIT_ASSERT(!router.get_handler("x"));
+		CPPUNIT_ASSERT(!router.get_handler("a/#/c"));
+	}
+
+	void test_remove() {
+		topic_router router;
+		router.add("a/b/c", make_handler("a/b/c"));
+		router.add("a/b", make_handler("a/b"));
+		router.add("a/+/#", make_handler("a/+/#"));
+
+		CPPUNIT_ASSERT(router.contains("a/b"));
+		CPPUNIT_ASSERT(!router.contains("a"));
+		CPPUNIT_ASSERT(!router.remove("a"));
+		CPPUNIT_ASSERT(!router.remove("x/y/z"));
+
+		CPPUNIT_ASSERT(router.remove("a/b"));
+		CPPUNIT_ASSERT(!router.contains("a/b"));
+		CPPUNIT_ASSERT_EQUAL(size_t(2), router.size());
+		CPPUNIT_ASSERT(matches(router, "a/b") == strvec{ "a/+/#" });
+		CPPUNIT_ASSERT((matches(router, "a/b/c") == strvec{ "a/+/#", "a/b/c" }));
+
+		CPPUNIT_ASSERT(router.remove("a/b/c"));
+		CPPUNIT_ASSERT(router.remove("a/+/#"));
+		CPPUNIT_ASSERT(router.empty());
+		CPPUNIT_ASSERT(matches(router, "a/b/c").empty());
+
+		// The pruned nodes get reused
+		router.add("a/b/c", make_handler("a/b/c"));
+		CPPUNIT_ASSERT(matches(router, "a/b/c") == strvec{ "a/b/c" });
+
+		router.clear();
+		CPPUNIT_ASSERT(router.empty());
+		CPPUNIT_ASSERT(matches(router, "a/b/c").empty());
+	}
+
+	void test_copy() {
+		topic_router router;
+		router.add("a/b", make_handler("a/b"));
+
+		topic_router copy(router);
+		router.clear();
+		router.add("x", make_handler("x"));
+
+		CPPUNIT_ASSERT(matches(copy, "a/b") == strvec{ "a/b" });
+		copy.add("a/c", make_handler("a/c"));
+		CPPUNIT_ASSERT(matches(copy, "a/c") == strvec{ "a/c" });
+
+		router = copy;
+		CPPUNIT_ASSERT_EQUAL(size_t(2), router.size());
+		CPPUNIT_ASSERT(matches(router, "x").empty());
+		CPPUNIT_ASSERT(matches(router, "a/b") == strvec{ "a/b" });
+	}
+
+// ----------------------------------------------------------------------
+// Test routing a message
+// ----------------------------------------------------------------------
+
+	void test_route() {
+		topic_router router;
+		const_message_ptr got;
+		router.add("a/+", [&got](const_message_ptr msg) { got = msg; });
+
+		auto msg = make_message("hello");
+		msg->set_topic("a/b");
+		CPPUNIT_ASSERT_EQUAL(size_t(1), router.route(msg));
+		CPPUNIT_ASSERT(got == msg);
+
+		msg->set_topic("b/a");
+		got.reset();
+		CPPUNIT_ASSERT_EQUAL(size_t(0), router.route(msg));
+		CPPUNIT_ASSERT(!got);
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		//  __mqtt_topic_router_test_h
+
@@ -38,6 +38,7 @@ class topic_test : public CppUnit::TestFixture
 	CPPUNIT_TEST_SUITE( topic_test );
 
 	CPPUNIT_TEST( test_user_constructor );
+	CPPUNIT_TEST( test_invalid_name );
 	CPPUNIT_TEST( test_publish_1_arg );
 	CPPUNIT_TEST( test_publish_3_arg );
 	CPPUNIT_TEST( test_publish_4_arg );
@@ -64,6 +65,28 @@ public:
 		CPPUNIT_ASSERT_EQUAL(TOPIC_NAME, topic.to_str());
 	}
 
+// ----------------------------------------------------------------------
+// Test that the name is validated when the topic is made
+// ----------------------------------------------------------------------
+
+	void test_invalid_name() {
+		CPPUNIT_ASSERT(mqtt::topic::is_valid_name("a/b/c"));
+		CPPUNIT_ASSERT(mqtt::topic::is_valid_name("/"));
+		CPPUNIT_ASSERT(!mqtt::topic::is_valid_name(""));
+		CPPUNIT_ASSERT(!mqtt::topic::is_valid_name("a/+/c"));
+		CPPUNIT_ASSERT(!mqtt::topic::is_valid_name("a/#"));
+		CPPUNIT_ASSERT(!mqtt::topic::is_valid_name(std::string("a\0b", 3)));
+		CPPUNIT_ASSERT(!mqtt::topic::is_valid_name(std::string(65536, 'a')));
+
+		try {
+			mqtt::topic topic{ "sensors/+", cli };
+			CPPUNIT_FAIL("topic shouldn't accept a wildcard");
+		}
+		catch (const mqtt::exception& ex) {
+			CPPUNIT_ASSERT_EQUAL(MQTTASYNC_BAD_UTF8_STRING, ex.get_reason_code());
+		}
+	}
+
 // ----------------------------------------------------------------------
 // Test publish with one argument
 // ----------------------------------------------------------------------
@@ -0,0 +1,212 @@
+// trace_test.h
+// Unit tests for the tracing classes in the Paho MQTT C++ library.
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_trace_test_h
+#define __mqtt_trace_test_h
+
+#include <string>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "mqtt/trace.h"
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+class trace_test : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( trace_test );
+
+	CPPUNIT_TEST( test_event_name );
+	CPPUNIT_TEST( test_tracer_sink );
+	CPPUNIT_TEST( test_buffer_capacity );
+	CPPUNIT_TEST( test_buffer_record );
+	CPPUNIT_TEST( test_buffer_wrap );
+	CPPUNIT_TEST( test_buffer_threads );
+	CPPUNIT_TEST( test_chrome_trace );
+	CPPUNIT_TEST( test_chrome_trace_orphans );
+
+	CPPUNIT_TEST_SUITE_END();
+
+	// Some objects to trace
+	int a_, b_;
+
+	static size_t count(const std::string& s, const std::string& sub) {
+		size_t n = 0;
+		for (auto pos = s.find(sub); pos != std::string::npos; pos = s.find(sub, pos+1))
+			++n;
+		return n;
+	}
+
+public:
+	void setUp() {}
+	void tearDown() {
+		tracer::set_sink(nullptr);
+	}
+
+	void test_event_name() {
+		CPPUNIT_ASSERT_EQUAL(std::string("publish_begin"),
+							 std::string(trace_event_name(trace_event::PUBLISH_BEGIN)));
+		CPPUNIT_ASSERT_EQUAL(std::string("receive_complete"),
+							 std::string(trace_event_name(trace_event::RECEIVE_COMPLETE)));
+	}
+
+	void test_tracer_sink() {
+		trace_buffer buf(8);
+		CPPUNIT_ASSERT(!tracer::get_sink());
+
+		// Nobody's listening
+		tracer::point(trace_event::PUBLISH_BEGIN, &a_);
+
+		tracer::set_sink(&buf);
+		CPPUNIT_ASSERT_EQUAL(static_cast<trace_sink*>(&buf), tracer::get_sink());
+		tracer::point(trace_event::PUBLISH_SENT, &a_);
+
+		tracer::set_sink(nullptr);
+		tracer::point(trace_event::TOKEN_COMPLETE, &a_);
+
+		auto recs = buf.snapshot();
+		CPPUNIT_ASSERT_EQUAL(size_t(1), recs.size());
+		CPPUNIT_ASSERT(trace_event::PUBLISH_SENT == recs[0].evt);
+	}
+
+	void test_buffer_capacity() {
+		CPPUNIT_ASSERT_EQUAL(trace_buffer::DFLT_CAPACITY, trace_buffer().capacity());
+		CPPUNIT_ASSERT_EQUAL(size_t(8), trace_buffer(8).capacity());
+		CPPUNIT_ASSERT_EQUAL(size_t(16), trace_buffer(9).capacity());
+		CPPUNIT_ASSERT_EQUAL(size_t(1), trace_buffer(0).capacity());
+	}
+
+	void test_buffer_record() {
+		trace_buffer buf(8);
+		CPPUNIT_ASSERT(buf.snapshot().empty());
+
+		buf.on_trace(trace_event::PUBLISH_BEGIN, &a_);
+		buf.on_trace(trace_event::RECEIVE_BEGIN, &b_);
+
+		auto recs = buf.snapshot();
+		CPPUNIT_ASSERT_EQUAL(size_t(2), recs.size());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(2), buf.total());
+
+		CPPUNIT_ASSERT(trace_event::PUBLISH_BEGIN == recs[0].evt);
+		CPPUNIT_ASSERT_EQUAL(static_cast<const void*>(&a_), recs[0].id);
+		CPPUNIT_ASSERT(trace_event::RECEIVE_BEGIN == recs[1].evt);
+		CPPUNIT_ASSERT_EQUAL(static_cast<const void*>(&b_), recs[1].id);
+
+		CPPUNIT_ASSERT(recs[0].ns <= recs[1].ns);
+		CPPUNIT_ASSERT_EQUAL(recs[0].thread, recs[1].thread);
+	}
+
+	void test_buffer_wrap() {
+		trace_buffer buf(4);
+		for (int i=0; i<10; ++i)
+			buf.on_trace(trace_event(i % 8), &a_);
+
+		auto recs = buf.snapshot();
+		CPPUNIT_ASSERT_EQUAL(size_t(4), recs.size());
+		CPPUNIT_ASSERT_EQUAL(uint64_t(10), buf.total());
+
+		// The newest are kept, oldest first
+		for (int i=0; i<4; ++i)
+			CPPUNIT_ASSERT(trace_event((6+i) % 8) == recs[i].evt);
+	}
+
+	void test_buffer_threads() {
+		const int N_THR = 4, N = 1000;
+		trace_buffer buf(N_THR*N);
+
+		std::vector<std::thread> thrs;
+		for (int i=0; i<N_THR; ++i) {
+			thrs.emplace_back([this, &buf] {
+				for (int j=0; j<N; ++j)
+					buf.on_trace(trace_event::TOKEN_ACKED, &a_);
+			});
+		}
+		for (auto& thr : thrs)
+			thr.join();
+
+		auto recs = buf.snapshot();
+		CPPUNIT_ASSERT_EQUAL(size_t(N_THR*N), recs.size());
+		for (const auto& rec : recs) {
+			CPPUNIT_ASSERT(trace_event::TOKEN_ACKED == rec.evt);
+			CPPUNIT_ASSERT_EQUAL(static_cast<const void*>(&a_), rec.id);
+		}
+	}
+
+	void test_chrome_trace() {
+		trace_buffer buf(16);
+		buf.on_trace(trace_event::PUBLISH_BEGIN, &a_);
+		buf.on_trace(trace_event::PUBLISH_SENT, &a_);
+		buf.on_trace(trace_event::TOKEN_ACKED, &a_);
+		buf.on_trace(trace_event::TOKEN_COMPLETE, &a_);
+
+		std::ostringstream os;
+		write_chrome_trace(os, buf.snapshot());
+		std::string s = os.str();
+
+		CPPUNIT_ASSERT_EQUAL(size_t(0), s.find("{\"traceEvents\":["));
+		CPPUNIT_ASSERT_EQUAL(size_t(4), count(s, "\"cat\":\"publish\""));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), count(s, "\"ph\":\"b\""));
+		CPPUNIT_ASSERT_EQUAL(size_t(2), count(s, "\"ph\":\"n\""));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), count(s, "\"ph\":\"e\""));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), count(s, "\"name\":\"publish_sent\""));
+		CPPUNIT_ASSERT(count(s, "\"ts\":0.000") >= 1);
+		CPPUNIT_ASSERT(s.find("],\"displayTimeUnit\":\"ns\"}") != std::string::npos);
+
+		// Empty
+		std::ostringstream os2;
+		write_chrome_trace(os2, std::vector<trace_record>());
+		CPPUNIT_ASSERT_EQUAL(std::string("{\"traceEvents\":[\n],\"displayTimeUnit\":\"ns\"}\n"),
+							 os2.str());
+	}
+
+	void test_chrome_trace_orphans() {
+		trace_buffer buf(16);
+
+		// A token that wasn't for a publish
+		buf.on_trace(trace_event::TOKEN_ACKED, &a_);
+		buf.on_trace(trace_event::TOKEN_COMPLETE, &a_);
+
+		buf.on_trace(trace_event::RECEIVE_BEGIN, &b_);
+		buf.on_trace(trace_event::RECEIVE_COMPLETE, &b_);
+
+		// After its span ended
+		buf.on_trace(trace_event::RECEIVE_MESSAGE, &b_);
+
+		std::ostringstream os;
+		write_chrome_trace(os, buf.snapshot());
+		std::string s = os.str();
+
+		CPPUNIT_ASSERT_EQUAL(size_t(0), count(s, "\"cat\":\"publish\""));
+		CPPUNIT_ASSERT_EQUAL(size_t(2), count(s, "\"cat\":\"receive\""));
+		CPPUNIT_ASSERT_EQUAL(size_t(2), count(s, "\"name\":\"receive\""));
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		//  __mqtt_trace_test_h
+
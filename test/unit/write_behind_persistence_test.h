@@ -0,0 +1,422 @@
+// write_behind_persistence_test.h
+// Unit tests for the write_behind_persistence class in the Paho MQTT C++ library.
+
+/*******************************************************************************
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v1.0 which accompany this distribution.
+ *
+ * The Eclipse Public License is available at
+ *    http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ *   http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * Contributors:
+ *    agent - initial implementation and documentation
+ *******************************************************************************/
+
+#ifndef __mqtt_write_behind_persistence_test_h
+#define __mqtt_write_behind_persistence_test_h
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <chrono>
+
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "mqtt/write_behind_persistence.h"
+#include "mqtt/exception.h"
+
+namespace mqtt {
+
+/////////////////////////////////////////////////////////////////////////////
+
+class write_behind_persistence_test : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( write_behind_persistence_test );
+
+	CPPUNIT_TEST( test_put_get );
+	CPPUNIT_TEST( test_sync );
+	CPPUNIT_TEST( test_coalesce );
+	CPPUNIT_TEST( test_remove_stored );
+	CPPUNIT_TEST( test_sync_records );
+	CPPUNIT_TEST( test_sync_interval );
+	CPPUNIT_TEST( test_open_close );
+	CPPUNIT_TEST( test_clear );
+	CPPUNIT_TEST( test_max_pending );
+	CPPUNIT_TEST( test_failure );
+
+	CPPUNIT_TEST_SUITE_END();
+
+	/** A backing store that keeps a log of the calls into it */
+	class recording_persistence : public iclient_persistence
+	{
+		mutable std::mutex lock_;
+		std::map<std::string, std::string> data_;
+		std::vector<std::string> log_;
+		bool fail_;
+
+	public:
+		recording_persistence() : fail_(false) {}
+
+		void open(const std::string&, const std::string&) override {
+			std::lock_guard<std::mutex> g(lock_);
+			log_.push_back("open");
+		}
+		void close() override {
+			std::lock_guard<std::mutex> g(lock_);
+			log_.push_back("close");
+		}
+		void clear() override {
+			std::lock_guard<std::mutex> g(lock_);
+			data_.clear();
+			log_.push_back("clear");
+		}
+		bool contains_key(const std::string& key) override {
+			std::lock_guard<std::mutex> g(lock_);
+			return data_.count(key) != 0;
+		}
+		ipersistable_ptr get(const std::string& key) const override {
+			std::lock_guard<std::mutex> g(lock_);
+			auto it = data_.find(key);
+			if (it == data_.end())
+				throw persistence_exception();
+			return make_data(it->second);
+		}
+		std::vector<std::string> keys() const override {
+			std::lock_guard<std::mutex> g(lock_);
+			std::vector<std::string> v;
+			for (const auto& d : data_)
+				v.push_back(d.first);
+			return v;
+		}
+		void put(const std::string& key, ipersistable_ptr p) override {
+			std::lock_guard<std::mutex> g(lock_);
+			if (fail_)
+				throw persistence_exception();
+			data_[key] = to_string(p);
+			log_.push_back("put " + key);
+		}
+		void remove(const std::string& key) override {
+			std::lock_guard<std::mutex> g(lock_);
+			data_.erase(key);
+			log_.push_back("remove " + key);
+		}
+		void sync() override {
+			std::lock_guard<std::mutex> g(lock_);
+			log_.push_back("sync");
+		}
+
+		void set_fail(bool on) {
+			std::lock_guard<std::mutex> g(lock_);
+			fail_ = on;
+		}
+		size_t size() const {
+			std::lock_guard<std::mutex> g(lock_);
+			return data_.size();
+		}
+		std::vector<std::string> log() const {
+			std::lock_guard<std::mutex> g(lock_);
+			return log_;
+		}
+		size_t count(const std::string& entry) const {
+			std::lock_guard<std::mutex> g(lock_);
+			return std::count(log_.begin(), log_.end(), entry);
+		}
+		void clear_log() {
+			std::lock_guard<std::mutex> g(lock_);
+			log_.clear();
+		}
+	};
+
+	static ipersistable_ptr make_data(const std::string& s) {
+		return std::make_shared<persistable_buffer>(
+					reinterpret_cast<const byte*>(s.data()), s.size());
+	}
+
+	static std::string to_string(ipersistable_ptr p) {
+		std::string s;
+		if (p->get_header_bytes())
+			s.append(reinterpret_cast<const char*>(p->get_header_bytes()),
+					 p->get_header_length());
+		if (p->get_payload_bytes())
+			s.append(reinterpret_cast<const char*>(p->get_payload_bytes()),
+					 p->get_payload_length());
+		return s;
+	}
+
+	/** Waits up to a second for the condition to be true */
+	template <typename Pred>
+	static bool wait_for(Pred pred) {
+		for (int i=0; i<1000 && !pred(); ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		return pred();
+	}
+
+	using strvec = std::vector<std::string>;
+
+	// The changes are only written when the test asks
+	const std::chrono::milliseconds FOREVER { std::chrono::hours(1) };
+
+public:
+	void setUp() {}
+	void tearDown() {}
+
+// ----------------------------------------------------------------------
+// Test that the changes are seen before they're written
+// ----------------------------------------------------------------------
+
+	void test_put_get() {
+		recording_persistence rec;
+		write_behind_persistence per(rec);
+		per.set_sync_interval(FOREVER);
+		per.set_sync_records(0);
+		per.open("client", "tcp://localhost:1883");
+
+		per.put("s-1", make_data("one"));
+		per.put("s-2", make_data("two"));
+
+		CPPUNIT_ASSERT_EQUAL(size_t(2), per.pending());
+		CPPUNIT_ASSERT_EQUAL(size_t(0), rec.size());
+
+		CPPUNIT_ASSERT(per.contains_key("s-1"));
+		CPPUNIT_ASSERT(!per.contains_key("s-3"));
+		auto v = per.keys();
+		std::sort(v.begin(), v.end());
+		CPPUNIT_ASSERT((v == strvec{ "s-1", "s-2" }));
+		CPPUNIT_ASSERT_EQUAL(std::string("one"), to_string(per.get("s-1")));
+
+		per.remove("s-2");
+		try {
+			per.get("s-2");
+			CPPUNIT_FAIL("get() of a removed key should throw");
+		}
+		catch (const persistence_exception&) {}
+
+		per.close();
+	}
+
+	void test_sync() {
+		recording_persistence rec;
+		write_behind_persistence per(rec);
+		per.set_sync_interval(FOREVER);
+		per.set_sync_records(0);
+		per.open("client", "tcp://localhost:1883");
+		rec.clear_log();
+
+		per.put("s-1", make_data("one"));
+		per.sync();
+
+		CPPUNIT_ASSERT_EQUAL(size_t(0), per.pending());
+		CPPUNIT_ASSERT((rec.log() == strvec{ "put s-1", "sync" }));
+
+		// Now it comes from the backing store
+		CPPUNIT_ASSERT_EQUAL(std::string("one"), to_string(per.get("s-1")));
+		per.close();
+	}
+
+// ----------------------------------------------------------------------
+// Test that the changes are combined
+// ----------------------------------------------------------------------
+
+	void test_coalesce() {
+		recording_persistence rec;
+		write_behind_persistence per(rec);
+		per.set_sync_interval(FOREVER);
+		per.set_sync_records(0);
+		per.open("client", "tcp://localhost:1883");
+		rec.clear_log();
+
+		// Acked before it was written
+		per.put("s-1", make_data("one"));
+		per.remove("s-1");
+		CPPUNIT_ASSERT_EQUAL(size_t(0), per.pending());
+
+		// Only the last put counts
+		per.put("s-2", make_data("first"));
+		per.put("s-2", make_data("second"));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), per.pending());
+
+		per.sync();
+		CPPUNIT_ASSERT((rec.log() == strvec{ "put s-2", "sync" }));
+		CPPUNIT_ASSERT_EQUAL(std::string("second"), to_string(rec.get("s-2")));
+		per.close();
+	}
+
+	void test_remove_stored() {
+		recording_persistence rec;
+		write_behind_persistence per(rec);
+		per.set_sync_interval(FOREVER);
+		per.set_sync_records(0);
+		per.open("client", "tcp://localhost:1883");
+
+		per.put("s-1", make_data("one"));
+		per.sync();
+		rec.clear_log();
+
+		// A put and remove of a key that's in the backing store still
+		// has to remove it from there.
+		per.put("s-1", make_data("again"));
+		per.remove("s-1");
+		per.remove("s-9");		// not there; does nothing
+		per.sync();
+
+		CPPUNIT_ASSERT((rec.log() == strvec{ "remove s-1", "sync" }));
+		CPPUNIT_ASSERT(!per.contains_key("s-1"));
+		per.close();
+	}
+
+// ----------------------------------------------------------------------
+// Test the durability windows
+// ----------------------------------------------------------------------
+
+	void test_sync_records() {
+		recording_persistence rec;
+		write_behind_persistence per(rec);
+		per.set_sync_interval(FOREVER);
+		per.set_sync_records(10);
+		per.open("client", "tcp://localhost:1883");
+
+		for (int i=0; i<9; ++i)
+			per.put("s-" + std::to_string(i), make_data("x"));
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		CPPUNIT_ASSERT_EQUAL(size_t(0), rec.size());
+
+		per.put("s-9", make_data("x"));
+		CPPUNIT_ASSERT(wait_for([&]{ return rec.size() == 10; }));
+		CPPUNIT_ASSERT(wait_for([&]{ return rec.count("sync") == 1; }));
+		per.close();
+	}
+
+	void test_sync_interval() {
+		recording_persistence rec;
+		write_behind_persistence per(rec);
+		per.set_sync_interval(std::chrono::milliseconds(5));
+		per.set_sync_records(0);
+		per.open("client", "tcp://localhost:1883");
+
+		per.put("s-1", make_data("one"));
+		CPPUNIT_ASSERT(wait_for([&]{ return rec.count("sync") == 1; }));
+		CPPUNIT_ASSERT_EQUAL(size_t(1), rec.size());
+		per.close();
+	}
+
+// ----------------------------------------------------------------------
+// Test opening, closing, and clearing the store
+// ----------------------------------------------------------------------
+
+	void test_open_close() {
+		recording_persistence rec;
+		rec.put("s-1", make_data("one"));
+
+		{
+			write_behind_persistence per(rec);
+			per.set_sync_interval(FOREVER);
+			per.set_sync_records(0);
+
+			// The keys in the backing store are loaded
+			per.open("client", "tcp://localhost:1883");
+			CPPUNIT_ASSERT(per.contains_key("s-1"));
+
+			per.put("s-2", make_data("two"));
+			rec.clear_log();
+
+			// Closing writes out the pending changes first
+			per.close();
+			CPPUNIT_ASSERT((rec.log() == strvec{ "put s-2", "sync", "close" }));
+
+			per.open("client", "tcp://localhost:1883");
+			per.put("s-3", make_data("three"));
+		}
+
+		// ...and so does the destructor
+		CPPUNIT_ASSERT_EQUAL(size_t(3), rec.size());
+	}
+
+	void test_clear() {
+		recording_persistence rec;
+		write_behind_persistence per(rec);
+		per.set_sync_interval(FOREVER);
+		per.set_sync_records(0);
+		per.open("client", "tcp://localhost:1883");
+
+		per.put("s-1", make_data("one"));
+		per.sync();
+		per.put("s-2", make_data("two"));
+
+		per.clear();
+		CPPUNIT_ASSERT(per.keys().empty());
+		CPPUNIT_ASSERT_EQUAL(size_t(0), per.pending());
+		CPPUNIT_ASSERT_EQUAL(size_t(0), rec.size());
+		CPPUNIT_ASSERT_EQUAL(size_t(0), rec.count("put s-2"));
+		per.close();
+	}
+
+	void test_max_pending() {
+		recording_persistence rec;
+		write_behind_persistence per(rec);
+		per.set_sync_interval(FOREVER);
+		per.set_sync_records(0);
+		per.set_max_pending(4);
+		per.open("client", "tcp://localhost:1883");
+
+		// The puts past the limit wait for the thread to write the batch
+		for (int i=0; i<100; ++i)
+			per.put("s-" + std::to_string(i), make_data("x"));
+
+		CPPUNIT_ASSERT(per.pending() <= 8);
+		per.close();
+		CPPUNIT_ASSERT_EQUAL(size_t(100), rec.size());
+	}
+
+// ----------------------------------------------------------------------
+// Test a failure of the backing store
+// ----------------------------------------------------------------------
+
+	void test_failure() {
+		recording_persistence rec;
+		write_behind_persistence per(rec);
+		per.set_sync_interval(FOREVER);
+		per.set_sync_records(0);
+		per.open("client", "tcp://localhost:1883");
+
+		rec.set_fail(true);
+		per.put("s-1", make_data("one"));
+
+		try {
+			per.sync();
+			CPPUNIT_FAIL("sync() should report the failure");
+		}
+		catch (const persistence_exception&) {}
+
+		try {
+			per.put("s-2", make_data("two"));
+			CPPUNIT_FAIL("put() after a failure should throw");
+		}
+		catch (const persistence_exception&) {}
+
+		// Opening again starts over
+		rec.set_fail(false);
+		per.close();
+		per.open("client", "tcp://localhost:1883");
+		per.put("s-2", make_data("two"));
+		per.sync();
+		CPPUNIT_ASSERT(rec.contains_key("s-2"));
+		per.close();
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// end namespace mqtt
+}
+
+#endif		//  __mqtt_write_behind_persistence_test_h
+